@@ -41,6 +41,10 @@
  * SOFTWARE.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "atoms.h"
 #include <string.h>
 #include <glib.h>
@@ -49,6 +53,27 @@
 #include <gst/base/gstbytewriter.h>
 #include <gst/tag/tag.h>
 
+typedef struct _AtomsJournalSplice
+{
+  guint64 atom_offset;          /* of the table atom in the moov */
+  guint64 offset;               /* of the entries from the journal */
+  AtomJournalBlocks *jb;
+  guint entry_size;             /* in the journal */
+  AtomSTCO64 *stco64;           /* for chunk offsets, which are converted */
+} AtomsJournalSplice;
+
+struct _AtomsJournal
+{
+  FILE *file;
+  guint64 size;                 /* bytes written to the file */
+  gboolean failed;              /* the entries are kept in memory from now on */
+  gboolean reading;
+
+  /* the entries that atoms_journal_write_moov() left out of the moov */
+  gboolean splicing;
+  ATOM_ARRAY (AtomsJournalSplice) splices;
+};
+
 /**
  * Creates a new AtomsContext for the given flavor.
  */
@@ -567,6 +592,299 @@ atom_stsd_clear (AtomSTSD * stsd)
   atom_full_clear (&stsd->header);
 }
 
+/* -- sample table journal -- */
+
+/**
+ * Creates a new AtomsJournal that writes to @file. The file is not closed by
+ * atoms_journal_free().
+ */
+AtomsJournal *
+atoms_journal_new (FILE * file)
+{
+  AtomsJournal *journal = g_new0 (AtomsJournal, 1);
+
+  journal->file = file;
+  atom_array_init (&journal->splices, 16);
+  return journal;
+}
+
+void
+atoms_journal_free (AtomsJournal * journal)
+{
+  atom_array_clear (&journal->splices);
+  g_free (journal);
+}
+
+static gboolean
+atoms_journal_seek (AtomsJournal * journal, guint64 offset)
+{
+#ifdef HAVE_FSEEKO
+  return fseeko (journal->file, (off_t) offset, SEEK_SET) == 0;
+#else
+  return fseek (journal->file, (long) offset, SEEK_SET) == 0;
+#endif
+}
+
+static void
+atom_journal_blocks_init (AtomJournalBlocks * jb)
+{
+  jb->journal = NULL;
+  jb->blocks.size = jb->blocks.len = 0;
+  jb->blocks.data = NULL;
+}
+
+static void
+atom_journal_blocks_clear (AtomJournalBlocks * jb)
+{
+  jb->journal = NULL;
+  atom_array_clear (&jb->blocks);
+}
+
+/* if a table with @len entries in memory should write a block of them */
+static gboolean
+atom_journal_blocks_is_full (AtomJournalBlocks * jb, guint len)
+{
+  return jb->journal && !jb->journal->failed &&
+      len >= ATOMS_JOURNAL_BLOCK_ENTRIES;
+}
+
+/* appends a block of serialized entries to the journal, the entries have to
+ * stay in memory if that fails */
+static gboolean
+atom_journal_blocks_write (AtomJournalBlocks * jb, const guint8 * data,
+    guint64 size)
+{
+  AtomsJournal *journal = jb->journal;
+
+  if (journal->reading) {
+    if (!atoms_journal_seek (journal, journal->size))
+      goto write_failed;
+    journal->reading = FALSE;
+  }
+  if (fwrite (data, 1, size, journal->file) != size)
+    goto write_failed;
+
+  if (jb->blocks.data == NULL)
+    atom_array_init (&jb->blocks, 16);
+  atom_array_append (&jb->blocks, journal->size, 64);
+  journal->size += size;
+  return TRUE;
+
+write_failed:
+  {
+    GST_WARNING ("Failed to write to the sample table journal, keeping the "
+        "sample tables in memory");
+    journal->failed = TRUE;
+    return FALSE;
+  }
+}
+
+static gboolean
+atom_journal_blocks_write_uint32 (AtomJournalBlocks * jb, guint32 * entries)
+{
+  guint8 *data = NULL;
+  guint64 size = 0, offset = 0;
+  gboolean ret;
+
+  prop_copy_uint32_array (entries, ATOMS_JOURNAL_BLOCK_ENTRIES, &data, &size,
+      &offset);
+  ret = atom_journal_blocks_write (jb, data, offset);
+  g_free (data);
+  return ret;
+}
+
+/* bytes of an entry in the moov */
+static guint
+atom_journal_blocks_get_entry_size (guint entry_size, AtomSTCO64 * stco64)
+{
+  /* chunk offsets are kept as 64 bits in the journal */
+  if (stco64 && stco64->header.header.type == FOURCC_stco)
+    return 4;
+  return entry_size;
+}
+
+/* reads block @index of @jb as it goes in the moov into @dest */
+static gboolean
+atom_journal_blocks_read (AtomJournalBlocks * jb, guint index,
+    guint entry_size, AtomSTCO64 * stco64, guint8 * dest)
+{
+  AtomsJournal *journal = jb->journal;
+  guint size = ATOMS_JOURNAL_BLOCK_ENTRIES * entry_size;
+  guint8 *data;
+  guint i;
+
+  journal->reading = TRUE;
+  if (!atoms_journal_seek (journal, atom_array_index (&jb->blocks, index)))
+    return FALSE;
+
+  if (stco64 == NULL)
+    return fread (dest, 1, size, journal->file) == size;
+
+  data = g_malloc (size);
+  if (fread (data, 1, size, journal->file) != size) {
+    g_free (data);
+    return FALSE;
+  }
+  for (i = 0; i < ATOMS_JOURNAL_BLOCK_ENTRIES; i++) {
+    guint64 value = GST_READ_UINT64_BE (data + 8 * i) +
+        stco64->journal_chunks_offset;
+
+    if (stco64->header.header.type == FOURCC_stco)
+      GST_WRITE_UINT32_BE (dest + 4 * i, (guint32) value);
+    else
+      GST_WRITE_UINT64_BE (dest + 8 * i, value);
+  }
+  g_free (data);
+
+  return TRUE;
+}
+
+/* copies the entries of the table atom at @atom_offset that are in the
+ * journal. They are left out when atoms_journal_write_moov() serializes the
+ * moov. */
+static gboolean
+atom_journal_blocks_copy_data (AtomJournalBlocks * jb, guint entry_size,
+    AtomSTCO64 * stco64, guint64 atom_offset, guint8 ** buffer,
+    guint64 * size, guint64 * offset)
+{
+  guint block_size;
+  guint64 bytes;
+  guint i;
+
+  if (atom_array_get_len (&jb->blocks) == 0)
+    return TRUE;
+
+  block_size = ATOMS_JOURNAL_BLOCK_ENTRIES *
+      atom_journal_blocks_get_entry_size (entry_size, stco64);
+  bytes = (guint64) atom_array_get_len (&jb->blocks) * block_size;
+  if (buffer == NULL) {
+    *offset += bytes;
+    return TRUE;
+  }
+
+  if (jb->journal->splicing) {
+    AtomsJournalSplice splice;
+
+    splice.atom_offset = atom_offset;
+    splice.offset = *offset;
+    splice.jb = jb;
+    splice.entry_size = entry_size;
+    splice.stco64 = stco64;
+    atom_array_append (&jb->journal->splices, splice, 16);
+    return TRUE;
+  }
+
+  prop_copy_ensure_buffer (buffer, size, offset, bytes);
+  for (i = 0; i < atom_array_get_len (&jb->blocks); i++) {
+    if (!atom_journal_blocks_read (jb, i, entry_size, stco64,
+            *buffer + *offset))
+      return FALSE;
+    *offset += block_size;
+  }
+  return TRUE;
+}
+
+static guint64
+atoms_journal_splice_get_size (AtomsJournalSplice * splice)
+{
+  return atom_journal_blocks_get_len (splice->jb) *
+      atom_journal_blocks_get_entry_size (splice->entry_size, splice->stco64);
+}
+
+/* adds the size of the left out entries to the atoms that contain them,
+ * for the atoms from @start to @end in @data */
+static guint64
+atoms_journal_fix_sizes (AtomsJournal * journal, guint8 * data, guint64 start,
+    guint64 end)
+{
+  guint64 added = 0;
+
+  while (start + 8 <= end) {
+    guint32 size = GST_READ_UINT32_BE (data + start);
+    gboolean container = FALSE;
+    guint64 add = 0;
+    guint i;
+
+    if (size < 8 || start + size > end)
+      break;
+
+    for (i = 0; i < atom_array_get_len (&journal->splices); i++) {
+      AtomsJournalSplice *splice = &atom_array_index (&journal->splices, i);
+
+      if (splice->atom_offset == start)
+        add += atoms_journal_splice_get_size (splice);
+      else if (splice->atom_offset > start &&
+          splice->atom_offset < start + size)
+        container = TRUE;
+    }
+    if (container)
+      add += atoms_journal_fix_sizes (journal, data, start + 8, start + size);
+    if (add)
+      GST_WRITE_UINT32_BE (data + start, size + add);
+
+    added += add;
+    start += size;
+  }
+
+  return added;
+}
+
+/**
+ * Serializes @moov like atom_moov_copy_data() and passes it to @func in
+ * parts, with the sample table entries that are in the journal read back
+ * from it a block at a time. Only a moov without those entries is kept in
+ * memory.
+ */
+gboolean
+atoms_journal_write_moov (AtomsJournal * journal, AtomMOOV * moov,
+    AtomsJournalWriteFunc func, gpointer user_data)
+{
+  guint8 *data = NULL;
+  guint8 *block = NULL;
+  guint64 size = 0, offset = 0, pos = 0;
+  gboolean ret = FALSE;
+  guint i, j;
+
+  journal->splices.len = 0;
+  journal->splicing = TRUE;
+  if (!atom_moov_copy_data (moov, &data, &size, &offset)) {
+    journal->splicing = FALSE;
+    goto done;
+  }
+  journal->splicing = FALSE;
+
+  atoms_journal_fix_sizes (journal, data, 0, offset);
+
+  block = g_malloc (ATOMS_JOURNAL_BLOCK_ENTRIES * 8);
+  for (i = 0; i < atom_array_get_len (&journal->splices); i++) {
+    AtomsJournalSplice *splice = &atom_array_index (&journal->splices, i);
+    guint block_size = ATOMS_JOURNAL_BLOCK_ENTRIES *
+        atom_journal_blocks_get_entry_size (splice->entry_size, splice->stco64);
+
+    if (splice->offset > pos && !func (data + pos, splice->offset - pos,
+            user_data))
+      goto done;
+    pos = splice->offset;
+
+    for (j = 0; j < atom_array_get_len (&splice->jb->blocks); j++) {
+      if (!atom_journal_blocks_read (splice->jb, j, splice->entry_size,
+              splice->stco64, block))
+        goto done;
+      if (!func (block, block_size, user_data))
+        goto done;
+    }
+  }
+  if (offset > pos && !func (data + pos, offset - pos, user_data))
+    goto done;
+
+  ret = TRUE;
+
+done:
+  g_free (block);
+  g_free (data);
+  return ret;
+}
+
 static void
 atom_ctts_init (AtomCTTS * ctts)
 {
@@ -574,6 +892,7 @@ atom_ctts_init (AtomCTTS * ctts)
 
   atom_full_init (&ctts->header, FOURCC_ctts, 0, 0, 0, flags);
   atom_array_init (&ctts->entries, 128);
+  atom_journal_blocks_init (&ctts->journal);
   ctts->do_pts = FALSE;
 }
 
@@ -591,6 +910,7 @@ atom_ctts_free (AtomCTTS * ctts)
 {
   atom_full_clear (&ctts->header);
   atom_array_clear (&ctts->entries);
+  atom_journal_blocks_clear (&ctts->journal);
   g_free (ctts);
 }
 
@@ -601,6 +921,8 @@ atom_stts_init (AtomSTTS * stts)
 
   atom_full_init (&stts->header, FOURCC_stts, 0, 0, 0, flags);
   atom_array_init (&stts->entries, 512);
+  atom_journal_blocks_init (&stts->journal);
+  stts->journal_duration = 0;
 }
 
 static void
@@ -608,6 +930,8 @@ atom_stts_clear (AtomSTTS * stts)
 {
   atom_full_clear (&stts->header);
   atom_array_clear (&stts->entries);
+  atom_journal_blocks_clear (&stts->journal);
+  stts->journal_duration = 0;
 }
 
 static void
@@ -617,6 +941,7 @@ atom_stsz_init (AtomSTSZ * stsz)
 
   atom_full_init (&stsz->header, FOURCC_stsz, 0, 0, 0, flags);
   atom_array_init (&stsz->entries, 1024);
+  atom_journal_blocks_init (&stsz->journal);
   stsz->sample_size = 0;
   stsz->table_size = 0;
 }
@@ -626,6 +951,7 @@ atom_stsz_clear (AtomSTSZ * stsz)
 {
   atom_full_clear (&stsz->header);
   atom_array_clear (&stsz->entries);
+  atom_journal_blocks_clear (&stsz->journal);
   stsz->table_size = 0;
 }
 
@@ -652,6 +978,8 @@ atom_co64_init (AtomSTCO64 * co64)
 
   atom_full_init (&co64->header, FOURCC_stco, 0, 0, 0, flags);
   atom_array_init (&co64->entries, 256);
+  atom_journal_blocks_init (&co64->journal);
+  co64->journal_chunks_offset = 0;
 }
 
 static void
@@ -659,6 +987,8 @@ atom_stco64_clear (AtomSTCO64 * stco64)
 {
   atom_full_clear (&stco64->header);
   atom_array_clear (&stco64->entries);
+  atom_journal_blocks_clear (&stco64->journal);
+  stco64->journal_chunks_offset = 0;
 }
 
 static void
@@ -668,6 +998,7 @@ atom_stss_init (AtomSTSS * stss)
 
   atom_full_init (&stss->header, FOURCC_stss, 0, 0, 0, flags);
   atom_array_init (&stss->entries, 128);
+  atom_journal_blocks_init (&stss->journal);
 }
 
 static void
@@ -675,6 +1006,7 @@ atom_stss_clear (AtomSTSS * stss)
 {
   atom_full_clear (&stss->header);
   atom_array_clear (&stss->entries);
+  atom_journal_blocks_clear (&stss->journal);
 }
 
 void
@@ -1657,7 +1989,11 @@ atom_stts_copy_data (AtomSTTS * stts, guint8 ** buffer, guint64 * size,
     return 0;
   }
 
-  prop_copy_uint32 (atom_array_get_len (&stts->entries), buffer, size, offset);
+  prop_copy_uint32 (atom_array_get_len (&stts->entries) +
+      atom_journal_blocks_get_len (&stts->journal), buffer, size, offset);
+  if (!atom_journal_blocks_copy_data (&stts->journal, 8, NULL,
+          original_offset, buffer, size, offset))
+    return 0;
   /* minimize realloc */
   prop_copy_ensure_buffer (buffer, size, offset,
       8 * atom_array_get_len (&stts->entries));
@@ -1886,10 +2222,15 @@ atom_stsz_copy_data (AtomSTSZ * stsz, guint8 ** buffer, guint64 * size,
   prop_copy_uint32 (stsz->sample_size, buffer, size, offset);
   prop_copy_uint32 (stsz->table_size, buffer, size, offset);
   if (stsz->sample_size == 0) {
+    if (!atom_journal_blocks_copy_data (&stsz->journal, 4, NULL,
+            original_offset, buffer, size, offset))
+      return 0;
     /* minimize realloc */
-    prop_copy_ensure_buffer (buffer, size, offset, 4 * stsz->table_size);
+    prop_copy_ensure_buffer (buffer, size, offset,
+        4 * atom_array_get_len (&stsz->entries));
     /* entry count must match sample count */
-    g_assert (atom_array_get_len (&stsz->entries) == stsz->table_size);
+    g_assert (atom_array_get_len (&stsz->entries) +
+        atom_journal_blocks_get_len (&stsz->journal) == stsz->table_size);
     for (i = 0; i < atom_array_get_len (&stsz->entries); i++) {
       prop_copy_uint32 (atom_array_index (&stsz->entries, i), buffer, size,
           offset);
@@ -1939,7 +2280,11 @@ atom_ctts_copy_data (AtomCTTS * ctts, guint8 ** buffer, guint64 * size,
     return 0;
   }
 
-  prop_copy_uint32 (atom_array_get_len (&ctts->entries), buffer, size, offset);
+  prop_copy_uint32 (atom_array_get_len (&ctts->entries) +
+      atom_journal_blocks_get_len (&ctts->journal), buffer, size, offset);
+  if (!atom_journal_blocks_copy_data (&ctts->journal, 8, NULL,
+          original_offset, buffer, size, offset))
+    return 0;
   /* minimize realloc */
   prop_copy_ensure_buffer (buffer, size, offset,
       8 * atom_array_get_len (&ctts->entries));
@@ -1966,8 +2311,11 @@ atom_stco64_copy_data (AtomSTCO64 * stco64, guint8 ** buffer, guint64 * size,
     return 0;
   }
 
-  prop_copy_uint32 (atom_array_get_len (&stco64->entries), buffer, size,
-      offset);
+  prop_copy_uint32 (atom_array_get_len (&stco64->entries) +
+      atom_journal_blocks_get_len (&stco64->journal), buffer, size, offset);
+  if (!atom_journal_blocks_copy_data (&stco64->journal, 8, stco64,
+          original_offset, buffer, size, offset))
+    return 0;
 
   /* minimize realloc */
   prop_copy_ensure_buffer (buffer, size, offset,
@@ -1993,7 +2341,8 @@ atom_stss_copy_data (AtomSTSS * stss, guint8 ** buffer, guint64 * size,
   guint64 original_offset = *offset;
   guint i;
 
-  if (atom_array_get_len (&stss->entries) == 0) {
+  if (atom_array_get_len (&stss->entries) == 0 &&
+      atom_array_get_len (&stss->journal.blocks) == 0) {
     /* FIXME not needing this atom might be confused with error while copying */
     return 0;
   }
@@ -2002,7 +2351,11 @@ atom_stss_copy_data (AtomSTSS * stss, guint8 ** buffer, guint64 * size,
     return 0;
   }
 
-  prop_copy_uint32 (atom_array_get_len (&stss->entries), buffer, size, offset);
+  prop_copy_uint32 (atom_array_get_len (&stss->entries) +
+      atom_journal_blocks_get_len (&stss->journal), buffer, size, offset);
+  if (!atom_journal_blocks_copy_data (&stss->journal, 4, NULL,
+          original_offset, buffer, size, offset))
+    return 0;
   /* minimize realloc */
   prop_copy_ensure_buffer (buffer, size, offset,
       4 * atom_array_get_len (&stss->entries));
@@ -2099,7 +2452,8 @@ atom_stbl_copy_data (AtomSTBL * stbl, guint8 ** buffer, guint64 * size,
   }
   /* this atom is optional, so let's check if we need it
    * (to avoid false error) */
-  if (atom_array_get_len (&stbl->stss.entries)) {
+  if (atom_array_get_len (&stbl->stss.entries) ||
+      atom_array_get_len (&stbl->stss.journal.blocks)) {
     if (!atom_stss_copy_data (&stbl->stss, buffer, size, offset)) {
       return 0;
     }
@@ -2569,6 +2923,30 @@ atom_stsc_add_new_entry (AtomSTSC * stsc, guint32 first_chunk, guint32 nsamples)
   atom_array_append (&stsc->entries, nentry, 128);
 }
 
+static void
+atom_stts_write_journal (AtomSTTS * stts)
+{
+  guint8 *data = NULL;
+  guint64 size = 0, offset = 0;
+  guint64 duration = 0;
+  guint i;
+
+  prop_copy_ensure_buffer (&data, &size, &offset,
+      8 * ATOMS_JOURNAL_BLOCK_ENTRIES);
+  for (i = 0; i < ATOMS_JOURNAL_BLOCK_ENTRIES; i++) {
+    STTSEntry *entry = &atom_array_index (&stts->entries, i);
+
+    prop_copy_uint32 (entry->sample_count, &data, &size, &offset);
+    prop_copy_int32 (entry->sample_delta, &data, &size, &offset);
+    duration += (guint64) (entry->sample_count) * entry->sample_delta;
+  }
+  if (atom_journal_blocks_write (&stts->journal, data, offset)) {
+    atom_array_remove_head (&stts->entries, ATOMS_JOURNAL_BLOCK_ENTRIES);
+    stts->journal_duration += duration;
+  }
+  g_free (data);
+}
+
 static void
 atom_stts_add_entry (AtomSTTS * stts, guint32 sample_count, gint32 sample_delta)
 {
@@ -2586,6 +2964,11 @@ atom_stts_add_entry (AtomSTTS * stts, guint32 sample_count, gint32 sample_delta)
     nentry.sample_count = sample_count;
     nentry.sample_delta = sample_delta;
     atom_array_append (&stts->entries, nentry, 256);
+
+    /* the last entry stays in memory to add samples to */
+    if (atom_journal_blocks_is_full (&stts->journal,
+            atom_array_get_len (&stts->entries) - 1))
+      atom_stts_write_journal (stts);
   }
 }
 
@@ -2601,13 +2984,32 @@ atom_stsz_add_entry (AtomSTSZ * stsz, guint32 nsamples, guint32 size)
   }
   for (i = 0; i < nsamples; i++) {
     atom_array_append (&stsz->entries, size, 1024);
+    if (atom_journal_blocks_is_full (&stsz->journal,
+            atom_array_get_len (&stsz->entries)) &&
+        atom_journal_blocks_write_uint32 (&stsz->journal,
+            stsz->entries.data))
+      atom_array_remove_head (&stsz->entries, ATOMS_JOURNAL_BLOCK_ENTRIES);
   }
 }
 
 static guint32
 atom_stco64_get_entry_count (AtomSTCO64 * stco64)
 {
-  return atom_array_get_len (&stco64->entries);
+  return atom_array_get_len (&stco64->entries) +
+      atom_journal_blocks_get_len (&stco64->journal);
+}
+
+static void
+atom_stco64_write_journal (AtomSTCO64 * stco64)
+{
+  guint8 *data = NULL;
+  guint64 size = 0, offset = 0;
+
+  prop_copy_uint64_array (stco64->entries.data, ATOMS_JOURNAL_BLOCK_ENTRIES,
+      &data, &size, &offset);
+  if (atom_journal_blocks_write (&stco64->journal, data, offset))
+    atom_array_remove_head (&stco64->entries, ATOMS_JOURNAL_BLOCK_ENTRIES);
+  g_free (data);
 }
 
 static void
@@ -2616,12 +3018,19 @@ atom_stco64_add_entry (AtomSTCO64 * stco64, guint64 entry)
   atom_array_append (&stco64->entries, entry, 256);
   if (entry > G_MAXUINT32)
     stco64->header.header.type = FOURCC_co64;
+  if (atom_journal_blocks_is_full (&stco64->journal,
+          atom_array_get_len (&stco64->entries)))
+    atom_stco64_write_journal (stco64);
 }
 
 static void
 atom_stss_add_entry (AtomSTSS * stss, guint32 sample)
 {
   atom_array_append (&stss->entries, sample, 512);
+  if (atom_journal_blocks_is_full (&stss->journal,
+          atom_array_get_len (&stss->entries)) &&
+      atom_journal_blocks_write_uint32 (&stss->journal, stss->entries.data))
+    atom_array_remove_head (&stss->entries, ATOMS_JOURNAL_BLOCK_ENTRIES);
 }
 
 static void
@@ -2632,6 +3041,26 @@ atom_stbl_add_stss_entry (AtomSTBL * stbl)
   atom_stss_add_entry (&stbl->stss, sample_index);
 }
 
+static void
+atom_ctts_write_journal (AtomCTTS * ctts)
+{
+  guint8 *data = NULL;
+  guint64 size = 0, offset = 0;
+  guint i;
+
+  prop_copy_ensure_buffer (&data, &size, &offset,
+      8 * ATOMS_JOURNAL_BLOCK_ENTRIES);
+  for (i = 0; i < ATOMS_JOURNAL_BLOCK_ENTRIES; i++) {
+    CTTSEntry *entry = &atom_array_index (&ctts->entries, i);
+
+    prop_copy_uint32 (entry->samplecount, &data, &size, &offset);
+    prop_copy_uint32 (entry->sampleoffset, &data, &size, &offset);
+  }
+  if (atom_journal_blocks_write (&ctts->journal, data, offset))
+    atom_array_remove_head (&ctts->entries, ATOMS_JOURNAL_BLOCK_ENTRIES);
+  g_free (data);
+}
+
 static void
 atom_ctts_add_entry (AtomCTTS * ctts, guint32 nsamples, guint32 offset)
 {
@@ -2649,6 +3078,11 @@ atom_ctts_add_entry (AtomCTTS * ctts, guint32 nsamples, guint32 offset)
     atom_array_append (&ctts->entries, nentry, 256);
     if (offset != 0)
       ctts->do_pts = TRUE;
+
+    /* the last entry stays in memory to add samples to */
+    if (atom_journal_blocks_is_full (&ctts->journal,
+            atom_array_get_len (&ctts->entries) - 1))
+      atom_ctts_write_journal (ctts);
   } else {
     entry->samplecount += nsamples;
   }
@@ -2659,6 +3093,7 @@ atom_stbl_add_ctts_entry (AtomSTBL * stbl, guint32 nsamples, guint32 offset)
 {
   if (stbl->ctts == NULL) {
     stbl->ctts = atom_ctts_new ();
+    stbl->ctts->journal.journal = stbl->stts.journal.journal;
   }
   atom_ctts_add_entry (stbl->ctts, nsamples, offset);
 }
@@ -2678,6 +3113,23 @@ atom_stbl_add_samples (AtomSTBL * stbl, guint32 nsamples, guint32 delta,
   atom_stbl_add_ctts_entry (stbl, nsamples, pts_offset);
 }
 
+/**
+ * Makes the sample tables of @trak write their entries to @journal in blocks
+ * as samples are added, instead of keeping them all in memory.
+ */
+void
+atom_trak_set_journal (AtomTRAK * trak, AtomsJournal * journal)
+{
+  AtomSTBL *stbl = &trak->mdia.minf.stbl;
+
+  stbl->stts.journal.journal = journal;
+  stbl->stss.journal.journal = journal;
+  stbl->stsz.journal.journal = journal;
+  stbl->stco64.journal.journal = journal;
+  if (stbl->ctts)
+    stbl->ctts->journal.journal = journal;
+}
+
 void
 atom_trak_add_samples (AtomTRAK * trak, guint32 nsamples, guint32 delta,
     guint32 size, guint64 chunk_offset, gboolean sync, gint64 pts_offset)
@@ -2749,7 +3201,7 @@ static guint64
 atom_stts_get_total_duration (AtomSTTS * stts)
 {
   guint i;
-  guint64 sum = 0;
+  guint64 sum = stts->journal_duration;
 
   for (i = 0; i < atom_array_get_len (&stts->entries); i++) {
     STTSEntry *entry = &atom_array_index (&stts->entries, i);
@@ -2820,6 +3272,7 @@ atom_stco64_chunks_add_offset (AtomSTCO64 * stco64, guint32 offset)
 
     *value += offset;
   }
+  stco64->journal_chunks_offset += offset;
 }
 
 void
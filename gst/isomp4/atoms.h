@@ -44,6 +44,7 @@
 #define __ATOMS_H__
 
 #include <glib.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "descriptors.h"
@@ -90,6 +91,31 @@ G_STMT_START {                                                                \
   (array)->data = NULL;                                                       \
 } G_STMT_END
 
+#define atom_array_remove_head(array, count)                                  \
+G_STMT_START {                                                                \
+  (array)->len -= (count);                                                    \
+  memmove ((array)->data, (array)->data + (count),                            \
+      sizeof (*(array)->data) * (array)->len);                                \
+} G_STMT_END
+
+/* Sample table journal: the entries of the sample tables can be written to a
+ * file in blocks while they are added, so that long recordings don't keep
+ * them all in memory. They are read back from the file when the moov is
+ * written, see atoms_journal_write_moov(). */
+#define ATOMS_JOURNAL_BLOCK_ENTRIES 4096
+
+typedef struct _AtomsJournal AtomsJournal;
+
+/* the entries of a sample table that were written to the journal */
+typedef struct _AtomJournalBlocks
+{
+  AtomsJournal *journal;        /* NULL if not journaled */
+  ATOM_ARRAY (guint64) blocks;  /* journal offset of each block */
+} AtomJournalBlocks;
+
+#define atom_journal_blocks_get_len(jb) \
+    ((guint64) atom_array_get_len (&(jb)->blocks) * ATOMS_JOURNAL_BLOCK_ENTRIES)
+
 /* light-weight context that may influence header atom tree construction */
 typedef enum _AtomsTreeFlavor
 {
@@ -313,6 +339,8 @@ typedef struct _AtomSTTS
   AtomFull header;
 
   ATOM_ARRAY (STTSEntry) entries;
+  AtomJournalBlocks journal;
+  guint64 journal_duration;
 } AtomSTTS;
 
 typedef struct _AtomSTSS
@@ -320,6 +348,7 @@ typedef struct _AtomSTSS
   AtomFull header;
 
   ATOM_ARRAY (guint32) entries;
+  AtomJournalBlocks journal;
 } AtomSTSS;
 
 typedef struct _AtomESDS
@@ -454,6 +483,7 @@ typedef struct _AtomSTSZ
    * the list is empty */
   guint32 table_size;
   ATOM_ARRAY (guint32) entries;
+  AtomJournalBlocks journal;
 } AtomSTSZ;
 
 typedef struct _STSCEntry
@@ -480,6 +510,9 @@ typedef struct _AtomSTCO64
   AtomFull header;
 
   ATOM_ARRAY (guint64) entries;
+  AtomJournalBlocks journal;
+  /* added to the entries in the journal when they are written */
+  guint64 journal_chunks_offset;
 } AtomSTCO64;
 
 typedef struct _CTTSEntry
@@ -494,6 +527,7 @@ typedef struct _AtomCTTS
 
   /* also entry count here */
   ATOM_ARRAY (CTTSEntry) entries;
+  AtomJournalBlocks journal;
   gboolean do_pts;
 } AtomCTTS;
 
@@ -831,6 +865,7 @@ void       atom_stbl_add_samples       (AtomSTBL * stbl, guint32 nsamples,
                                         guint32 delta, guint32 size,
                                         guint64 chunk_offset, gboolean sync,
                                         gint64 pts_offset);
+void       atom_trak_set_journal       (AtomTRAK * trak, AtomsJournal * journal);
 
 AtomMOOV*  atom_moov_new               (AtomsContext *context);
 void       atom_moov_free              (AtomMOOV *moov);
@@ -841,6 +876,15 @@ void       atom_moov_set_fragmented    (AtomMOOV *moov, gboolean fragmented);
 void       atom_moov_chunks_add_offset (AtomMOOV *moov, guint32 offset);
 void       atom_moov_add_trak          (AtomMOOV *moov, AtomTRAK *trak);
 
+typedef gboolean (*AtomsJournalWriteFunc) (const guint8 * data, guint size,
+                                           gpointer user_data);
+
+AtomsJournal* atoms_journal_new        (FILE * file);
+void       atoms_journal_free          (AtomsJournal * journal);
+gboolean   atoms_journal_write_moov    (AtomsJournal * journal, AtomMOOV * moov,
+                                        AtomsJournalWriteFunc func,
+                                        gpointer user_data);
+
 guint64    atom_mvhd_copy_data         (AtomMVHD * atom, guint8 ** buffer,
                                         guint64 * size, guint64 * offset);
 void       atom_stco64_chunks_add_offset (AtomSTCO64 * stco64, guint32 offset);
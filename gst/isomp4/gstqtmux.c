@@ -174,6 +174,7 @@ enum
   PROP_FAST_START,
   PROP_FAST_START_TEMP_FILE,
   PROP_MOOV_RECOV_FILE,
+  PROP_SAMPLE_TABLE_FILE,
   PROP_FRAGMENT_DURATION,
   PROP_STREAMABLE,
 #ifndef GST_REMOVE_DEPRECATED
@@ -191,6 +192,7 @@ enum
 #define DEFAULT_FAST_START              FALSE
 #define DEFAULT_FAST_START_TEMP_FILE    NULL
 #define DEFAULT_MOOV_RECOV_FILE         NULL
+#define DEFAULT_SAMPLE_TABLE_FILE       NULL
 #define DEFAULT_FRAGMENT_DURATION       0
 #define DEFAULT_STREAMABLE              TRUE
 #ifndef GST_REMOVE_DEPRECATED
@@ -346,6 +348,23 @@ gst_qt_mux_class_init (GstQTMuxClass * klass)
           "of a crash during muxing. Null for disabled. (Experimental)",
           DEFAULT_MOOV_RECOV_FILE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstQTMux:sample-table-file:
+   *
+   * File that the sample tables are written to in blocks during recording,
+   * so that their memory use does not grow with the length of the recording.
+   * The moov atom is assembled from this file at the end. Not used for
+   * fragmented files.
+   *
+   * Since: 1.4
+   */
+  g_object_class_install_property (gobject_class, PROP_SAMPLE_TABLE_FILE,
+      g_param_spec_string ("sample-table-file",
+          "File to store the sample tables in while muxing",
+          "File to be used to temporarily store the sample tables while "
+          "muxing instead of keeping them in memory. Null for disabled",
+          DEFAULT_SAMPLE_TABLE_FILE,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
   g_object_class_install_property (gobject_class, PROP_FRAGMENT_DURATION,
       g_param_spec_uint ("fragment-duration", "Fragment duration",
           "Fragment durations in ms (produce a fragmented file if > 0)",
@@ -437,6 +456,16 @@ gst_qt_mux_reset (GstQTMux * qtmux, gboolean alloc)
     fclose (qtmux->moov_recov_file);
     qtmux->moov_recov_file = NULL;
   }
+  /* after the moov, whose sample tables refer to it */
+  if (qtmux->sample_table_journal) {
+    atoms_journal_free (qtmux->sample_table_journal);
+    qtmux->sample_table_journal = NULL;
+  }
+  if (qtmux->sample_table_file) {
+    fclose (qtmux->sample_table_file);
+    g_remove (qtmux->sample_table_file_path);
+    qtmux->sample_table_file = NULL;
+  }
   for (walk = qtmux->extra_atoms; walk; walk = g_slist_next (walk)) {
     AtomInfo *ainfo = (AtomInfo *) walk->data;
     ainfo->free_func (ainfo->atom);
@@ -511,6 +540,7 @@ gst_qt_mux_finalize (GObject * object)
 
   g_free (qtmux->fast_start_file_path);
   g_free (qtmux->moov_recov_file_path);
+  g_free (qtmux->sample_table_file_path);
 
   atoms_context_free (qtmux->context);
   gst_object_unref (qtmux->collect);
@@ -1588,6 +1618,57 @@ gst_qt_mux_configure_moov (GstQTMux * qtmux, guint32 * _timescale)
     *_timescale = timescale;
 }
 
+typedef struct
+{
+  GstQTMux *qtmux;
+  guint64 *offset;
+  gboolean mind_fast;
+  GstFlowReturn ret;
+} GstQTMuxJournalWriteData;
+
+static gboolean
+gst_qt_mux_send_moov_part (const guint8 * data, guint size, gpointer user_data)
+{
+  GstQTMuxJournalWriteData *wdata = user_data;
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_fill (buf, 0, data, size);
+  wdata->ret = gst_qt_mux_send_buffer (wdata->qtmux, buf, wdata->offset,
+      wdata->mind_fast);
+
+  return wdata->ret == GST_FLOW_OK;
+}
+
+/* the moov is pushed in parts with the sample table entries read back from
+ * the journal, so it is never all in memory and can't go on the caps */
+static GstFlowReturn
+gst_qt_mux_send_moov_from_journal (GstQTMux * qtmux, guint64 * _offset,
+    gboolean mind_fast)
+{
+  GstQTMuxJournalWriteData wdata;
+
+  wdata.qtmux = qtmux;
+  wdata.offset = _offset;
+  wdata.mind_fast = mind_fast;
+  wdata.ret = GST_FLOW_OK;
+
+  GST_DEBUG_OBJECT (qtmux, "Pushing moov atoms from the sample table file");
+  if (!atoms_journal_write_moov (qtmux->sample_table_journal, qtmux->moov,
+          gst_qt_mux_send_moov_part, &wdata) && wdata.ret == GST_FLOW_OK)
+    goto read_failed;
+
+  return wdata.ret;
+
+read_failed:
+  {
+    GST_ELEMENT_ERROR (qtmux, RESOURCE, READ,
+        ("Failed to read the sample tables from \"%s\"",
+            qtmux->sample_table_file_path), GST_ERROR_SYSTEM);
+    return GST_FLOW_ERROR;
+  }
+}
+
 static GstFlowReturn
 gst_qt_mux_send_moov (GstQTMux * qtmux, guint64 * _offset, gboolean mind_fast)
 {
@@ -1596,6 +1677,9 @@ gst_qt_mux_send_moov (GstQTMux * qtmux, guint64 * _offset, gboolean mind_fast)
   GstBuffer *buf;
   GstFlowReturn ret = GST_FLOW_OK;
 
+  if (qtmux->sample_table_journal)
+    return gst_qt_mux_send_moov_from_journal (qtmux, _offset, mind_fast);
+
   /* serialize moov */
   offset = size = 0;
   data = NULL;
@@ -1770,6 +1854,25 @@ gst_qt_mux_start_file (GstQTMux * qtmux)
       }
     }
   }
+
+  /* keep the sample tables in a file while recording */
+  if (qtmux->sample_table_file_path && !qtmux->fragment_duration) {
+    GSList *walk;
+
+    GST_DEBUG_OBJECT (qtmux, "Opening sample table file: %s",
+        qtmux->sample_table_file_path);
+    qtmux->sample_table_file = g_fopen (qtmux->sample_table_file_path, "wb+");
+    if (!qtmux->sample_table_file)
+      goto sample_table_open_failed;
+
+    qtmux->sample_table_journal =
+        atoms_journal_new (qtmux->sample_table_file);
+    for (walk = qtmux->sinkpads; walk; walk = g_slist_next (walk)) {
+      GstQTPad *qpad = (GstQTPad *) walk->data;
+
+      atom_trak_set_journal (qpad->trak, qtmux->sample_table_journal);
+    }
+  }
   GST_OBJECT_UNLOCK (qtmux);
 
   /* 
@@ -1836,6 +1939,14 @@ open_failed:
     GST_OBJECT_UNLOCK (qtmux);
     return GST_FLOW_ERROR;
   }
+sample_table_open_failed:
+  {
+    GST_ELEMENT_ERROR (qtmux, RESOURCE, OPEN_READ_WRITE,
+        (("Could not open temporary file \"%s\""),
+            qtmux->sample_table_file_path), GST_ERROR_SYSTEM);
+    GST_OBJECT_UNLOCK (qtmux);
+    return GST_FLOW_ERROR;
+  }
 }
 
 static GstFlowReturn
@@ -3554,6 +3665,9 @@ gst_qt_mux_get_property (GObject * object,
     case PROP_MOOV_RECOV_FILE:
       g_value_set_string (value, qtmux->moov_recov_file_path);
       break;
+    case PROP_SAMPLE_TABLE_FILE:
+      g_value_set_string (value, qtmux->sample_table_file_path);
+      break;
     case PROP_FRAGMENT_DURATION:
       g_value_set_uint (value, qtmux->fragment_duration);
       break;
@@ -3617,6 +3731,10 @@ gst_qt_mux_set_property (GObject * object,
       g_free (qtmux->moov_recov_file_path);
       qtmux->moov_recov_file_path = g_value_dup_string (value);
       break;
+    case PROP_SAMPLE_TABLE_FILE:
+      g_free (qtmux->sample_table_file_path);
+      qtmux->sample_table_file_path = g_value_dup_string (value);
+      break;
     case PROP_FRAGMENT_DURATION:
       qtmux->fragment_duration = g_value_get_uint (value);
       break;
@@ -179,6 +179,10 @@ struct _GstQTMux
   /* moov recovery */
   FILE *moov_recov_file;
 
+  /* sample tables kept out of memory */
+  FILE *sample_table_file;
+  AtomsJournal *sample_table_journal;
+
   /* fragment sequence */
   guint32 fragment_sequence;
 
@@ -193,6 +197,7 @@ struct _GstQTMux
 #endif
   gchar *fast_start_file_path;
   gchar *moov_recov_file_path;
+  gchar *sample_table_file_path;
   guint32 fragment_duration;
   gboolean streamable;
 
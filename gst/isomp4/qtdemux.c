@@ -84,6 +84,15 @@
 /* if the sample index is larger than this, something is likely wrong */
 #define QTDEMUX_MAX_SAMPLE_INDEX_SIZE (50*1024*1024)
 
+/* in pull mode, a moov larger than this is read without the bulk of its
+ * sample tables, which are read when the samples are parsed */
+#define QTDEMUX_LAZY_MOOV_SIZE (1024*1024)
+/* sample table atoms larger than this are read lazily, only their first
+ * QTDEMUX_LAZY_TABLE_SIZE bytes are read with the moov */
+#define QTDEMUX_LAZY_TABLE_SIZE (64*1024)
+/* read lazy tables and the rest of a lazy moov in blocks of this size */
+#define QTDEMUX_LAZY_BLOCK_SIZE (64*1024)
+
 /* For converting qt creation times to unix epoch times */
 #define QTDEMUX_SECONDS_PER_DAY (60 * 60 * 24)
 #define QTDEMUX_LEAP_YEARS_FROM_1904_TO_1970 17
@@ -97,6 +106,9 @@ GST_DEBUG_CATEGORY (qtdemux_debug);
 /*typedef struct _QtNode QtNode; */
 typedef struct _QtDemuxSegment QtDemuxSegment;
 typedef struct _QtDemuxSample QtDemuxSample;
+typedef struct _QtDemuxTimeRun QtDemuxTimeRun;
+typedef struct _QtDemuxLazyTable QtDemuxLazyTable;
+typedef struct _QtDemuxFragment QtDemuxFragment;
 
 /*struct _QtNode
 {
@@ -105,27 +117,82 @@ typedef struct _QtDemuxSample QtDemuxSample;
   gint len;
 };*/
 
+/* The timestamp and duration of the samples are kept as runs of samples
+ * with the same duration in the stream, see QtDemuxTimeRun, and the keyframe
+ * flags in a bitset, so that a sample only takes 16 bytes. Samples whose
+ * duration changes too often for runs to pay off, like alternating 33 and
+ * 34 ms, are kept in a time table of 4 bytes per sample instead. */
 struct _QtDemuxSample
 {
+  guint64 offset;
   guint32 size;
   gint32 pts_offset;            /* Add this value to timestamp to get the pts */
-  guint64 offset;
-  guint64 timestamp;            /* DTS In mov time */
+};
+
+/* consecutive samples that have the same duration, like an stts entry, or
+ * when table is set, samples whose DTS are in the time table */
+struct _QtDemuxTimeRun
+{
+  guint64 timestamp;            /* DTS of the first sample In mov time */
+  guint32 first_sample;         /* index of the first sample of the run */
   guint32 duration;             /* In mov time */
-  gboolean keyframe;            /* TRUE when this packet is a keyframe */
+  gint32 step;                  /* DTS difference between the samples */
+  guint32 table;                /* index in the time table of the DTS of the
+                                   first sample, relative to timestamp, or
+                                   QTDEMUX_NO_TIME_TABLE */
 };
 
+#define QTDEMUX_NO_TIME_TABLE G_MAXUINT32
+
+/* a run of fewer samples takes more memory than their time table entries */
+#define QTDEMUX_MIN_TIME_RUN (sizeof (QtDemuxTimeRun) / sizeof (guint32))
+
+/* a sample table that is read from the file as the samples are parsed */
+struct _QtDemuxLazyTable
+{
+  guint64 offset;               /* file offset of the table data */
+  guint loaded;                 /* bytes of the table data that are read */
+};
+
+/* a moof in the fragment index */
+struct _QtDemuxFragment
+{
+  guint64 offset;               /* file offset of the moof */
+  GstClockTime time;            /* decode time of its first samples */
+};
+
+#define QTSAMPLE_INDEX(stream,sample) ((guint32) ((sample) - (stream)->samples))
+
 /* timestamp is the DTS */
-#define QTSAMPLE_DTS(stream,sample) gst_util_uint64_scale ((sample)->timestamp,\
+#define QTSAMPLE_TIMESTAMP(stream,sample) \
+    qtdemux_sample_get_timestamp ((stream), QTSAMPLE_INDEX (stream, sample))
+#define QTSAMPLE_DURATION(stream,sample) \
+    qtdemux_sample_get_duration ((stream), QTSAMPLE_INDEX (stream, sample))
+
+#define QTSAMPLE_DTS(stream,sample) \
+    gst_util_uint64_scale (QTSAMPLE_TIMESTAMP (stream, sample), \
     GST_SECOND, (stream)->timescale)
 /* timestamp + offset is the PTS */
-#define QTSAMPLE_PTS(stream,sample) gst_util_uint64_scale ((sample)->timestamp + \
+#define QTSAMPLE_PTS(stream,sample) \
+    gst_util_uint64_scale (QTSAMPLE_TIMESTAMP (stream, sample) + \
     (sample)->pts_offset, GST_SECOND, (stream)->timescale)
 /* timestamp + duration - dts is the duration */
-#define QTSAMPLE_DUR_DTS(stream,sample,dts) (gst_util_uint64_scale ((sample)->timestamp + \
-    (sample)->duration, GST_SECOND, (stream)->timescale) - (dts));
-
-#define QTSAMPLE_KEYFRAME(stream,sample) ((stream)->all_keyframe || (sample)->keyframe)
+#define QTSAMPLE_DUR_DTS(stream,sample,dts) \
+    (gst_util_uint64_scale (QTSAMPLE_TIMESTAMP (stream, sample) + \
+    QTSAMPLE_DURATION (stream, sample), GST_SECOND, (stream)->timescale) - \
+    (dts));
+
+#define QTSAMPLE_IS_KEYFRAME(stream,index) \
+    (((stream)->keyframes[(index) >> 5] >> ((index) & 31)) & 1)
+#define QTSAMPLE_SET_KEYFRAME(stream,index,keyframe) G_STMT_START { \
+  if (keyframe) \
+    (stream)->keyframes[(index) >> 5] |= 1U << ((index) & 31); \
+  else \
+    (stream)->keyframes[(index) >> 5] &= ~(1U << ((index) & 31)); \
+} G_STMT_END
+
+#define QTSAMPLE_KEYFRAME(stream,sample) ((stream)->all_keyframe || \
+    QTSAMPLE_IS_KEYFRAME (stream, QTSAMPLE_INDEX (stream, sample)))
 
 /*
  * Quicktime has tracks and segments. A track is a continuous piece of
@@ -232,6 +299,17 @@ struct _QtDemuxStream
   /* our samples */
   guint32 n_samples;
   QtDemuxSample *samples;
+  guint32 *keyframes;           /* bitset of the keyframes */
+  QtDemuxTimeRun *time_runs;
+  guint32 n_time_runs;
+  guint32 time_runs_size;       /* allocated runs */
+  guint32 *time_table;          /* DTS of the samples of table runs, with
+                                   the end of the run after the last one */
+  guint32 time_table_len;
+  guint32 time_table_size;      /* allocated entries */
+  gboolean samples_from_tfdt;   /* the samples start at a later fragment, at
+                                   its tfdt decode time */
+  guint64 first_tfdt;           /* tfdt of the first fragment */
   gboolean all_keyframe;        /* TRUE when all samples are keyframes (no stss) */
   guint32 min_duration;         /* duration in timescale of first sample, used for figuring out
                                    the framerate, in timescale units */
@@ -357,6 +435,15 @@ struct _QtDemuxStream
   guint32 ctts_sample_index;
   guint32 ctts_count;
   gint32 ctts_soffset;
+  /* tables not completely read yet, see qtdemux_stbl_load() */
+  gboolean stbl_lazy;
+  QtDemuxLazyTable stts_lazy;
+  QtDemuxLazyTable stss_lazy;
+  QtDemuxLazyTable stps_lazy;
+  QtDemuxLazyTable stsz_lazy;
+  QtDemuxLazyTable stsc_lazy;
+  QtDemuxLazyTable stco_lazy;
+  QtDemuxLazyTable ctts_lazy;
 
   /* fragmented */
   gboolean parsed_trex;
@@ -367,6 +454,182 @@ struct _QtDemuxStream
   gboolean disabled;
 };
 
+/* get the run of sample @index, or NULL when it has no timestamp yet. This
+ * only reads the stream, so it can be used from any thread that may look at
+ * the samples. */
+static QtDemuxTimeRun *
+qtdemux_stream_find_time_run (QtDemuxStream * stream, guint32 index)
+{
+  QtDemuxTimeRun *runs = stream->time_runs;
+  guint32 n_runs = stream->n_time_runs;
+  guint32 lo, hi;
+
+  if (G_UNLIKELY (n_runs == 0 || index < runs[0].first_sample))
+    return NULL;
+
+  /* samples are mostly looked up near the end of what is parsed */
+  lo = n_runs - 1;
+  if (runs[lo].first_sample <= index)
+    return &runs[lo];
+
+  lo = 0;
+  hi = n_runs;
+  while (hi - lo > 1) {
+    guint32 mid = lo + (hi - lo) / 2;
+
+    if (runs[mid].first_sample <= index)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return &runs[lo];
+}
+
+static guint64
+qtdemux_sample_get_timestamp (QtDemuxStream * stream, guint32 index)
+{
+  QtDemuxTimeRun *run = qtdemux_stream_find_time_run (stream, index);
+  guint32 n;
+
+  if (G_UNLIKELY (run == NULL))
+    return 0;
+
+  n = index - run->first_sample;
+  if (run->table != QTDEMUX_NO_TIME_TABLE)
+    return run->timestamp + stream->time_table[run->table + n];
+
+  return run->timestamp + (gint64) n * run->step;
+}
+
+static guint32
+qtdemux_sample_get_duration (QtDemuxStream * stream, guint32 index)
+{
+  QtDemuxTimeRun *run = qtdemux_stream_find_time_run (stream, index);
+  guint32 *table;
+
+  if (G_UNLIKELY (run == NULL))
+    return 0;
+
+  if (run->table == QTDEMUX_NO_TIME_TABLE)
+    return run->duration;
+
+  /* a table run is never the last run, the entry after the last sample is
+   * the end of the run */
+  table = stream->time_table + run->table + (index - run->first_sample);
+  return table[1] - table[0];
+}
+
+static gboolean
+qtdemux_stream_grow_time_table (QtDemuxStream * stream, guint32 n)
+{
+  guint32 size;
+  guint32 *table;
+
+  if (stream->time_table_len + n <= stream->time_table_size)
+    return TRUE;
+
+  size = MAX (64, MAX (stream->time_table_size * 2,
+          stream->time_table_len + n));
+  table = g_try_renew (guint32, stream->time_table, size);
+  if (table == NULL)
+    return FALSE;
+  stream->time_table = table;
+  stream->time_table_size = size;
+
+  return TRUE;
+}
+
+/* move the @n samples of the last run, which is too short to pay off, to the
+ * time table. They continue the table of the run before when that one ends
+ * where they start, otherwise the last run becomes a table run. */
+static gboolean
+qtdemux_stream_fold_time_run (QtDemuxStream * stream, guint32 n)
+{
+  QtDemuxTimeRun *run, *prev = NULL;
+  guint64 base = 0;
+  guint32 i;
+
+  run = &stream->time_runs[stream->n_time_runs - 1];
+  if ((guint64) n * run->step > G_MAXUINT32)
+    return TRUE;
+
+  if (!qtdemux_stream_grow_time_table (stream, n + 1))
+    return FALSE;
+  if (stream->n_time_runs > 1) {
+    prev = run - 1;
+    base = run->timestamp - prev->timestamp;
+    if (prev->table == QTDEMUX_NO_TIME_TABLE ||
+        prev->table + (run->first_sample - prev->first_sample) + 1 !=
+        stream->time_table_len ||
+        stream->time_table[stream->time_table_len - 1] != base ||
+        base + (guint64) n * run->step > G_MAXUINT32)
+      prev = NULL;
+  }
+
+  if (prev == NULL) {
+    base = 0;
+    run->table = stream->time_table_len;
+    stream->time_table[stream->time_table_len++] = 0;
+  }
+  for (i = 1; i <= n; i++)
+    stream->time_table[stream->time_table_len++] =
+        base + (guint64) i * run->step;
+
+  if (prev != NULL)
+    stream->n_time_runs--;
+
+  return TRUE;
+}
+
+/* set the timing of sample @index, which must be the sample after the last
+ * one that got its timing */
+static gboolean
+qtdemux_stream_add_sample_time (QtDemuxStream * stream, guint32 index,
+    guint64 timestamp, guint32 duration, gint32 step)
+{
+  QtDemuxTimeRun *run;
+
+  if (G_LIKELY (stream->n_time_runs > 0)) {
+    guint32 n;
+
+    /* the last run is never a table run */
+    run = &stream->time_runs[stream->n_time_runs - 1];
+    n = index - run->first_sample;
+
+    /* extend the last run */
+    if (run->duration == duration && run->step == step &&
+        run->timestamp + (gint64) n * step == timestamp)
+      return TRUE;
+
+    /* a short run of samples that follow each other goes to the time
+     * table */
+    if (n < QTDEMUX_MIN_TIME_RUN && run->step >= 0 &&
+        run->step == (gint32) run->duration &&
+        !qtdemux_stream_fold_time_run (stream, n))
+      return FALSE;
+  }
+
+  if (stream->n_time_runs == stream->time_runs_size) {
+    guint32 size = MAX (16, stream->time_runs_size * 2);
+
+    run = g_try_renew (QtDemuxTimeRun, stream->time_runs, size);
+    if (run == NULL)
+      return FALSE;
+    stream->time_runs = run;
+    stream->time_runs_size = size;
+  }
+
+  run = &stream->time_runs[stream->n_time_runs++];
+  run->timestamp = timestamp;
+  run->step = step;
+  run->first_sample = index;
+  run->duration = duration;
+  run->table = QTDEMUX_NO_TIME_TABLE;
+
+  return TRUE;
+}
+
 enum QtDemuxState
 {
   QTDEMUX_STATE_INITIAL,        /* Initial state (haven't got the header yet) */
@@ -408,10 +671,22 @@ GST_STATIC_PAD_TEMPLATE ("subtitle_%u",
     GST_PAD_SOMETIMES,
     GST_STATIC_CAPS_ANY);
 
+#define DEFAULT_READ_AHEAD 0
+
+enum
+{
+  PROP_0,
+  PROP_READ_AHEAD
+};
+
 #define gst_qtdemux_parent_class parent_class
 G_DEFINE_TYPE (GstQTDemux, gst_qtdemux, GST_TYPE_ELEMENT);
 
 static void gst_qtdemux_dispose (GObject * object);
+static void gst_qtdemux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_qtdemux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 static guint32
 gst_qtdemux_find_index_linear (GstQTDemux * qtdemux, QtDemuxStream * str,
@@ -470,6 +745,8 @@ static void gst_qtdemux_stream_free (GstQTDemux * qtdemux,
 static void gst_qtdemux_stream_clear (QtDemuxStream * stream);
 static void gst_qtdemux_remove_stream (GstQTDemux * qtdemux, int index);
 static GstFlowReturn qtdemux_prepare_streams (GstQTDemux * qtdemux);
+static GstFlowReturn qtdemux_seek_fragment (GstQTDemux * qtdemux,
+    GstClockTime time);
 static void qtdemux_do_allocation (GstQTDemux * qtdemux,
     QtDemuxStream * stream);
 
@@ -485,6 +762,8 @@ gst_qtdemux_class_init (GstQTDemuxClass * klass)
   parent_class = g_type_class_peek_parent (klass);
 
   gobject_class->dispose = gst_qtdemux_dispose;
+  gobject_class->set_property = gst_qtdemux_set_property;
+  gobject_class->get_property = gst_qtdemux_get_property;
 
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_qtdemux_change_state);
 #if 0
@@ -492,6 +771,24 @@ gst_qtdemux_class_init (GstQTDemuxClass * klass)
   gstelement_class->get_index = GST_DEBUG_FUNCPTR (gst_qtdemux_get_index);
 #endif
 
+  /**
+   * GstQTDemux:read-ahead:
+   *
+   * In pull mode, read this many bytes at once when the next samples of the
+   * streams are stored next to each other in the file and hand out the
+   * samples from that data, instead of pulling every sample on its own.
+   * This saves a lot of requests with sources where each pull has a high
+   * latency, like network file systems or HTTP. 0 pulls every sample
+   * separately.
+   *
+   * Since: 1.4
+   */
+  g_object_class_install_property (gobject_class, PROP_READ_AHEAD,
+      g_param_spec_uint ("read-ahead", "Read ahead",
+          "Bytes of adjacent samples to pull at once in pull mode "
+          "(0 = disabled)", 0, QTDEMUX_MAX_ATOM_SIZE,
+          DEFAULT_READ_AHEAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_tag_register_musicbrainz_tags ();
 
   gst_element_class_add_pad_template (gstelement_class,
@@ -545,6 +842,13 @@ gst_qtdemux_init (GstQTDemux * qtdemux)
   qtdemux->upstream_newsegment = FALSE;
   qtdemux->have_group_id = FALSE;
   qtdemux->group_id = G_MAXUINT;
+  qtdemux->read_ahead = DEFAULT_READ_AHEAD;
+  qtdemux->read_ahead_buffer = NULL;
+  qtdemux->read_ahead_offset = 0;
+  qtdemux->fragment_index = NULL;
+  qtdemux->fragment_index_done = FALSE;
+  qtdemux->fragment_seek = GST_CLOCK_TIME_NONE;
+  qtdemux->lazy_moov_data = NULL;
   gst_segment_init (&qtdemux->segment, GST_FORMAT_TIME);
 
   GST_OBJECT_FLAG_SET (qtdemux, GST_ELEMENT_FLAG_INDEXABLE);
@@ -559,10 +863,51 @@ gst_qtdemux_dispose (GObject * object)
     g_object_unref (G_OBJECT (qtdemux->adapter));
     qtdemux->adapter = NULL;
   }
+  gst_buffer_replace (&qtdemux->read_ahead_buffer, NULL);
+  if (qtdemux->fragment_index) {
+    g_array_free (qtdemux->fragment_index, TRUE);
+    qtdemux->fragment_index = NULL;
+  }
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+static void
+gst_qtdemux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstQTDemux *qtdemux = GST_QTDEMUX (object);
+
+  switch (prop_id) {
+    case PROP_READ_AHEAD:
+      GST_OBJECT_LOCK (qtdemux);
+      qtdemux->read_ahead = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (qtdemux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_qtdemux_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstQTDemux *qtdemux = GST_QTDEMUX (object);
+
+  switch (prop_id) {
+    case PROP_READ_AHEAD:
+      GST_OBJECT_LOCK (qtdemux);
+      g_value_set_uint (value, qtdemux->read_ahead);
+      GST_OBJECT_UNLOCK (qtdemux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_qtdemux_post_no_playable_stream_error (GstQTDemux * qtdemux)
 {
@@ -688,8 +1033,8 @@ gst_qtdemux_src_convert (GstPad * pad, GstFormat src_format, gint64 src_value,
             return FALSE;
 
           *dest_value =
-              gst_util_uint64_scale (stream->samples[index].timestamp,
-              GST_SECOND, stream->timescale);
+              gst_util_uint64_scale (qtdemux_sample_get_timestamp (stream,
+                  index), GST_SECOND, stream->timescale);
           GST_DEBUG_OBJECT (qtdemux, "Format Conversion Offset->Time :%"
               G_GUINT64_FORMAT "->%" GST_TIME_FORMAT,
               src_value, GST_TIME_ARGS (*dest_value));
@@ -917,22 +1262,9 @@ gst_qtdemux_push_pending_newsegment (GstQTDemux * qtdemux)
   }
 }
 
-typedef struct
-{
-  guint64 media_time;
-} FindData;
-
-static gint
-find_func (QtDemuxSample * s1, guint64 * media_time, gpointer user_data)
-{
-  if (s1->timestamp > *media_time)
-    return 1;
-
-  return -1;
-}
-
 /* find the index of the sample that includes the data for @media_time using a
- * binary search.  Only to be called in optimized cases of linear search below.
+ * binary search on the time runs.  Only to be called in optimized cases of
+ * linear search below.
  *
  * Returns the index of the sample.
  */
@@ -940,23 +1272,62 @@ static guint32
 gst_qtdemux_find_index (GstQTDemux * qtdemux, QtDemuxStream * str,
     guint64 media_time)
 {
-  QtDemuxSample *result;
-  guint32 index;
+  QtDemuxTimeRun *runs = str->time_runs;
+  QtDemuxTimeRun *run;
+  guint32 n_runs = str->n_time_runs;
+  guint32 lo, hi, end;
 
   /* convert media_time to mov format */
   media_time =
       gst_util_uint64_scale_ceil (media_time, str->timescale, GST_SECOND);
 
-  result = gst_util_array_binary_search (str->samples, str->stbl_index + 1,
-      sizeof (QtDemuxSample), (GCompareDataFunc) find_func,
-      GST_SEARCH_MODE_BEFORE, &media_time, NULL);
+  if (G_UNLIKELY (n_runs == 0 || runs[0].timestamp > media_time))
+    return 0;
 
-  if (G_LIKELY (result))
-    index = result - str->samples;
+  /* the last run that starts before @media_time */
+  lo = 0;
+  hi = n_runs;
+  while (hi - lo > 1) {
+    guint32 mid = lo + (hi - lo) / 2;
+
+    if (runs[mid].timestamp <= media_time)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  run = &runs[lo];
+
+  /* the run ends at the next run or at the last parsed sample */
+  if (lo + 1 < n_runs)
+    end = runs[lo + 1].first_sample;
   else
-    index = 0;
+    end = str->stbl_index + 1;
 
-  return index;
+  if (G_UNLIKELY (end <= run->first_sample))
+    return run->first_sample;
+
+  if (run->table != QTDEMUX_NO_TIME_TABLE) {
+    guint32 *table = str->time_table + run->table;
+
+    /* the last sample of the table run that starts before @media_time */
+    lo = 0;
+    hi = end - run->first_sample;
+    while (hi - lo > 1) {
+      guint32 mid = lo + (hi - lo) / 2;
+
+      if (table[mid] <= media_time - run->timestamp)
+        lo = mid;
+      else
+        hi = mid;
+    }
+    return run->first_sample + lo;
+  }
+
+  if (run->step <= 0)
+    return end - 1;
+
+  return run->first_sample + MIN ((media_time - run->timestamp) / run->step,
+      end - 1 - run->first_sample);
 }
 
 
@@ -1017,19 +1388,19 @@ gst_qtdemux_find_index_linear (GstQTDemux * qtdemux, QtDemuxStream * str,
   mov_time =
       gst_util_uint64_scale_ceil (media_time, str->timescale, GST_SECOND);
 
-  if (mov_time == str->samples[0].timestamp)
+  if (mov_time == qtdemux_sample_get_timestamp (str, 0))
     return index;
 
   /* use faster search if requested time in already parsed range */
   if (str->stbl_index >= 0 &&
-      mov_time <= str->samples[str->stbl_index].timestamp)
+      mov_time <= qtdemux_sample_get_timestamp (str, str->stbl_index))
     return gst_qtdemux_find_index (qtdemux, str, media_time);
 
   while (index < str->n_samples - 1) {
     if (!qtdemux_parse_samples (qtdemux, str, index + 1))
       goto parse_failed;
 
-    if (mov_time < str->samples[index + 1].timestamp)
+    if (mov_time < qtdemux_sample_get_timestamp (str, index + 1))
       break;
 
     index++;
@@ -1068,7 +1439,7 @@ gst_qtdemux_find_keyframe (GstQTDemux * qtdemux, QtDemuxStream * str,
 
   /* else go back until we have a keyframe */
   while (TRUE) {
-    if (str->samples[new_index].keyframe)
+    if (QTSAMPLE_IS_KEYFRAME (str, new_index))
       break;
 
     if (new_index == 0)
@@ -1203,8 +1574,8 @@ gst_qtdemux_adjust_seek (GstQTDemux * qtdemux, gint64 desired_time,
 
       /* get timestamp of keyframe */
       media_time =
-          gst_util_uint64_scale (str->samples[kindex].timestamp, GST_SECOND,
-          str->timescale);
+          gst_util_uint64_scale (qtdemux_sample_get_timestamp (str, kindex),
+          GST_SECOND, str->timescale);
       GST_DEBUG_OBJECT (qtdemux, "keyframe at %u with time %" GST_TIME_FORMAT
           " at offset %" G_GUINT64_FORMAT,
           kindex, GST_TIME_ARGS (media_time), str->samples[kindex].offset);
@@ -1389,6 +1760,11 @@ gst_qtdemux_perform_seek (GstQTDemux * qtdemux, GstSegment * segment,
     desired_offset = min_offset;
   }
 
+  /* the moofs may have to be parsed again from the one of the target, which
+   * is done in the streaming thread as upstream may be flushing now */
+  if (qtdemux->fragmented)
+    qtdemux->fragment_seek = desired_offset;
+
   /* and set all streams to the final position */
   for (n = 0; n < qtdemux->n_streams; n++) {
     QtDemuxStream *stream = qtdemux->streams[n];
@@ -1669,7 +2045,8 @@ gst_qtdemux_find_sample (GstQTDemux * qtdemux, gint64 byte_pos, gboolean fw,
       /* avoid index from sparse streams since they might be far away */
       if (!str->sparse) {
         /* determine min/max time */
-        time = str->samples[i].timestamp + str->samples[i].pts_offset;
+        time =
+            qtdemux_sample_get_timestamp (str, i) + str->samples[i].pts_offset;
         time = gst_util_uint64_scale (time, GST_SECOND, str->timescale);
         if (min_time == -1 || (!fw && time > min_time) ||
             (fw && time < min_time)) {
@@ -1824,6 +2201,8 @@ gst_qtdemux_reset (GstQTDemux * qtdemux, gboolean hard)
     qtdemux->mdatbuffer = NULL;
     qtdemux->restoredata_buffer = NULL;
     qtdemux->mdatleft = 0;
+    gst_buffer_replace (&qtdemux->read_ahead_buffer, NULL);
+    qtdemux->read_ahead_offset = 0;
     if (qtdemux->comp_brands)
       gst_buffer_unref (qtdemux->comp_brands);
     qtdemux->comp_brands = NULL;
@@ -1853,6 +2232,12 @@ gst_qtdemux_reset (GstQTDemux * qtdemux, gboolean hard)
     qtdemux->duration = 0;
     qtdemux->mfra_offset = 0;
     qtdemux->moof_offset = 0;
+    qtdemux->first_moof_offset = 0;
+    if (qtdemux->fragment_index)
+      g_array_free (qtdemux->fragment_index, TRUE);
+    qtdemux->fragment_index = NULL;
+    qtdemux->fragment_index_done = FALSE;
+    qtdemux->fragment_seek = GST_CLOCK_TIME_NONE;
     qtdemux->chapters_track_id = 0;
     qtdemux->have_group_id = FALSE;
     qtdemux->group_id = G_MAXUINT;
@@ -2129,6 +2514,28 @@ gst_qtdemux_stbl_free (QtDemuxStream * stream)
   stream->ctts.data = NULL;
 }
 
+/* drop the sample table, used when the samples of a fragmented file are
+ * parsed again from another moof */
+static void
+gst_qtdemux_stream_flush_samples (QtDemuxStream * stream)
+{
+  g_free (stream->samples);
+  stream->samples = NULL;
+  g_free (stream->keyframes);
+  stream->keyframes = NULL;
+  g_free (stream->time_runs);
+  stream->time_runs = NULL;
+  stream->n_time_runs = 0;
+  stream->time_runs_size = 0;
+  g_free (stream->time_table);
+  stream->time_table = NULL;
+  stream->time_table_len = 0;
+  stream->time_table_size = 0;
+  stream->sample_index = -1;
+  stream->stbl_index = -1;
+  stream->n_samples = 0;
+}
+
 static void
 gst_qtdemux_stream_clear (QtDemuxStream * stream)
 {
@@ -2142,8 +2549,7 @@ gst_qtdemux_stream_clear (QtDemuxStream * stream)
     gst_memory_unref (stream->rgb8_palette);
     stream->rgb8_palette = NULL;
   }
-  g_free (stream->samples);
-  stream->samples = NULL;
+  gst_qtdemux_stream_flush_samples (stream);
   g_free (stream->segments);
   stream->segments = NULL;
   if (stream->pending_tags)
@@ -2158,9 +2564,6 @@ gst_qtdemux_stream_clear (QtDemuxStream * stream)
   stream->sent_eos = FALSE;
   stream->segment_index = -1;
   stream->time_position = 0;
-  stream->sample_index = -1;
-  stream->stbl_index = -1;
-  stream->n_samples = 0;
   stream->sparse = FALSE;
 }
 
@@ -2437,7 +2840,7 @@ static gboolean
 qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
     QtDemuxStream * stream, guint32 d_sample_duration, guint32 d_sample_size,
     guint32 d_sample_flags, gint64 moof_offset, gint64 moof_length,
-    gint64 * base_offset, gint64 * running_offset)
+    gint64 * base_offset, gint64 * running_offset, guint64 decode_time)
 {
   guint64 timestamp;
   gint32 data_offset = 0;
@@ -2547,13 +2950,17 @@ qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
       stream->n_samples * sizeof (QtDemuxSample) / (1024.0 * 1024.0));
 
   /* create a new array of samples if it's the first sample parsed */
-  if (stream->n_samples == 0)
+  if (stream->n_samples == 0) {
     stream->samples = g_try_new0 (QtDemuxSample, samples_count);
-  /* or try to reallocate it with space enough to insert the new samples */
-  else
+    stream->keyframes = g_try_new0 (guint32, (samples_count + 31) / 32);
+  } else {
+    /* or try to reallocate it with space enough to insert the new samples */
     stream->samples = g_try_renew (QtDemuxSample, stream->samples,
         stream->n_samples + samples_count);
-  if (stream->samples == NULL)
+    stream->keyframes = g_try_renew (guint32, stream->keyframes,
+        (stream->n_samples + samples_count + 31) / 32);
+  }
+  if (stream->samples == NULL || stream->keyframes == NULL)
     goto out_of_memory;
 
   if (qtdemux->fragment_start != -1) {
@@ -2565,11 +2972,20 @@ qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
       /* the timestamp of the first sample is also provided by the tfra entry
        * but we shouldn't rely on it as it is at the end of files */
       timestamp = 0;
+      /* the tfdt of the first fragment is the origin of the timestamps, after
+       * a seek the samples can also start at a later fragment */
+      if (decode_time == -1) {
+        /* no tfdt */
+      } else if (!stream->samples_from_tfdt) {
+        stream->first_tfdt = decode_time;
+      } else if (decode_time > stream->first_tfdt) {
+        timestamp = decode_time - stream->first_tfdt;
+      }
     } else {
       /* subsequent fragments extend stream */
       timestamp =
-          stream->samples[stream->n_samples - 1].timestamp +
-          stream->samples[stream->n_samples - 1].duration;
+          qtdemux_sample_get_timestamp (stream, stream->n_samples - 1) +
+          qtdemux_sample_get_duration (stream, stream->n_samples - 1);
     }
   }
   sample = stream->samples + stream->n_samples;
@@ -2609,12 +3025,14 @@ qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
     sample->offset = *running_offset;
     sample->pts_offset = ct;
     sample->size = size;
-    sample->timestamp = timestamp;
-    sample->duration = dur;
+    if (!qtdemux_stream_add_sample_time (stream, stream->n_samples + i,
+            timestamp, dur, dur))
+      goto out_of_memory;
     /* sample-is-difference-sample */
     /* ismv seems to use 0x40 for keyframe, 0xc0 for non-keyframe,
      * now idea how it relates to bitfield other than massive LE/BE confusion */
-    sample->keyframe = ismv ? ((sflags & 0xff) == 0x40) : !(sflags & 0x10000);
+    QTSAMPLE_SET_KEYFRAME (stream, stream->n_samples + i,
+        ismv ? ((sflags & 0xff) == 0x40) : !(sflags & 0x10000));
     *running_offset += size;
     timestamp += dur;
     sample++;
@@ -2777,6 +3195,7 @@ qtdemux_parse_moof (GstQTDemux * qtdemux, const guint8 * buffer, guint length,
   GstByteReader trun_data, tfhd_data, tfdt_data;
   guint32 ds_size = 0, ds_duration = 0, ds_flags = 0;
   gint64 base_offset, running_offset;
+  guint64 decode_time;
 
   /* NOTE @stream ignored */
 
@@ -2800,12 +3219,11 @@ qtdemux_parse_moof (GstQTDemux * qtdemux, const guint8 * buffer, guint length,
     tfdt_node =
         qtdemux_tree_get_child_by_type_full (traf_node, FOURCC_tfdt,
         &tfdt_data);
-    if (tfdt_node) {
-      guint64 decode_time = 0;
+    decode_time = -1;
+    if (tfdt_node && stream &&
+        qtdemux_parse_tfdt (qtdemux, &tfdt_data, &decode_time)) {
       GstClockTime decode_time_ts;
 
-      qtdemux_parse_tfdt (qtdemux, &tfdt_data, &decode_time);
-
       /* FIXME, we can use decode_time to interpolate timestamps
        * in case the input timestamps are missing */
       decode_time_ts = gst_util_uint64_scale (decode_time, GST_SECOND,
@@ -2831,7 +3249,7 @@ qtdemux_parse_moof (GstQTDemux * qtdemux, const guint8 * buffer, guint length,
     while (trun_node) {
       qtdemux_parse_trun (qtdemux, &trun_data, stream,
           ds_duration, ds_size, ds_flags, moof_offset, length, &base_offset,
-          &running_offset);
+          &running_offset, decode_time);
       /* iterate all siblings */
       trun_node = qtdemux_tree_get_sibling_by_type_full (trun_node, FOURCC_trun,
           &trun_data);
@@ -3049,6 +3467,140 @@ qtdemux_parse_fragmented (GstQTDemux * qtdemux)
 }
 #endif
 
+typedef struct
+{
+  GstQTDemux *qtdemux;
+  guint64 offset;               /* file offset of the moov */
+  guint8 *data;
+  guint size;
+  GstBuffer *block;             /* last block read from the file */
+  guint block_offset;           /* offset of block in the moov */
+} QtDemuxLazyMoov;
+
+/* copy @size bytes at @pos of the moov from the file */
+static GstFlowReturn
+qtdemux_lazy_moov_read (QtDemuxLazyMoov * moov, guint pos, guint size)
+{
+  GstFlowReturn ret;
+  gsize block_size;
+  guint len;
+
+  while (size > 0) {
+    block_size = moov->block ? gst_buffer_get_size (moov->block) : 0;
+
+    if (moov->block == NULL || pos < moov->block_offset ||
+        pos >= moov->block_offset + block_size) {
+      gst_buffer_replace (&moov->block, NULL);
+      moov->block_offset = pos;
+      block_size = MIN (QTDEMUX_LAZY_BLOCK_SIZE, moov->size - pos);
+
+      ret = gst_pad_pull_range (moov->qtdemux->sinkpad, moov->offset + pos,
+          block_size, &moov->block);
+      if (ret != GST_FLOW_OK)
+        return ret;
+      if (gst_buffer_get_size (moov->block) < MIN (size, block_size))
+        return GST_FLOW_EOS;
+      block_size = gst_buffer_get_size (moov->block);
+    }
+
+    len = MIN (size, moov->block_offset + block_size - pos);
+    gst_buffer_extract (moov->block, pos - moov->block_offset,
+        moov->data + pos, len);
+    pos += len;
+    size -= len;
+  }
+  return GST_FLOW_OK;
+}
+
+/* read the atoms of a container from @pos to @end, only the start of large
+ * sample tables is read */
+static GstFlowReturn
+qtdemux_lazy_moov_read_container (QtDemuxLazyMoov * moov, guint pos,
+    guint end)
+{
+  GstFlowReturn ret;
+  guint32 len, fourcc;
+
+  while (pos + 8 <= end) {
+    if ((ret = qtdemux_lazy_moov_read (moov, pos, 8)) != GST_FLOW_OK)
+      return ret;
+
+    len = QT_UINT32 (moov->data + pos);
+    fourcc = QT_FOURCC (moov->data + pos + 4);
+
+    /* let the parser deal with broken atoms */
+    if (len < 8 || len > end - pos)
+      return qtdemux_lazy_moov_read (moov, pos + 8, end - pos - 8);
+
+    switch (fourcc) {
+      case FOURCC_trak:
+      case FOURCC_mdia:
+      case FOURCC_minf:
+      case FOURCC_stbl:
+        ret = qtdemux_lazy_moov_read_container (moov, pos + 8, pos + len);
+        break;
+      case FOURCC_stts:
+      case FOURCC_stss:
+      case FOURCC_stps:
+      case FOURCC_stsz:
+      case FOURCC_stsc:
+      case FOURCC_stco:
+      case FOURCC_co64:
+      case FOURCC_ctts:
+        /* the rest is read by qtdemux_stbl_load() */
+        ret = qtdemux_lazy_moov_read (moov, pos + 8,
+            MIN (len, QTDEMUX_LAZY_TABLE_SIZE) - 8);
+        break;
+      default:
+        ret = qtdemux_lazy_moov_read (moov, pos + 8, len - 8);
+        break;
+    }
+    if (ret != GST_FLOW_OK)
+      return ret;
+
+    pos += len;
+  }
+  return qtdemux_lazy_moov_read (moov, pos, end - pos);
+}
+
+/* read the moov of @length bytes at @offset without the bulk of its sample
+ * tables, which are only needed as playback progresses */
+static GstFlowReturn
+qtdemux_pull_moov_lazy (GstQTDemux * qtdemux, guint64 offset, guint length,
+    GstBuffer ** buf)
+{
+  QtDemuxLazyMoov moov;
+  GstFlowReturn ret;
+
+  moov.qtdemux = qtdemux;
+  moov.offset = offset;
+  moov.size = length;
+  moov.data = g_try_malloc0 (length);
+  moov.block = NULL;
+  moov.block_offset = 0;
+  if (moov.data == NULL) {
+    GST_WARNING_OBJECT (qtdemux, "failed to allocate moov of %u bytes",
+        length);
+    return GST_FLOW_ERROR;
+  }
+
+  GST_DEBUG_OBJECT (qtdemux, "reading moov of %u bytes lazily", length);
+
+  ret = qtdemux_lazy_moov_read (&moov, 0, 8);
+  if (ret == GST_FLOW_OK)
+    ret = qtdemux_lazy_moov_read_container (&moov, 8, length);
+  gst_buffer_replace (&moov.block, NULL);
+
+  if (ret != GST_FLOW_OK) {
+    g_free (moov.data);
+    return ret;
+  }
+
+  *buf = _gst_buffer_new_wrapped (moov.data, length, g_free);
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_qtdemux_loop_state_header (GstQTDemux * qtdemux)
 {
@@ -3100,6 +3652,7 @@ gst_qtdemux_loop_state_header (GstQTDemux * qtdemux)
     case FOURCC_moov:
     {
       GstBuffer *moov = NULL;
+      gboolean lazy = FALSE;
 
       if (qtdemux->got_moov) {
         GST_DEBUG_OBJECT (qtdemux, "Skipping moov atom as we have one already");
@@ -3107,9 +3660,21 @@ gst_qtdemux_loop_state_header (GstQTDemux * qtdemux)
         goto beach;
       }
 
-      ret = gst_pad_pull_range (qtdemux->sinkpad, cur_offset, length, &moov);
-      if (ret != GST_FLOW_OK)
-        goto beach;
+      /* large moov atoms are mostly sample tables, which we don't need
+       * completely to start playback */
+      if (length > QTDEMUX_LAZY_MOOV_SIZE && length <= G_MAXUINT) {
+        ret = qtdemux_pull_moov_lazy (qtdemux, cur_offset, length, &moov);
+        if (ret == GST_FLOW_OK)
+          lazy = TRUE;
+        else if (ret == GST_FLOW_FLUSHING)
+          goto beach;
+      }
+      /* otherwise read it completely, which also handles truncated atoms */
+      if (moov == NULL) {
+        ret = gst_pad_pull_range (qtdemux->sinkpad, cur_offset, length, &moov);
+        if (ret != GST_FLOW_OK)
+          goto beach;
+      }
       gst_buffer_map (moov, &map, GST_MAP_READ);
 
       if (length != map.size) {
@@ -3150,10 +3715,17 @@ gst_qtdemux_loop_state_header (GstQTDemux * qtdemux)
       }
       qtdemux->offset += length;
 
+      if (lazy) {
+        qtdemux->lazy_moov_data = map.data;
+        qtdemux->lazy_moov_size = length;
+        qtdemux->lazy_moov_offset = cur_offset;
+      }
+
       qtdemux_parse_moov (qtdemux, map.data, length);
       qtdemux_node_dump (qtdemux, qtdemux->moov_node);
 
       qtdemux_parse_tree (qtdemux);
+      qtdemux->lazy_moov_data = NULL;
       g_node_destroy (qtdemux->moov_node);
       gst_buffer_unmap (moov, &map);
       gst_buffer_unref (moov);
@@ -3296,7 +3868,8 @@ gst_qtdemux_seek_to_previous_keyframe (GstQTDemux * qtdemux)
   seg_media_start_mov =
       gst_util_uint64_scale (seg->media_start, ref_str->timescale, GST_SECOND);
   /* Crawl back through segments to find the one containing this I frame */
-  while (ref_str->samples[k_index].timestamp < seg_media_start_mov) {
+  while (qtdemux_sample_get_timestamp (ref_str,
+          k_index) < seg_media_start_mov) {
     GST_DEBUG_OBJECT (qtdemux, "keyframe position is out of segment %u",
         ref_str->segment_index);
     if (G_UNLIKELY (!ref_str->segment_index)) {
@@ -3312,11 +3885,11 @@ gst_qtdemux_seek_to_previous_keyframe (GstQTDemux * qtdemux)
   }
   /* Calculate time position of the keyframe and where we should stop */
   k_pos =
-      (gst_util_uint64_scale (ref_str->samples[k_index].timestamp, GST_SECOND,
-          ref_str->timescale) - seg->media_start) + seg->time;
+      (gst_util_uint64_scale (qtdemux_sample_get_timestamp (ref_str, k_index),
+          GST_SECOND, ref_str->timescale) - seg->media_start) + seg->time;
   last_stop =
-      gst_util_uint64_scale (ref_str->samples[ref_str->from_sample].timestamp,
-      GST_SECOND, ref_str->timescale);
+      gst_util_uint64_scale (qtdemux_sample_get_timestamp (ref_str,
+          ref_str->from_sample), GST_SECOND, ref_str->timescale);
   last_stop = (last_stop - seg->media_start) + seg->time;
 
   GST_DEBUG_OBJECT (qtdemux, "preferred stream played from sample %u, "
@@ -3379,8 +3952,8 @@ gst_qtdemux_seek_to_previous_keyframe (GstQTDemux * qtdemux)
     str->to_sample = str->from_sample - 1;
     /* Define our time position */
     str->time_position =
-        (gst_util_uint64_scale (str->samples[k_index].timestamp, GST_SECOND,
-            str->timescale) - seg->media_start) + seg->time;
+        (gst_util_uint64_scale (qtdemux_sample_get_timestamp (str, k_index),
+            GST_SECOND, str->timescale) - seg->media_start) + seg->time;
     /* Now seek back in time */
     gst_qtdemux_move_stream (qtdemux, str, k_index);
     GST_DEBUG_OBJECT (qtdemux, "keyframe at %u, time position %"
@@ -3525,15 +4098,17 @@ gst_qtdemux_activate_segment (GstQTDemux * qtdemux, QtDemuxStream * stream,
       stream->to_sample = G_MAXUINT32;
       GST_DEBUG_OBJECT (qtdemux, "moving data pointer to %" GST_TIME_FORMAT
           ", index: %u, pts %" GST_TIME_FORMAT, GST_TIME_ARGS (start), index,
-          GST_TIME_ARGS (gst_util_uint64_scale (stream->
-                  samples[index].timestamp, GST_SECOND, stream->timescale)));
+          GST_TIME_ARGS (gst_util_uint64_scale
+              (qtdemux_sample_get_timestamp (stream, index), GST_SECOND,
+                  stream->timescale)));
     } else {
       index = gst_qtdemux_find_index_linear (qtdemux, stream, stop);
       stream->to_sample = index;
       GST_DEBUG_OBJECT (qtdemux, "moving data pointer to %" GST_TIME_FORMAT
           ", index: %u, pts %" GST_TIME_FORMAT, GST_TIME_ARGS (stop), index,
-          GST_TIME_ARGS (gst_util_uint64_scale (stream->
-                  samples[index].timestamp, GST_SECOND, stream->timescale)));
+          GST_TIME_ARGS (gst_util_uint64_scale
+              (qtdemux_sample_get_timestamp (stream, index), GST_SECOND,
+                  stream->timescale)));
     }
   } else {
     GST_DEBUG_OBJECT (qtdemux, "No need to look for keyframe, "
@@ -3567,7 +4142,7 @@ gst_qtdemux_activate_segment (GstQTDemux * qtdemux, QtDemuxStream * stream,
       GST_DEBUG_OBJECT (qtdemux,
           "moving forwards to keyframe at %u (pts %" GST_TIME_FORMAT, kf_index,
           GST_TIME_ARGS (gst_util_uint64_scale (
-                  stream->samples[kf_index].timestamp,
+                  qtdemux_sample_get_timestamp (stream, kf_index),
                   GST_SECOND, stream->timescale)));
       gst_qtdemux_move_stream (qtdemux, stream, kf_index);
     } else {
@@ -3575,14 +4150,14 @@ gst_qtdemux_activate_segment (GstQTDemux * qtdemux, QtDemuxStream * stream,
           "moving forwards, keyframe at %u (pts %" GST_TIME_FORMAT
           " already sent", kf_index,
           GST_TIME_ARGS (gst_util_uint64_scale (
-                  stream->samples[kf_index].timestamp,
+                  qtdemux_sample_get_timestamp (stream, kf_index),
                   GST_SECOND, stream->timescale)));
     }
   } else {
     GST_DEBUG_OBJECT (qtdemux,
         "moving backwards to keyframe at %u (pts %" GST_TIME_FORMAT, kf_index,
         GST_TIME_ARGS (gst_util_uint64_scale (
-                stream->samples[kf_index].timestamp,
+                qtdemux_sample_get_timestamp (stream, kf_index),
                 GST_SECOND, stream->timescale)));
     gst_qtdemux_move_stream (qtdemux, stream, kf_index);
   }
@@ -3720,16 +4295,16 @@ gst_qtdemux_advance_sample (GstQTDemux * qtdemux, QtDemuxStream * stream)
   sample = &stream->samples[stream->sample_index];
 
   /* see if we are past the segment */
-  if (G_UNLIKELY (gst_util_uint64_scale (sample->timestamp,
+  if (G_UNLIKELY (gst_util_uint64_scale (QTSAMPLE_TIMESTAMP (stream, sample),
               GST_SECOND, stream->timescale) >= segment->media_stop))
     goto next_segment;
 
-  if (gst_util_uint64_scale (sample->timestamp, GST_SECOND,
+  if (gst_util_uint64_scale (QTSAMPLE_TIMESTAMP (stream, sample), GST_SECOND,
           stream->timescale) >= segment->media_start) {
     /* inside the segment, update time_position, looks very familiar to
      * GStreamer segments, doesn't it? */
     stream->time_position =
-        (gst_util_uint64_scale (sample->timestamp, GST_SECOND,
+        (gst_util_uint64_scale (QTSAMPLE_TIMESTAMP (stream, sample), GST_SECOND,
             stream->timescale) - segment->media_start) + segment->time;
   } else {
     /* not yet in segment, time does not yet increment. This means
@@ -4186,6 +4761,118 @@ exit:
   return ret;
 }
 
+/* get the end of the data to pull from @offset so that it covers the
+ * following samples of all streams that are in the next @max bytes of the
+ * file */
+static guint64
+gst_qtdemux_read_ahead_end (GstQTDemux * qtdemux, guint64 offset,
+    guint64 end, guint max)
+{
+  gint i;
+
+  for (i = 0; i < qtdemux->n_streams; i++) {
+    QtDemuxStream *str = qtdemux->streams[i];
+    guint32 index;
+
+    /* EOS or disabled streams, their data is not needed */
+    if (str->time_position == -1 || str->pad == NULL)
+      continue;
+
+    for (index = str->sample_index; index < str->n_samples; index++) {
+      QtDemuxSample *sample;
+      guint64 start;
+
+      if (!qtdemux_parse_samples (qtdemux, str, index))
+        break;
+
+      sample = &str->samples[index];
+      /* the current sample might have been pushed partially already, only
+       * its remaining data is needed */
+      start = sample->offset;
+      if (index == str->sample_index)
+        start += str->offset_in_sample;
+
+      /* samples of a stream are normally stored in increasing order, stop
+       * when the data is not ahead of us or does not fit in the window */
+      if (start < offset || sample->offset + sample->size > offset + max)
+        break;
+
+      end = MAX (end, sample->offset + sample->size);
+    }
+  }
+  return end;
+}
+
+/* pull @size bytes of sample data at @offset, from the data that was read
+ * ahead when possible */
+static GstFlowReturn
+gst_qtdemux_pull_sample (GstQTDemux * qtdemux, guint64 offset, guint size,
+    GstBuffer ** buf)
+{
+  GstFlowReturn ret;
+  guint64 end;
+  guint read_ahead;
+
+  GST_OBJECT_LOCK (qtdemux);
+  read_ahead = qtdemux->read_ahead;
+  GST_OBJECT_UNLOCK (qtdemux);
+
+  if (read_ahead == 0) {
+    gst_buffer_replace (&qtdemux->read_ahead_buffer, NULL);
+    return gst_qtdemux_pull_atom (qtdemux, offset, size, buf);
+  }
+
+  /* too big to read ahead, pull it on its own and keep the window for the
+   * samples of the other streams around it */
+  if (size >= read_ahead)
+    return gst_qtdemux_pull_atom (qtdemux, offset, size, buf);
+
+  if (qtdemux->read_ahead_buffer == NULL ||
+      offset < qtdemux->read_ahead_offset ||
+      offset + size > qtdemux->read_ahead_offset +
+      gst_buffer_get_size (qtdemux->read_ahead_buffer)) {
+    gst_buffer_replace (&qtdemux->read_ahead_buffer, NULL);
+
+    end = gst_qtdemux_read_ahead_end (qtdemux, offset, offset + size,
+        read_ahead);
+
+    GST_LOG_OBJECT (qtdemux, "reading ahead %" G_GUINT64_FORMAT " bytes @ %"
+        G_GUINT64_FORMAT, end - offset, offset);
+
+    ret = gst_qtdemux_pull_atom (qtdemux, offset, end - offset,
+        &qtdemux->read_ahead_buffer);
+    if (ret == GST_FLOW_EOS && end > offset + size) {
+      /* truncated file, the sample itself might still be there */
+      return gst_qtdemux_pull_atom (qtdemux, offset, size, buf);
+    } else if (ret != GST_FLOW_OK) {
+      return ret;
+    }
+    qtdemux->read_ahead_offset = offset;
+  }
+
+  offset -= qtdemux->read_ahead_offset;
+
+  if (*buf) {
+    GstMapInfo map;
+
+    /* fill the buffer from the stream allocator */
+    if (!gst_buffer_map (*buf, &map, GST_MAP_WRITE)) {
+      gst_buffer_unref (*buf);
+      *buf = NULL;
+      return GST_FLOW_ERROR;
+    }
+    gst_buffer_extract (qtdemux->read_ahead_buffer, offset, map.data, size);
+    gst_buffer_unmap (*buf, &map);
+  } else {
+    *buf = gst_buffer_copy_region (qtdemux->read_ahead_buffer,
+        GST_BUFFER_COPY_MEMORY, offset, size);
+  }
+  if (*buf == NULL)
+    return GST_FLOW_ERROR;
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_qtdemux_loop_state_movie (GstQTDemux * qtdemux)
 {
@@ -4308,7 +4995,7 @@ gst_qtdemux_loop_state_movie (GstQTDemux * qtdemux)
     buf = gst_buffer_new_allocate (stream->allocator, size, &stream->params);
   }
 
-  ret = gst_qtdemux_pull_atom (qtdemux, offset + stream->offset_in_sample,
+  ret = gst_qtdemux_pull_sample (qtdemux, offset + stream->offset_in_sample,
       size, &buf);
   if (G_UNLIKELY (ret != GST_FLOW_OK))
     goto beach;
@@ -4329,7 +5016,8 @@ gst_qtdemux_loop_state_movie (GstQTDemux * qtdemux)
     QtDemuxSample *sample = &stream->samples[stream->sample_index];
     QtDemuxSegment *segment = &stream->segments[stream->segment_index];
 
-    GstClockTime time_position = gst_util_uint64_scale (sample->timestamp +
+    GstClockTime time_position =
+        gst_util_uint64_scale (QTSAMPLE_TIMESTAMP (stream, sample) +
         stream->offset_in_sample / stream->bytes_per_frame, GST_SECOND,
         stream->timescale);
     if (time_position >= segment->media_start) {
@@ -4399,6 +5087,14 @@ gst_qtdemux_loop (GstPad * pad)
       ret = gst_qtdemux_loop_state_header (qtdemux);
       break;
     case QTDEMUX_STATE_MOVIE:
+      if (G_UNLIKELY (qtdemux->fragment_seek != GST_CLOCK_TIME_NONE)) {
+        GstClockTime time = qtdemux->fragment_seek;
+
+        qtdemux->fragment_seek = GST_CLOCK_TIME_NONE;
+        ret = qtdemux_seek_fragment (qtdemux, time);
+        if (ret != GST_FLOW_OK)
+          break;
+      }
       ret = gst_qtdemux_loop_state_movie (qtdemux);
       if (qtdemux->segment.rate < 0 && ret == GST_FLOW_EOS) {
         ret = gst_qtdemux_seek_to_previous_keyframe (qtdemux);
@@ -6165,17 +6861,387 @@ flow_failed:
   }
 }
 
+/* bytes read from the start of each moof for the fragment index, enough for
+ * the tfhd and tfdt of its first traf */
+#define QTDEMUX_FRAGMENT_PEEK_SIZE 256
+
+/* get the decode time of the first traf in the start of a moof in @data,
+ * relative to the tfdt of the first fragment of its stream */
+static gboolean
+qtdemux_peek_moof_time (GstQTDemux * qtdemux, const guint8 * data, guint size,
+    GstClockTime * time)
+{
+  GstByteReader moof, traf, box;
+  QtDemuxStream *stream = NULL;
+  const guint8 *traf_data, *box_data;
+  guint32 length, fourcc, track_id;
+  guint64 decode_time;
+
+  gst_byte_reader_init (&moof, data, size);
+  if (!gst_byte_reader_skip (&moof, 8))
+    return FALSE;
+
+  while (gst_byte_reader_get_uint32_be (&moof, &length) &&
+      gst_byte_reader_get_uint32_le (&moof, &fourcc) && length >= 8) {
+    length = MIN (length - 8, gst_byte_reader_get_remaining (&moof));
+    if (!gst_byte_reader_get_data (&moof, length, &traf_data))
+      break;
+    if (fourcc != FOURCC_traf)
+      continue;
+
+    gst_byte_reader_init (&traf, traf_data, length);
+    while (gst_byte_reader_get_uint32_be (&traf, &length) &&
+        gst_byte_reader_get_uint32_le (&traf, &fourcc) && length >= 8) {
+      length = MIN (length - 8, gst_byte_reader_get_remaining (&traf));
+      if (!gst_byte_reader_get_data (&traf, length, &box_data))
+        break;
+      gst_byte_reader_init (&box, box_data, length);
+
+      if (fourcc == FOURCC_tfhd) {
+        if (gst_byte_reader_skip (&box, 4) &&
+            gst_byte_reader_get_uint32_be (&box, &track_id))
+          stream = qtdemux_find_stream (qtdemux, track_id);
+      } else if (fourcc == FOURCC_tfdt && stream &&
+          qtdemux_parse_tfdt (qtdemux, &box, &decode_time)) {
+        decode_time -= MIN (decode_time, stream->first_tfdt);
+        *time = gst_util_uint64_scale (decode_time, GST_SECOND,
+            stream->timescale);
+        return TRUE;
+      }
+    }
+    /* only look at the first traf */
+    break;
+  }
+
+  return FALSE;
+}
+
+/* walk the atoms from the first moof to the end of the file and index the
+ * moofs by their decode time, reading only the start of each atom. The index
+ * is only used when all the moofs have a tfdt. */
+static GstFlowReturn
+qtdemux_build_fragment_index (GstQTDemux * qtdemux)
+{
+  GArray *index;
+  QtDemuxFragment fragment;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint64 offset, length;
+  guint32 fourcc;
+  gboolean valid = TRUE;
+
+  index = g_array_new (FALSE, FALSE, sizeof (QtDemuxFragment));
+  offset = qtdemux->first_moof_offset;
+
+  while (offset) {
+    buf = NULL;
+    ret = gst_pad_pull_range (qtdemux->sinkpad, offset,
+        QTDEMUX_FRAGMENT_PEEK_SIZE, &buf);
+    if (ret != GST_FLOW_OK)
+      break;
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    if (map.size < 8) {
+      gst_buffer_unmap (buf, &map);
+      gst_buffer_unref (buf);
+      break;
+    }
+    extract_initial_length_and_fourcc (map.data, map.size, &length, &fourcc);
+    if (fourcc == FOURCC_moof) {
+      fragment.offset = offset;
+      valid = qtdemux_peek_moof_time (qtdemux, map.data, map.size,
+          &fragment.time);
+      if (valid)
+        g_array_append_val (index, fragment);
+    }
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+
+    if (!valid) {
+      GST_DEBUG_OBJECT (qtdemux, "no tfdt in moof at offset %"
+          G_GUINT64_FORMAT, offset);
+      break;
+    }
+    if (length < 8)
+      break;
+    offset += length;
+  }
+
+  /* try again on the next seek */
+  if (ret == GST_FLOW_FLUSHING) {
+    g_array_free (index, TRUE);
+    return ret;
+  }
+
+  if (valid) {
+    GST_DEBUG_OBJECT (qtdemux, "indexed %u fragments", index->len);
+    qtdemux->fragment_index = index;
+  } else {
+    g_array_free (index, TRUE);
+  }
+  qtdemux->fragment_index_done = TRUE;
+
+  return GST_FLOW_OK;
+}
+
+/* the last fragment in the index that starts at or before @time,
+ * or the first one */
+static QtDemuxFragment *
+qtdemux_find_fragment (GstQTDemux * qtdemux, GstClockTime time)
+{
+  GArray *index = qtdemux->fragment_index;
+  guint lo, hi;
+
+  lo = 0;
+  hi = index->len;
+  while (hi - lo > 1) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (g_array_index (index, QtDemuxFragment, mid).time <= time)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return &g_array_index (index, QtDemuxFragment, lo);
+}
+
+/* drop the samples of all streams and parse the moofs from @fragment on
+ * until all streams have samples again */
+/* call with OBJECT lock */
+static GstFlowReturn
+qtdemux_restart_fragments (GstQTDemux * qtdemux, QtDemuxFragment * fragment)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  gint i;
+
+  GST_DEBUG_OBJECT (qtdemux, "parsing samples from moof at offset %"
+      G_GUINT64_FORMAT ", time %" GST_TIME_FORMAT, fragment->offset,
+      GST_TIME_ARGS (fragment->time));
+
+  for (i = 0; i < qtdemux->n_streams; i++) {
+    QtDemuxStream *stream = qtdemux->streams[i];
+
+    gst_qtdemux_stream_flush_samples (stream);
+    stream->samples_from_tfdt =
+        fragment->offset != qtdemux->first_moof_offset;
+  }
+  qtdemux->moof_offset = fragment->offset;
+
+  for (i = 0; i < qtdemux->n_streams; i++) {
+    QtDemuxStream *stream = qtdemux->streams[i];
+
+    while (stream->n_samples == 0)
+      if ((ret = qtdemux_add_fragmented_samples (qtdemux)) != GST_FLOW_OK)
+        break;
+    if (stream->n_samples == 0)
+      return ret;
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* The samples of a fragmented file are only known up to the last parsed moof
+ * and parsing all the moofs up to a seek target can take long in big files
+ * without mfra. Instead, find the moof of @time in an index of all moofs,
+ * built on the first seek, and parse the samples again from there.
+ * Called from the streaming thread. */
+static GstFlowReturn
+qtdemux_seek_fragment (GstQTDemux * qtdemux, GstClockTime time)
+{
+  QtDemuxFragment *fragment;
+  GstFlowReturn ret;
+  gboolean parsed;
+  gint i;
+
+  /* reverse playback steps back from the seek position to the start of the
+   * file, so it needs the samples from the first fragment on. They only start
+   * at a later fragment after an earlier forward seek. */
+  if (qtdemux->segment.rate < 0) {
+    if (qtdemux->fragment_index == NULL)
+      return GST_FLOW_OK;
+
+    fragment = &g_array_index (qtdemux->fragment_index, QtDemuxFragment, 0);
+
+    GST_OBJECT_LOCK (qtdemux);
+    parsed = TRUE;
+    for (i = 0; parsed && i < qtdemux->n_streams; i++)
+      parsed = !qtdemux->streams[i]->samples_from_tfdt;
+    goto restart;
+  }
+
+  if (!qtdemux->fragment_index_done) {
+    ret = qtdemux_build_fragment_index (qtdemux);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+  if (qtdemux->fragment_index == NULL || qtdemux->fragment_index->len < 2)
+    return GST_FLOW_OK;
+
+  fragment = qtdemux_find_fragment (qtdemux, time);
+
+  GST_OBJECT_LOCK (qtdemux);
+  /* no need to parse anything again if the samples of the fragment are
+   * already there */
+  parsed = qtdemux->moof_offset == 0 || fragment->offset < qtdemux->moof_offset;
+  for (i = 0; parsed && i < qtdemux->n_streams; i++) {
+    QtDemuxStream *stream = qtdemux->streams[i];
+
+    parsed = stream->n_samples > 0 &&
+        gst_util_uint64_scale (qtdemux_sample_get_timestamp (stream, 0),
+        GST_SECOND, stream->timescale) <= time;
+  }
+
+restart:
+  if (parsed) {
+    GST_OBJECT_UNLOCK (qtdemux);
+    return GST_FLOW_OK;
+  }
+
+  ret = qtdemux_restart_fragments (qtdemux, fragment);
+  if (ret == GST_FLOW_EOS && fragment->offset != qtdemux->first_moof_offset) {
+    /* a stream has no samples after the fragment, parse all of them */
+    ret = qtdemux_restart_fragments (qtdemux,
+        &g_array_index (qtdemux->fragment_index, QtDemuxFragment, 0));
+  }
+  GST_OBJECT_UNLOCK (qtdemux);
+
+  /* the streams run out of samples at the end */
+  if (ret == GST_FLOW_EOS)
+    ret = GST_FLOW_OK;
+
+  return ret;
+}
+
 /* initialise bytereaders for stbl sub-atoms */
+/* check if @table is in the moov that is being parsed lazily and set up
+ * @lazy with the part of it that was read */
+static void
+qtdemux_stbl_lazy_init (GstQTDemux * qtdemux, QtDemuxStream * stream,
+    GstByteReader * table, QtDemuxLazyTable * lazy)
+{
+  const guint8 *moov = qtdemux->lazy_moov_data;
+
+  lazy->offset = 0;
+  lazy->loaded = table->size;
+
+  if (moov == NULL || table->data < moov ||
+      table->data >= moov + qtdemux->lazy_moov_size)
+    return;
+
+  /* see qtdemux_pull_moov_lazy() for what was read */
+  if (table->size + 8 > QTDEMUX_LAZY_TABLE_SIZE) {
+    lazy->offset = qtdemux->lazy_moov_offset + (table->data - moov);
+    lazy->loaded = QTDEMUX_LAZY_TABLE_SIZE - 8;
+    stream->stbl_lazy = TRUE;
+
+    GST_DEBUG_OBJECT (qtdemux, "reading %u bytes of table at %"
+        G_GUINT64_FORMAT " lazily", table->size, lazy->offset);
+  }
+}
+
+/* make sure the entries of @table that are needed for the samples up to @n
+ * are read. A table has @header bytes before its entries and there are never
+ * more entries than samples, with one more entry that might be peeked.
+ * Call with OBJECT lock, it is released while pulling. */
+static GstFlowReturn
+qtdemux_table_load (GstQTDemux * qtdemux, GstByteReader * table,
+    QtDemuxLazyTable * lazy, guint header, guint entry_size, guint32 n)
+{
+  GstFlowReturn ret;
+  GstBuffer *buf = NULL;
+  guint64 needed;
+  guint loaded, size;
+
+again:
+  if (table->data == NULL || lazy->loaded >= table->size)
+    return GST_FLOW_OK;
+
+  needed = header + ((guint64) n + 2) * entry_size;
+  if (needed <= lazy->loaded)
+    return GST_FLOW_OK;
+
+  /* don't read a few entries at a time */
+  loaded = lazy->loaded;
+  needed = MAX (needed, loaded + QTDEMUX_LAZY_BLOCK_SIZE);
+  size = MIN (needed, table->size) - loaded;
+
+  GST_LOG_OBJECT (qtdemux, "reading %u bytes of table at %" G_GUINT64_FORMAT,
+      size, lazy->offset + loaded);
+
+  /* best not do pull etc with lock held */
+  GST_OBJECT_UNLOCK (qtdemux);
+  ret = gst_pad_pull_range (qtdemux->sinkpad, lazy->offset + loaded, size,
+      &buf);
+  GST_OBJECT_LOCK (qtdemux);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  /* meanwhile the table might have been freed, or read by another thread */
+  if (table->data == NULL || lazy->loaded != loaded) {
+    gst_buffer_unref (buf);
+    buf = NULL;
+    goto again;
+  }
+
+  if (gst_buffer_get_size (buf) < size) {
+    gst_buffer_unref (buf);
+    return GST_FLOW_EOS;
+  }
+  gst_buffer_extract (buf, 0, (guint8 *) table->data + loaded, size);
+  gst_buffer_unref (buf);
+  lazy->loaded += size;
+
+  return GST_FLOW_OK;
+}
+
+/* read the parts of the lazy sample tables that are needed to parse the
+ * samples up to @n. Called with the object lock, which is released while
+ * pulling, so the caller has to check the state of @stream again. It must
+ * not post messages. */
+static GstFlowReturn
+qtdemux_stbl_load (GstQTDemux * qtdemux, QtDemuxStream * stream, guint32 n)
+{
+  GstFlowReturn ret;
+
+  if ((ret = qtdemux_table_load (qtdemux, &stream->stsz, &stream->stsz_lazy,
+              12, 4, n)) != GST_FLOW_OK)
+    return ret;
+  if ((ret = qtdemux_table_load (qtdemux, &stream->stsc, &stream->stsc_lazy,
+              8, 12, n)) != GST_FLOW_OK)
+    return ret;
+  if ((ret = qtdemux_table_load (qtdemux, &stream->stco, &stream->stco_lazy,
+              8, stream->co_size, n)) != GST_FLOW_OK)
+    return ret;
+  if ((ret = qtdemux_table_load (qtdemux, &stream->stts, &stream->stts_lazy,
+              8, 8, n)) != GST_FLOW_OK)
+    return ret;
+  if ((ret = qtdemux_table_load (qtdemux, &stream->stss, &stream->stss_lazy,
+              8, 4, n)) != GST_FLOW_OK)
+    return ret;
+  if ((ret = qtdemux_table_load (qtdemux, &stream->stps, &stream->stps_lazy,
+              8, 4, n)) != GST_FLOW_OK)
+    return ret;
+  if ((ret = qtdemux_table_load (qtdemux, &stream->ctts, &stream->ctts_lazy,
+              8, 8, n)) != GST_FLOW_OK)
+    return ret;
+
+  return GST_FLOW_OK;
+}
+
 static gboolean
 qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
 {
   stream->stbl_index = -1;      /* no samples have yet been parsed */
   stream->sample_index = -1;
+  stream->stbl_lazy = FALSE;
 
   /* time-to-sample atom */
   if (!qtdemux_tree_get_child_by_type_full (stbl, FOURCC_stts, &stream->stts))
     goto corrupt_file;
 
+  qtdemux_stbl_lazy_init (qtdemux, stream, &stream->stts, &stream->stts_lazy);
   /* copy atom data into a new buffer for later use */
   stream->stts.data = g_memdup (stream->stts.data, stream->stts.size);
 
@@ -6199,6 +7265,7 @@ qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
   if ((stream->stss_present =
           ! !qtdemux_tree_get_child_by_type_full (stbl, FOURCC_stss,
               &stream->stss) ? TRUE : FALSE) == TRUE) {
+    qtdemux_stbl_lazy_init (qtdemux, stream, &stream->stss, &stream->stss_lazy);
     /* copy atom data into a new buffer for later use */
     stream->stss.data = g_memdup (stream->stss.data, stream->stss.size);
 
@@ -6217,6 +7284,8 @@ qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
     if ((stream->stps_present =
             ! !qtdemux_tree_get_child_by_type_full (stbl, FOURCC_stps,
                 &stream->stps) ? TRUE : FALSE) == TRUE) {
+      qtdemux_stbl_lazy_init (qtdemux, stream, &stream->stps,
+          &stream->stps_lazy);
       /* copy atom data into a new buffer for later use */
       stream->stps.data = g_memdup (stream->stps.data, stream->stps.size);
 
@@ -6241,6 +7310,7 @@ qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
   if (!qtdemux_tree_get_child_by_type_full (stbl, FOURCC_stsz, &stream->stsz))
     goto no_samples;
 
+  qtdemux_stbl_lazy_init (qtdemux, stream, &stream->stsz, &stream->stsz_lazy);
   /* copy atom data into a new buffer for later use */
   stream->stsz.data = g_memdup (stream->stsz.data, stream->stsz.size);
 
@@ -6259,6 +7329,7 @@ qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
   if (!qtdemux_tree_get_child_by_type_full (stbl, FOURCC_stsc, &stream->stsc))
     goto corrupt_file;
 
+  qtdemux_stbl_lazy_init (qtdemux, stream, &stream->stsc, &stream->stsc_lazy);
   /* copy atom data into a new buffer for later use */
   stream->stsc.data = g_memdup (stream->stsc.data, stream->stsc.size);
 
@@ -6286,6 +7357,7 @@ qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
   else
     goto corrupt_file;
 
+  qtdemux_stbl_lazy_init (qtdemux, stream, &stream->stco, &stream->stco_lazy);
   /* copy atom data into a new buffer for later use */
   stream->stco.data = g_memdup (stream->stco.data, stream->stco.size);
 
@@ -6325,7 +7397,8 @@ qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
   }
 
   stream->samples = g_try_new0 (QtDemuxSample, stream->n_samples);
-  if (!stream->samples) {
+  stream->keyframes = g_try_new0 (guint32, (stream->n_samples + 31) / 32);
+  if (!stream->samples || !stream->keyframes) {
     GST_WARNING_OBJECT (qtdemux, "failed to allocate %d samples",
         stream->n_samples);
     return FALSE;
@@ -6336,6 +7409,7 @@ qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
   if ((stream->ctts_present =
           ! !qtdemux_tree_get_child_by_type_full (stbl, FOURCC_ctts,
               &stream->ctts) ? TRUE : FALSE) == TRUE) {
+    qtdemux_stbl_lazy_init (qtdemux, stream, &stream->ctts, &stream->ctts_lazy);
     /* copy atom data into a new buffer for later use */
     stream->ctts.data = g_memdup (stream->ctts.data, stream->ctts.size);
 
@@ -6386,6 +7460,7 @@ qtdemux_parse_samples (GstQTDemux * qtdemux, QtDemuxStream * stream, guint32 n)
   QtDemuxSample *samples, *first, *cur, *last;
   guint32 n_samples_per_chunk;
   guint32 n_samples;
+  GstFlowReturn ret = GST_FLOW_OK;
 
   GST_LOG_OBJECT (qtdemux, "parsing samples for stream fourcc %"
       GST_FOURCC_FORMAT ", pad %s", GST_FOURCC_ARGS (stream->fourcc),
@@ -6409,6 +7484,21 @@ qtdemux_parse_samples (GstQTDemux * qtdemux, QtDemuxStream * stream, guint32 n)
     goto done;
   }
 
+  /* read the parts of the tables we need that are not read yet */
+  if (G_UNLIKELY (stream->stbl_lazy)) {
+    if ((ret = qtdemux_stbl_load (qtdemux, stream, n)) != GST_FLOW_OK)
+      goto read_failed;
+
+    /* the lock was released while reading, another thread might have parsed
+     * the samples meanwhile or the stream might have been reset */
+    if (n <= stream->stbl_index)
+      goto already_parsed;
+    if (!stream->stsz.data) {
+      ret = GST_FLOW_FLUSHING;
+      goto read_failed;
+    }
+  }
+
   /* pointer to the sample table */
   samples = stream->samples;
 
@@ -6526,9 +7616,11 @@ qtdemux_parse_samples (GstQTDemux * qtdemux, QtDemuxStream * stream, guint32 n)
             j, GST_TIME_ARGS (gst_util_uint64_scale (stream->stco_sample_index,
                     GST_SECOND, stream->timescale)), cur->size);
 
-        cur->timestamp = stream->stco_sample_index;
-        cur->duration = stream->samples_per_chunk;
-        cur->keyframe = TRUE;
+        if (!qtdemux_stream_add_sample_time (stream, j,
+                stream->stco_sample_index, stream->samples_per_chunk,
+                stream->samples_per_chunk))
+          goto out_of_memory;
+        QTSAMPLE_SET_KEYFRAME (stream, j, TRUE);
         cur++;
 
         stream->stco_sample_index += stream->samples_per_chunk;
@@ -6610,8 +7702,9 @@ done2:
             GST_TIME_ARGS (gst_util_uint64_scale (stts_time, GST_SECOND,
                     stream->timescale)));
 
-        cur->timestamp = stts_time;
-        cur->duration = stts_duration;
+        if (!qtdemux_stream_add_sample_time (stream, cur - samples, stts_time,
+                stts_duration, stts_duration))
+          goto out_of_memory;
 
         /* avoid 32-bit wrap-around,
          * but still mind possible 'negative' duration */
@@ -6639,8 +7732,9 @@ done2:
           (guint) (cur - samples),
           GST_TIME_ARGS (gst_util_uint64_scale (stream->stts_time, GST_SECOND,
                   stream->timescale)));
-      cur->timestamp = stream->stts_time;
-      cur->duration = -1;
+      if (!qtdemux_stream_add_sample_time (stream, cur - samples,
+              stream->stts_time, -1, 0))
+        goto out_of_memory;
     }
   }
 done3:
@@ -6663,7 +7757,7 @@ done3:
 
           if (G_LIKELY (index > 0 && index <= n_samples)) {
             index -= 1;
-            samples[index].keyframe = TRUE;
+            QTSAMPLE_SET_KEYFRAME (stream, index, TRUE);
             GST_DEBUG_OBJECT (qtdemux, "samples at %u is keyframe", index);
             /* and exit if we have enough samples */
             if (G_UNLIKELY (index >= n)) {
@@ -6693,7 +7787,7 @@ done3:
 
             if (G_LIKELY (index > 0 && index <= n_samples)) {
               index -= 1;
-              samples[index].keyframe = TRUE;
+              QTSAMPLE_SET_KEYFRAME (stream, index, TRUE);
               GST_DEBUG_OBJECT (qtdemux, "samples at %u is keyframe", index);
               /* and exit if we have enough samples */
               if (G_UNLIKELY (index >= n)) {
@@ -6756,6 +7850,13 @@ done:
   /* if index has been completely parsed, free data that is no-longer needed */
   if (n + 1 == stream->n_samples) {
     gst_qtdemux_stbl_free (stream);
+    GST_INFO_OBJECT (qtdemux, "%u samples take %" G_GSIZE_FORMAT " bytes, "
+        "%u time runs %" G_GSIZE_FORMAT " bytes, time table %" G_GSIZE_FORMAT
+        " bytes, keyframes %" G_GSIZE_FORMAT " bytes", stream->n_samples,
+        stream->n_samples * sizeof (QtDemuxSample), stream->n_time_runs,
+        stream->n_time_runs * sizeof (QtDemuxTimeRun),
+        stream->time_table_len * sizeof (guint32),
+        (stream->n_samples + 31) / 32 * sizeof (guint32));
     GST_DEBUG_OBJECT (qtdemux,
         "parsed all available samples; checking for more");
     while (n + 1 == stream->n_samples)
@@ -6795,6 +7896,24 @@ corrupt_file:
         (_("This file is corrupt and cannot be played.")), (NULL));
     return FALSE;
   }
+out_of_memory:
+  {
+    GST_OBJECT_UNLOCK (qtdemux);
+    GST_ELEMENT_ERROR (qtdemux, RESOURCE, FAILED, (NULL),
+        ("failed to allocate the sample times"));
+    return FALSE;
+  }
+read_failed:
+  {
+    GST_OBJECT_UNLOCK (qtdemux);
+    GST_DEBUG_OBJECT (qtdemux, "reading sample tables failed: %s",
+        gst_flow_get_name (ret));
+    /* when flushing, the samples are parsed again after the seek */
+    if (ret != GST_FLOW_FLUSHING)
+      GST_ELEMENT_ERROR (qtdemux, RESOURCE, READ, (NULL),
+          ("failed to read the sample tables"));
+    return FALSE;
+  }
 }
 
 /* collect all segment info for @stream.
@@ -8781,6 +9900,13 @@ qtdemux_prepare_streams (GstQTDemux * qtdemux)
 
   GST_DEBUG_OBJECT (qtdemux, "prepare streams");
 
+  /* the fragment index can only replace the samples of the moofs */
+  qtdemux->first_moof_offset = qtdemux->moof_offset;
+  for (i = 0; i < qtdemux->n_streams; i++) {
+    if (qtdemux->streams[i]->n_samples)
+      qtdemux->fragment_index_done = TRUE;
+  }
+
   for (i = 0; ret == GST_FLOW_OK && i < qtdemux->n_streams; i++) {
     QtDemuxStream *stream = qtdemux->streams[i];
     guint32 sample_num = 0;
@@ -8829,7 +9955,9 @@ qtdemux_prepare_streams (GstQTDemux * qtdemux)
       durations = g_array_sized_new (FALSE, FALSE, sizeof (guint32), samples);
       sample_num = 0;
       while (sample_num < samples) {
-        g_array_append_val (durations, stream->samples[sample_num].duration);
+        guint32 dur = qtdemux_sample_get_duration (stream, sample_num);
+
+        g_array_append_val (durations, dur);
         sample_num++;
       }
       g_array_sort (durations, less_than);
@@ -79,6 +79,12 @@ struct _GstQTDemux {
   /* offset of the mfra atom */
   guint64 mfra_offset;
   guint64 moof_offset;
+  /* sparse index of the moofs for seeking in pull mode, see
+   * qtdemux_seek_fragment() */
+  guint64 first_moof_offset;
+  GArray *fragment_index;
+  gboolean fragment_index_done;
+  GstClockTime fragment_seek;
 
   gint state;
 
@@ -143,6 +149,16 @@ struct _GstQTDemux {
                       * requiring qtdemux to expose and create the streams */
   guint64 fragment_start;
   guint64 fragment_start_offset;
+
+  /* pull mode read-ahead of the samples */
+  guint read_ahead;
+  GstBuffer *read_ahead_buffer;
+  guint64 read_ahead_offset;
+
+  /* the moov that is being parsed when its sample tables are read lazily */
+  const guint8 *lazy_moov_data;
+  guint lazy_moov_size;
+  guint64 lazy_moov_offset;
     
   gint64 chapters_track_id;
 };
@@ -36,6 +36,8 @@
 #define IDR_TYPE_ID  5
 #define SPS_TYPE_ID  7
 #define PPS_TYPE_ID  8
+#define STAP_A_TYPE_ID 24
+#define FU_A_TYPE_ID 28
 
 GST_DEBUG_CATEGORY_STATIC (rtph264pay_debug);
 #define GST_CAT_DEFAULT (rtph264pay_debug)
@@ -67,17 +69,49 @@ GST_STATIC_PAD_TEMPLATE ("src",
 
 #define DEFAULT_SPROP_PARAMETER_SETS    NULL
 #define DEFAULT_CONFIG_INTERVAL		      0
+#define DEFAULT_AGGREGATE_MODE          GST_RTP_H264_AGGREGATE_NONE
 
 enum
 {
   PROP_0,
   PROP_SPROP_PARAMETER_SETS,
   PROP_CONFIG_INTERVAL,
+  PROP_AGGREGATE_MODE,
   PROP_LAST
 };
 
+#define GST_TYPE_RTP_H264_AGGREGATE_MODE \
+  (gst_rtp_h264_aggregate_mode_get_type ())
+static GType
+gst_rtp_h264_aggregate_mode_get_type (void)
+{
+  static GType aggregate_mode_type = 0;
+  static const GEnumValue aggregate_modes[] = {
+    {GST_RTP_H264_AGGREGATE_NONE, "Do not aggregate NAL units", "none"},
+    {GST_RTP_H264_AGGREGATE_ZERO_LATENCY,
+        "Aggregate NAL units of the same input buffer in STAP-A packets",
+        "zero-latency"},
+    {0, NULL, NULL},
+  };
+
+  if (!aggregate_mode_type) {
+    aggregate_mode_type =
+        g_enum_register_static ("GstRtpH264AggregateMode", aggregate_modes);
+  }
+  return aggregate_mode_type;
+}
+
 #define IS_ACCESS_UNIT(x) (((x) > 0x00) && ((x) < 0x06))
 
+/* a NAL unit found in byte-stream input */
+typedef struct
+{
+  /* distance to the next start code */
+  guint nal_len;
+  /* size without the trailing 0x0 bytes */
+  guint size;
+} GstRtpH264PayNal;
+
 static void gst_rtp_h264_pay_finalize (GObject * object);
 
 static void gst_rtp_h264_pay_set_property (GObject * object, guint prop_id,
@@ -131,6 +165,25 @@ gst_rtp_h264_pay_class_init (GstRtpH264PayClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
 
+  /**
+   * GstRtpH264Pay:aggregate-mode:
+   *
+   * Pack consecutive NAL units of an input buffer that are small enough in
+   * STAP-A packets up to the MTU and push the packets of the input buffer as
+   * one buffer list. This is typically used for the SPS/PPS and for streams
+   * with many small slices.
+   *
+   * Since: 1.4
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_AGGREGATE_MODE,
+      g_param_spec_enum ("aggregate-mode",
+          "Aggregate Mode",
+          "How to aggregate NAL units in STAP-A packets",
+          GST_TYPE_RTP_H264_AGGREGATE_MODE, DEFAULT_AGGREGATE_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
+      );
+
   gobject_class->finalize = gst_rtp_h264_pay_finalize;
 
   gst_element_class_add_pad_template (gstelement_class,
@@ -158,7 +211,7 @@ gst_rtp_h264_pay_class_init (GstRtpH264PayClass * klass)
 static void
 gst_rtp_h264_pay_init (GstRtpH264Pay * rtph264pay)
 {
-  rtph264pay->queue = g_array_new (FALSE, FALSE, sizeof (guint));
+  rtph264pay->queue = g_array_new (FALSE, FALSE, sizeof (GstRtpH264PayNal));
   rtph264pay->profile = 0;
   rtph264pay->sps = g_ptr_array_new_with_free_func (
       (GDestroyNotify) gst_buffer_unref);
@@ -166,10 +219,26 @@ gst_rtp_h264_pay_init (GstRtpH264Pay * rtph264pay)
       (GDestroyNotify) gst_buffer_unref);
   rtph264pay->last_spspps = -1;
   rtph264pay->spspps_interval = DEFAULT_CONFIG_INTERVAL;
+  rtph264pay->aggregate_mode = DEFAULT_AGGREGATE_MODE;
 
   rtph264pay->adapter = gst_adapter_new ();
 }
 
+static void
+gst_rtp_h264_pay_reset_bundle (GstRtpH264Pay * rtph264pay)
+{
+  if (rtph264pay->bundle) {
+    gst_buffer_list_unref (rtph264pay->bundle);
+    rtph264pay->bundle = NULL;
+  }
+  if (rtph264pay->pending) {
+    gst_buffer_list_unref (rtph264pay->pending);
+    rtph264pay->pending = NULL;
+  }
+  rtph264pay->bundle_size = 0;
+  rtph264pay->bundle_contains_vcl = FALSE;
+}
+
 static void
 gst_rtp_h264_pay_clear_sps_pps (GstRtpH264Pay * rtph264pay)
 {
@@ -193,6 +262,8 @@ gst_rtp_h264_pay_finalize (GObject * object)
 
   g_object_unref (rtph264pay->adapter);
 
+  gst_rtp_h264_pay_reset_bundle (rtph264pay);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -749,78 +820,50 @@ gst_rtp_h264_pay_send_sps_pps (GstRTPBasePayload * basepayload,
   return ret;
 }
 
+static void
+gst_rtp_h264_pay_add_packet (GstRtpH264Pay * rtph264pay, GstBuffer * outbuf)
+{
+  if (rtph264pay->pending == NULL)
+    rtph264pay->pending = gst_buffer_list_new ();
+
+  gst_buffer_list_add (rtph264pay->pending, outbuf);
+}
+
 static GstFlowReturn
-gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
-    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au)
+gst_rtp_h264_pay_push_pending (GstRTPBasePayload * basepayload)
+{
+  GstRtpH264Pay *rtph264pay = GST_RTP_H264_PAY (basepayload);
+  GstBufferList *list;
+
+  if (rtph264pay->pending == NULL)
+    return GST_FLOW_OK;
+
+  list = rtph264pay->pending;
+  rtph264pay->pending = NULL;
+
+  /* push the list to the next element in the pipe */
+  return gst_rtp_base_payload_push_list (basepayload, list);
+}
+
+/* put the NAL unit in one or more RTP packets and add them to the pending
+ * packets, takes ownership of @paybuf */
+static void
+gst_rtp_h264_pay_payload_nal_packets (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au,
+    guint8 nalHeader)
 {
   GstRtpH264Pay *rtph264pay;
-  GstFlowReturn ret;
-  guint8 nalHeader;
   guint8 nalType;
   guint packet_len, payload_len, mtu;
   GstBuffer *outbuf;
   guint8 *payload;
-  GstBufferList *list = NULL;
-  gboolean send_spspps;
   GstRTPBuffer rtp = { NULL };
   guint size = gst_buffer_get_size (paybuf);
 
   rtph264pay = GST_RTP_H264_PAY (basepayload);
   mtu = GST_RTP_BASE_PAYLOAD_MTU (rtph264pay);
-
-  gst_buffer_extract (paybuf, 0, &nalHeader, 1);
   nalType = nalHeader & 0x1f;
 
-  GST_DEBUG_OBJECT (rtph264pay, "Processing Buffer with NAL TYPE=%d", nalType);
-
-  /* should set src caps before pushing stuff,
-   * and if we did not see enough SPS/PPS, that may not be the case */
-  if (G_UNLIKELY (!gst_pad_has_current_caps (GST_RTP_BASE_PAYLOAD_SRCPAD
-              (basepayload))))
-    gst_rtp_h264_pay_set_sps_pps (basepayload);
-
-  send_spspps = FALSE;
-
-  /* check if we need to emit an SPS/PPS now */
-  if (nalType == IDR_TYPE_ID && rtph264pay->spspps_interval > 0) {
-    if (rtph264pay->last_spspps != -1) {
-      guint64 diff;
-
-      GST_LOG_OBJECT (rtph264pay,
-          "now %" GST_TIME_FORMAT ", last SPS/PPS %" GST_TIME_FORMAT,
-          GST_TIME_ARGS (pts), GST_TIME_ARGS (rtph264pay->last_spspps));
-
-      /* calculate diff between last SPS/PPS in milliseconds */
-      if (pts > rtph264pay->last_spspps)
-        diff = pts - rtph264pay->last_spspps;
-      else
-        diff = 0;
-
-      GST_DEBUG_OBJECT (rtph264pay,
-          "interval since last SPS/PPS %" GST_TIME_FORMAT,
-          GST_TIME_ARGS (diff));
-
-      /* bigger than interval, queue SPS/PPS */
-      if (GST_TIME_AS_SECONDS (diff) >= rtph264pay->spspps_interval) {
-        GST_DEBUG_OBJECT (rtph264pay, "time to send SPS/PPS");
-        send_spspps = TRUE;
-      }
-    } else {
-      /* no know previous SPS/PPS time, send now */
-      GST_DEBUG_OBJECT (rtph264pay, "no previous SPS/PPS time, send now");
-      send_spspps = TRUE;
-    }
-  }
-
-  if (send_spspps || rtph264pay->send_spspps) {
-    /* we need to send SPS/PPS now first. FIXME, don't use the pts for
-     * checking when we need to send SPS/PPS but convert to running_time first. */
-    rtph264pay->send_spspps = FALSE;
-    ret = gst_rtp_h264_pay_send_sps_pps (basepayload, rtph264pay, dts, pts);
-    if (ret != GST_FLOW_OK)
-      return ret;
-  }
-
   packet_len = gst_rtp_buffer_calc_packet_len (size, 0, 0);
 
   if (packet_len < mtu) {
@@ -844,18 +887,13 @@ gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
     GST_BUFFER_PTS (outbuf) = pts;
     GST_BUFFER_DTS (outbuf) = dts;
 
+    gst_rtp_buffer_unmap (&rtp);
+
     /* insert payload memory block */
     outbuf = gst_buffer_append (outbuf, paybuf);
 
-    list = gst_buffer_list_new ();
-
     /* add the buffer to the buffer list */
-    gst_buffer_list_add (list, outbuf);
-
-    gst_rtp_buffer_unmap (&rtp);
-
-    /* push the list to the next element in the pipe */
-    ret = gst_rtp_base_payload_push_list (basepayload, list);
+    gst_rtp_h264_pay_add_packet (rtph264pay, outbuf);
   } else {
     /* fragmentation Units FU-A */
     guint limitedSize;
@@ -867,16 +905,12 @@ gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
     pos++;
     size--;
 
-    ret = GST_FLOW_OK;
-
     GST_DEBUG_OBJECT (basepayload, "Using FU-A fragmentation for data size=%d",
         size);
 
     /* We keep 2 bytes for FU indicator and FU Header */
     payload_len = gst_rtp_buffer_calc_payload_len (mtu - 2, 0, 0);
 
-    list = gst_buffer_list_new ();
-
     while (end == 0) {
       limitedSize = size < payload_len ? size : payload_len;
       GST_DEBUG_OBJECT (basepayload,
@@ -903,7 +937,7 @@ gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
       }
 
       /* FU indicator */
-      payload[0] = (nalHeader & 0x60) | 28;
+      payload[0] = (nalHeader & 0x60) | FU_A_TYPE_ID;
 
       /* FU Header */
       payload[1] = (start << 7) | (end << 6) | (nalHeader & 0x1f);
@@ -916,8 +950,7 @@ gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
               limitedSize));
 
       /* add the buffer to the buffer list */
-      gst_buffer_list_add (list, outbuf);
-
+      gst_rtp_h264_pay_add_packet (rtph264pay, outbuf);
 
       size -= limitedSize;
       pos += limitedSize;
@@ -925,10 +958,198 @@ gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
       start = 0;
     }
 
-    ret = gst_rtp_base_payload_push_list (basepayload, list);
     gst_buffer_unref (paybuf);
   }
-  return ret;
+}
+
+/* make a STAP-A packet of the collected NAL units and add it to the pending
+ * packets, a single NAL unit is sent without the aggregation header */
+static void
+gst_rtp_h264_pay_flush_bundle (GstRTPBasePayload * basepayload,
+    GstClockTime dts, GstClockTime pts, gboolean end_of_au)
+{
+  GstRtpH264Pay *rtph264pay = GST_RTP_H264_PAY (basepayload);
+  GstBufferList *bundle;
+  GstBuffer *outbuf;
+  GstRTPBuffer rtp = { NULL };
+  guint8 *payload;
+  guint8 fbit = 0, nri = 0;
+  guint i, len, offset;
+
+  bundle = rtph264pay->bundle;
+  if (bundle == NULL)
+    return;
+  rtph264pay->bundle = NULL;
+
+  len = gst_buffer_list_length (bundle);
+
+  if (len == 1) {
+    GstBuffer *paybuf = gst_buffer_ref (gst_buffer_list_get (bundle, 0));
+    guint8 nalHeader;
+
+    gst_buffer_extract (paybuf, 0, &nalHeader, 1);
+    gst_rtp_h264_pay_payload_nal_packets (basepayload, paybuf, dts, pts,
+        end_of_au, nalHeader);
+    gst_buffer_list_unref (bundle);
+    return;
+  }
+
+  GST_DEBUG_OBJECT (basepayload, "STAP-A with %u NAL units, payload size %u",
+      len, rtph264pay->bundle_size);
+
+  outbuf = gst_rtp_buffer_new_allocate (rtph264pay->bundle_size, 0, 0);
+
+  gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+  payload = gst_rtp_buffer_get_payload (&rtp);
+
+  /* the NAL units are small, copy them after their 16 bits size */
+  offset = 1;
+  for (i = 0; i < len; i++) {
+    GstBuffer *nal = gst_buffer_list_get (bundle, i);
+    guint size = gst_buffer_get_size (nal);
+
+    GST_WRITE_UINT16_BE (payload + offset, size);
+    gst_buffer_extract (nal, 0, payload + offset + 2, size);
+
+    /* F is set when any of the NAL units has it set, NRI is the maximum of
+     * the NRI of the NAL units (RFC 3984 5.7) */
+    fbit |= payload[offset + 2] & 0x80;
+    nri = MAX (nri, payload[offset + 2] & 0x60);
+
+    offset += 2 + size;
+  }
+  payload[0] = fbit | nri | STAP_A_TYPE_ID;
+
+  if (rtph264pay->bundle_contains_vcl && end_of_au)
+    gst_rtp_buffer_set_marker (&rtp, 1);
+
+  gst_rtp_buffer_unmap (&rtp);
+
+  GST_BUFFER_PTS (outbuf) = pts;
+  GST_BUFFER_DTS (outbuf) = dts;
+
+  gst_rtp_h264_pay_add_packet (rtph264pay, outbuf);
+  gst_buffer_list_unref (bundle);
+}
+
+/* collect the NAL unit for a STAP-A packet when it is small enough, takes
+ * ownership of @paybuf */
+static void
+gst_rtp_h264_pay_bundle_nal (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au,
+    guint8 nalHeader)
+{
+  GstRtpH264Pay *rtph264pay = GST_RTP_H264_PAY (basepayload);
+  guint size, mtu;
+
+  size = gst_buffer_get_size (paybuf);
+  mtu = GST_RTP_BASE_PAYLOAD_MTU (rtph264pay);
+
+  /* STAP-A header, NAL size and NAL unit */
+  if (gst_rtp_buffer_calc_packet_len (1 + 2 + size, 0, 0) > mtu) {
+    /* too big to aggregate, send what we have and then this NAL unit */
+    gst_rtp_h264_pay_flush_bundle (basepayload, dts, pts, FALSE);
+    gst_rtp_h264_pay_payload_nal_packets (basepayload, paybuf, dts, pts,
+        end_of_au, nalHeader);
+    return;
+  }
+
+  if (rtph264pay->bundle != NULL &&
+      gst_rtp_buffer_calc_packet_len (rtph264pay->bundle_size + 2 + size, 0,
+          0) > mtu)
+    gst_rtp_h264_pay_flush_bundle (basepayload, dts, pts, FALSE);
+
+  if (rtph264pay->bundle == NULL) {
+    rtph264pay->bundle = gst_buffer_list_new ();
+    rtph264pay->bundle_size = 1;
+    rtph264pay->bundle_contains_vcl = FALSE;
+  }
+
+  gst_buffer_list_add (rtph264pay->bundle, paybuf);
+  rtph264pay->bundle_size += 2 + size;
+  if (IS_ACCESS_UNIT (nalHeader & 0x1f))
+    rtph264pay->bundle_contains_vcl = TRUE;
+
+  if (end_of_au)
+    gst_rtp_h264_pay_flush_bundle (basepayload, dts, pts, TRUE);
+}
+
+static GstFlowReturn
+gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au)
+{
+  GstRtpH264Pay *rtph264pay;
+  GstFlowReturn ret;
+  guint8 nalHeader;
+  guint8 nalType;
+  gboolean send_spspps;
+
+  rtph264pay = GST_RTP_H264_PAY (basepayload);
+
+  gst_buffer_extract (paybuf, 0, &nalHeader, 1);
+  nalType = nalHeader & 0x1f;
+
+  GST_DEBUG_OBJECT (rtph264pay, "Processing Buffer with NAL TYPE=%d", nalType);
+
+  /* should set src caps before pushing stuff,
+   * and if we did not see enough SPS/PPS, that may not be the case */
+  if (G_UNLIKELY (!gst_pad_has_current_caps (GST_RTP_BASE_PAYLOAD_SRCPAD
+              (basepayload))))
+    gst_rtp_h264_pay_set_sps_pps (basepayload);
+
+  send_spspps = FALSE;
+
+  /* check if we need to emit an SPS/PPS now */
+  if (nalType == IDR_TYPE_ID && rtph264pay->spspps_interval > 0) {
+    if (rtph264pay->last_spspps != -1) {
+      guint64 diff;
+
+      GST_LOG_OBJECT (rtph264pay,
+          "now %" GST_TIME_FORMAT ", last SPS/PPS %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (pts), GST_TIME_ARGS (rtph264pay->last_spspps));
+
+      /* calculate diff between last SPS/PPS in milliseconds */
+      if (pts > rtph264pay->last_spspps)
+        diff = pts - rtph264pay->last_spspps;
+      else
+        diff = 0;
+
+      GST_DEBUG_OBJECT (rtph264pay,
+          "interval since last SPS/PPS %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (diff));
+
+      /* bigger than interval, queue SPS/PPS */
+      if (GST_TIME_AS_SECONDS (diff) >= rtph264pay->spspps_interval) {
+        GST_DEBUG_OBJECT (rtph264pay, "time to send SPS/PPS");
+        send_spspps = TRUE;
+      }
+    } else {
+      /* no know previous SPS/PPS time, send now */
+      GST_DEBUG_OBJECT (rtph264pay, "no previous SPS/PPS time, send now");
+      send_spspps = TRUE;
+    }
+  }
+
+  if (send_spspps || rtph264pay->send_spspps) {
+    /* we need to send SPS/PPS now first. FIXME, don't use the pts for
+     * checking when we need to send SPS/PPS but convert to running_time first. */
+    rtph264pay->send_spspps = FALSE;
+    ret = gst_rtp_h264_pay_send_sps_pps (basepayload, rtph264pay, dts, pts);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+
+  if (rtph264pay->aggregate_mode != GST_RTP_H264_AGGREGATE_NONE) {
+    /* the packets are pushed at the end of the input buffer */
+    gst_rtp_h264_pay_bundle_nal (basepayload, paybuf, dts, pts, end_of_au,
+        nalHeader);
+    return GST_FLOW_OK;
+  }
+
+  gst_rtp_h264_pay_payload_nal_packets (basepayload, paybuf, dts, pts,
+      end_of_au, nalHeader);
+
+  return gst_rtp_h264_pay_push_pending (basepayload);
 }
 
 static GstFlowReturn
@@ -986,10 +1207,8 @@ gst_rtp_h264_pay_handle_buffer (GstRTPBasePayload * basepayload,
 
   ret = GST_FLOW_OK;
 
-  /* now loop over all NAL units and put them in a packet
-   * FIXME, we should really try to pack multiple NAL units into one RTP packet
-   * if we can, especially for the config packets that wont't cause decoder 
-   * latency. */
+  /* now loop over all NAL units and put them in a packet, multiple NAL units
+   * are packed in one STAP-A packet when the aggregate-mode allows it. */
   if (avc) {
     guint nal_length_size;
     gsize offset = 0;
@@ -1039,6 +1258,7 @@ gst_rtp_h264_pay_handle_buffer (GstRTPBasePayload * basepayload,
       size -= nal_len;
     }
   } else {
+    GstRtpH264PayNal nal;
     guint next;
     gboolean update = FALSE;
 
@@ -1073,14 +1293,24 @@ gst_rtp_h264_pay_handle_buffer (GstRTPBasePayload * basepayload,
        */
       next = next_start_code (data, size);
 
-      if (next == size && buffer != NULL) {
+      if (next == size && buffer != NULL &&
+          rtph264pay->alignment != GST_H264_ALIGNMENT_AU) {
         /* Didn't find the start of next NAL and it's not EOS,
-         * handle it next time */
+         * handle it next time. With AU alignment the buffer ends with the
+         * last NAL of the access unit. */
         break;
       }
 
       /* nal length is distance to next start code */
       nal_len = next;
+      nal.nal_len = nal_len;
+
+      /* In case we're not at the end of the buffer we know the next block
+       * starts with 0x000001 so all the 0x00 bytes at the end of this one are
+       * trailing 0x0 that can be discarded */
+      for (nal.size = nal_len; nal.size > 1 && data[nal.size - 1] == 0x0;
+          nal.size--)
+        /* skip */ ;
 
       GST_DEBUG_OBJECT (basepayload, "found next start at %u of size %u", next,
           nal_len);
@@ -1113,9 +1343,13 @@ gst_rtp_h264_pay_handle_buffer (GstRTPBasePayload * basepayload,
       data += nal_len;
       size -= nal_len;
 
-      g_array_append_val (nal_queue, nal_len);
+      g_array_append_val (nal_queue, nal);
     }
 
+    /* we don't need the data anymore, the NAL units are taken from the
+     * adapter without merging the memory */
+    gst_adapter_unmap (rtph264pay->adapter);
+
     /* if has new SPS & PPS, update the output caps */
     if (G_UNLIKELY (update))
       if (!gst_rtp_h264_pay_set_sps_pps (basepayload))
@@ -1130,20 +1364,16 @@ gst_rtp_h264_pay_handle_buffer (GstRTPBasePayload * basepayload,
       guint size;
       gboolean end_of_au = FALSE;
 
-      nal_len = g_array_index (nal_queue, guint, i);
+      nal = g_array_index (nal_queue, GstRtpH264PayNal, i);
+      nal_len = nal.nal_len;
       /* skip start code */
       gst_adapter_flush (rtph264pay->adapter, 3);
 
-      /* Trim the end unless we're the last NAL in the stream.
-       * In case we're not at the end of the buffer we know the next block
-       * starts with 0x000001 so all the 0x00 bytes at the end of this one are
-       * trailing 0x0 that can be discarded */
-      size = nal_len;
-      data = gst_adapter_map (rtph264pay->adapter, size);
+      /* Trim the end unless we're the last NAL in the stream. */
       if (i + 1 != nal_queue->len || buffer != NULL)
-        for (; size > 1 && data[size - 1] == 0x0; size--)
-          /* skip */ ;
-
+        size = nal.size;
+      else
+        size = nal_len;
 
       /* If it's the last nal unit we have in non-bytestream mode, we can
        * assume it's the end of an access-unit
@@ -1155,7 +1385,7 @@ gst_rtp_h264_pay_handle_buffer (GstRTPBasePayload * basepayload,
       if ((rtph264pay->alignment == GST_H264_ALIGNMENT_AU || buffer == NULL) &&
           i == nal_queue->len - 1)
         end_of_au = TRUE;
-      paybuf = gst_adapter_take_buffer (rtph264pay->adapter, size);
+      paybuf = gst_adapter_take_buffer_fast (rtph264pay->adapter, size);
       g_assert (paybuf);
 
       /* put the data in one or more RTP packets */
@@ -1173,6 +1403,14 @@ gst_rtp_h264_pay_handle_buffer (GstRTPBasePayload * basepayload,
     g_array_set_size (nal_queue, 0);
   }
 
+  /* send the remaining NAL units and push the packets of this buffer */
+  if (ret == GST_FLOW_OK) {
+    gst_rtp_h264_pay_flush_bundle (basepayload, dts, pts, FALSE);
+    ret = gst_rtp_h264_pay_push_pending (basepayload);
+  } else {
+    gst_rtp_h264_pay_reset_bundle (rtph264pay);
+  }
+
 done:
   if (avc) {
     gst_buffer_unmap (buffer, &map);
@@ -1187,6 +1425,7 @@ caps_rejected:
   {
     GST_WARNING_OBJECT (basepayload, "Could not set outcaps");
     g_array_set_size (nal_queue, 0);
+    gst_rtp_h264_pay_reset_bundle (rtph264pay);
     ret = GST_FLOW_NOT_NEGOTIATED;
     goto done;
   }
@@ -1202,6 +1441,7 @@ gst_rtp_h264_pay_sink_event (GstRTPBasePayload * payload, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_STOP:
       gst_adapter_clear (rtph264pay->adapter);
+      gst_rtp_h264_pay_reset_bundle (rtph264pay);
       break;
     case GST_EVENT_CUSTOM_DOWNSTREAM:
       s = gst_event_get_structure (event);
@@ -1244,6 +1484,7 @@ gst_rtp_h264_pay_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       rtph264pay->send_spspps = FALSE;
       gst_adapter_clear (rtph264pay->adapter);
+      gst_rtp_h264_pay_reset_bundle (rtph264pay);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       rtph264pay->last_spspps = -1;
@@ -1275,6 +1516,9 @@ gst_rtp_h264_pay_set_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       rtph264pay->spspps_interval = g_value_get_uint (value);
       break;
+    case PROP_AGGREGATE_MODE:
+      rtph264pay->aggregate_mode = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1296,6 +1540,9 @@ gst_rtp_h264_pay_get_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       g_value_set_uint (value, rtph264pay->spspps_interval);
       break;
+    case PROP_AGGREGATE_MODE:
+      g_value_set_enum (value, rtph264pay->aggregate_mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -54,6 +54,12 @@ typedef enum
   GST_H264_ALIGNMENT_AU
 } GstH264Alignment;
 
+typedef enum
+{
+  GST_RTP_H264_AGGREGATE_NONE,
+  GST_RTP_H264_AGGREGATE_ZERO_LATENCY
+} GstRtpH264AggregateMode;
+
 struct _GstRtpH264Pay
 {
   GstRTPBasePayload payload;
@@ -74,6 +80,14 @@ struct _GstRtpH264Pay
   guint spspps_interval;
   gboolean send_spspps;
   GstClockTime last_spspps;
+
+  GstRtpH264AggregateMode aggregate_mode;
+  /* packets of the input buffer that are not pushed yet */
+  GstBufferList *pending;
+  /* NAL units for the next STAP-A packet */
+  GstBufferList *bundle;
+  guint bundle_size;
+  gboolean bundle_contains_vcl;
 };
 
 struct _GstRtpH264PayClass
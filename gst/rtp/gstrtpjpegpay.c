@@ -30,6 +30,10 @@
  * the actual JPEG entropy scan.
  *
  * The payloader assumes that correct width and height is found in the caps.
+ *
+ * Most cameras send the same header with every picture. When the header of a
+ * picture is identical to the one of the previous picture, the result of
+ * parsing it is reused.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -220,6 +224,8 @@ typedef struct
 
 /* FIXME: restart marker header currently unsupported */
 
+static void gst_rtp_jpeg_pay_finalize (GObject * object);
+
 static void gst_rtp_jpeg_pay_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 
@@ -246,6 +252,7 @@ gst_rtp_jpeg_pay_class_init (GstRtpJPEGPayClass * klass)
   gstelement_class = (GstElementClass *) klass;
   gstrtpbasepayload_class = (GstRTPBasePayloadClass *) klass;
 
+  gobject_class->finalize = gst_rtp_jpeg_pay_finalize;
   gobject_class->set_property = gst_rtp_jpeg_pay_set_property;
   gobject_class->get_property = gst_rtp_jpeg_pay_get_property;
 
@@ -286,6 +293,22 @@ gst_rtp_jpeg_pay_init (GstRtpJPEGPay * pay)
   pay->height = -1;
 }
 
+static void
+gst_rtp_jpeg_pay_clear_header (GstRtpJPEGPay * pay)
+{
+  g_free (pay->header);
+  pay->header = NULL;
+  pay->header_size = 0;
+}
+
+static void
+gst_rtp_jpeg_pay_finalize (GObject * object)
+{
+  gst_rtp_jpeg_pay_clear_header (GST_RTP_JPEG_PAY (object));
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 gst_rtp_jpeg_pay_setcaps (GstRTPBasePayload * basepayload, GstCaps * caps)
 {
@@ -300,6 +323,8 @@ gst_rtp_jpeg_pay_setcaps (GstRTPBasePayload * basepayload, GstCaps * caps)
 
   pay = GST_RTP_JPEG_PAY (basepayload);
 
+  gst_rtp_jpeg_pay_clear_header (pay);
+
   /* these properties are mandatory, but they might be adjusted by the SOF, if there
    * is one. */
   if (!gst_structure_get_int (caps_structure, "height", &height) || height <= 0) {
@@ -647,19 +672,92 @@ wrong_length:
 static RtpJpegMarker
 gst_rtp_jpeg_pay_scan_marker (const guint8 * data, guint size, guint * offset)
 {
-  while ((data[(*offset)++] != JPEG_MARKER) && ((*offset) < size));
+  const guint8 *p = NULL;
+  guint8 marker;
 
-  if (G_UNLIKELY ((*offset) >= size)) {
+  /* memchr() is a lot faster than checking byte by byte */
+  if (G_LIKELY (*offset < size))
+    p = memchr (data + *offset, JPEG_MARKER, size - *offset);
+
+  if (G_UNLIKELY (p == NULL || p + 1 >= data + size)) {
     GST_LOG ("found EOI marker");
+    *offset = size;
     return JPEG_MARKER_EOI;
-  } else {
-    guint8 marker;
+  }
+
+  *offset = p + 1 - data;
+  marker = data[*offset];
+  GST_LOG ("found 0x%02x marker at offset %u", marker, *offset);
+  (*offset)++;
+  return marker;
+}
 
-    marker = data[*offset];
-    GST_LOG ("found 0x%02x marker at offset %u", marker, *offset);
-    (*offset)++;
-    return marker;
+/* reuse the header of the previous frame when the header of @data is
+ * identical to it */
+static gboolean
+gst_rtp_jpeg_pay_lookup_header (GstRtpJPEGPay * pay, const guint8 * data,
+    guint size, CompInfo info[], RtpQuantTable tables[],
+    RtpRestartMarkerHeader * dri)
+{
+  gint i;
+
+  if (pay->header == NULL || size < pay->header_size ||
+      memcmp (data, pay->header, pay->header_size) != 0)
+    return FALSE;
+
+  GST_LOG_OBJECT (pay, "header identical to previous frame");
+
+  pay->type = pay->header_type;
+  pay->width = pay->header_width;
+  pay->height = pay->header_height;
+
+  /* the tables are at the same offsets as in the previous frame, refer to
+   * them with the component index */
+  for (i = 0; i < 2; i++) {
+    info[i].qt = i;
+    tables[i].size = pay->header_qt_size[i];
+    tables[i].data = pay->header_qt_size[i] ?
+        data + pay->header_qt_offset[i] : NULL;
+  }
+
+  if (pay->header_dri) {
+    dri->restart_interval = pay->header_restart_interval;
+    dri->restart_count = g_htons (0xFFFF);
+  }
+
+  return TRUE;
+}
+
+static void
+gst_rtp_jpeg_pay_store_header (GstRtpJPEGPay * pay, const guint8 * data,
+    guint size, CompInfo info[], RtpQuantTable tables[], gulong tables_elements,
+    gboolean dri_found, RtpRestartMarkerHeader * dri)
+{
+  gint i;
+
+  gst_rtp_jpeg_pay_clear_header (pay);
+
+  pay->header = g_memdup (data, size);
+  pay->header_size = size;
+  pay->header_type = pay->type;
+  pay->header_width = pay->width;
+  pay->header_height = pay->height;
+
+  for (i = 0; i < 2; i++) {
+    guint qt = info[i].qt;
+
+    if (qt < tables_elements && tables[qt].size > 0) {
+      pay->header_qt_offset[i] = tables[qt].data - data;
+      pay->header_qt_size[i] = tables[qt].size;
+    } else {
+      pay->header_qt_offset[i] = 0;
+      pay->header_qt_size[i] = 0;
+    }
   }
+
+  pay->header_dri = dri_found;
+  if (dri_found)
+    pay->header_restart_interval = dri->restart_interval;
 }
 
 static GstFlowReturn
@@ -705,6 +803,14 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
   sof_found = FALSE;
   dri_found = FALSE;
 
+  if (gst_rtp_jpeg_pay_lookup_header (pay, data, size, info, tables,
+          &restart_marker_header)) {
+    sos_found = dqt_found = sof_found = TRUE;
+    dri_found = pay->header_dri;
+    jpeg_header_size = pay->header_size;
+    offset = jpeg_header_size;
+  }
+
   while (!sos_found && (offset < size)) {
     GST_LOG_OBJECT (pay, "checking from offset %u", offset);
     switch (gst_rtp_jpeg_pay_scan_marker (data, size, &offset)) {
@@ -730,6 +836,10 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
         sos_found = TRUE;
         GST_LOG_OBJECT (pay, "SOS found");
         jpeg_header_size = offset + gst_rtp_jpeg_pay_header_size (data, offset);
+        if (dqt_found && sof_found && jpeg_header_size <= size)
+          gst_rtp_jpeg_pay_store_header (pay, data, jpeg_header_size, info,
+              tables, G_N_ELEMENTS (tables), dri_found,
+              &restart_marker_header);
         break;
       case JPEG_MARKER_EOI:
         GST_WARNING_OBJECT (pay, "EOI reached before SOS!");
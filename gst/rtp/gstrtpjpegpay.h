@@ -48,6 +48,18 @@ struct _GstRtpJPEGPay
   gint width;
 
   guint8 quant;
+
+  /* the header of the previous frame, up to the scan data, and what was
+   * parsed from it */
+  guint8 *header;
+  guint header_size;
+  guint8 header_type;
+  gint header_width;
+  gint header_height;
+  guint header_qt_offset[2];
+  guint header_qt_size[2];
+  gboolean header_dri;
+  guint16 header_restart_interval;
 };
 
 struct _GstRtpJPEGPayClass
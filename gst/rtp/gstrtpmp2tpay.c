@@ -45,10 +45,35 @@ GST_STATIC_PAD_TEMPLATE ("src",
         "clock-rate = (int) 90000, " "encoding-name = (string) \"MP2T\"")
     );
 
+#define DEFAULT_PCR_PACING FALSE
+
+/* the PCR is a 33 bit 90kHz base and a 27MHz extension */
+#define PCR_WRAP (G_GUINT64_CONSTANT (300) << 33)
+
+/* how far the PCR derived time can drift from the input timestamps before
+ * pacing continues from the input timestamps again */
+#define PCR_MAX_DRIFT (500 * GST_MSECOND)
+
+enum
+{
+  PROP_0,
+  PROP_PCR_PACING,
+  PROP_LAST
+};
+
+static void gst_rtp_mp2t_pay_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_rtp_mp2t_pay_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static GstStateChangeReturn gst_rtp_mp2t_pay_change_state (GstElement *
+    element, GstStateChange transition);
+
 static gboolean gst_rtp_mp2t_pay_setcaps (GstRTPBasePayload * payload,
     GstCaps * caps);
 static GstFlowReturn gst_rtp_mp2t_pay_handle_buffer (GstRTPBasePayload *
     payload, GstBuffer * buffer);
+static gboolean gst_rtp_mp2t_pay_sink_event (GstRTPBasePayload * payload,
+    GstEvent * event);
 static GstFlowReturn gst_rtp_mp2t_pay_flush (GstRTPMP2TPay * rtpmp2tpay);
 static void gst_rtp_mp2t_pay_finalize (GObject * object);
 
@@ -67,9 +92,14 @@ gst_rtp_mp2t_pay_class_init (GstRTPMP2TPayClass * klass)
   gstrtpbasepayload_class = (GstRTPBasePayloadClass *) klass;
 
   gobject_class->finalize = gst_rtp_mp2t_pay_finalize;
+  gobject_class->set_property = gst_rtp_mp2t_pay_set_property;
+  gobject_class->get_property = gst_rtp_mp2t_pay_get_property;
+
+  gstelement_class->change_state = gst_rtp_mp2t_pay_change_state;
 
   gstrtpbasepayload_class->set_caps = gst_rtp_mp2t_pay_setcaps;
   gstrtpbasepayload_class->handle_buffer = gst_rtp_mp2t_pay_handle_buffer;
+  gstrtpbasepayload_class->sink_event = gst_rtp_mp2t_pay_sink_event;
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gst_rtp_mp2t_pay_sink_template));
@@ -79,6 +109,33 @@ gst_rtp_mp2t_pay_class_init (GstRTPMP2TPayClass * klass)
       "RTP MPEG2 Transport Stream payloader", "Codec/Payloader/Network/RTP",
       "Payload-encodes MPEG2 TS into RTP packets (RFC 2250)",
       "Wim Taymans <wim.taymans@gmail.com>");
+
+  /**
+   * GstRTPMP2TPay:pcr-pacing:
+   *
+   * Give each packet the time at which its first byte is due according to
+   * the PCR of the stream instead of the time of the input buffer, so that
+   * a sink that syncs on the clock sends the packets of a large frame
+   * spread over the frame interval instead of in one burst. Without PCR,
+   * the packets are spread evenly over the duration of the input.
+   *
+   * Since: 1.4
+   */
+  g_object_class_install_property (gobject_class, PROP_PCR_PACING,
+      g_param_spec_boolean ("pcr-pacing", "PCR pacing",
+          "Timestamp the packets with the PCR of the stream",
+          DEFAULT_PCR_PACING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_rtp_mp2t_pay_reset_pacing (GstRTPMP2TPay * rtpmp2tpay)
+{
+  rtpmp2tpay->pcr_pid = -1;
+  rtpmp2tpay->pcr = 0;
+  rtpmp2tpay->pcr_time = GST_CLOCK_TIME_NONE;
+  rtpmp2tpay->pcr_bytes = 0;
+  rtpmp2tpay->byte_rate = 0;
+  rtpmp2tpay->last_time = GST_CLOCK_TIME_NONE;
 }
 
 static void
@@ -88,6 +145,8 @@ gst_rtp_mp2t_pay_init (GstRTPMP2TPay * rtpmp2tpay)
   GST_RTP_BASE_PAYLOAD_PT (rtpmp2tpay) = GST_RTP_PAYLOAD_MP2T;
 
   rtpmp2tpay->adapter = gst_adapter_new ();
+  rtpmp2tpay->pcr_pacing = DEFAULT_PCR_PACING;
+  gst_rtp_mp2t_pay_reset_pacing (rtpmp2tpay);
 }
 
 static void
@@ -114,57 +173,225 @@ gst_rtp_mp2t_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
   return res;
 }
 
+static gboolean
+gst_rtp_mp2t_pay_read_pcr (const guint8 * data, gint * pid, guint64 * pcr)
+{
+  /* sync byte, adaptation field with the PCR flag */
+  if (data[0] != 0x47 || !(data[3] & 0x20) || data[4] < 7 || !(data[5] & 0x10))
+    return FALSE;
+
+  *pid = ((data[1] & 0x1f) << 8) | data[2];
+  *pcr = ((guint64) data[6] << 25 | data[7] << 17 | data[8] << 9 |
+      data[9] << 1 | data[10] >> 7) * 300 + ((data[10] & 1) << 8 | data[11]);
+
+  return TRUE;
+}
+
+/* get the time at which the TS packet in @data is due from the PCR before it
+ * and the byte rate between the last two PCRs */
+static GstClockTime
+gst_rtp_mp2t_pay_packet_time (GstRTPMP2TPay * rtpmp2tpay, const guint8 * data)
+{
+  GstClockTime time = GST_CLOCK_TIME_NONE;
+  guint64 pcr;
+  gint pid;
+
+  if (gst_rtp_mp2t_pay_read_pcr (data, &pid, &pcr) &&
+      (rtpmp2tpay->pcr_pid == -1 || rtpmp2tpay->pcr_pid == pid)) {
+    GstClockTime delta = GST_CLOCK_TIME_NONE;
+
+    if (rtpmp2tpay->pcr_pid != -1)
+      delta = gst_util_uint64_scale ((pcr + PCR_WRAP - rtpmp2tpay->pcr) %
+          PCR_WRAP, 1000, 27);
+
+    if (GST_CLOCK_TIME_IS_VALID (delta) && delta > 0 && delta < GST_SECOND &&
+        GST_CLOCK_TIME_IS_VALID (rtpmp2tpay->pcr_time)) {
+      rtpmp2tpay->byte_rate = gst_util_uint64_scale (rtpmp2tpay->pcr_bytes,
+          GST_SECOND, delta);
+      rtpmp2tpay->pcr_time += delta;
+
+      /* the PCR clock and the input timestamps drifted apart, continue from
+       * the input timestamp. The PCR can be anywhere in the pending input. */
+      if (GST_CLOCK_TIME_IS_VALID (rtpmp2tpay->first_ts)) {
+        GstClockTime start, end;
+
+        start = rtpmp2tpay->first_ts;
+        end = start;
+        if (GST_CLOCK_TIME_IS_VALID (rtpmp2tpay->duration))
+          end += rtpmp2tpay->duration;
+
+        if (rtpmp2tpay->pcr_time + PCR_MAX_DRIFT < start ||
+            rtpmp2tpay->pcr_time > end + PCR_MAX_DRIFT) {
+          GST_DEBUG_OBJECT (rtpmp2tpay, "PCR time %" GST_TIME_FORMAT
+              " drifted from input %" GST_TIME_FORMAT ", resyncing",
+              GST_TIME_ARGS (rtpmp2tpay->pcr_time), GST_TIME_ARGS (start));
+          rtpmp2tpay->pcr_time = start;
+          rtpmp2tpay->last_time = GST_CLOCK_TIME_NONE;
+        }
+      }
+    } else {
+      /* first PCR or a discontinuity, continue from the input timestamp */
+      GST_DEBUG_OBJECT (rtpmp2tpay, "PCR on PID %d restarts pacing", pid);
+      rtpmp2tpay->pcr_pid = pid;
+      rtpmp2tpay->pcr_time = rtpmp2tpay->first_ts;
+      rtpmp2tpay->byte_rate = 0;
+    }
+    rtpmp2tpay->pcr = pcr;
+    rtpmp2tpay->pcr_bytes = 0;
+  }
+
+  if (rtpmp2tpay->byte_rate > 0)
+    time = rtpmp2tpay->pcr_time +
+        gst_util_uint64_scale (rtpmp2tpay->pcr_bytes, GST_SECOND,
+        rtpmp2tpay->byte_rate);
+
+  rtpmp2tpay->pcr_bytes += 188;
+
+  return time;
+}
+
+/* timestamp the packet with @paybuf, the @index of @n_packets in this flush */
+static void
+gst_rtp_mp2t_pay_pace (GstRTPMP2TPay * rtpmp2tpay, GstBuffer * paybuf,
+    guint index, guint n_packets, GstClockTime * timestamp,
+    GstClockTime * duration)
+{
+  GstClockTime time = GST_CLOCK_TIME_NONE;
+  GstMapInfo map;
+  gsize offset;
+
+  gst_buffer_map (paybuf, &map, GST_MAP_READ);
+  for (offset = 0; offset + 188 <= map.size; offset += 188) {
+    GstClockTime t;
+
+    t = gst_rtp_mp2t_pay_packet_time (rtpmp2tpay, map.data + offset);
+    if (offset == 0)
+      time = t;
+  }
+  gst_buffer_unmap (paybuf, &map);
+
+  if (GST_CLOCK_TIME_IS_VALID (time)) {
+    *duration = gst_util_uint64_scale (map.size, GST_SECOND,
+        rtpmp2tpay->byte_rate);
+  } else if (GST_CLOCK_TIME_IS_VALID (rtpmp2tpay->first_ts) &&
+      GST_CLOCK_TIME_IS_VALID (rtpmp2tpay->duration)) {
+    /* no PCR yet, spread the packets over the duration of the input */
+    time = rtpmp2tpay->first_ts +
+        gst_util_uint64_scale (rtpmp2tpay->duration, index, n_packets);
+    *duration = rtpmp2tpay->duration / n_packets;
+  } else {
+    time = rtpmp2tpay->first_ts;
+    *duration = rtpmp2tpay->duration;
+  }
+
+  /* the byte rate changes between PCRs, never go back in time */
+  if (GST_CLOCK_TIME_IS_VALID (time) &&
+      GST_CLOCK_TIME_IS_VALID (rtpmp2tpay->last_time) &&
+      time < rtpmp2tpay->last_time)
+    time = rtpmp2tpay->last_time;
+  if (GST_CLOCK_TIME_IS_VALID (time))
+    rtpmp2tpay->last_time = time;
+
+  *timestamp = time;
+}
+
 static GstFlowReturn
 gst_rtp_mp2t_pay_flush (GstRTPMP2TPay * rtpmp2tpay)
 {
-  guint avail, mtu;
-  GstFlowReturn ret = GST_FLOW_OK;
-  GstBuffer *outbuf;
+  guint avail, mtu, max_len;
+  guint n_packets, i;
+  GstBufferList *list;
 
   avail = gst_adapter_available (rtpmp2tpay->adapter);
+  avail -= avail % 188;
 
   mtu = GST_RTP_BASE_PAYLOAD_MTU (rtpmp2tpay);
 
-  while (avail > 0 && (ret == GST_FLOW_OK)) {
-    guint towrite;
-    guint payload_len;
-    guint packet_len;
-    GstBuffer *paybuf;
+  /* fill each packet up to the MTU with whole TS packets */
+  max_len = gst_rtp_buffer_calc_payload_len (mtu, 0, 0);
+  max_len -= max_len % 188;
 
-    /* this will be the total length of the packet */
-    packet_len = gst_rtp_buffer_calc_packet_len (avail, 0, 0);
+  if (avail == 0 || max_len == 0)
+    return GST_FLOW_OK;
 
-    /* fill one MTU or all available bytes */
-    towrite = MIN (packet_len, mtu);
+  n_packets = (avail + max_len - 1) / max_len;
+  list = gst_buffer_list_new_sized (n_packets);
 
-    /* this is the payload length */
-    payload_len = gst_rtp_buffer_calc_payload_len (towrite, 0, 0);
-    payload_len -= payload_len % 188;
+  for (i = 0; i < n_packets; i++) {
+    guint payload_len;
+    GstBuffer *outbuf, *paybuf;
+    GstClockTime timestamp, duration;
 
-    /* need whole packets */
-    if (!payload_len)
-      break;
+    payload_len = MIN (avail, max_len);
 
     /* create buffer to hold the payload */
     outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
 
     /* get payload */
     paybuf = gst_adapter_take_buffer_fast (rtpmp2tpay->adapter, payload_len);
-    outbuf = gst_buffer_append (outbuf, paybuf);
     avail -= payload_len;
 
-    GST_BUFFER_TIMESTAMP (outbuf) = rtpmp2tpay->first_ts;
-    GST_BUFFER_DURATION (outbuf) = rtpmp2tpay->duration;
+    if (rtpmp2tpay->pcr_pacing) {
+      gst_rtp_mp2t_pay_pace (rtpmp2tpay, paybuf, i, n_packets, &timestamp,
+          &duration);
+    } else {
+      timestamp = rtpmp2tpay->first_ts;
+      duration = rtpmp2tpay->duration;
+    }
+
+    outbuf = gst_buffer_append (outbuf, paybuf);
+
+    GST_BUFFER_TIMESTAMP (outbuf) = timestamp;
+    GST_BUFFER_DURATION (outbuf) = duration;
 
-    GST_DEBUG_OBJECT (rtpmp2tpay, "pushing buffer of size %u",
-        (guint) gst_buffer_get_size (outbuf));
+    GST_LOG_OBJECT (rtpmp2tpay, "packet of size %u, timestamp %"
+        GST_TIME_FORMAT, payload_len, GST_TIME_ARGS (timestamp));
 
-    ret = gst_rtp_base_payload_push (GST_RTP_BASE_PAYLOAD (rtpmp2tpay), outbuf);
+    gst_buffer_list_add (list, outbuf);
   }
 
+  GST_DEBUG_OBJECT (rtpmp2tpay, "pushing list of %u packets", n_packets);
+
+  return gst_rtp_base_payload_push_list (GST_RTP_BASE_PAYLOAD (rtpmp2tpay),
+      list);
+}
+
+/* push what is pending and start pacing again from the next input */
+static GstFlowReturn
+gst_rtp_mp2t_pay_restart (GstRTPMP2TPay * rtpmp2tpay)
+{
+  GstFlowReturn ret;
+
+  ret = gst_rtp_mp2t_pay_flush (rtpmp2tpay);
+  gst_adapter_clear (rtpmp2tpay->adapter);
+  gst_rtp_mp2t_pay_reset_pacing (rtpmp2tpay);
+
   return ret;
 }
 
+static gboolean
+gst_rtp_mp2t_pay_sink_event (GstRTPBasePayload * payload, GstEvent * event)
+{
+  GstRTPMP2TPay *rtpmp2tpay;
+
+  rtpmp2tpay = GST_RTP_MP2T_PAY (payload);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      gst_adapter_clear (rtpmp2tpay->adapter);
+      gst_rtp_mp2t_pay_reset_pacing (rtpmp2tpay);
+      break;
+    case GST_EVENT_SEGMENT:
+      /* the timestamps of a new segment can go back in time */
+      gst_rtp_mp2t_pay_restart (rtpmp2tpay);
+      break;
+    default:
+      break;
+  }
+
+  return GST_RTP_BASE_PAYLOAD_CLASS (parent_class)->sink_event (payload, event);
+}
+
 static GstFlowReturn
 gst_rtp_mp2t_pay_handle_buffer (GstRTPBasePayload * basepayload,
     GstBuffer * buffer)
@@ -180,6 +407,15 @@ gst_rtp_mp2t_pay_handle_buffer (GstRTPBasePayload * basepayload,
   timestamp = GST_BUFFER_TIMESTAMP (buffer);
   duration = GST_BUFFER_DURATION (buffer);
 
+  if (GST_BUFFER_IS_DISCONT (buffer)) {
+    GST_DEBUG_OBJECT (rtpmp2tpay, "discont, restarting pacing");
+    ret = gst_rtp_mp2t_pay_restart (rtpmp2tpay);
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref (buffer);
+      return ret;
+    }
+  }
+
 again:
   ret = GST_FLOW_OK;
   avail = gst_adapter_available (rtpmp2tpay->adapter);
@@ -222,6 +458,64 @@ again:
 
 }
 
+static void
+gst_rtp_mp2t_pay_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRTPMP2TPay *rtpmp2tpay;
+
+  rtpmp2tpay = GST_RTP_MP2T_PAY (object);
+
+  switch (prop_id) {
+    case PROP_PCR_PACING:
+      rtpmp2tpay->pcr_pacing = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_rtp_mp2t_pay_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRTPMP2TPay *rtpmp2tpay;
+
+  rtpmp2tpay = GST_RTP_MP2T_PAY (object);
+
+  switch (prop_id) {
+    case PROP_PCR_PACING:
+      g_value_set_boolean (value, rtpmp2tpay->pcr_pacing);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static GstStateChangeReturn
+gst_rtp_mp2t_pay_change_state (GstElement * element, GstStateChange transition)
+{
+  GstRTPMP2TPay *rtpmp2tpay;
+  GstStateChangeReturn ret;
+
+  rtpmp2tpay = GST_RTP_MP2T_PAY (element);
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_adapter_clear (rtpmp2tpay->adapter);
+      gst_rtp_mp2t_pay_reset_pacing (rtpmp2tpay);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
 gboolean
 gst_rtp_mp2t_pay_plugin_init (GstPlugin * plugin)
 {
@@ -48,6 +48,16 @@ struct _GstRTPMP2TPay
   GstAdapter  *adapter;
   GstClockTime first_ts;
   GstClockTime duration;
+
+  gboolean pcr_pacing;
+
+  /* PCR pacing state */
+  gint pcr_pid;
+  guint64 pcr;
+  GstClockTime pcr_time;
+  guint64 pcr_bytes;
+  guint64 byte_rate;
+  GstClockTime last_time;
 };
 
 struct _GstRTPMP2TPayClass
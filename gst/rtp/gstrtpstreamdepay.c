@@ -54,25 +54,41 @@ static GstStaticPadTemplate sink_template =
         "application/x-srtp-stream; application/x-srtcp-stream")
     );
 
-#define parent_class gst_rtp_stream_depay_parent_class
-G_DEFINE_TYPE (GstRtpStreamDepay, gst_rtp_stream_depay, GST_TYPE_BASE_PARSE);
+typedef struct
+{
+  guint offset;
+  guint size;
+  GstClockTime pts;
+  GstClockTime dts;
+} GstRtpStreamPacket;
 
-static gboolean gst_rtp_stream_depay_set_sink_caps (GstBaseParse * parse,
-    GstCaps * caps);
-static GstCaps *gst_rtp_stream_depay_get_sink_caps (GstBaseParse * parse,
-    GstCaps * filter);
-static GstFlowReturn gst_rtp_stream_depay_handle_frame (GstBaseParse * parse,
-    GstBaseParseFrame * frame, gint * skipsize);
+#define parent_class gst_rtp_stream_depay_parent_class
+G_DEFINE_TYPE (GstRtpStreamDepay, gst_rtp_stream_depay, GST_TYPE_ELEMENT);
+
+static void gst_rtp_stream_depay_finalize (GObject * object);
+static GstStateChangeReturn gst_rtp_stream_depay_change_state (GstElement *
+    element, GstStateChange transition);
+static gboolean gst_rtp_stream_depay_sink_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
+static GstFlowReturn gst_rtp_stream_depay_sink_chain (GstPad * pad,
+    GstObject * parent, GstBuffer * inbuf);
+static gboolean gst_rtp_stream_depay_sink_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
 
 static void
 gst_rtp_stream_depay_class_init (GstRtpStreamDepayClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
-  GstBaseParseClass *parse_class = GST_BASE_PARSE_CLASS (klass);
 
   GST_DEBUG_CATEGORY_INIT (gst_rtp_stream_depay_debug, "rtpstreamdepay", 0,
       "RTP stream depayloader");
 
+  gobject_class->finalize = gst_rtp_stream_depay_finalize;
+
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_rtp_stream_depay_change_state);
+
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&src_template));
   gst_element_class_add_pad_template (gstelement_class,
@@ -82,23 +98,51 @@ gst_rtp_stream_depay_class_init (GstRtpStreamDepayClass * klass)
       "RTP Stream Depayloading", "Codec/Depayloader/Network",
       "Depayloads RTP/RTCP packets for streaming protocols according to RFC4571",
       "Sebastian Dröge <sebastian@centricular.com>");
+}
 
-  parse_class->set_sink_caps =
-      GST_DEBUG_FUNCPTR (gst_rtp_stream_depay_set_sink_caps);
-  parse_class->get_sink_caps =
-      GST_DEBUG_FUNCPTR (gst_rtp_stream_depay_get_sink_caps);
-  parse_class->handle_frame =
-      GST_DEBUG_FUNCPTR (gst_rtp_stream_depay_handle_frame);
+static void
+gst_rtp_stream_depay_reset (GstRtpStreamDepay * self)
+{
+  gst_adapter_clear (self->adapter);
+  self->discont = TRUE;
+  self->prev_pts = GST_CLOCK_TIME_NONE;
+  self->prev_dts = GST_CLOCK_TIME_NONE;
 }
 
 static void
 gst_rtp_stream_depay_init (GstRtpStreamDepay * self)
 {
-  gst_base_parse_set_min_frame_size (GST_BASE_PARSE (self), 2);
+  self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_stream_depay_sink_chain));
+  gst_pad_set_event_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_stream_depay_sink_event));
+  gst_pad_set_query_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_stream_depay_sink_query));
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  self->srcpad = gst_pad_new_from_static_template (&src_template, "src");
+  gst_pad_use_fixed_caps (self->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
+
+  self->adapter = gst_adapter_new ();
+  self->packets = g_array_new (FALSE, FALSE, sizeof (GstRtpStreamPacket));
+  gst_rtp_stream_depay_reset (self);
+}
+
+static void
+gst_rtp_stream_depay_finalize (GObject * object)
+{
+  GstRtpStreamDepay *self = GST_RTP_STREAM_DEPAY (object);
+
+  g_object_unref (self->adapter);
+  g_array_free (self->packets, TRUE);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static gboolean
-gst_rtp_stream_depay_set_sink_caps (GstBaseParse * parse, GstCaps * caps)
+gst_rtp_stream_depay_set_sink_caps (GstRtpStreamDepay * self, GstCaps * caps)
 {
   GstCaps *othercaps;
   GstStructure *structure;
@@ -116,14 +160,14 @@ gst_rtp_stream_depay_set_sink_caps (GstBaseParse * parse, GstCaps * caps)
   else
     gst_structure_set_name (structure, "application/x-srtcp");
 
-  ret = gst_pad_set_caps (GST_BASE_PARSE_SRC_PAD (parse), othercaps);
+  ret = gst_pad_set_caps (self->srcpad, othercaps);
   gst_caps_unref (othercaps);
 
   return ret;
 }
 
 static GstCaps *
-gst_rtp_stream_depay_get_sink_caps (GstBaseParse * parse, GstCaps * filter)
+gst_rtp_stream_depay_get_sink_caps (GstRtpStreamDepay * self, GstCaps * filter)
 {
   GstCaps *peerfilter = NULL, *peercaps, *templ;
   GstCaps *res;
@@ -147,9 +191,8 @@ gst_rtp_stream_depay_get_sink_caps (GstBaseParse * parse, GstCaps * filter)
     }
   }
 
-  templ = gst_pad_get_pad_template_caps (GST_BASE_PARSE_SINK_PAD (parse));
-  peercaps =
-      gst_pad_peer_query_caps (GST_BASE_PARSE_SRC_PAD (parse), peerfilter);
+  templ = gst_pad_get_pad_template_caps (self->sinkpad);
+  peercaps = gst_pad_peer_query_caps (self->srcpad, peerfilter);
 
   if (peercaps) {
     /* Rename structure names */
@@ -170,6 +213,7 @@ gst_rtp_stream_depay_get_sink_caps (GstBaseParse * parse, GstCaps * filter)
 
     res = gst_caps_intersect_full (peercaps, templ, GST_CAPS_INTERSECT_FIRST);
     gst_caps_unref (peercaps);
+    gst_caps_unref (templ);
   } else {
     res = templ;
   }
@@ -188,27 +232,197 @@ gst_rtp_stream_depay_get_sink_caps (GstBaseParse * parse, GstCaps * filter)
   return res;
 }
 
+static gboolean
+gst_rtp_stream_depay_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstRtpStreamDepay *self = GST_RTP_STREAM_DEPAY (parent);
+  gboolean ret;
+
+  GST_LOG_OBJECT (pad, "Handling query of type '%s'",
+      gst_query_type_get_name (GST_QUERY_TYPE (query)));
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CAPS:
+    {
+      GstCaps *caps;
+
+      gst_query_parse_caps (query, &caps);
+      caps = gst_rtp_stream_depay_get_sink_caps (self, caps);
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      ret = TRUE;
+      break;
+    }
+    default:
+      ret = gst_pad_query_default (pad, parent, query);
+  }
+
+  return ret;
+}
+
+static gboolean
+gst_rtp_stream_depay_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstRtpStreamDepay *self = GST_RTP_STREAM_DEPAY (parent);
+  gboolean ret;
+
+  GST_LOG_OBJECT (pad, "Got %s event", GST_EVENT_TYPE_NAME (event));
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+    {
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      ret = gst_rtp_stream_depay_set_sink_caps (self, caps);
+      gst_event_unref (event);
+      break;
+    }
+    case GST_EVENT_SEGMENT:
+    {
+      const GstSegment *segment;
+
+      /* the packets are timestamped with the time of the stream, a byte
+       * segment from a network source is not useful downstream */
+      gst_event_parse_segment (event, &segment);
+      if (segment->format != GST_FORMAT_TIME) {
+        GstSegment tsegment;
+
+        gst_segment_init (&tsegment, GST_FORMAT_TIME);
+        gst_event_unref (event);
+        event = gst_event_new_segment (&tsegment);
+      }
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
+    }
+    case GST_EVENT_FLUSH_STOP:
+      gst_rtp_stream_depay_reset (self);
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
+    case GST_EVENT_EOS:
+      if (gst_adapter_available (self->adapter) > 0)
+        GST_DEBUG_OBJECT (self, "dropping %" G_GSIZE_FORMAT " bytes of an "
+            "incomplete packet", gst_adapter_available (self->adapter));
+      gst_adapter_clear (self->adapter);
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
+    default:
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
+  }
+
+  return ret;
+}
+
+/* Find all complete packets in the adapter in one pass, take them out of the
+ * adapter together and push them as a list of sub-buffers. A packet gets the
+ * timestamps of the input buffer it starts in when it is the first packet
+ * that starts in that buffer. */
 static GstFlowReturn
-gst_rtp_stream_depay_handle_frame (GstBaseParse * parse,
-    GstBaseParseFrame * frame, gint * skipsize)
+gst_rtp_stream_depay_sink_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * inbuf)
 {
-  gsize buf_size;
-  guint16 size;
+  GstRtpStreamDepay *self = GST_RTP_STREAM_DEPAY (parent);
+  GstBuffer *outbuf;
+  GstBufferList *list;
+  gsize avail, offset;
+  guint i;
+
+  if (GST_BUFFER_FLAG_IS_SET (inbuf, GST_BUFFER_FLAG_DISCONT)) {
+    if (gst_adapter_available (self->adapter) > 0)
+      GST_DEBUG_OBJECT (self, "discont, dropping %" G_GSIZE_FORMAT " bytes",
+          gst_adapter_available (self->adapter));
+    gst_rtp_stream_depay_reset (self);
+  }
 
-  if (gst_buffer_extract (frame->buffer, 0, &size, 2) != 2)
-    return GST_FLOW_ERROR;
+  gst_adapter_push (self->adapter, inbuf);
 
-  size = GUINT16_FROM_BE (size);
-  buf_size = gst_buffer_get_size (frame->buffer);
+  avail = gst_adapter_available (self->adapter);
+  g_array_set_size (self->packets, 0);
+  offset = 0;
+
+  while (offset + 2 <= avail) {
+    GstRtpStreamPacket packet;
+    GstClockTime pts, dts;
+    guint8 size16[2];
+
+    gst_adapter_copy (self->adapter, size16, offset, 2);
+    packet.size = GST_READ_UINT16_BE (size16);
+
+    /* need more data */
+    if (offset + 2 + packet.size > avail)
+      break;
+
+    pts = gst_adapter_prev_pts_at_offset (self->adapter, offset, NULL);
+    dts = gst_adapter_prev_dts_at_offset (self->adapter, offset, NULL);
+
+    packet.offset = offset + 2;
+    packet.pts = packet.dts = GST_CLOCK_TIME_NONE;
+    if (GST_CLOCK_TIME_IS_VALID (pts) && pts != self->prev_pts)
+      packet.pts = self->prev_pts = pts;
+    if (GST_CLOCK_TIME_IS_VALID (dts) && dts != self->prev_dts)
+      packet.dts = self->prev_dts = dts;
+
+    if (packet.size > 0)
+      g_array_append_val (self->packets, packet);
+
+    offset += 2 + packet.size;
+  }
 
-  /* Need more data */
-  if (size + 2 > buf_size)
+  if (offset == 0)
     return GST_FLOW_OK;
 
-  frame->out_buffer =
-      gst_buffer_copy_region (frame->buffer, GST_BUFFER_COPY_ALL, 2, size);
+  /* the packets share the memory of the input buffers */
+  outbuf = gst_adapter_take_buffer_fast (self->adapter, offset);
 
-  return gst_base_parse_finish_frame (parse, frame, size + 2);
+  if (self->packets->len == 0) {
+    gst_buffer_unref (outbuf);
+    return GST_FLOW_OK;
+  }
+
+  list = gst_buffer_list_new_sized (self->packets->len);
+  for (i = 0; i < self->packets->len; i++) {
+    GstRtpStreamPacket *packet =
+        &g_array_index (self->packets, GstRtpStreamPacket, i);
+    GstBuffer *buf;
+
+    buf = gst_buffer_copy_region (outbuf, GST_BUFFER_COPY_MEMORY,
+        packet->offset, packet->size);
+    GST_BUFFER_PTS (buf) = packet->pts;
+    GST_BUFFER_DTS (buf) = packet->dts;
+    if (self->discont) {
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+      self->discont = FALSE;
+    }
+    gst_buffer_list_add (list, buf);
+  }
+  gst_buffer_unref (outbuf);
+
+  GST_LOG_OBJECT (self, "pushing %u packets", self->packets->len);
+
+  return gst_pad_push_list (self->srcpad, list);
+}
+
+static GstStateChangeReturn
+gst_rtp_stream_depay_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstRtpStreamDepay *self = GST_RTP_STREAM_DEPAY (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_rtp_stream_depay_reset (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
 }
 
 gboolean
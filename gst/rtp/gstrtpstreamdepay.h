@@ -21,7 +21,7 @@
 #define __GST_RTP_STREAM_DEPAY_H__
 
 #include <gst/gst.h>
-#include <gst/base/gstbaseparse.h>
+#include <gst/base/gstadapter.h>
 
 G_BEGIN_DECLS
 
@@ -41,12 +41,20 @@ typedef struct _GstRtpStreamDepayClass GstRtpStreamDepayClass;
 
 struct _GstRtpStreamDepay
 {
-  GstBaseParse parent;
+  GstElement parent;
+
+  GstPad *srcpad, *sinkpad;
+
+  GstAdapter *adapter;
+  /* offsets of the packets in the adapter */
+  GArray *packets;
+  gboolean discont;
+  GstClockTime prev_pts, prev_dts;
 };
 
 struct _GstRtpStreamDepayClass
 {
-  GstBaseParseClass parent_class;
+  GstElementClass parent_class;
 };
 
 GType gst_rtp_stream_depay_get_type (void);
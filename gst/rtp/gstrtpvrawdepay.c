@@ -99,6 +99,7 @@ static void
 gst_rtp_vraw_depay_reset (GstRtpVRawDepay * rtpvrawdepay)
 {
   if (rtpvrawdepay->outbuf) {
+    gst_video_frame_unmap (&rtpvrawdepay->frame);
     gst_buffer_unref (rtpvrawdepay->outbuf);
     rtpvrawdepay->outbuf = NULL;
   }
@@ -164,6 +165,101 @@ gst_rtp_vraw_depay_negotiate_pool (GstRtpVRawDepay * depay, GstCaps * caps,
   return GST_FLOW_OK;
 }
 
+/* Line unpacking functions. They read @pgroups pixel groups in the RFC 4175
+ * sample order from @payload and write them to the line @line, starting at
+ * pixel @offs. The loops are kept simple with fixed strides and no per-pixel
+ * branches so that the compiler can unroll and vectorize them. */
+static void
+gst_rtp_vraw_depay_unpack_copy (GstRtpVRawDepay * depay, GstVideoFrame * frame,
+    guint line, guint offs, const guint8 * payload, guint pgroups)
+{
+  guint8 *p0;
+
+  /* samples are packed just like gstreamer packs them */
+  p0 = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  p0 += line * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+  p0 += (offs / depay->xinc) * depay->pgroup;
+
+  memcpy (p0, payload, pgroups * depay->pgroup);
+}
+
+static void
+gst_rtp_vraw_depay_unpack_ayuv (GstRtpVRawDepay * depay, GstVideoFrame * frame,
+    guint line, guint offs, const guint8 * payload, guint pgroups)
+{
+  guint8 *d;
+  guint i;
+
+  d = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  d += line * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0) + offs * 4;
+
+  /* samples are packed in order Cb-Y-Cr for both interlaced and
+   * progressive frames */
+  for (i = 0; i < pgroups; i++) {
+    d[4 * i + 0] = 0;
+    d[4 * i + 1] = payload[3 * i + 1];
+    d[4 * i + 2] = payload[3 * i + 0];
+    d[4 * i + 3] = payload[3 * i + 2];
+  }
+}
+
+static void
+gst_rtp_vraw_depay_unpack_i420 (GstRtpVRawDepay * depay, GstVideoFrame * frame,
+    guint line, guint offs, const guint8 * payload, guint pgroups)
+{
+  guint8 *y1, *y2, *u, *v;
+  guint ystride, uvoff, i;
+
+  ystride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  y1 = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  y1 += line * ystride + offs;
+  y2 = y1 + ystride;
+  uvoff = (line / depay->yinc) * GST_VIDEO_FRAME_COMP_STRIDE (frame, 1) +
+      offs / depay->xinc;
+  u = GST_VIDEO_FRAME_COMP_DATA (frame, 1);
+  u += uvoff;
+  v = GST_VIDEO_FRAME_COMP_DATA (frame, 2);
+  v += uvoff;
+
+  /* line 0/1: Y00-Y01-Y10-Y11-Cb00-Cr00 Y02-Y03-Y12-Y13-Cb01-Cr01 ...  */
+  for (i = 0; i < pgroups; i++) {
+    y1[2 * i + 0] = payload[6 * i + 0];
+    y1[2 * i + 1] = payload[6 * i + 1];
+    y2[2 * i + 0] = payload[6 * i + 2];
+    y2[2 * i + 1] = payload[6 * i + 3];
+    u[i] = payload[6 * i + 4];
+    v[i] = payload[6 * i + 5];
+  }
+}
+
+static void
+gst_rtp_vraw_depay_unpack_y41b (GstRtpVRawDepay * depay, GstVideoFrame * frame,
+    guint line, guint offs, const guint8 * payload, guint pgroups)
+{
+  guint8 *y, *u, *v;
+  guint uvoff, i;
+
+  y = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  y += line * GST_VIDEO_FRAME_COMP_STRIDE (frame, 0) + offs;
+  uvoff = (line / depay->yinc) * GST_VIDEO_FRAME_COMP_STRIDE (frame, 1) +
+      offs / depay->xinc;
+  u = GST_VIDEO_FRAME_COMP_DATA (frame, 1);
+  u += uvoff;
+  v = GST_VIDEO_FRAME_COMP_DATA (frame, 2);
+  v += uvoff;
+
+  /* Samples are packed in order Cb0-Y0-Y1-Cr0-Y2-Y3 for both interlaced
+   * and progressive scan lines */
+  for (i = 0; i < pgroups; i++) {
+    u[i] = payload[6 * i + 0];
+    y[4 * i + 0] = payload[6 * i + 1];
+    y[4 * i + 1] = payload[6 * i + 2];
+    v[i] = payload[6 * i + 3];
+    y[4 * i + 2] = payload[6 * i + 4];
+    y[4 * i + 3] = payload[6 * i + 5];
+  }
+}
+
 static gboolean
 gst_rtp_vraw_depay_setcaps (GstRTPBaseDepayload * depayload, GstCaps * caps)
 {
@@ -175,12 +271,17 @@ gst_rtp_vraw_depay_setcaps (GstRTPBaseDepayload * depayload, GstCaps * caps)
   GstCaps *srccaps;
   gboolean res;
   GstFlowReturn ret;
+  GstRtpVRawUnpackFunc unpack;
 
   rtpvrawdepay = GST_RTP_VRAW_DEPAY (depayload);
 
+  /* a pending frame was mapped with the old format */
+  gst_rtp_vraw_depay_reset (rtpvrawdepay);
+
   structure = gst_caps_get_structure (caps, 0);
 
   xinc = yinc = 1;
+  unpack = gst_rtp_vraw_depay_unpack_copy;
 
   if (!gst_structure_get_int (structure, "clock-rate", &clock_rate))
     clock_rate = 90000;         /* default */
@@ -221,6 +322,7 @@ gst_rtp_vraw_depay_setcaps (GstRTPBaseDepayload * depayload, GstCaps * caps)
   } else if (!strcmp (str, "YCbCr-4:4:4")) {
     format = GST_VIDEO_FORMAT_AYUV;
     pgroup = 3;
+    unpack = gst_rtp_vraw_depay_unpack_ayuv;
   } else if (!strcmp (str, "YCbCr-4:2:2")) {
     if (depth == 8) {
       format = GST_VIDEO_FORMAT_UYVY;
@@ -235,10 +337,12 @@ gst_rtp_vraw_depay_setcaps (GstRTPBaseDepayload * depayload, GstCaps * caps)
     format = GST_VIDEO_FORMAT_I420;
     pgroup = 6;
     xinc = yinc = 2;
+    unpack = gst_rtp_vraw_depay_unpack_i420;
   } else if (!strcmp (str, "YCbCr-4:1:1")) {
     format = GST_VIDEO_FORMAT_Y41B;
     pgroup = 6;
     xinc = 4;
+    unpack = gst_rtp_vraw_depay_unpack_y41b;
   } else
     goto unknown_format;
 
@@ -250,6 +354,7 @@ gst_rtp_vraw_depay_setcaps (GstRTPBaseDepayload * depayload, GstCaps * caps)
   rtpvrawdepay->pgroup = pgroup;
   rtpvrawdepay->xinc = xinc;
   rtpvrawdepay->yinc = yinc;
+  rtpvrawdepay->unpack = unpack;
 
   srccaps = gst_video_info_to_caps (&rtpvrawdepay->vinfo);
   res = gst_pad_set_caps (GST_RTP_BASE_DEPAYLOAD_SRCPAD (depayload), srccaps);
@@ -309,12 +414,11 @@ static GstBuffer *
 gst_rtp_vraw_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
 {
   GstRtpVRawDepay *rtpvrawdepay;
-  guint8 *payload, *p0, *yp, *up, *vp, *headers;
+  guint8 *payload, *headers;
   guint32 timestamp;
-  guint cont, ystride, uvstride, pgroup, payload_len;
+  guint cont, pgroup, payload_len;
   gint width, height, xinc, yinc;
   GstRTPBuffer rtp = { NULL };
-  GstVideoFrame frame;
   gboolean marker;
   GstBuffer *outbuf = NULL;
 
@@ -331,6 +435,7 @@ gst_rtp_vraw_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
     GST_LOG_OBJECT (depayload, "new frame with timestamp %u", timestamp);
     /* new timestamp, flush old buffer and create new output buffer */
     if (rtpvrawdepay->outbuf) {
+      gst_video_frame_unmap (&rtpvrawdepay->frame);
       gst_rtp_base_depayload_push (depayload, rtpvrawdepay->outbuf);
       rtpvrawdepay->outbuf = NULL;
     }
@@ -352,23 +457,18 @@ gst_rtp_vraw_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
     /* clear timestamp from alloc... */
     GST_BUFFER_TIMESTAMP (outbuf) = -1;
 
+    /* keep the frame mapped until it is complete instead of mapping it for
+     * every packet */
+    if (!gst_video_frame_map (&rtpvrawdepay->frame, &rtpvrawdepay->vinfo,
+            outbuf, GST_MAP_WRITE)) {
+      gst_buffer_unref (outbuf);
+      goto invalid_frame;
+    }
+
     rtpvrawdepay->outbuf = outbuf;
     rtpvrawdepay->timestamp = timestamp;
   }
 
-  if (!gst_video_frame_map (&frame, &rtpvrawdepay->vinfo, rtpvrawdepay->outbuf,
-          GST_MAP_WRITE))
-    goto invalid_frame;
-
-  /* get pointer and strides of the planes */
-  p0 = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
-  yp = GST_VIDEO_FRAME_COMP_DATA (&frame, 0);
-  up = GST_VIDEO_FRAME_COMP_DATA (&frame, 1);
-  vp = GST_VIDEO_FRAME_COMP_DATA (&frame, 2);
-
-  ystride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0);
-  uvstride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 1);
-
   pgroup = rtpvrawdepay->pgroup;
   width = GST_VIDEO_INFO_WIDTH (&rtpvrawdepay->vinfo);
   height = GST_VIDEO_INFO_HEIGHT (&rtpvrawdepay->vinfo);
@@ -401,7 +501,6 @@ gst_rtp_vraw_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
 
   while (TRUE) {
     guint length, line, offs, plen;
-    guint8 *datap;
 
     /* stop when we run out of data */
     if (payload_len == 0)
@@ -444,93 +543,8 @@ gst_rtp_vraw_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
         "writing length %u/%u, line %u, offset %u, remaining %u", plen, length,
         line, offs, payload_len);
 
-    switch (GST_VIDEO_INFO_FORMAT (&rtpvrawdepay->vinfo)) {
-      case GST_VIDEO_FORMAT_RGB:
-      case GST_VIDEO_FORMAT_RGBA:
-      case GST_VIDEO_FORMAT_BGR:
-      case GST_VIDEO_FORMAT_BGRA:
-      case GST_VIDEO_FORMAT_UYVY:
-      case GST_VIDEO_FORMAT_UYVP:
-        /* samples are packed just like gstreamer packs them */
-        offs /= xinc;
-        datap = p0 + (line * ystride) + (offs * pgroup);
-
-        memcpy (datap, payload, plen);
-        break;
-      case GST_VIDEO_FORMAT_AYUV:
-      {
-        gint i;
-        guint8 *p;
-
-        datap = p0 + (line * ystride) + (offs * 4);
-        p = payload;
-
-        /* samples are packed in order Cb-Y-Cr for both interlaced and
-         * progressive frames */
-        for (i = 0; i < plen; i += pgroup) {
-          *datap++ = 0;
-          *datap++ = p[1];
-          *datap++ = p[0];
-          *datap++ = p[2];
-          p += pgroup;
-        }
-        break;
-      }
-      case GST_VIDEO_FORMAT_I420:
-      {
-        gint i;
-        guint uvoff;
-        guint8 *yd1p, *yd2p, *udp, *vdp, *p;
-
-        yd1p = yp + (line * ystride) + (offs);
-        yd2p = yd1p + ystride;
-        uvoff = (line / yinc * uvstride) + (offs / xinc);
-
-        udp = up + uvoff;
-        vdp = vp + uvoff;
-        p = payload;
-
-        /* line 0/1: Y00-Y01-Y10-Y11-Cb00-Cr00 Y02-Y03-Y12-Y13-Cb01-Cr01 ...  */
-        for (i = 0; i < plen; i += pgroup) {
-          *yd1p++ = p[0];
-          *yd1p++ = p[1];
-          *yd2p++ = p[2];
-          *yd2p++ = p[3];
-          *udp++ = p[4];
-          *vdp++ = p[5];
-          p += pgroup;
-        }
-        break;
-      }
-      case GST_VIDEO_FORMAT_Y41B:
-      {
-        gint i;
-        guint uvoff;
-        guint8 *ydp, *udp, *vdp, *p;
-
-        ydp = yp + (line * ystride) + (offs);
-        uvoff = (line / yinc * uvstride) + (offs / xinc);
-
-        udp = up + uvoff;
-        vdp = vp + uvoff;
-        p = payload;
-
-        /* Samples are packed in order Cb0-Y0-Y1-Cr0-Y2-Y3 for both interlaced
-         * and progressive scan lines */
-        for (i = 0; i < plen; i += pgroup) {
-          *udp++ = p[0];
-          *ydp++ = p[1];
-          *ydp++ = p[2];
-          *vdp++ = p[3];
-          *ydp++ = p[4];
-          *ydp++ = p[5];
-          p += pgroup;
-        }
-        break;
-      }
-      default:
-        goto unknown_sampling;
-    }
+    rtpvrawdepay->unpack (rtpvrawdepay, &rtpvrawdepay->frame, line, offs,
+        payload, plen / pgroup);
 
   next:
     if (!cont)
@@ -540,12 +554,12 @@ gst_rtp_vraw_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
     payload_len -= length;
   }
 
-  gst_video_frame_unmap (&frame);
   marker = gst_rtp_buffer_get_marker (&rtp);
   gst_rtp_buffer_unmap (&rtp);
 
   if (marker) {
     GST_LOG_OBJECT (depayload, "marker, flushing frame");
+    gst_video_frame_unmap (&rtpvrawdepay->frame);
     outbuf = rtpvrawdepay->outbuf;
     rtpvrawdepay->outbuf = NULL;
     rtpvrawdepay->timestamp = -1;
@@ -553,14 +567,6 @@ gst_rtp_vraw_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
   return outbuf;
 
   /* ERRORS */
-unknown_sampling:
-  {
-    GST_ELEMENT_ERROR (depayload, STREAM, FORMAT,
-        (NULL), ("unimplemented sampling"));
-    gst_video_frame_unmap (&frame);
-    gst_rtp_buffer_unmap (&rtp);
-    return NULL;
-  }
 alloc_failed:
   {
     GST_WARNING_OBJECT (depayload, "failed to alloc output buffer");
@@ -576,14 +582,12 @@ invalid_frame:
 wrong_length:
   {
     GST_WARNING_OBJECT (depayload, "length not multiple of pgroup");
-    gst_video_frame_unmap (&frame);
     gst_rtp_buffer_unmap (&rtp);
     return NULL;
   }
 short_packet:
   {
     GST_WARNING_OBJECT (depayload, "short packet");
-    gst_video_frame_unmap (&frame);
     gst_rtp_buffer_unmap (&rtp);
     return NULL;
   }
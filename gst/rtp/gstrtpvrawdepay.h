@@ -42,6 +42,10 @@ G_BEGIN_DECLS
 typedef struct _GstRtpVRawDepay GstRtpVRawDepay;
 typedef struct _GstRtpVRawDepayClass GstRtpVRawDepayClass;
 
+typedef void (*GstRtpVRawUnpackFunc) (GstRtpVRawDepay * depay,
+    GstVideoFrame * frame, guint line, guint offs, const guint8 * payload,
+    guint pgroups);
+
 struct _GstRtpVRawDepay
 {
   GstRTPBaseDepayload payload;
@@ -50,11 +54,15 @@ struct _GstRtpVRawDepay
   GstVideoInfo vinfo;
 
   GstBuffer *outbuf;
+  /* mapped for as long as we have an outbuf */
+  GstVideoFrame frame;
   guint32 timestamp;
   guint outsize;
 
   gint pgroup;
   gint xinc, yinc;
+
+  GstRtpVRawUnpackFunc unpack;
 };
 
 struct _GstRtpVRawDepayClass
@@ -103,6 +103,98 @@ gst_rtp_vraw_pay_init (GstRtpVRawPay * rtpvrawpay)
 {
 }
 
+/* Line packing functions. They write @pgroups pixel groups of the line
+ * @line, starting at pixel @offs, into @outdata in the RFC 4175 sample order.
+ * The loops are kept simple with fixed strides and no per-pixel branches so
+ * that the compiler can unroll and vectorize them. */
+static void
+gst_rtp_vraw_pay_pack_copy (GstRtpVRawPay * pay, guint8 * outdata,
+    GstVideoFrame * frame, guint line, guint offs, guint pgroups)
+{
+  guint8 *p0;
+
+  /* samples are packed just like gstreamer packs them */
+  p0 = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  p0 += line * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+  p0 += (offs / pay->xinc) * pay->pgroup;
+
+  memcpy (outdata, p0, pgroups * pay->pgroup);
+}
+
+static void
+gst_rtp_vraw_pay_pack_ayuv (GstRtpVRawPay * pay, guint8 * outdata,
+    GstVideoFrame * frame, guint line, guint offs, guint pgroups)
+{
+  const guint8 *s;
+  guint i;
+
+  s = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  s += line * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0) + offs * 4;
+
+  /* A-Y-U-V -> Cb-Y-Cr */
+  for (i = 0; i < pgroups; i++) {
+    outdata[3 * i + 0] = s[4 * i + 2];
+    outdata[3 * i + 1] = s[4 * i + 1];
+    outdata[3 * i + 2] = s[4 * i + 3];
+  }
+}
+
+static void
+gst_rtp_vraw_pay_pack_i420 (GstRtpVRawPay * pay, guint8 * outdata,
+    GstVideoFrame * frame, guint line, guint offs, guint pgroups)
+{
+  const guint8 *y1, *y2, *u, *v;
+  guint ystride, uvoff, i;
+
+  ystride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  y1 = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  y1 += line * ystride + offs;
+  y2 = y1 + ystride;
+  uvoff = (line / pay->yinc) * GST_VIDEO_FRAME_COMP_STRIDE (frame, 1) +
+      offs / pay->xinc;
+  u = GST_VIDEO_FRAME_COMP_DATA (frame, 1);
+  u += uvoff;
+  v = GST_VIDEO_FRAME_COMP_DATA (frame, 2);
+  v += uvoff;
+
+  /* Y00-Y01-Y10-Y11-Cb00-Cr00 */
+  for (i = 0; i < pgroups; i++) {
+    outdata[6 * i + 0] = y1[2 * i + 0];
+    outdata[6 * i + 1] = y1[2 * i + 1];
+    outdata[6 * i + 2] = y2[2 * i + 0];
+    outdata[6 * i + 3] = y2[2 * i + 1];
+    outdata[6 * i + 4] = u[i];
+    outdata[6 * i + 5] = v[i];
+  }
+}
+
+static void
+gst_rtp_vraw_pay_pack_y41b (GstRtpVRawPay * pay, guint8 * outdata,
+    GstVideoFrame * frame, guint line, guint offs, guint pgroups)
+{
+  const guint8 *y, *u, *v;
+  guint uvoff, i;
+
+  y = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  y += line * GST_VIDEO_FRAME_COMP_STRIDE (frame, 0) + offs;
+  uvoff = (line / pay->yinc) * GST_VIDEO_FRAME_COMP_STRIDE (frame, 1) +
+      offs / pay->xinc;
+  u = GST_VIDEO_FRAME_COMP_DATA (frame, 1);
+  u += uvoff;
+  v = GST_VIDEO_FRAME_COMP_DATA (frame, 2);
+  v += uvoff;
+
+  /* Cb0-Y0-Y1-Cr0-Y2-Y3 */
+  for (i = 0; i < pgroups; i++) {
+    outdata[6 * i + 0] = u[i];
+    outdata[6 * i + 1] = y[4 * i + 0];
+    outdata[6 * i + 2] = y[4 * i + 1];
+    outdata[6 * i + 3] = v[i];
+    outdata[6 * i + 4] = y[4 * i + 2];
+    outdata[6 * i + 5] = y[4 * i + 3];
+  }
+}
+
 static gboolean
 gst_rtp_vraw_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
 {
@@ -113,6 +205,7 @@ gst_rtp_vraw_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
   gchar *wstr, *hstr;
   gint depth;
   GstVideoInfo info;
+  GstRtpVRawPackFunc pack;
 
   rtpvrawpay = GST_RTP_VRAW_PAY (payload);
 
@@ -139,6 +232,7 @@ gst_rtp_vraw_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
   /* these values are the only thing we can do */
   depthstr = "8";
   depth = 8;
+  pack = gst_rtp_vraw_pay_pack_copy;
 
   switch (GST_VIDEO_INFO_FORMAT (&info)) {
     case GST_VIDEO_FORMAT_RGBA:
@@ -160,6 +254,7 @@ gst_rtp_vraw_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
     case GST_VIDEO_FORMAT_AYUV:
       samplingstr = "YCbCr-4:4:4";
       pgroup = 3;
+      pack = gst_rtp_vraw_pay_pack_ayuv;
       break;
     case GST_VIDEO_FORMAT_UYVY:
       samplingstr = "YCbCr-4:2:2";
@@ -170,11 +265,13 @@ gst_rtp_vraw_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
       samplingstr = "YCbCr-4:1:1";
       pgroup = 6;
       xinc = 4;
+      pack = gst_rtp_vraw_pay_pack_y41b;
       break;
     case GST_VIDEO_FORMAT_I420:
       samplingstr = "YCbCr-4:2:0";
       pgroup = 6;
       xinc = yinc = 2;
+      pack = gst_rtp_vraw_pay_pack_i420;
       break;
     case GST_VIDEO_FORMAT_UYVP:
       samplingstr = "YCbCr-4:2:2";
@@ -196,6 +293,7 @@ gst_rtp_vraw_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
   rtpvrawpay->xinc = xinc;
   rtpvrawpay->yinc = yinc;
   rtpvrawpay->depth = depth;
+  rtpvrawpay->pack = pack;
 
   GST_DEBUG_OBJECT (payload, "width %d, height %d, sampling %s",
       GST_VIDEO_INFO_WIDTH (&info), GST_VIDEO_INFO_HEIGHT (&info), samplingstr);
@@ -240,8 +338,6 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   GstRtpVRawPay *rtpvrawpay;
   GstFlowReturn ret = GST_FLOW_OK;
   guint line, offset;
-  guint8 *p0, *yp, *up, *vp;
-  guint ystride, uvstride;
   guint pgroup;
   guint mtu;
   guint width, height;
@@ -249,6 +345,7 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   GstVideoFrame frame;
   gint interlaced;
   GstRTPBuffer rtp = { NULL, };
+  GstBufferList *list;
 
   rtpvrawpay = GST_RTP_VRAW_PAY (payload);
 
@@ -257,15 +354,6 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   GST_LOG_OBJECT (rtpvrawpay, "new frame of %" G_GSIZE_FORMAT " bytes",
       gst_buffer_get_size (buffer));
 
-  /* get pointer and strides of the planes */
-  p0 = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
-  yp = GST_VIDEO_FRAME_COMP_DATA (&frame, 0);
-  up = GST_VIDEO_FRAME_COMP_DATA (&frame, 1);
-  vp = GST_VIDEO_FRAME_COMP_DATA (&frame, 2);
-
-  ystride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0);
-  uvstride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 1);
-
   mtu = GST_RTP_BASE_PAYLOAD_MTU (payload);
 
   /* amount of bytes for one pixel */
@@ -280,6 +368,8 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
     line = field;
     offset = 0;
 
+    list = gst_buffer_list_new ();
+
     /* write all lines */
     while (line < height) {
       guint left;
@@ -335,6 +425,7 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
       if (!(left > (6 + pgroup))) {
         gst_rtp_buffer_unmap (&rtp);
         gst_buffer_unref (out);
+        gst_buffer_list_unref (list);
         goto too_small;
       }
 
@@ -412,82 +503,8 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
             "writing length %u, line %u, offset %u, cont %d", length, lin, offs,
             cont);
 
-        switch (GST_VIDEO_INFO_FORMAT (&rtpvrawpay->vinfo)) {
-          case GST_VIDEO_FORMAT_RGB:
-          case GST_VIDEO_FORMAT_RGBA:
-          case GST_VIDEO_FORMAT_BGR:
-          case GST_VIDEO_FORMAT_BGRA:
-          case GST_VIDEO_FORMAT_UYVY:
-          case GST_VIDEO_FORMAT_UYVP:
-            offs /= rtpvrawpay->xinc;
-            memcpy (outdata, p0 + (lin * ystride) + (offs * pgroup), length);
-            outdata += length;
-            break;
-          case GST_VIDEO_FORMAT_AYUV:
-          {
-            gint i;
-            guint8 *datap;
-
-            datap = p0 + (lin * ystride) + (offs * 4);
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = datap[2];
-              *outdata++ = datap[1];
-              *outdata++ = datap[3];
-              datap += 4;
-            }
-            break;
-          }
-          case GST_VIDEO_FORMAT_I420:
-          {
-            gint i;
-            guint uvoff;
-            guint8 *yd1p, *yd2p, *udp, *vdp;
-
-            yd1p = yp + (lin * ystride) + (offs);
-            yd2p = yd1p + ystride;
-            uvoff =
-                (lin / rtpvrawpay->yinc * uvstride) + (offs / rtpvrawpay->xinc);
-            udp = up + uvoff;
-            vdp = vp + uvoff;
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = *yd1p++;
-              *outdata++ = *yd1p++;
-              *outdata++ = *yd2p++;
-              *outdata++ = *yd2p++;
-              *outdata++ = *udp++;
-              *outdata++ = *vdp++;
-            }
-            break;
-          }
-          case GST_VIDEO_FORMAT_Y41B:
-          {
-            gint i;
-            guint uvoff;
-            guint8 *ydp, *udp, *vdp;
-
-            ydp = yp + (lin * ystride) + offs;
-            uvoff =
-                (lin / rtpvrawpay->yinc * uvstride) + (offs / rtpvrawpay->xinc);
-            udp = up + uvoff;
-            vdp = vp + uvoff;
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = *udp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *vdp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *ydp++;
-            }
-            break;
-          }
-          default:
-            gst_rtp_buffer_unmap (&rtp);
-            gst_buffer_unref (out);
-            goto unknown_sampling;
-        }
+        rtpvrawpay->pack (rtpvrawpay, outdata, &frame, lin, offs, pixels);
+        outdata += length;
 
         if (!cont)
           break;
@@ -503,10 +520,14 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
         gst_buffer_resize (out, 0, gst_buffer_get_size (out) - left);
       }
 
-      /* push buffer */
-      ret = gst_rtp_base_payload_push (payload, out);
+      /* and add to list */
+      gst_buffer_list_insert (list, -1, out);
     }
 
+    /* push the packets of the field at once */
+    ret = gst_rtp_base_payload_push_list (payload, list);
+    if (ret != GST_FLOW_OK)
+      break;
   }
 
   gst_video_frame_unmap (&frame);
@@ -515,14 +536,6 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   return ret;
 
   /* ERRORS */
-unknown_sampling:
-  {
-    GST_ELEMENT_ERROR (payload, STREAM, FORMAT,
-        (NULL), ("unimplemented sampling"));
-    gst_video_frame_unmap (&frame);
-    gst_buffer_unref (buffer);
-    return GST_FLOW_NOT_SUPPORTED;
-  }
 too_small:
   {
     GST_ELEMENT_ERROR (payload, RESOURCE, NO_SPACE_LEFT,
@@ -40,6 +40,9 @@ G_BEGIN_DECLS
 typedef struct _GstRtpVRawPay GstRtpVRawPay;
 typedef struct _GstRtpVRawPayClass GstRtpVRawPayClass;
 
+typedef void (*GstRtpVRawPackFunc) (GstRtpVRawPay * pay, guint8 * outdata,
+    GstVideoFrame * frame, guint line, guint offs, guint pgroups);
+
 struct _GstRtpVRawPay
 {
   GstRTPBasePayload payload;
@@ -53,6 +56,8 @@ struct _GstRtpVRawPay
 //   gint uvstride;
 //   gboolean interlaced;
   gint depth;
+
+  GstRtpVRawPackFunc pack;
 };
 
 struct _GstRtpVRawPayClass
@@ -103,7 +103,9 @@
 
 #include "gstrtpjitterbuffer.h"
 #include "rtpjitterbuffer.h"
+#include "rtptimerqueue.h"
 #include "rtpstats.h"
+#include "rtppacketmeta.h"
 
 #include <gst/glib-compat-private.h>
 
@@ -132,6 +134,7 @@ enum
 #define DEFAULT_RTX_DELAY_REORDER   3
 #define DEFAULT_RTX_RETRY_TIMEOUT   -1
 #define DEFAULT_RTX_RETRY_PERIOD    -1
+#define DEFAULT_RTX_THREAD          FALSE
 
 #define DEFAULT_AUTO_RTX_DELAY (20 * GST_MSECOND)
 #define DEFAULT_AUTO_RTX_TIMEOUT (40 * GST_MSECOND)
@@ -150,6 +153,7 @@ enum
   PROP_RTX_DELAY_REORDER,
   PROP_RTX_RETRY_TIMEOUT,
   PROP_RTX_RETRY_PERIOD,
+  PROP_RTX_THREAD,
   PROP_STATS,
   PROP_LAST
 };
@@ -177,6 +181,20 @@ enum
   }                                                       \
 } G_STMT_END
 
+#define JBUF_WAIT_RTX_TIMER(priv)   G_STMT_START {            \
+  GST_DEBUG ("waiting rtx timer");                            \
+  (priv)->waiting_rtx_timer = TRUE;                           \
+  g_cond_wait (&(priv)->jbuf_rtx_timer, &(priv)->jbuf_lock);  \
+  (priv)->waiting_rtx_timer = FALSE;                          \
+  GST_DEBUG ("waiting rtx timer done");                       \
+} G_STMT_END
+#define JBUF_SIGNAL_RTX_TIMER(priv) G_STMT_START {            \
+  if (G_UNLIKELY ((priv)->waiting_rtx_timer)) {               \
+    GST_DEBUG ("signal rtx timer");                           \
+    g_cond_signal (&(priv)->jbuf_rtx_timer);                  \
+  }                                                           \
+} G_STMT_END
+
 #define JBUF_WAIT_EVENT(priv,label) G_STMT_START {       \
   GST_DEBUG ("waiting event");                           \
   (priv)->waiting_event = TRUE;                          \
@@ -232,6 +250,10 @@ struct _GstRtpJitterBufferPrivate
 
   gboolean timer_running;
   GThread *timer_thread;
+  /* handles the expected timers when rtx-thread is set */
+  GThread *rtx_timer_thread;
+  gboolean waiting_rtx_timer;
+  GCond jbuf_rtx_timer;
 
   /* properties */
   guint latency_ms;
@@ -244,6 +266,7 @@ struct _GstRtpJitterBufferPrivate
   gint rtx_delay_reorder;
   gint rtx_retry_timeout;
   gint rtx_retry_period;
+  gboolean rtx_thread;
 
   /* the last seqnum we pushed out */
   guint32 last_popped_seqnum;
@@ -261,7 +284,7 @@ struct _GstRtpJitterBufferPrivate
   guint32 last_in_seqnum;
   guint32 next_in_seqnum;
 
-  GArray *timers;
+  RTPTimerQueue *timers;
 
   /* start and stop ranges */
   GstClockTime npt_start;
@@ -290,6 +313,9 @@ struct _GstRtpJitterBufferPrivate
   GstClockID clock_id;
   GstClockTime timer_timeout;
   guint16 timer_seqnum;
+  GstClockID rtx_clock_id;
+  GstClockTime rtx_timer_timeout;
+  guint16 rtx_timer_seqnum;
   /* the latency of the upstream peer, we have to take this into account when
    * synchronizing the buffers. */
   GstClockTime peer_latency;
@@ -309,30 +335,16 @@ struct _GstRtpJitterBufferPrivate
   GstClockTime last_dts;
   guint64 last_rtptime;
   GstClockTime avg_jitter;
-};
 
-typedef enum
-{
-  TIMER_TYPE_EXPECTED,
-  TIMER_TYPE_LOST,
-  TIMER_TYPE_DEADLINE,
-  TIMER_TYPE_EOS
-} TimerType;
+  /* free-list of items, protected with the JBUF_LOCK */
+  RTPJitterBufferItem *free_items;
+  guint num_free_items;
+  guint64 num_item_allocs;
+};
 
-typedef struct
-{
-  guint idx;
-  guint16 seqnum;
-  guint num;
-  TimerType type;
-  GstClockTime timeout;
-  GstClockTime duration;
-  GstClockTime rtx_base;
-  GstClockTime rtx_delay;
-  GstClockTime rtx_retry;
-  GstClockTime rtx_last;
-  guint num_rtx_retry;
-} TimerData;
+/* expected timers are handled in their own thread when rtx-thread is set */
+#define IS_RTX_TIMER(priv,timer) \
+  ((priv)->rtx_timer_thread != NULL && (timer)->type == RTP_TIMER_EXPECTED)
 
 #define GST_RTP_JITTER_BUFFER_GET_PRIVATE(o) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((o), GST_TYPE_RTP_JITTER_BUFFER, \
@@ -424,9 +436,11 @@ gst_rtp_jitter_buffer_set_active (GstRtpJitterBuffer * jitterbuffer,
 static void do_handle_sync (GstRtpJitterBuffer * jitterbuffer);
 
 static void unschedule_current_timer (GstRtpJitterBuffer * jitterbuffer);
+static void unschedule_rtx_timer (GstRtpJitterBuffer * jitterbuffer);
 static void remove_all_timers (GstRtpJitterBuffer * jitterbuffer);
 
 static void wait_next_timeout (GstRtpJitterBuffer * jitterbuffer);
+static void wait_next_rtx_timeout (GstRtpJitterBuffer * jitterbuffer);
 
 static GstStructure *gst_rtp_jitter_buffer_create_stats (GstRtpJitterBuffer *
     jitterbuffer);
@@ -584,6 +598,22 @@ gst_rtp_jitter_buffer_class_init (GstRtpJitterBufferClass * klass)
           "Try to get a retransmission for this many ms "
           "(-1 automatic)", -1, G_MAXINT, DEFAULT_RTX_RETRY_PERIOD,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstRtpJitterBuffer:rtx-thread:
+   *
+   * Detect missing packets and send the retransmission events from a separate
+   * thread, so that the timers for lost packets and the output of the
+   * jitterbuffer cannot delay the retransmission requests. All requests that
+   * are due at the same time are sent together.
+   *
+   * The property is used when going from READY to PAUSED.
+   *
+   * Since: 1.4
+   */
+  g_object_class_install_property (gobject_class, PROP_RTX_THREAD,
+      g_param_spec_boolean ("rtx-thread", "RTX Thread",
+          "Send retransmission events from a separate thread",
+          DEFAULT_RTX_THREAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   /**
    * GstRtpJitterBuffer:stats:
    *
@@ -594,6 +624,11 @@ gst_rtp_jitter_buffer_class_init (GstRtpJitterBufferClass * klass)
    *  "rtx-success-count" G_TYPE_UINT64 The number of successful retransmissions
    *  "rtx-per-packet"    G_TYPE_DOUBLE Average number of RTX per packet
    *  "rtx-rtt"           G_TYPE_UINT64 Average round trip time per RTX
+   *  "item-allocs"       G_TYPE_UINT64 The number of allocated queue items
+   *  "timer-allocs"      G_TYPE_UINT64 The number of allocated timers
+   *
+   * Items and timers are reused, the allocation counters stop increasing once
+   * the jitterbuffer reached its steady state.
    *
    * Since: 1.4
    */
@@ -715,14 +750,16 @@ gst_rtp_jitter_buffer_init (GstRtpJitterBuffer * jitterbuffer)
   priv->rtx_delay_reorder = DEFAULT_RTX_DELAY_REORDER;
   priv->rtx_retry_timeout = DEFAULT_RTX_RETRY_TIMEOUT;
   priv->rtx_retry_period = DEFAULT_RTX_RETRY_PERIOD;
+  priv->rtx_thread = DEFAULT_RTX_THREAD;
 
   priv->last_dts = -1;
   priv->last_rtptime = -1;
   priv->avg_jitter = 0;
-  priv->timers = g_array_new (FALSE, TRUE, sizeof (TimerData));
+  priv->timers = rtp_timer_queue_new ();
   priv->jbuf = rtp_jitter_buffer_new ();
   g_mutex_init (&priv->jbuf_lock);
   g_cond_init (&priv->jbuf_timer);
+  g_cond_init (&priv->jbuf_rtx_timer);
   g_cond_init (&priv->jbuf_event);
   g_cond_init (&priv->jbuf_query);
 
@@ -767,13 +804,25 @@ gst_rtp_jitter_buffer_init (GstRtpJitterBuffer * jitterbuffer)
 #define ITEM_TYPE_EVENT         2
 #define ITEM_TYPE_QUERY         3
 
+/* max number of unused items we keep around for reuse */
+#define MAX_FREE_ITEMS          128
+
+/* must be called with the JBUF_LOCK */
 static RTPJitterBufferItem *
-alloc_item (gpointer data, guint type, GstClockTime dts, GstClockTime pts,
-    guint seqnum, guint count, guint rtptime)
+alloc_item (GstRtpJitterBuffer * jitterbuffer, gpointer data, guint type,
+    GstClockTime dts, GstClockTime pts, guint seqnum, guint count,
+    guint rtptime)
 {
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
   RTPJitterBufferItem *item;
 
-  item = g_slice_new (RTPJitterBufferItem);
+  if ((item = priv->free_items)) {
+    priv->free_items = (RTPJitterBufferItem *) item->next;
+    priv->num_free_items--;
+  } else {
+    item = g_slice_new (RTPJitterBufferItem);
+    priv->num_item_allocs++;
+  }
   item->data = data;
   item->next = NULL;
   item->prev = NULL;
@@ -787,12 +836,35 @@ alloc_item (gpointer data, guint type, GstClockTime dts, GstClockTime pts,
   return item;
 }
 
+/* must be called with the JBUF_LOCK */
 static void
-free_item (RTPJitterBufferItem * item)
+free_item (RTPJitterBufferItem * item, GstRtpJitterBuffer * jitterbuffer)
 {
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+
   if (item->data && item->type != ITEM_TYPE_QUERY)
     gst_mini_object_unref (item->data);
-  g_slice_free (RTPJitterBufferItem, item);
+
+  if (priv->num_free_items < MAX_FREE_ITEMS) {
+    item->next = (GList *) priv->free_items;
+    priv->free_items = item;
+    priv->num_free_items++;
+  } else {
+    g_slice_free (RTPJitterBufferItem, item);
+  }
+}
+
+static void
+free_all_items (GstRtpJitterBuffer * jitterbuffer)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+  RTPJitterBufferItem *item;
+
+  while ((item = priv->free_items)) {
+    priv->free_items = (RTPJitterBufferItem *) item->next;
+    g_slice_free (RTPJitterBufferItem, item);
+  }
+  priv->num_free_items = 0;
 }
 
 static void
@@ -804,14 +876,16 @@ gst_rtp_jitter_buffer_finalize (GObject * object)
   jitterbuffer = GST_RTP_JITTER_BUFFER (object);
   priv = jitterbuffer->priv;
 
-  g_array_free (priv->timers, TRUE);
+  rtp_timer_queue_free (priv->timers);
   g_mutex_clear (&priv->jbuf_lock);
   g_cond_clear (&priv->jbuf_timer);
+  g_cond_clear (&priv->jbuf_rtx_timer);
   g_cond_clear (&priv->jbuf_event);
   g_cond_clear (&priv->jbuf_query);
 
-  rtp_jitter_buffer_flush (priv->jbuf, (GFunc) free_item, NULL);
+  rtp_jitter_buffer_flush (priv->jbuf, (GFunc) free_item, jitterbuffer);
   g_object_unref (priv->jbuf);
+  free_all_items (jitterbuffer);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -1184,7 +1258,7 @@ gst_rtp_jitter_buffer_flush_stop (GstRtpJitterBuffer * jitterbuffer)
   priv->last_dts = -1;
   priv->last_rtptime = -1;
   GST_DEBUG_OBJECT (jitterbuffer, "flush and reset jitterbuffer");
-  rtp_jitter_buffer_flush (priv->jbuf, (GFunc) free_item, NULL);
+  rtp_jitter_buffer_flush (priv->jbuf, (GFunc) free_item, jitterbuffer);
   rtp_jitter_buffer_disable_buffering (priv->jbuf, FALSE);
   rtp_jitter_buffer_reset_skew (priv->jbuf);
   remove_all_timers (jitterbuffer);
@@ -1253,6 +1327,9 @@ gst_rtp_jitter_buffer_change_state (GstElement * element,
       priv->timer_running = TRUE;
       priv->timer_thread =
           g_thread_new ("timer", (GThreadFunc) wait_next_timeout, jitterbuffer);
+      if (priv->rtx_thread)
+        priv->rtx_timer_thread = g_thread_new ("rtx-timer",
+            (GThreadFunc) wait_next_rtx_timeout, jitterbuffer);
       JBUF_UNLOCK (priv);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
@@ -1261,6 +1338,7 @@ gst_rtp_jitter_buffer_change_state (GstElement * element,
       priv->blocked = FALSE;
       JBUF_SIGNAL_EVENT (priv);
       JBUF_SIGNAL_TIMER (priv);
+      JBUF_SIGNAL_RTX_TIMER (priv);
       JBUF_UNLOCK (priv);
       break;
     default:
@@ -1281,6 +1359,7 @@ gst_rtp_jitter_buffer_change_state (GstElement * element,
       /* block to stop streaming when PAUSED */
       priv->blocked = TRUE;
       unschedule_current_timer (jitterbuffer);
+      unschedule_rtx_timer (jitterbuffer);
       JBUF_UNLOCK (priv);
       if (ret != GST_STATE_CHANGE_FAILURE)
         ret = GST_STATE_CHANGE_NO_PREROLL;
@@ -1290,11 +1369,17 @@ gst_rtp_jitter_buffer_change_state (GstElement * element,
       gst_buffer_replace (&priv->last_sr, NULL);
       priv->timer_running = FALSE;
       unschedule_current_timer (jitterbuffer);
+      unschedule_rtx_timer (jitterbuffer);
       JBUF_SIGNAL_TIMER (priv);
+      JBUF_SIGNAL_RTX_TIMER (priv);
       JBUF_SIGNAL_QUERY (priv, FALSE);
       JBUF_UNLOCK (priv);
       g_thread_join (priv->timer_thread);
       priv->timer_thread = NULL;
+      if (priv->rtx_timer_thread) {
+        g_thread_join (priv->rtx_timer_thread);
+        priv->rtx_timer_thread = NULL;
+      }
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
@@ -1389,7 +1474,7 @@ queue_event (GstRtpJitterBuffer * jitterbuffer, GstEvent * event)
 
 
   GST_DEBUG_OBJECT (jitterbuffer, "adding event");
-  item = alloc_item (event, ITEM_TYPE_EVENT, -1, -1, -1, 0, -1);
+  item = alloc_item (jitterbuffer, event, ITEM_TYPE_EVENT, -1, -1, -1, 0, -1);
   rtp_jitter_buffer_insert (priv->jbuf, item, &head, NULL);
   if (head)
     JBUF_SIGNAL_EVENT (priv);
@@ -1609,22 +1694,13 @@ apply_offset (GstRtpJitterBuffer * jitterbuffer, GstClockTime timestamp)
   return timestamp;
 }
 
-static TimerData *
-find_timer (GstRtpJitterBuffer * jitterbuffer, TimerType type, guint16 seqnum)
+static RTPTimer *
+find_timer (GstRtpJitterBuffer * jitterbuffer, RTPTimerType type,
+    guint16 seqnum)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
-  TimerData *timer = NULL;
-  gint i, len;
 
-  len = priv->timers->len;
-  for (i = 0; i < len; i++) {
-    TimerData *test = &g_array_index (priv->timers, TimerData, i);
-    if (test->seqnum == seqnum && test->type == type) {
-      timer = test;
-      break;
-    }
-  }
-  return timer;
+  return rtp_timer_queue_find (priv->timers, type, seqnum);
 }
 
 static void
@@ -1639,8 +1715,20 @@ unschedule_current_timer (GstRtpJitterBuffer * jitterbuffer)
   }
 }
 
+static void
+unschedule_rtx_timer (GstRtpJitterBuffer * jitterbuffer)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+
+  if (priv->rtx_clock_id) {
+    GST_DEBUG_OBJECT (jitterbuffer, "unschedule current rtx timer");
+    gst_clock_id_unschedule (priv->rtx_clock_id);
+    priv->rtx_clock_id = NULL;
+  }
+}
+
 static GstClockTime
-get_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer)
+get_timeout (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
   GstClockTime test_timeout;
@@ -1648,7 +1736,7 @@ get_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer)
   if ((test_timeout = timer->timeout) == -1)
     return -1;
 
-  if (timer->type != TIMER_TYPE_EXPECTED) {
+  if (timer->type != RTP_TIMER_EXPECTED) {
     /* add our latency and offset to get output times. */
     test_timeout = apply_offset (jitterbuffer, test_timeout);
     test_timeout += priv->latency_ns;
@@ -1657,11 +1745,18 @@ get_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer)
 }
 
 static void
-recalculate_timer (GstRtpJitterBuffer * jitterbuffer, TimerData * timer)
+recalculate_timer (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
 
-  if (priv->clock_id) {
+  if (IS_RTX_TIMER (priv, timer)) {
+    if (priv->rtx_clock_id) {
+      GstClockTime timeout = get_timeout (jitterbuffer, timer);
+
+      if (timeout == -1 || timeout < priv->rtx_timer_timeout)
+        unschedule_rtx_timer (jitterbuffer);
+    }
+  } else if (priv->clock_id) {
     GstClockTime timeout = get_timeout (jitterbuffer, timer);
 
     GST_DEBUG ("%" GST_TIME_FORMAT " <> %" GST_TIME_FORMAT,
@@ -1672,43 +1767,43 @@ recalculate_timer (GstRtpJitterBuffer * jitterbuffer, TimerData * timer)
   }
 }
 
-static TimerData *
-add_timer (GstRtpJitterBuffer * jitterbuffer, TimerType type,
+static RTPTimer *
+add_timer (GstRtpJitterBuffer * jitterbuffer, RTPTimerType type,
     guint16 seqnum, guint num, GstClockTime timeout, GstClockTime delay,
     GstClockTime duration)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
-  TimerData *timer;
-  gint len;
+  RTPTimer *timer;
 
   GST_DEBUG_OBJECT (jitterbuffer,
       "add timer %d for seqnum %d to %" GST_TIME_FORMAT ", delay %"
       GST_TIME_FORMAT, type, seqnum, GST_TIME_ARGS (timeout),
       GST_TIME_ARGS (delay));
 
-  len = priv->timers->len;
-  g_array_set_size (priv->timers, len + 1);
-  timer = &g_array_index (priv->timers, TimerData, len);
-  timer->idx = len;
+  timer = rtp_timer_queue_alloc (priv->timers);
   timer->type = type;
   timer->seqnum = seqnum;
   timer->num = num;
   timer->timeout = timeout + delay;
   timer->duration = duration;
-  if (type == TIMER_TYPE_EXPECTED) {
+  if (type == RTP_TIMER_EXPECTED) {
     timer->rtx_base = timeout;
     timer->rtx_delay = delay;
     timer->rtx_retry = 0;
   }
   timer->num_rtx_retry = 0;
+  rtp_timer_queue_insert (priv->timers, timer);
   recalculate_timer (jitterbuffer, timer);
-  JBUF_SIGNAL_TIMER (priv);
+  if (IS_RTX_TIMER (priv, timer))
+    JBUF_SIGNAL_RTX_TIMER (priv);
+  else
+    JBUF_SIGNAL_TIMER (priv);
 
   return timer;
 }
 
 static void
-reschedule_timer (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
+reschedule_timer (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer,
     guint16 seqnum, GstClockTime timeout, GstClockTime delay, gboolean reset)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
@@ -1736,8 +1831,14 @@ reschedule_timer (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
   }
   if (seqchange)
     timer->num_rtx_retry = 0;
+  rtp_timer_queue_update (priv->timers, timer);
 
-  if (priv->clock_id) {
+  if (IS_RTX_TIMER (priv, timer)) {
+    if (seqchange && priv->rtx_clock_id && priv->rtx_timer_seqnum == oldseq)
+      unschedule_rtx_timer (jitterbuffer);
+    else if (timechange)
+      recalculate_timer (jitterbuffer, timer);
+  } else if (priv->clock_id) {
     /* we changed the seqnum and there is a timer currently waiting with this
      * seqnum, unschedule it */
     if (seqchange && priv->timer_seqnum == oldseq)
@@ -1749,11 +1850,11 @@ reschedule_timer (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
   }
 }
 
-static TimerData *
-set_timer (GstRtpJitterBuffer * jitterbuffer, TimerType type,
+static RTPTimer *
+set_timer (GstRtpJitterBuffer * jitterbuffer, RTPTimerType type,
     guint16 seqnum, GstClockTime timeout)
 {
-  TimerData *timer;
+  RTPTimer *timer;
 
   /* find the seqnum timer */
   timer = find_timer (jitterbuffer, type, seqnum);
@@ -1766,18 +1867,19 @@ set_timer (GstRtpJitterBuffer * jitterbuffer, TimerType type,
 }
 
 static void
-remove_timer (GstRtpJitterBuffer * jitterbuffer, TimerData * timer)
+remove_timer (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
-  guint idx;
 
-  if (priv->clock_id && priv->timer_seqnum == timer->seqnum)
+  if (IS_RTX_TIMER (priv, timer)) {
+    if (priv->rtx_clock_id && priv->rtx_timer_seqnum == timer->seqnum)
+      unschedule_rtx_timer (jitterbuffer);
+  } else if (priv->clock_id && priv->timer_seqnum == timer->seqnum)
     unschedule_current_timer (jitterbuffer);
 
-  idx = timer->idx;
-  GST_DEBUG_OBJECT (jitterbuffer, "removed index %d", idx);
-  g_array_remove_index_fast (priv->timers, idx);
-  timer->idx = idx;
+  GST_DEBUG_OBJECT (jitterbuffer, "removed timer %d for seqnum %d",
+      timer->type, timer->seqnum);
+  rtp_timer_queue_remove (priv->timers, timer);
 }
 
 static void
@@ -1785,8 +1887,9 @@ remove_all_timers (GstRtpJitterBuffer * jitterbuffer)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
   GST_DEBUG_OBJECT (jitterbuffer, "removed all timers");
-  g_array_set_size (priv->timers, 0);
+  rtp_timer_queue_clear (priv->timers);
   unschedule_current_timer (jitterbuffer);
+  unschedule_rtx_timer (jitterbuffer);
 }
 
 /* we just received a packet with seqnum and dts.
@@ -1804,41 +1907,35 @@ update_timers (GstRtpJitterBuffer * jitterbuffer, guint16 seqnum,
     GstClockTime dts, gboolean do_next_seqnum)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
-  TimerData *timer = NULL;
-  gint i, len;
-
-  /* go through all timers and unschedule the ones with a large gap, also find
-   * the timer for the seqnum */
-  len = priv->timers->len;
-  for (i = 0; i < len; i++) {
-    TimerData *test = &g_array_index (priv->timers, TimerData, i);
+  RTPTimer *timer, *test;
+
+  /* unschedule the expected timers with a large gap, starting from the oldest
+   * seqnum. The timers that are rescheduled leave the reorder queue. */
+  while ((test = rtp_timer_queue_peek_reorder (priv->timers))) {
     gint gap;
 
     gap = gst_rtp_buffer_compare_seqnum (test->seqnum, seqnum);
 
-    GST_DEBUG_OBJECT (jitterbuffer, "%d, %d, #%d<->#%d gap %d", i,
-        test->type, test->seqnum, seqnum, gap);
+    GST_DEBUG_OBJECT (jitterbuffer, "%d, #%d<->#%d gap %d", test->type,
+        test->seqnum, seqnum, gap);
 
-    if (gap == 0) {
-      GST_DEBUG ("found timer for current seqnum");
-      /* the timer for the current seqnum */
-      timer = test;
-      /* when no retransmission, we can stop now, we only need to find the
-       * timer for the current seqnum */
-      if (!priv->do_retransmission)
-        break;
-    } else if (gap > priv->rtx_delay_reorder) {
-      /* max gap, we exceeded the max reorder distance and we don't expect the
-       * missing packet to be this reordered */
-      if (test->num_rtx_retry == 0 && test->type == TIMER_TYPE_EXPECTED)
-        reschedule_timer (jitterbuffer, test, test->seqnum, -1, 0, FALSE);
-    }
+    /* all other timers are for newer seqnums and have a smaller gap */
+    if (gap == 0 || gap <= priv->rtx_delay_reorder)
+      break;
+
+    /* max gap, we exceeded the max reorder distance and we don't expect the
+     * missing packet to be this reordered */
+    reschedule_timer (jitterbuffer, test, test->seqnum, -1, 0, FALSE);
   }
 
+  /* the timer for the current seqnum */
+  if ((timer = rtp_timer_queue_find_seqnum (priv->timers, seqnum)))
+    GST_DEBUG ("found timer for current seqnum");
+
   do_next_seqnum = do_next_seqnum && priv->packet_spacing > 0
       && priv->do_retransmission;
 
-  if (timer && timer->type != TIMER_TYPE_DEADLINE) {
+  if (timer && timer->type != RTP_TIMER_DEADLINE) {
     if (timer->num_rtx_retry > 0) {
       GstClockTime rtx_last, delay;
 
@@ -1901,9 +1998,9 @@ update_timers (GstRtpJitterBuffer * jitterbuffer, guint16 seqnum,
       reschedule_timer (jitterbuffer, timer, priv->next_in_seqnum, expected,
           delay, TRUE);
     else
-      add_timer (jitterbuffer, TIMER_TYPE_EXPECTED, priv->next_in_seqnum, 0,
+      add_timer (jitterbuffer, RTP_TIMER_EXPECTED, priv->next_in_seqnum, 0,
           expected, delay, priv->packet_spacing);
-  } else if (timer && timer->type != TIMER_TYPE_DEADLINE) {
+  } else if (timer && timer->type != RTP_TIMER_DEADLINE) {
     /* if we had a timer, remove it, we don't know when to expect the next
      * packet. */
     remove_timer (jitterbuffer, timer);
@@ -1937,7 +2034,7 @@ calculate_expected (GstRtpJitterBuffer * jitterbuffer, guint32 expected,
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
   GstClockTime total_duration, duration, expected_dts;
-  TimerType type;
+  RTPTimerType type;
 
   GST_DEBUG_OBJECT (jitterbuffer,
       "dts %" GST_TIME_FORMAT ", last %" GST_TIME_FORMAT,
@@ -1979,7 +2076,7 @@ calculate_expected (GstRtpJitterBuffer * jitterbuffer, guint32 expected,
 
     /* this timer will fire immediately and the lost event will be pushed from
      * the timer thread */
-    add_timer (jitterbuffer, TIMER_TYPE_LOST, expected, lost_packets,
+    add_timer (jitterbuffer, RTP_TIMER_LOST, expected, lost_packets,
         priv->last_in_dts + duration, 0, gap_time);
 
     expected += lost_packets;
@@ -1989,9 +2086,9 @@ calculate_expected (GstRtpJitterBuffer * jitterbuffer, guint32 expected,
   expected_dts = priv->last_in_dts + duration;
 
   if (priv->do_retransmission) {
-    TimerData *timer;
+    RTPTimer *timer;
 
-    type = TIMER_TYPE_EXPECTED;
+    type = RTP_TIMER_EXPECTED;
     /* if we had a timer for the first missing packet, update it. */
     if ((timer = find_timer (jitterbuffer, type, expected))) {
       GstClockTime timeout = timer->timeout;
@@ -2006,7 +2103,7 @@ calculate_expected (GstRtpJitterBuffer * jitterbuffer, guint32 expected,
       expected_dts += duration;
     }
   } else {
-    type = TIMER_TYPE_LOST;
+    type = RTP_TIMER_LOST;
   }
 
   while (gst_rtp_buffer_compare_seqnum (expected, seqnum) > 0) {
@@ -2085,7 +2182,7 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
   gboolean head;
   gint percent = -1;
   guint8 pt;
-  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  RTPPacketMeta *meta;
   gboolean do_next_seqnum = FALSE;
   RTPJitterBufferItem *item;
   GstMessage *msg = NULL;
@@ -2094,13 +2191,22 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
 
   priv = jitterbuffer->priv;
 
-  if (G_UNLIKELY (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)))
-    goto invalid_buffer;
+  if ((meta = rtp_packet_meta_get (buffer))) {
+    /* the session already validated and parsed the packet */
+    pt = meta->pt;
+    seqnum = meta->seqnum;
+    rtptime = meta->rtptime;
+  } else {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
 
-  pt = gst_rtp_buffer_get_payload_type (&rtp);
-  seqnum = gst_rtp_buffer_get_seq (&rtp);
-  rtptime = gst_rtp_buffer_get_timestamp (&rtp);
-  gst_rtp_buffer_unmap (&rtp);
+    if (G_UNLIKELY (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)))
+      goto invalid_buffer;
+
+    pt = gst_rtp_buffer_get_payload_type (&rtp);
+    seqnum = gst_rtp_buffer_get_seq (&rtp);
+    rtptime = gst_rtp_buffer_get_timestamp (&rtp);
+    gst_rtp_buffer_unmap (&rtp);
+  }
 
   /* make sure we have PTS and DTS set */
   pts = GST_BUFFER_PTS (buffer);
@@ -2203,7 +2309,7 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
       }
       if (G_UNLIKELY (reset)) {
         GST_DEBUG_OBJECT (jitterbuffer, "flush and reset jitterbuffer");
-        rtp_jitter_buffer_flush (priv->jbuf, (GFunc) free_item, NULL);
+        rtp_jitter_buffer_flush (priv->jbuf, (GFunc) free_item, jitterbuffer);
         rtp_jitter_buffer_reset_skew (priv->jbuf);
         remove_all_timers (jitterbuffer);
         priv->last_popped_seqnum = -1;
@@ -2220,7 +2326,7 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
     /* we don't know what the next_in_seqnum should be, wait for the last
      * possible moment to push this buffer, maybe we get an earlier seqnum
      * while we wait */
-    set_timer (jitterbuffer, TIMER_TYPE_DEADLINE, seqnum, dts);
+    set_timer (jitterbuffer, RTP_TIMER_DEADLINE, seqnum, dts);
     do_next_seqnum = TRUE;
     /* take rtptime and dts to calculate packet spacing */
     priv->ips_rtptime = rtptime;
@@ -2262,7 +2368,7 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
         GST_DEBUG_OBJECT (jitterbuffer, "Queue full, dropping old packet %p",
             old_item);
         priv->next_seqnum = (old_item->seqnum + 1) & 0xffff;
-        free_item (old_item);
+        free_item (old_item, jitterbuffer);
       }
       /* we might have removed some head buffers, signal the pushing thread to
        * see if it can push now */
@@ -2270,7 +2376,8 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
     }
   }
 
-  item = alloc_item (buffer, ITEM_TYPE_BUFFER, dts, pts, seqnum, 1, rtptime);
+  item = alloc_item (jitterbuffer, buffer, ITEM_TYPE_BUFFER, dts, pts, seqnum,
+      1, rtptime);
 
   /* now insert the packet into the queue in sorted order. This function returns
    * FALSE if a packet with the same seqnum was already in the queue, meaning we
@@ -2356,7 +2463,7 @@ duplicate:
     GST_WARNING_OBJECT (jitterbuffer, "Duplicate packet #%d detected, dropping",
         seqnum);
     priv->num_duplicates++;
-    free_item (item);
+    free_item (item, jitterbuffer);
     goto finished;
   }
 }
@@ -2446,7 +2553,7 @@ update_estimated_eos (GstRtpJitterBuffer * jitterbuffer,
       GST_TIME_FORMAT, GST_TIME_ARGS (elapsed), GST_TIME_ARGS (estimated));
 
   if (estimated != -1 && priv->estimated_eos != estimated) {
-    set_timer (jitterbuffer, TIMER_TYPE_EOS, -1, estimated);
+    set_timer (jitterbuffer, RTP_TIMER_EOS, -1, estimated);
     priv->estimated_eos = estimated;
   }
 }
@@ -2458,6 +2565,7 @@ pop_and_push_next (GstRtpJitterBuffer * jitterbuffer, guint seqnum)
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
   GstFlowReturn result = GST_FLOW_OK;
   RTPJitterBufferItem *item;
+  RTPPacketMeta *meta;
   GstBuffer *outbuf = NULL;
   GstEvent *outevent = NULL;
   GstQuery *outquery = NULL;
@@ -2477,6 +2585,11 @@ pop_and_push_next (GstRtpJitterBuffer * jitterbuffer, guint seqnum)
       /* we need to make writable to change the flags and timestamps */
       outbuf = gst_buffer_make_writable (item->data);
 
+      /* the parsed header is only for the elements of rtpbin, elements
+       * after us could change the packet */
+      if ((meta = rtp_packet_meta_get (outbuf)))
+        gst_buffer_remove_meta (outbuf, (GstMeta *) meta);
+
       if (G_UNLIKELY (priv->discont)) {
         /* set DISCONT flag when we missed a packet. We pushed the buffer writable
          * into the jitterbuffer so we can modify now. */
@@ -2523,10 +2636,10 @@ pop_and_push_next (GstRtpJitterBuffer * jitterbuffer, guint seqnum)
     priv->next_seqnum = (seqnum + item->count) & 0xffff;
   }
   msg = check_buffering_percent (jitterbuffer, percent);
-  JBUF_UNLOCK (priv);
 
   item->data = NULL;
-  free_item (item);
+  free_item (item, jitterbuffer);
+  JBUF_UNLOCK (priv);
 
   if (msg)
     gst_element_post_message (GST_ELEMENT_CAST (jitterbuffer), msg);
@@ -2638,7 +2751,7 @@ again:
       GST_DEBUG_OBJECT (jitterbuffer, "Old packet #%d, next #%d dropping",
           seqnum, next_seqnum);
       item = rtp_jitter_buffer_pop (priv->jbuf, NULL);
-      free_item (item);
+      free_item (item, jitterbuffer);
       goto again;
     } else {
       /* the chain function has scheduled timers to request retransmission or
@@ -2663,8 +2776,10 @@ wait:
 }
 
 /* the timeout for when we expected a packet expired */
-static gboolean
-do_expected_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
+/* create the retransmission event for the expected @timer and schedule the
+ * next request, must be called with the lock */
+static GstEvent *
+create_rtx_request (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer,
     GstClockTime now)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
@@ -2737,13 +2852,28 @@ do_expected_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
     GST_DEBUG_OBJECT (jitterbuffer, "reschedule as LOST timer");
     /* too many retransmission request, we now convert the timer
      * to a lost timer, leave the num_rtx_retry as it is for stats */
-    timer->type = TIMER_TYPE_LOST;
+    timer->type = RTP_TIMER_LOST;
     timer->rtx_delay = 0;
     timer->rtx_retry = 0;
+    /* the lost timer is handled by the timer thread */
+    JBUF_SIGNAL_TIMER (priv);
   }
+  rtp_timer_queue_update (priv->timers, timer);
   reschedule_timer (jitterbuffer, timer, timer->seqnum,
       timer->rtx_base + timer->rtx_retry, timer->rtx_delay, FALSE);
 
+  return event;
+}
+
+static gboolean
+do_expected_timeout (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer,
+    GstClockTime now)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+  GstEvent *event;
+
+  event = create_rtx_request (jitterbuffer, timer, now);
+
   JBUF_UNLOCK (priv);
   gst_pad_push_event (priv->sinkpad, event);
   JBUF_LOCK (priv);
@@ -2753,7 +2883,7 @@ do_expected_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
 
 /* a packet is lost */
 static gboolean
-do_lost_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
+do_lost_timeout (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer,
     GstClockTime now)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
@@ -2797,7 +2927,8 @@ do_lost_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
           "late", G_TYPE_BOOLEAN, late,
           "retry", G_TYPE_UINT, num_rtx_retry, NULL));
 
-  item = alloc_item (event, ITEM_TYPE_LOST, -1, -1, seqnum, lost_packets, -1);
+  item = alloc_item (jitterbuffer, event, ITEM_TYPE_LOST, -1, -1, seqnum,
+      lost_packets, -1);
   rtp_jitter_buffer_insert (priv->jbuf, item, &head, NULL);
 
   /* remove timer now */
@@ -2809,7 +2940,7 @@ do_lost_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
 }
 
 static gboolean
-do_eos_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
+do_eos_timeout (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer,
     GstClockTime now)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
@@ -2826,7 +2957,7 @@ do_eos_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
 }
 
 static gboolean
-do_deadline_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
+do_deadline_timeout (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer,
     GstClockTime now)
 {
   GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
@@ -2844,22 +2975,22 @@ do_deadline_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
 }
 
 static gboolean
-do_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
+do_timeout (GstRtpJitterBuffer * jitterbuffer, RTPTimer * timer,
     GstClockTime now)
 {
   gboolean removed = FALSE;
 
   switch (timer->type) {
-    case TIMER_TYPE_EXPECTED:
+    case RTP_TIMER_EXPECTED:
       removed = do_expected_timeout (jitterbuffer, timer, now);
       break;
-    case TIMER_TYPE_LOST:
+    case RTP_TIMER_LOST:
       removed = do_lost_timeout (jitterbuffer, timer, now);
       break;
-    case TIMER_TYPE_DEADLINE:
+    case RTP_TIMER_DEADLINE:
       removed = do_deadline_timeout (jitterbuffer, timer, now);
       break;
-    case TIMER_TYPE_EOS:
+    case RTP_TIMER_EOS:
       removed = do_eos_timeout (jitterbuffer, timer, now);
       break;
   }
@@ -2868,7 +2999,7 @@ do_timeout (GstRtpJitterBuffer * jitterbuffer, TimerData * timer,
 
 /* called when we need to wait for the next timeout.
  *
- * We loop over the array of recorded timeouts and wait for the earliest one.
+ * We take the earliest of the recorded timeouts and wait for it.
  * When it timed out, do the logic associated with the timer.
  *
  * If there are no timers, we wait on a gcond until something new happens.
@@ -2881,19 +3012,31 @@ wait_next_timeout (GstRtpJitterBuffer * jitterbuffer)
 
   JBUF_LOCK (priv);
   while (priv->timer_running) {
-    TimerData *timer = NULL;
+    RTPTimer *timer = NULL, *first[2];
     GstClockTime timer_timeout = -1;
-    gint i, len;
+    gint i;
 
     GST_DEBUG_OBJECT (jitterbuffer, "now %" GST_TIME_FORMAT,
         GST_TIME_ARGS (now));
 
-    len = priv->timers->len;
-    for (i = 0; i < len; i++) {
-      TimerData *test = &g_array_index (priv->timers, TimerData, i);
-      GstClockTime test_timeout = get_timeout (jitterbuffer, test);
+    /* the timers are sorted on their timeout, we only need to compare the
+     * first expected timer with the first output timer. The expected timers
+     * have their own thread when rtx-thread is set. */
+    if (priv->rtx_timer_thread)
+      first[0] = NULL;
+    else
+      first[0] = rtp_timer_queue_peek_expected (priv->timers);
+    first[1] = rtp_timer_queue_peek_output (priv->timers);
+    for (i = 0; i < 2; i++) {
+      RTPTimer *test = first[i];
+      GstClockTime test_timeout;
       gboolean save_best = FALSE;
 
+      if (test == NULL)
+        continue;
+
+      test_timeout = get_timeout (jitterbuffer, test);
+
       GST_DEBUG_OBJECT (jitterbuffer, "%d, %d, %d, %" GST_TIME_FORMAT,
           i, test->type, test->seqnum, GST_TIME_ARGS (test_timeout));
 
@@ -2998,6 +3141,112 @@ wait_next_timeout (GstRtpJitterBuffer * jitterbuffer)
   return;
 }
 
+/* called in the rtx timer thread when rtx-thread is set.
+ *
+ * Like wait_next_timeout() but only for the expected timers. All the
+ * retransmission requests that are due are created at once and pushed
+ * upstream after releasing the lock only once.
+ */
+static void
+wait_next_rtx_timeout (GstRtpJitterBuffer * jitterbuffer)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+  GstClockTime now = 0;
+
+  JBUF_LOCK (priv);
+  while (priv->timer_running) {
+    RTPTimer *timer;
+    GstClockTime timer_timeout = -1;
+
+    timer = rtp_timer_queue_peek_expected (priv->timers);
+    if (timer)
+      timer_timeout = get_timeout (jitterbuffer, timer);
+
+    GST_DEBUG_OBJECT (jitterbuffer, "rtx now %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (now));
+
+    if (timer && !priv->blocked) {
+      GstClock *clock;
+      GstClockTime sync_time;
+      GstClockID id;
+      GstClockReturn ret;
+      GstClockTimeDiff clock_jitter;
+
+      if (timer_timeout == -1 || timer_timeout <= now) {
+        GQueue events = G_QUEUE_INIT;
+        GstEvent *event;
+        RTPTimer *last;
+
+        do {
+          g_queue_push_tail (&events,
+              create_rtx_request (jitterbuffer, timer, now));
+          last = timer;
+
+          /* a timer that is due again is retried in the next round */
+          timer = rtp_timer_queue_peek_expected (priv->timers);
+          if (timer == NULL || timer == last)
+            break;
+          timer_timeout = get_timeout (jitterbuffer, timer);
+        } while (timer_timeout == -1 || timer_timeout <= now);
+
+        GST_DEBUG_OBJECT (jitterbuffer, "pushing %u retransmission requests",
+            events.length);
+
+        JBUF_UNLOCK (priv);
+        while ((event = g_queue_pop_head (&events)))
+          gst_pad_push_event (priv->sinkpad, event);
+        JBUF_LOCK (priv);
+        continue;
+      }
+
+      GST_OBJECT_LOCK (jitterbuffer);
+      clock = GST_ELEMENT_CLOCK (jitterbuffer);
+      if (!clock) {
+        GST_OBJECT_UNLOCK (jitterbuffer);
+        GST_DEBUG_OBJECT (jitterbuffer, "No clock, timeout right away");
+        now = timer_timeout;
+        continue;
+      }
+
+      /* expected timers are in input time */
+      sync_time = timer_timeout + GST_ELEMENT_CAST (jitterbuffer)->base_time;
+      sync_time += priv->peer_latency;
+
+      id = priv->rtx_clock_id = gst_clock_new_single_shot_id (clock, sync_time);
+      priv->rtx_timer_timeout = timer_timeout;
+      priv->rtx_timer_seqnum = timer->seqnum;
+      GST_OBJECT_UNLOCK (jitterbuffer);
+
+      JBUF_UNLOCK (priv);
+
+      ret = gst_clock_id_wait (id, &clock_jitter);
+
+      JBUF_LOCK (priv);
+      if (!priv->timer_running) {
+        gst_clock_id_unref (id);
+        priv->rtx_clock_id = NULL;
+        break;
+      }
+
+      if (ret != GST_CLOCK_UNSCHEDULED) {
+        now = timer_timeout + MAX (clock_jitter, 0);
+        GST_DEBUG_OBJECT (jitterbuffer, "rtx sync done, %d, #%d, %"
+            G_GINT64_FORMAT, ret, priv->rtx_timer_seqnum, clock_jitter);
+      } else {
+        GST_DEBUG_OBJECT (jitterbuffer, "rtx sync unscheduled");
+      }
+      gst_clock_id_unref (id);
+      priv->rtx_clock_id = NULL;
+    } else {
+      /* no expected timers, wait for activity */
+      JBUF_WAIT_RTX_TIMER (priv);
+    }
+  }
+  JBUF_UNLOCK (priv);
+
+  GST_DEBUG_OBJECT (jitterbuffer, "rtx timer thread stopping");
+}
+
 /*
  * This funcion implements the main pushing loop on the source pad.
  *
@@ -3244,7 +3493,8 @@ gst_rtp_jitter_buffer_sink_query (GstPad * pad, GstObject * parent,
         if (rtp_jitter_buffer_get_mode (priv->jbuf) !=
             RTP_JITTER_BUFFER_MODE_BUFFER) {
           GST_DEBUG_OBJECT (jitterbuffer, "adding serialized query");
-          item = alloc_item (query, ITEM_TYPE_QUERY, -1, -1, -1, 0, -1);
+          item = alloc_item (jitterbuffer, query, ITEM_TYPE_QUERY, -1, -1, -1,
+              0, -1);
           rtp_jitter_buffer_insert (priv->jbuf, item, &head, NULL);
           if (head)
             JBUF_SIGNAL_EVENT (priv);
@@ -3448,6 +3698,11 @@ gst_rtp_jitter_buffer_set_property (GObject * object,
       priv->rtx_retry_period = g_value_get_int (value);
       JBUF_UNLOCK (priv);
       break;
+    case PROP_RTX_THREAD:
+      JBUF_LOCK (priv);
+      priv->rtx_thread = g_value_get_boolean (value);
+      JBUF_UNLOCK (priv);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3529,6 +3784,11 @@ gst_rtp_jitter_buffer_get_property (GObject * object,
       g_value_set_int (value, priv->rtx_retry_period);
       JBUF_UNLOCK (priv);
       break;
+    case PROP_RTX_THREAD:
+      JBUF_LOCK (priv);
+      g_value_set_boolean (value, priv->rtx_thread);
+      JBUF_UNLOCK (priv);
+      break;
     case PROP_STATS:
       g_value_take_boxed (value,
           gst_rtp_jitter_buffer_create_stats (jitterbuffer));
@@ -3549,7 +3809,10 @@ gst_rtp_jitter_buffer_create_stats (GstRtpJitterBuffer * jbuf)
       "rtx-count", G_TYPE_UINT64, jbuf->priv->num_rtx_requests,
       "rtx-success-count", G_TYPE_UINT64, jbuf->priv->num_rtx_success,
       "rtx-per-packet", G_TYPE_DOUBLE, jbuf->priv->avg_rtx_num,
-      "rtx-rtt", G_TYPE_UINT64, jbuf->priv->avg_rtx_rtt, NULL);
+      "rtx-rtt", G_TYPE_UINT64, jbuf->priv->avg_rtx_rtt,
+      "item-allocs", G_TYPE_UINT64, jbuf->priv->num_item_allocs,
+      "timer-allocs", G_TYPE_UINT64,
+      rtp_timer_queue_get_num_allocs (jbuf->priv->timers), NULL);
   JBUF_UNLOCK (jbuf->priv);
 
   return s;
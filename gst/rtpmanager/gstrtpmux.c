@@ -321,49 +321,108 @@ gst_rtp_mux_release_pad (GstElement * element, GstPad * pad)
   }
 }
 
-/* Put our own clock-base on the buffer */
-static void
-gst_rtp_mux_readjust_rtp_timestamp_locked (GstRTPMux * rtp_mux,
-    GstRTPMuxPadPrivate * padpriv, GstRTPBuffer * rtpbuffer)
+static gboolean
+accept_buffer_locked (GstRTPMux * rtp_mux, GstRTPMuxPadPrivate * padpriv,
+    GstBuffer * buffer)
 {
-  guint32 ts;
-  guint32 sink_ts_base = 0;
+  GstRTPMuxClass *klass = GST_RTP_MUX_GET_CLASS (rtp_mux);
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  gboolean ret;
 
-  if (padpriv && padpriv->have_clock_base)
-    sink_ts_base = padpriv->clock_base;
+  if (!klass->accept_buffer_locked)
+    return TRUE;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer)) {
+    GST_WARNING_OBJECT (rtp_mux, "Dropping invalid RTP buffer");
+    return FALSE;
+  }
+
+  ret = klass->accept_buffer_locked (rtp_mux, padpriv, &rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return ret;
+}
+
+/* Do the checks of gst_rtp_buffer_map() on the header in @data, the start
+ * of @buffer, without mapping the rest of the packet */
+static gboolean
+validate_header (GstBuffer * buffer, const guint8 * data)
+{
+  gsize size = gst_buffer_get_size (buffer);
+  guint header_len;
+  guint8 ext[4], padding;
+
+  if ((data[0] & 0xc0) != (GST_RTP_VERSION << 6))
+    return FALSE;
+
+  /* the CSRCs and the header extension */
+  header_len = 12 + (data[0] & 0x0f) * 4;
+  if (data[0] & 0x10) {
+    if (gst_buffer_extract (buffer, header_len, ext, 4) != 4)
+      return FALSE;
+    header_len += 4 + GST_READ_UINT16_BE (ext + 2) * 4;
+  }
+  if (size < header_len)
+    return FALSE;
 
-  ts = gst_rtp_buffer_get_timestamp (rtpbuffer) - sink_ts_base +
-      rtp_mux->ts_base;
-  GST_LOG_OBJECT (rtp_mux, "Re-adjusting RTP ts %u to %u",
-      gst_rtp_buffer_get_timestamp (rtpbuffer), ts);
-  gst_rtp_buffer_set_timestamp (rtpbuffer, ts);
+  if (data[0] & 0x20) {
+    if (gst_buffer_extract (buffer, size - 1, &padding, 1) != 1)
+      return FALSE;
+    if (header_len + padding > size)
+      return FALSE;
+  }
+
+  return TRUE;
 }
 
+/* Put our own seqnum, SSRC and clock-base on the buffer. Only the memory
+ * with the RTP header is mapped and written to, so that a payload that is
+ * shared with other buffers is not copied. */
 static gboolean
 process_buffer_locked (GstRTPMux * rtp_mux, GstRTPMuxPadPrivate * padpriv,
-    GstRTPBuffer * rtpbuffer)
+    GstBuffer * buffer)
 {
-  GstRTPMuxClass *klass = GST_RTP_MUX_GET_CLASS (rtp_mux);
+  GstMapInfo map;
+  guint32 sink_ts_base = 0;
+  guint32 ts;
 
-  if (klass->accept_buffer_locked)
-    if (!klass->accept_buffer_locked (rtp_mux, padpriv, rtpbuffer))
+  if (gst_buffer_n_memory (buffer) == 0 ||
+      !gst_buffer_map_range (buffer, 0, 1, &map, GST_MAP_READWRITE))
+    return FALSE;
+
+  if (G_UNLIKELY (map.size < 12)) {
+    /* header split over several memories */
+    gst_buffer_unmap (buffer, &map);
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READWRITE))
       return FALSE;
+  }
+
+  if (map.size < 12 || !validate_header (buffer, map.data)) {
+    gst_buffer_unmap (buffer, &map);
+    return FALSE;
+  }
+
+  if (padpriv && padpriv->have_clock_base)
+    sink_ts_base = padpriv->clock_base;
 
   rtp_mux->seqnum++;
-  gst_rtp_buffer_set_seq (rtpbuffer, rtp_mux->seqnum);
+  ts = GST_READ_UINT32_BE (map.data + 4) - sink_ts_base + rtp_mux->ts_base;
+
+  GST_WRITE_UINT16_BE (map.data + 2, rtp_mux->seqnum);
+  GST_WRITE_UINT32_BE (map.data + 4, ts);
+  GST_WRITE_UINT32_BE (map.data + 8, rtp_mux->current_ssrc);
+
+  gst_buffer_unmap (buffer, &map);
 
-  gst_rtp_buffer_set_ssrc (rtpbuffer, rtp_mux->current_ssrc);
-  gst_rtp_mux_readjust_rtp_timestamp_locked (rtp_mux, padpriv, rtpbuffer);
   GST_LOG_OBJECT (rtp_mux,
       "Pushing packet size %" G_GSIZE_FORMAT ", seq=%d, ts=%u",
-      rtpbuffer->map[0].size, rtp_mux->seqnum,
-      gst_rtp_buffer_get_timestamp (rtpbuffer));
+      gst_buffer_get_size (buffer), rtp_mux->seqnum, ts);
 
   if (padpriv) {
     if (padpriv->segment.format == GST_FORMAT_TIME)
-      GST_BUFFER_PTS (rtpbuffer->buffer) =
+      GST_BUFFER_PTS (buffer) =
           gst_segment_to_running_time (&padpriv->segment, GST_FORMAT_TIME,
-          GST_BUFFER_PTS (rtpbuffer->buffer));
+          GST_BUFFER_PTS (buffer));
   }
 
   return TRUE;
@@ -380,19 +439,20 @@ static gboolean
 process_list_item (GstBuffer ** buffer, guint idx, gpointer user_data)
 {
   struct BufferListData *bd = user_data;
-  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
 
   *buffer = gst_buffer_make_writable (*buffer);
 
-  gst_rtp_buffer_map (*buffer, GST_MAP_READWRITE, &rtpbuffer);
-
-  bd->drop = !process_buffer_locked (bd->rtp_mux, bd->padpriv, &rtpbuffer);
-
-  gst_rtp_buffer_unmap (&rtpbuffer);
-
+  bd->drop = !accept_buffer_locked (bd->rtp_mux, bd->padpriv, *buffer);
   if (bd->drop)
     return FALSE;
 
+  if (!process_buffer_locked (bd->rtp_mux, bd->padpriv, *buffer)) {
+    GST_WARNING_OBJECT (bd->rtp_mux, "Dropping invalid RTP buffer");
+    gst_buffer_unref (*buffer);
+    *buffer = NULL;
+    return TRUE;
+  }
+
   if (GST_BUFFER_DURATION_IS_VALID (*buffer) &&
       GST_BUFFER_TIMESTAMP_IS_VALID (*buffer))
     bd->rtp_mux->last_stop = GST_BUFFER_TIMESTAMP (*buffer) +
@@ -403,6 +463,24 @@ process_list_item (GstBuffer ** buffer, guint idx, gpointer user_data)
   return TRUE;
 }
 
+static gboolean
+resend_events (GstPad * pad, GstEvent ** event, gpointer user_data)
+{
+  GstRTPMux *rtp_mux = user_data;
+
+  if (GST_EVENT_TYPE (*event) == GST_EVENT_CAPS) {
+    GstCaps *caps;
+
+    gst_event_parse_caps (*event, &caps);
+    gst_rtp_mux_setcaps (pad, rtp_mux, caps);
+  } else {
+    gst_pad_push_event (rtp_mux->srcpad, gst_event_ref (*event));
+  }
+
+  return TRUE;
+}
+
+/* All buffers of the list are rewritten with one take of the object lock */
 static GstFlowReturn
 gst_rtp_mux_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * bufferlist)
@@ -410,6 +488,7 @@ gst_rtp_mux_chain_list (GstPad * pad, GstObject * parent,
   GstRTPMux *rtp_mux;
   GstFlowReturn ret;
   GstRTPMuxPadPrivate *padpriv;
+  gboolean changed = FALSE;
   struct BufferListData bd;
 
   rtp_mux = GST_RTP_MUX (parent);
@@ -431,9 +510,18 @@ gst_rtp_mux_chain_list (GstPad * pad, GstObject * parent,
   bufferlist = gst_buffer_list_make_writable (bufferlist);
   gst_buffer_list_foreach (bufferlist, process_list_item, &bd);
 
+  if (!bd.drop && pad != rtp_mux->last_pad) {
+    changed = TRUE;
+    g_clear_object (&rtp_mux->last_pad);
+    rtp_mux->last_pad = g_object_ref (pad);
+  }
+
   GST_OBJECT_UNLOCK (rtp_mux);
 
-  if (bd.drop) {
+  if (changed)
+    gst_pad_sticky_events_foreach (pad, resend_events, rtp_mux);
+
+  if (bd.drop || gst_buffer_list_length (bufferlist) == 0) {
     gst_buffer_list_unref (bufferlist);
     ret = GST_FLOW_OK;
   } else {
@@ -445,23 +533,6 @@ out:
   return ret;
 }
 
-static gboolean
-resend_events (GstPad * pad, GstEvent ** event, gpointer user_data)
-{
-  GstRTPMux *rtp_mux = user_data;
-
-  if (GST_EVENT_TYPE (*event) == GST_EVENT_CAPS) {
-    GstCaps *caps;
-
-    gst_event_parse_caps (*event, &caps);
-    gst_rtp_mux_setcaps (pad, rtp_mux, caps);
-  } else {
-    gst_pad_push_event (rtp_mux->srcpad, gst_event_ref (*event));
-  }
-
-  return TRUE;
-}
-
 static GstFlowReturn
 gst_rtp_mux_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
@@ -470,7 +541,6 @@ gst_rtp_mux_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   GstRTPMuxPadPrivate *padpriv;
   gboolean drop;
   gboolean changed = FALSE;
-  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
 
   rtp_mux = GST_RTP_MUX (GST_OBJECT_PARENT (pad));
 
@@ -485,17 +555,15 @@ gst_rtp_mux_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 
   buffer = gst_buffer_make_writable (buffer);
 
-  if (!gst_rtp_buffer_map (buffer, GST_MAP_READWRITE, &rtpbuffer)) {
+  drop = !accept_buffer_locked (rtp_mux, padpriv, buffer);
+
+  if (!drop && !process_buffer_locked (rtp_mux, padpriv, buffer)) {
     GST_OBJECT_UNLOCK (rtp_mux);
     gst_buffer_unref (buffer);
     GST_ERROR_OBJECT (rtp_mux, "Invalid RTP buffer");
     return GST_FLOW_ERROR;
   }
 
-  drop = !process_buffer_locked (rtp_mux, padpriv, &rtpbuffer);
-
-  gst_rtp_buffer_unmap (&rtpbuffer);
-
   if (!drop) {
     if (pad != rtp_mux->last_pad) {
       changed = TRUE;
@@ -45,6 +45,7 @@
 #include <stdlib.h>
 
 #include "gstrtprtxsend.h"
+#include "rtprtxhistory.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_rtp_rtx_send_debug);
 #define GST_CAT_DEFAULT gst_rtp_rtx_send_debug
@@ -102,20 +103,6 @@ static void gst_rtp_rtx_send_finalize (GObject * object);
 
 G_DEFINE_TYPE (GstRtpRtxSend, gst_rtp_rtx_send, GST_TYPE_ELEMENT);
 
-typedef struct
-{
-  guint16 seqnum;
-  guint32 timestamp;
-  GstBuffer *buffer;
-} BufferQueueItem;
-
-static void
-buffer_queue_item_free (BufferQueueItem * item)
-{
-  gst_buffer_unref (item->buffer);
-  g_slice_free (BufferQueueItem, item);
-}
-
 typedef struct
 {
   guint32 rtx_ssrc;
@@ -123,7 +110,7 @@ typedef struct
   gint clock_rate;
 
   /* history of rtp packets */
-  GSequence *queue;
+  RTPRtxHistory *history;
 } SSRCRtxData;
 
 static SSRCRtxData *
@@ -133,7 +120,7 @@ ssrc_rtx_data_new (guint32 rtx_ssrc)
 
   data->rtx_ssrc = rtx_ssrc;
   data->next_seqnum = g_random_int_range (0, G_MAXUINT16);
-  data->queue = g_sequence_new ((GDestroyNotify) buffer_queue_item_free);
+  data->history = rtp_rtx_history_new ();
 
   return data;
 }
@@ -141,7 +128,7 @@ ssrc_rtx_data_new (guint32 rtx_ssrc)
 static void
 ssrc_rtx_data_free (SSRCRtxData * data)
 {
-  g_sequence_free (data->queue);
+  rtp_rtx_history_free (data->history);
   g_slice_free (SSRCRtxData, data);
 }
 
@@ -429,16 +416,6 @@ gst_rtp_rtx_buffer_new (GstRtpRtxSend * rtx, GstBuffer * buffer)
   return new_buffer;
 }
 
-static gint
-buffer_queue_items_cmp (BufferQueueItem * a, BufferQueueItem * b,
-    gpointer user_data)
-{
-  /* gst_rtp_buffer_compare_seqnum returns the opposite of what we want,
-   * it returns negative when seqnum1 > seqnum2 and we want negative
-   * when b > a, i.e. a is smaller, so it comes first in the sequence */
-  return gst_rtp_buffer_compare_seqnum (b->seqnum, a->seqnum);
-}
-
 static gboolean
 gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -472,21 +449,17 @@ gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
         /* check if request is for us */
         if (g_hash_table_contains (rtx->ssrc_data, GUINT_TO_POINTER (ssrc))) {
           SSRCRtxData *data;
-          GSequenceIter *iter;
-          BufferQueueItem search_item;
+          GstBuffer *buffer;
 
           /* update statistics */
           ++rtx->num_rtx_requests;
 
           data = gst_rtp_rtx_send_get_ssrc_data (rtx, ssrc);
 
-          search_item.seqnum = seqnum;
-          iter = g_sequence_lookup (data->queue, &search_item,
-              (GCompareDataFunc) buffer_queue_items_cmp, NULL);
-          if (iter) {
-            BufferQueueItem *item = g_sequence_get (iter);
-            GST_DEBUG_OBJECT (rtx, "found %" G_GUINT16_FORMAT, item->seqnum);
-            rtx_buf = gst_rtp_rtx_buffer_new (rtx, item->buffer);
+          buffer = rtp_rtx_history_lookup (data->history, seqnum);
+          if (buffer) {
+            GST_DEBUG_OBJECT (rtx, "found %" G_GUINT16_FORMAT, seqnum);
+            rtx_buf = gst_rtp_rtx_buffer_new (rtx, buffer);
           }
         }
         GST_OBJECT_UNLOCK (rtx);
@@ -614,28 +587,13 @@ gst_rtp_rtx_send_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 static guint32
 gst_rtp_rtx_send_get_ts_diff (SSRCRtxData * data)
 {
-  guint64 high_ts, low_ts;
-  BufferQueueItem *high_buf, *low_buf;
   guint32 result;
 
-  high_buf =
-      g_sequence_get (g_sequence_iter_prev (g_sequence_get_end_iter
-          (data->queue)));
-  low_buf = g_sequence_get (g_sequence_get_begin_iter (data->queue));
-
-  if (!high_buf || !low_buf || high_buf == low_buf)
+  /* this works when the ts wraps */
+  result = rtp_rtx_history_get_rtptime_span (data->history);
+  if (result == 0)
     return 0;
 
-  high_ts = high_buf->timestamp;
-  low_ts = low_buf->timestamp;
-
-  /* it needs to work if ts wraps */
-  if (high_ts >= low_ts) {
-    result = (guint32) (high_ts - low_ts);
-  } else {
-    result = (guint32) (high_ts + G_MAXUINT32 + 1 - low_ts);
-  }
-
   /* return value in ms instead of clock ticks */
   return (guint32) gst_util_uint64_scale_int (result, 1000, data->clock_rate);
 }
@@ -646,7 +604,6 @@ gst_rtp_rtx_send_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (parent);
   GstFlowReturn ret = GST_FLOW_ERROR;
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
-  BufferQueueItem *item;
   SSRCRtxData *data;
   guint16 seqnum;
   guint8 payload_type;
@@ -667,20 +624,17 @@ gst_rtp_rtx_send_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     data = gst_rtp_rtx_send_get_ssrc_data (rtx, ssrc);
 
     /* add current rtp buffer to queue history */
-    item = g_slice_new0 (BufferQueueItem);
-    item->seqnum = seqnum;
-    item->timestamp = rtptime;
-    item->buffer = gst_buffer_ref (buffer);
-    g_sequence_append (data->queue, item);
+    rtp_rtx_history_push (data->history, seqnum, rtptime,
+        gst_buffer_ref (buffer));
 
     /* remove oldest packets from history if they are too many */
     if (rtx->max_size_packets) {
-      while (g_sequence_get_length (data->queue) > rtx->max_size_packets)
-        g_sequence_remove (g_sequence_get_begin_iter (data->queue));
+      while (rtp_rtx_history_length (data->history) > rtx->max_size_packets)
+        rtp_rtx_history_pop (data->history);
     }
     if (rtx->max_size_time) {
       while (gst_rtp_rtx_send_get_ts_diff (data) > rtx->max_size_time)
-        g_sequence_remove (g_sequence_get_begin_iter (data->queue));
+        rtp_rtx_history_pop (data->history);
     }
   }
 
@@ -47,6 +47,7 @@
 #include <gst/rtp/gstrtcpbuffer.h>
 
 #include "gstrtpssrcdemux.h"
+#include "rtppacketmeta.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_rtp_ssrc_demux_debug);
 #define GST_CAT_DEFAULT gst_rtp_ssrc_demux_debug
@@ -115,6 +116,8 @@ static void gst_rtp_ssrc_demux_clear_ssrc (GstRtpSsrcDemux * demux,
 /* sinkpad stuff */
 static GstFlowReturn gst_rtp_ssrc_demux_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf);
+static GstFlowReturn gst_rtp_ssrc_demux_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
 static gboolean gst_rtp_ssrc_demux_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 
@@ -448,6 +451,8 @@ gst_rtp_ssrc_demux_init (GstRtpSsrcDemux * demux)
       gst_pad_new_from_template (gst_element_class_get_pad_template (klass,
           "sink"), "sink");
   gst_pad_set_chain_function (demux->rtp_sink, gst_rtp_ssrc_demux_chain);
+  gst_pad_set_chain_list_function (demux->rtp_sink,
+      gst_rtp_ssrc_demux_chain_list);
   gst_pad_set_event_function (demux->rtp_sink, gst_rtp_ssrc_demux_sink_event);
   gst_pad_set_iterate_internal_links_function (demux->rtp_sink,
       gst_rtp_ssrc_demux_iterate_internal_links_sink);
@@ -604,24 +609,41 @@ gst_rtp_ssrc_demux_sink_event (GstPad * pad, GstObject * parent,
   return fdata.res;
 }
 
+/* use the header parsed by the session when there is one */
+static gboolean
+get_rtp_ssrc (GstBuffer * buf, guint32 * ssrc)
+{
+  GstRTPBuffer rtp = { NULL };
+  RTPPacketMeta *meta;
+
+  if ((meta = rtp_packet_meta_get (buf))) {
+    *ssrc = meta->ssrc;
+    return TRUE;
+  }
+
+  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
+    return FALSE;
+
+  *ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_rtp_ssrc_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
   GstFlowReturn ret;
   GstRtpSsrcDemux *demux;
   guint32 ssrc;
-  GstRTPBuffer rtp = { NULL };
   GstPad *srcpad;
   GstRtpSsrcDemuxPad *dpad;
 
   demux = GST_RTP_SSRC_DEMUX (parent);
 
-  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
+  if (!get_rtp_ssrc (buf, &ssrc))
     goto invalid_payload;
 
-  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
-  gst_rtp_buffer_unmap (&rtp);
-
   GST_DEBUG_OBJECT (demux, "received buffer of SSRC %08x", ssrc);
 
   srcpad = find_or_create_demux_pad_for_ssrc (demux, ssrc, RTP_PAD);
@@ -664,6 +686,137 @@ create_failed:
   }
 }
 
+/* the buffers of one SSRC in a buffer list */
+typedef struct
+{
+  guint32 ssrc;
+  GstPad *srcpad;
+  GstBufferList *list;
+} SsrcBufferList;
+
+static GstFlowReturn
+gst_rtp_ssrc_demux_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstRtpSsrcDemux *demux;
+  GArray *groups;
+  SsrcBufferList *group = NULL;
+  GstRtpSsrcDemuxPad *dpad;
+  guint i, j, len;
+
+  demux = GST_RTP_SSRC_DEMUX (parent);
+
+  len = gst_buffer_list_length (list);
+  groups = g_array_sized_new (FALSE, FALSE, sizeof (SsrcBufferList), 4);
+
+  /* split the list in a list per SSRC, keeping the order of the buffers of
+   * each SSRC */
+  for (i = 0; i < len; i++) {
+    GstBuffer *buf = gst_buffer_list_get (list, i);
+    guint32 ssrc;
+
+    if (!get_rtp_ssrc (buf, &ssrc))
+      goto invalid_payload;
+
+    /* consecutive packets are usually from the same SSRC */
+    if (group == NULL || group->ssrc != ssrc) {
+      group = NULL;
+      for (j = 0; j < groups->len; j++) {
+        if (g_array_index (groups, SsrcBufferList, j).ssrc == ssrc) {
+          group = &g_array_index (groups, SsrcBufferList, j);
+          break;
+        }
+      }
+      if (group == NULL) {
+        g_array_set_size (groups, groups->len + 1);
+        group = &g_array_index (groups, SsrcBufferList, groups->len - 1);
+        group->ssrc = ssrc;
+        group->srcpad = NULL;
+        group->list = gst_buffer_list_new ();
+      }
+    }
+    gst_buffer_list_add (group->list, gst_buffer_ref (buf));
+  }
+  gst_buffer_list_unref (list);
+
+  GST_DEBUG_OBJECT (demux, "received list of %u buffers for %u SSRCs", len,
+      groups->len);
+
+  /* look up the pads of the known SSRCs at once */
+  GST_PAD_LOCK (demux);
+  for (i = 0; i < groups->len; i++) {
+    group = &g_array_index (groups, SsrcBufferList, i);
+
+    dpad = find_demux_pad_for_ssrc (demux, group->ssrc);
+    if (dpad != NULL && dpad->pushed_initial_rtp_events)
+      group->srcpad = gst_object_ref (dpad->rtp_pad);
+  }
+  GST_PAD_UNLOCK (demux);
+
+  for (i = 0; i < groups->len; i++) {
+    GstFlowReturn res;
+
+    group = &g_array_index (groups, SsrcBufferList, i);
+
+    /* new SSRC, this creates the pad and pushes the initial events */
+    if (group->srcpad == NULL) {
+      group->srcpad = find_or_create_demux_pad_for_ssrc (demux, group->ssrc,
+          RTP_PAD);
+      if (group->srcpad == NULL)
+        goto create_failed;
+    }
+
+    res = gst_pad_push_list (group->srcpad, group->list);
+    group->list = NULL;
+
+    if (res != GST_FLOW_OK) {
+      /* check if the ssrc still there, may have been removed */
+      GST_PAD_LOCK (demux);
+      dpad = find_demux_pad_for_ssrc (demux, group->ssrc);
+      if (dpad == NULL || dpad->rtp_pad != group->srcpad) {
+        /* SSRC was removed during the push ... ignore the error */
+        res = GST_FLOW_OK;
+      }
+      GST_PAD_UNLOCK (demux);
+    }
+    /* keep pushing to the other SSRCs, report the first error */
+    if (ret == GST_FLOW_OK)
+      ret = res;
+  }
+
+done:
+  for (i = 0; i < groups->len; i++) {
+    group = &g_array_index (groups, SsrcBufferList, i);
+
+    if (group->srcpad)
+      gst_object_unref (group->srcpad);
+    if (group->list)
+      gst_buffer_list_unref (group->list);
+  }
+  g_array_free (groups, TRUE);
+
+  return ret;
+
+  /* ERRORS */
+invalid_payload:
+  {
+    /* this is fatal and should be filtered earlier */
+    GST_ELEMENT_ERROR (demux, STREAM, DECODE, (NULL),
+        ("Dropping invalid RTP payload"));
+    gst_buffer_list_unref (list);
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+create_failed:
+  {
+    GST_ELEMENT_ERROR (demux, STREAM, DECODE, (NULL),
+        ("Could not create new pad"));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+}
+
 static GstFlowReturn
 gst_rtp_ssrc_demux_rtcp_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf)
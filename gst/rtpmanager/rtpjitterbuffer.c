@@ -30,6 +30,10 @@ GST_DEBUG_CATEGORY_STATIC (rtp_jitter_buffer_debug);
 #define MAX_WINDOW	RTP_JITTER_BUFFER_MAX_WINDOW
 #define MAX_TIME	(2 * GST_SECOND)
 
+/* initial and maximum size of the seqnum index */
+#define MIN_INDEX_SIZE	32
+#define MAX_INDEX_SIZE	65536
+
 /* signals and args */
 enum
 {
@@ -99,6 +103,7 @@ rtp_jitter_buffer_finalize (GObject * object)
   jbuf = RTP_JITTER_BUFFER_CAST (object);
 
   g_queue_free (jbuf->packets);
+  g_free (jbuf->index);
 
   G_OBJECT_CLASS (rtp_jitter_buffer_parent_class)->finalize (object);
 }
@@ -621,6 +626,133 @@ no_skew:
   return out_time;
 }
 
+/* The packets after the last item without seqnum (an event or query) are
+ * sorted on seqnum. For those packets we keep an index on seqnum in a circular
+ * array that is large enough to hold all seqnums between the first and the
+ * last of those packets so that we can find the insert position of a packet
+ * without walking the list. */
+static inline RTPJitterBufferItem *
+index_lookup (RTPJitterBuffer * jbuf, guint16 seqnum)
+{
+  RTPJitterBufferItem *item;
+
+  if (G_UNLIKELY (jbuf->index_size == 0))
+    return NULL;
+
+  item = jbuf->index[seqnum & (jbuf->index_size - 1)];
+  if (item && item->seqnum == seqnum)
+    return item;
+
+  return NULL;
+}
+
+static inline GList *
+index_first (RTPJitterBuffer * jbuf)
+{
+  return jbuf->last_event ? jbuf->last_event->next : jbuf->packets->head;
+}
+
+static void
+index_resize (RTPJitterBuffer * jbuf, guint size)
+{
+  GList *list;
+
+  GST_DEBUG ("resize index %u -> %u", jbuf->index_size, size);
+
+  g_free (jbuf->index);
+  jbuf->index = g_new0 (RTPJitterBufferItem *, size);
+  jbuf->index_size = size;
+
+  for (list = index_first (jbuf); list; list = list->next) {
+    RTPJitterBufferItem *item = (RTPJitterBufferItem *) list;
+    jbuf->index[item->seqnum & (size - 1)] = item;
+  }
+}
+
+/* called after @item was inserted in the list */
+static void
+index_add (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item)
+{
+  RTPJitterBufferItem *first, *last;
+  guint span;
+
+  first = (RTPJitterBufferItem *) index_first (jbuf);
+  last = (RTPJitterBufferItem *) jbuf->packets->tail;
+
+  span = ((last->seqnum - first->seqnum) & 0xffff) + 1;
+  if (G_UNLIKELY (span > jbuf->index_size)) {
+    guint size = MAX (jbuf->index_size, MIN_INDEX_SIZE);
+
+    while (size < span)
+      size <<= 1;
+    /* also indexes the new item */
+    index_resize (jbuf, MIN (size, MAX_INDEX_SIZE));
+  } else {
+    jbuf->index[item->seqnum & (jbuf->index_size - 1)] = item;
+  }
+}
+
+static inline void
+index_remove (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item)
+{
+  RTPJitterBufferItem **slot;
+
+  if (item->seqnum == -1 || jbuf->index_size == 0)
+    return;
+
+  slot = &jbuf->index[item->seqnum & (jbuf->index_size - 1)];
+  if (*slot == item)
+    *slot = NULL;
+}
+
+/* an item without seqnum is appended, the packets before it are never
+ * looked at again when inserting */
+static void
+index_clear (RTPJitterBuffer * jbuf)
+{
+  GList *list;
+
+  if (jbuf->index_size == 0)
+    return;
+
+  for (list = index_first (jbuf); list; list = list->next)
+    index_remove (jbuf, (RTPJitterBufferItem *) list);
+}
+
+/* find a packet close to @seqnum from where we can walk back to the insert
+ * position */
+static GList *
+index_find_start (RTPJitterBuffer * jbuf, guint16 seqnum)
+{
+  RTPJitterBufferItem *last, *first, *item;
+  guint16 lo, hi;
+
+  last = (RTPJitterBufferItem *) jbuf->packets->tail;
+
+  /* empty, an event or a packet older than seqnum at the tail, we can start
+   * from the tail. This is the common case. */
+  if (last == NULL || last->seqnum == -1 ||
+      gst_rtp_buffer_compare_seqnum (seqnum, last->seqnum) <= 0)
+    return (GList *) last;
+
+  /* seqnum is not newer than the first packet, start there */
+  first = (RTPJitterBufferItem *) index_first (jbuf);
+  if (gst_rtp_buffer_compare_seqnum (seqnum, first->seqnum) >= 0)
+    return (GList *) first;
+
+  if ((item = index_lookup (jbuf, seqnum)))
+    return (GList *) item;
+
+  /* seqnum is between the first and last packet, the closest packet on
+   * either side is where we start */
+  for (lo = seqnum - 1, hi = seqnum + 1;; lo--, hi++) {
+    if ((item = index_lookup (jbuf, lo)))
+      return (GList *) item;
+    if ((item = index_lookup (jbuf, hi)))
+      return (GList *) item;
+  }
+}
+
 static void
 queue_do_insert (RTPJitterBuffer * jbuf, GList * list, GList * item)
 {
@@ -675,11 +807,16 @@ rtp_jitter_buffer_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
   list = jbuf->packets->tail;
 
   /* no seqnum, simply append then */
-  if (item->seqnum == -1)
+  if (item->seqnum == -1) {
+    index_clear (jbuf);
     goto append;
+  }
 
   seqnum = item->seqnum;
 
+  /* use the index to skip most of the strictly larger seqnum buffers */
+  list = index_find_start (jbuf, seqnum);
+
   /* loop the list to skip strictly larger seqnum buffers */
   for (; list; list = g_list_previous (list)) {
     guint16 qseq;
@@ -758,6 +895,11 @@ rtp_jitter_buffer_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
 append:
   queue_do_insert (jbuf, list, (GList *) item);
 
+  if (item->seqnum == -1)
+    jbuf->last_event = (GList *) item;
+  else
+    index_add (jbuf, item);
+
   /* buffering mode, update buffer stats */
   if (jbuf->mode == RTP_JITTER_BUFFER_MODE_BUFFER)
     update_buffer_level (jbuf, percent);
@@ -808,6 +950,11 @@ rtp_jitter_buffer_pop (RTPJitterBuffer * jbuf, gint * percent)
     else
       queue->tail = NULL;
     queue->length--;
+
+    if (item == jbuf->last_event)
+      jbuf->last_event = NULL;
+    else
+      index_remove (jbuf, (RTPJitterBufferItem *) item);
   }
 
   /* buffering mode, update buffer stats */
@@ -857,6 +1004,11 @@ rtp_jitter_buffer_flush (RTPJitterBuffer * jbuf, GFunc free_func,
 
   while ((item = g_queue_pop_head_link (jbuf->packets)))
     free_func ((RTPJitterBufferItem *) item, user_data);
+
+  jbuf->last_event = NULL;
+  g_free (jbuf->index);
+  jbuf->index = NULL;
+  jbuf->index_size = 0;
 }
 
 /**
@@ -75,6 +75,10 @@ struct _RTPJitterBuffer {
   GObject        object;
 
   GQueue        *packets;
+  /* seqnum index of the packets after the last item without seqnum */
+  GList         *last_event;
+  RTPJitterBufferItem **index;
+  guint          index_size;
 
   RTPJitterBufferMode mode;
 
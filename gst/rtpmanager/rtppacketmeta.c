@@ -0,0 +1,84 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "rtppacketmeta.h"
+
+GType
+rtp_packet_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("RTPPacketMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+static gboolean
+rtp_packet_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  return TRUE;
+}
+
+/* no transform function, the meta describes the bytes of the packet and is
+ * dropped when the buffer is copied or split */
+const GstMetaInfo *
+rtp_packet_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter (&meta_info)) {
+    const GstMetaInfo *mi = gst_meta_register (RTP_PACKET_META_API_TYPE,
+        "RTPPacketMeta", sizeof (RTPPacketMeta), rtp_packet_meta_init,
+        NULL, NULL);
+    g_once_init_leave (&meta_info, mi);
+  }
+  return meta_info;
+}
+
+/**
+ * rtp_packet_meta_add:
+ * @buffer: a writable #GstBuffer
+ * @pinfo: the #RTPPacketInfo of @buffer
+ *
+ * Attach the header fields of @pinfo to @buffer.
+ *
+ * Returns: the #RTPPacketMeta on @buffer.
+ */
+RTPPacketMeta *
+rtp_packet_meta_add (GstBuffer * buffer, RTPPacketInfo * pinfo)
+{
+  RTPPacketMeta *meta;
+
+  meta = (RTPPacketMeta *) gst_buffer_add_meta (buffer, RTP_PACKET_META_INFO,
+      NULL);
+
+  meta->ssrc = pinfo->ssrc;
+  meta->seqnum = pinfo->seqnum;
+  meta->pt = pinfo->pt;
+  meta->marker = pinfo->marker;
+  meta->rtptime = pinfo->rtptime;
+  meta->payload_offset = pinfo->payload_offset;
+  meta->payload_len = pinfo->payload_len;
+  meta->ext_offset = pinfo->ext_offset;
+  meta->ext_len = pinfo->ext_len;
+
+  return meta;
+}
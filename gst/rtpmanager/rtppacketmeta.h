@@ -0,0 +1,68 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RTP_PACKET_META_H__
+#define __RTP_PACKET_META_H__
+
+#include <gst/gst.h>
+
+#include "rtpstats.h"
+
+#define RTP_PACKET_META_API_TYPE  (rtp_packet_meta_api_get_type())
+#define RTP_PACKET_META_INFO      (rtp_packet_meta_get_info())
+
+/**
+ * RTPPacketMeta:
+ * @meta: parent #GstMeta
+ * @ssrc: the SSRC of the packet
+ * @seqnum: the seqnum of the packet
+ * @pt: the payload type of the packet
+ * @marker: the marker bit of the packet
+ * @rtptime: the RTP time of the packet
+ * @payload_offset: offset of the payload in the packet
+ * @payload_len: bytes of the RTP payload
+ * @ext_offset: offset of the header extension data or 0 when there is none
+ * @ext_len: bytes of the header extension data
+ *
+ * The parsed RTP header of a validated packet, attached to received packets
+ * by the session so that the elements after it in rtpbin do not need to map
+ * and parse the packet again. The meta is not copied with the buffer and is
+ * only valid as long as the RTP header is not changed.
+ */
+typedef struct {
+  GstMeta  meta;
+
+  guint32  ssrc;
+  guint16  seqnum;
+  guint8   pt;
+  gboolean marker;
+  guint32  rtptime;
+  guint    payload_offset;
+  guint    payload_len;
+  guint    ext_offset;
+  guint    ext_len;
+} RTPPacketMeta;
+
+GType               rtp_packet_meta_api_get_type (void);
+const GstMetaInfo * rtp_packet_meta_get_info     (void);
+
+#define rtp_packet_meta_get(buf) ((RTPPacketMeta *) gst_buffer_get_meta ((buf), RTP_PACKET_META_API_TYPE))
+
+RTPPacketMeta *     rtp_packet_meta_add          (GstBuffer *buffer, RTPPacketInfo *pinfo);
+
+#endif /* __RTP_PACKET_META_H__ */
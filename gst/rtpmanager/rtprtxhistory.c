@@ -0,0 +1,280 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "rtprtxhistory.h"
+
+/* The packets are stored in a ring of slots indexed by seqnum modulo the
+ * size of the ring. The window of seqnums from the oldest to the newest
+ * packet always fits in the ring, the ring grows when the window does not
+ * fit anymore. Slots inside the window can be empty when packets were not
+ * stored, slots outside of the window are always empty. The slots of the
+ * oldest and the newest packet are never empty.
+ */
+#define MIN_HISTORY_SIZE  64
+/* seqnums can only be ordered in half of the seqnum space */
+#define MAX_HISTORY_SIZE  32768
+/* packets older than this are not reordered but restart the seqnums, like
+ * in RFC 3550 appendix A.1 */
+#define MAX_MISORDER      100
+
+typedef struct
+{
+  GstBuffer *buffer;
+  guint32 rtptime;
+} RTPRtxHistoryItem;
+
+struct _RTPRtxHistory
+{
+  RTPRtxHistoryItem *items;
+  guint size;
+
+  /* seqnum of the oldest packet */
+  guint16 first;
+  /* number of seqnums from the oldest to the newest packet */
+  guint span;
+  /* number of packets */
+  guint length;
+};
+
+#define HISTORY_SLOT(h,seqnum) (&(h)->items[(seqnum) & ((h)->size - 1)])
+
+/**
+ * rtp_rtx_history_new:
+ *
+ * Create a new, empty #RTPRtxHistory.
+ *
+ * Returns: a new #RTPRtxHistory. Free with rtp_rtx_history_free().
+ */
+RTPRtxHistory *
+rtp_rtx_history_new (void)
+{
+  RTPRtxHistory *history = g_slice_new0 (RTPRtxHistory);
+
+  history->size = MIN_HISTORY_SIZE;
+  history->items = g_new0 (RTPRtxHistoryItem, history->size);
+
+  return history;
+}
+
+/**
+ * rtp_rtx_history_free:
+ * @history: an #RTPRtxHistory
+ *
+ * Free @history and unref all the packets in it.
+ */
+void
+rtp_rtx_history_free (RTPRtxHistory * history)
+{
+  rtp_rtx_history_clear (history);
+  g_free (history->items);
+  g_slice_free (RTPRtxHistory, history);
+}
+
+static void
+rtp_rtx_history_resize (RTPRtxHistory * history, guint size)
+{
+  RTPRtxHistoryItem *items;
+  guint i;
+
+  items = g_new0 (RTPRtxHistoryItem, size);
+  for (i = 0; i < history->span; i++) {
+    guint16 seqnum = history->first + i;
+
+    items[seqnum & (size - 1)] = *HISTORY_SLOT (history, seqnum);
+  }
+  g_free (history->items);
+  history->items = items;
+  history->size = size;
+}
+
+/**
+ * rtp_rtx_history_push:
+ * @history: an #RTPRtxHistory
+ * @seqnum: the seqnum of @buffer
+ * @rtptime: the RTP timestamp of @buffer
+ * @buffer: (transfer full): the packet
+ *
+ * Store @buffer in @history. A packet with the seqnum of a packet in the
+ * history replaces that packet, a packet a little older than the oldest
+ * packet is dropped and a packet much older clears the history. When the
+ * newest packet is too far from the oldest packet, the oldest packets are
+ * removed.
+ */
+void
+rtp_rtx_history_push (RTPRtxHistory * history, guint16 seqnum,
+    guint32 rtptime, GstBuffer * buffer)
+{
+  RTPRtxHistoryItem *item;
+  guint span;
+
+  if (history->length > 0) {
+    guint16 last = history->first + history->span - 1;
+
+    if (gst_rtp_buffer_compare_seqnum (last, seqnum) <= 0) {
+      gint diff = gst_rtp_buffer_compare_seqnum (history->first, seqnum);
+
+      if (diff < -MAX_MISORDER) {
+        /* the seqnums restarted, start a new history */
+        rtp_rtx_history_clear (history);
+        goto new_packet;
+      }
+      if (diff < 0) {
+        /* older than the oldest packet */
+        gst_buffer_unref (buffer);
+        return;
+      }
+      /* not newer than the newest packet, store it in the window */
+      item = HISTORY_SLOT (history, seqnum);
+      if (item->buffer)
+        gst_buffer_unref (item->buffer);
+      else
+        history->length++;
+      item->buffer = buffer;
+      item->rtptime = rtptime;
+      return;
+    }
+
+    while (history->length > 0 &&
+        (guint16) (seqnum - history->first) >= MAX_HISTORY_SIZE)
+      rtp_rtx_history_pop (history);
+  }
+
+new_packet:
+  if (history->length == 0) {
+    history->first = seqnum;
+    history->span = 0;
+  }
+
+  span = (guint16) (seqnum - history->first) + 1;
+  if (span > history->size) {
+    guint size = history->size;
+
+    while (size < span)
+      size <<= 1;
+    rtp_rtx_history_resize (history, size);
+  }
+  history->span = span;
+
+  item = HISTORY_SLOT (history, seqnum);
+  item->buffer = buffer;
+  item->rtptime = rtptime;
+  history->length++;
+}
+
+/**
+ * rtp_rtx_history_lookup:
+ * @history: an #RTPRtxHistory
+ * @seqnum: a seqnum
+ *
+ * Find the packet with @seqnum in @history.
+ *
+ * Returns: (transfer none): the packet with @seqnum or %NULL when it is not
+ * in @history.
+ */
+GstBuffer *
+rtp_rtx_history_lookup (RTPRtxHistory * history, guint16 seqnum)
+{
+  gint diff;
+
+  if (history->length == 0)
+    return NULL;
+
+  diff = gst_rtp_buffer_compare_seqnum (history->first, seqnum);
+  if (diff < 0 || diff >= history->span)
+    return NULL;
+
+  return HISTORY_SLOT (history, seqnum)->buffer;
+}
+
+/**
+ * rtp_rtx_history_pop:
+ * @history: an #RTPRtxHistory
+ *
+ * Remove the oldest packet from @history.
+ */
+void
+rtp_rtx_history_pop (RTPRtxHistory * history)
+{
+  RTPRtxHistoryItem *item;
+
+  if (history->length == 0)
+    return;
+
+  item = HISTORY_SLOT (history, history->first);
+  gst_buffer_unref (item->buffer);
+  item->buffer = NULL;
+  history->length--;
+
+  /* move to the next packet, the newest packet is never empty */
+  do {
+    history->first++;
+    history->span--;
+  } while (history->span > 0 &&
+      HISTORY_SLOT (history, history->first)->buffer == NULL);
+}
+
+/**
+ * rtp_rtx_history_clear:
+ * @history: an #RTPRtxHistory
+ *
+ * Remove all packets from @history.
+ */
+void
+rtp_rtx_history_clear (RTPRtxHistory * history)
+{
+  while (history->length > 0)
+    rtp_rtx_history_pop (history);
+}
+
+/**
+ * rtp_rtx_history_length:
+ * @history: an #RTPRtxHistory
+ *
+ * Returns: the number of packets in @history.
+ */
+guint
+rtp_rtx_history_length (RTPRtxHistory * history)
+{
+  return history->length;
+}
+
+/**
+ * rtp_rtx_history_get_rtptime_span:
+ * @history: an #RTPRtxHistory
+ *
+ * Get the difference between the RTP timestamps of the newest and the oldest
+ * packet, taking wraparound into account.
+ *
+ * Returns: the difference in clock-rate units or 0 when there are less than
+ * two packets.
+ */
+guint32
+rtp_rtx_history_get_rtptime_span (RTPRtxHistory * history)
+{
+  guint16 last;
+
+  if (history->length < 2)
+    return 0;
+
+  last = history->first + history->span - 1;
+
+  return HISTORY_SLOT (history, last)->rtptime -
+      HISTORY_SLOT (history, history->first)->rtptime;
+}
@@ -0,0 +1,44 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RTP_RTX_HISTORY_H__
+#define __RTP_RTX_HISTORY_H__
+
+#include <gst/gst.h>
+
+/**
+ * RTPRtxHistory:
+ *
+ * The history of sent RTP packets of one SSRC, indexed on seqnum. Storing,
+ * looking up and removing the oldest packet are O(1).
+ */
+typedef struct _RTPRtxHistory RTPRtxHistory;
+
+RTPRtxHistory *   rtp_rtx_history_new              (void);
+void              rtp_rtx_history_free             (RTPRtxHistory *history);
+
+void              rtp_rtx_history_push             (RTPRtxHistory *history, guint16 seqnum,
+                                                    guint32 rtptime, GstBuffer *buffer);
+GstBuffer *       rtp_rtx_history_lookup           (RTPRtxHistory *history, guint16 seqnum);
+void              rtp_rtx_history_pop              (RTPRtxHistory *history);
+void              rtp_rtx_history_clear            (RTPRtxHistory *history);
+
+guint             rtp_rtx_history_length           (RTPRtxHistory *history);
+guint32           rtp_rtx_history_get_rtptime_span (RTPRtxHistory *history);
+
+#endif /* __RTP_RTX_HISTORY_H__ */
@@ -29,6 +29,7 @@
 #include <gst/glib-compat-private.h>
 
 #include "rtpsession.h"
+#include "rtppacketmeta.h"
 
 GST_DEBUG_CATEGORY_STATIC (rtp_session_debug);
 #define GST_CAT_DEFAULT rtp_session_debug
@@ -1731,6 +1732,8 @@ update_packet (GstBuffer ** buffer, guint idx, RTPPacketInfo * pinfo)
 
   if (pinfo->rtp) {
     GstRTPBuffer rtp = { NULL };
+    gpointer ext_data;
+    guint ext_len;
 
     if (!gst_rtp_buffer_map (*buffer, GST_MAP_READ, &rtp))
       goto invalid_packet;
@@ -1744,12 +1747,26 @@ update_packet (GstBuffer ** buffer, guint idx, RTPPacketInfo * pinfo)
       pinfo->seqnum = gst_rtp_buffer_get_seq (&rtp);
       pinfo->pt = gst_rtp_buffer_get_payload_type (&rtp);
       pinfo->rtptime = gst_rtp_buffer_get_timestamp (&rtp);
+      pinfo->marker = gst_rtp_buffer_get_marker (&rtp);
+      pinfo->payload_offset = gst_rtp_buffer_get_header_len (&rtp);
+      if (gst_rtp_buffer_get_extension_data (&rtp, NULL, &ext_data, &ext_len)) {
+        pinfo->ext_offset = (guint8 *) ext_data - (guint8 *) rtp.data[0];
+        pinfo->ext_len = ext_len * 4;
+      } else {
+        pinfo->ext_offset = 0;
+        pinfo->ext_len = 0;
+      }
       /* copy available csrc */
       pinfo->csrc_count = gst_rtp_buffer_get_csrc_count (&rtp);
       for (i = 0; i < pinfo->csrc_count; i++)
         pinfo->csrcs[i] = gst_rtp_buffer_get_csrc (&rtp, i);
     }
     gst_rtp_buffer_unmap (&rtp);
+
+    /* pass the parsed header to the elements after the session, this is
+     * only possible when we are the only user of the buffer */
+    if (!pinfo->send && !pinfo->is_list && gst_buffer_is_writable (*buffer))
+      rtp_packet_meta_add (*buffer, pinfo);
   }
 
   if (idx == 0) {
@@ -2940,10 +2957,15 @@ typedef struct
   GstBuffer *buffer;
 } ReportOutput;
 
+/* the number of sources we look at before we release the session lock for a
+ * moment to let the RTP processing continue */
+#define SOURCES_PER_BATCH 64
+
 typedef struct
 {
   GstRTCPBuffer rtcpbuf;
   RTPSession *sess;
+  GPtrArray *sources;
   RTPSource *source;
   guint num_to_report;
   gboolean have_fir;
@@ -2958,10 +2980,22 @@ typedef struct
   gboolean has_sdes;
   gboolean is_early;
   gboolean may_suppress;
+  gboolean scheduled_bye;
   GQueue output;
   guint nacked_seqnums;
 } ReportData;
 
+/* called with the session lock after handling @n sources */
+static inline void
+session_yield (RTPSession * sess, guint n)
+{
+  if (n % SOURCES_PER_BATCH == 0) {
+    RTP_SESSION_UNLOCK (sess);
+    g_thread_yield ();
+    RTP_SESSION_LOCK (sess);
+  }
+}
+
 static void
 session_start_rtcp (RTPSession * sess, ReportData * data)
 {
@@ -3418,7 +3452,7 @@ is_rtcp_time (RTPSession * sess, GstClockTime current_time, ReportData * data)
   GstClockTime interval;
   RTPSessionStats *stats;
 
-  if (sess->scheduled_bye)
+  if (data->scheduled_bye)
     stats = &sess->bye_stats;
   else
     stats = &sess->stats;
@@ -3500,17 +3534,23 @@ early:
 }
 
 static void
-clone_ssrcs_hashtable (gchar * key, RTPSource * source, GHashTable * hash_table)
+add_source_to_array (gpointer key, RTPSource * source, GPtrArray * array)
 {
-  g_hash_table_insert (hash_table, key, g_object_ref (source));
+  g_ptr_array_add (array, g_object_ref (source));
 }
 
-static gboolean
-remove_closing_sources (const gchar * key, RTPSource * source,
+static void
+remove_closing_source (RTPSession * sess, RTPSource * source,
     ReportData * data)
 {
-  if (source->closing)
-    return TRUE;
+  GHashTable *ssrcs = sess->ssrcs[sess->mask_idx];
+  gpointer key = GINT_TO_POINTER (source->ssrc);
+
+  if (source->closing) {
+    if (g_hash_table_lookup (ssrcs, key) == source)
+      g_hash_table_remove (ssrcs, key);
+    return;
+  }
 
   if (source->send_fir)
     data->have_fir = TRUE;
@@ -3518,8 +3558,28 @@ remove_closing_sources (const gchar * key, RTPSource * source,
     data->have_pli = TRUE;
   if (source->send_nack)
     data->have_nack = TRUE;
+}
+
+/* loop over the known sources and add report blocks until the packet is
+ * full, the sources that don't fit are reported in the next packet */
+static void
+session_add_report_blocks (RTPSession * sess, ReportData * data)
+{
+  guint i;
+
+  for (i = 0; i < data->sources->len; i++) {
+    RTPSource *source = g_ptr_array_index (data->sources, i);
+
+    if (source->closing)
+      continue;
+
+    session_report_blocks (NULL, source, data);
 
-  return FALSE;
+    if (gst_rtcp_packet_get_rb_count (&data->packet) == GST_RTCP_MAX_RB_COUNT)
+      break;
+
+    session_yield (sess, i + 1);
+  }
 }
 
 static void
@@ -3534,7 +3594,7 @@ generate_rtcp (const gchar * key, RTPSource * source, ReportData * data)
     return;
 
   /* ignore other sources when we do the timeout after a scheduled BYE */
-  if (sess->scheduled_bye && !source->marked_bye)
+  if (data->scheduled_bye && !source->marked_bye)
     return;
 
   data->source = source;
@@ -3542,15 +3602,14 @@ generate_rtcp (const gchar * key, RTPSource * source, ReportData * data)
   /* open packet */
   session_start_rtcp (sess, data);
 
-  if (source->marked_bye) {
+  if (data->scheduled_bye && source->marked_bye) {
     /* send BYE */
     make_source_bye (sess, source, data);
     is_bye = TRUE;
   } else if (!data->is_early) {
-    /* loop over all known sources and add report blocks. If we are early, we
-     * just make a minimal RTCP packet and skip this step */
-    g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-        (GHFunc) session_report_blocks, data);
+    /* add report blocks for the known sources. If we are early, we just make
+     * a minimal RTCP packet and skip this step */
+    session_add_report_blocks (sess, data);
   }
   if (!data->has_sdes)
     session_sdes (sess, data);
@@ -3622,8 +3681,9 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
 {
   GstFlowReturn result = GST_FLOW_OK;
   ReportData data = { GST_RTCP_BUFFER_INIT };
-  GHashTable *table_copy;
+  GstClockTime early_rtcp_time;
   ReportOutput *output;
+  guint i;
 
   g_return_val_if_fail (RTP_IS_SESSION (sess), GST_FLOW_ERROR);
 
@@ -3658,25 +3718,32 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
   sess->conflicting_addresses =
       timeout_conflicting_addresses (sess->conflicting_addresses, current_time);
 
-  /* Make a local copy of the hashtable. We need to do this because the
-   * cleanup stage below releases the session lock. */
-  table_copy = g_hash_table_new_full (NULL, NULL, NULL,
-      (GDestroyNotify) g_object_unref);
+  /* Make a snapshot of the sources. We need to do this because the stages
+   * below release the session lock, we handle the sources in batches so that
+   * the RTP processing is not blocked for too long when there are many
+   * sources. */
+  data.sources = g_ptr_array_new_with_free_func (g_object_unref);
   g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-      (GHFunc) clone_ssrcs_hashtable, table_copy);
+      (GHFunc) add_source_to_array, data.sources);
 
-  /* Clean up the session, mark the source for removing, this might release the
-   * session lock. */
-  g_hash_table_foreach (table_copy, (GHFunc) session_cleanup, &data);
-  g_hash_table_destroy (table_copy);
+  /* Clean up the session, mark the sources for removing and remove them, this
+   * might release the session lock. */
+  for (i = 0; i < data.sources->len; i++) {
+    RTPSource *source = g_ptr_array_index (data.sources, i);
 
-  /* Now remove the marked sources */
-  g_hash_table_foreach_remove (sess->ssrcs[sess->mask_idx],
-      (GHRFunc) remove_closing_sources, &data);
+    session_cleanup (NULL, source, &data);
+    remove_closing_source (sess, source, &data);
+    session_yield (sess, i + 1);
+  }
 
   /* update point-to-point status */
   session_update_ptp (sess);
 
+  /* the lock is released while adding report blocks, take the BYE request
+   * now so that all sources of this round see the same one. A BYE scheduled
+   * in the meantime is sent in the next round. */
+  data.scheduled_bye = sess->scheduled_bye;
+
   /* see if we need to generate SR or RR packets */
   if (!is_rtcp_time (sess, current_time, &data))
     goto done;
@@ -3684,23 +3751,37 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
   GST_DEBUG ("doing RTCP generation %u for %u sources, early %d",
       sess->generation, data.num_to_report, data.is_early);
 
+  /* only reset the early RTCP request we are handling now */
+  early_rtcp_time = sess->next_early_rtcp_time;
+
   /* generate RTCP for all internal sources */
-  g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-      (GHFunc) generate_rtcp, &data);
+  for (i = 0; i < data.sources->len; i++) {
+    RTPSource *source = g_ptr_array_index (data.sources, i);
+
+    if (!source->closing)
+      generate_rtcp (NULL, source, &data);
+  }
 
   /* update the generation for all the sources that have been reported */
-  g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-      (GHFunc) update_generation, &data);
+  for (i = 0; i < data.sources->len; i++) {
+    RTPSource *source = g_ptr_array_index (data.sources, i);
+
+    if (!source->closing)
+      update_generation (NULL, source, &data);
+  }
 
   /* we keep track of the last report time in order to timeout inactive
    * receivers or senders */
   if (!data.is_early && !data.may_suppress)
     sess->last_rtcp_send_time = data.current_time;
   sess->first_rtcp = FALSE;
-  sess->next_early_rtcp_time = GST_CLOCK_TIME_NONE;
-  sess->scheduled_bye = FALSE;
+  if (sess->next_early_rtcp_time == early_rtcp_time)
+    sess->next_early_rtcp_time = GST_CLOCK_TIME_NONE;
+  if (data.scheduled_bye)
+    sess->scheduled_bye = FALSE;
 
 done:
+  g_ptr_array_free (data.sources, TRUE);
   RTP_SESSION_UNLOCK (sess);
 
   /* push out the RTCP packets */
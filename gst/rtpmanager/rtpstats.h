@@ -71,8 +71,13 @@ typedef struct {
  * @seqnum: the seqnum of the packet
  * @pt: the payload type of the packet
  * @rtptime: the RTP time of the packet
+ * @marker: the marker bit of the packet
+ * @payload_offset: offset of the payload in the packet
+ * @ext_offset: offset of the header extension data or 0 when there is none
+ * @ext_len: bytes of the header extension data
  *
- * Structure holding information about the packet.
+ * Structure holding information about the packet. The RTP header is parsed
+ * only once when the packet enters the session.
  */
 typedef struct {
   gboolean      send;
@@ -91,6 +96,10 @@ typedef struct {
   guint16       seqnum;
   guint8        pt;
   guint32       rtptime;
+  gboolean      marker;
+  guint         payload_offset;
+  guint         ext_offset;
+  guint         ext_len;
   guint32       csrc_count;
   guint32       csrcs[16];
 } RTPPacketInfo;
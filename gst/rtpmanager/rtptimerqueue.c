@@ -0,0 +1,544 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <string.h>
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "rtptimerqueue.h"
+
+/* The timers are kept in two binary min-heaps ordered by timeout, one for the
+ * EXPECTED timers and one for all other timers, because they have their
+ * timeouts expressed in different time bases. Immediate timers (with a -1
+ * timeout) sort before everything else and ties are broken by taking the
+ * oldest seqnum first.
+ *
+ * A third heap keeps the EXPECTED timers that did not request a
+ * retransmission yet, ordered by seqnum, so that the timers for packets that
+ * are reordered too much can be found without looking at all timers.
+ *
+ * Finally, a hashtable maps a seqnum to a chain of timers with that seqnum.
+ *
+ * Removed timers are kept on a bounded free-list for reuse.
+ */
+#define MAX_FREE_TIMERS  64
+
+typedef gint (*RTPTimerCompareFunc) (RTPTimer * a, RTPTimer * b);
+
+typedef struct
+{
+  GPtrArray *timers;
+  RTPTimerCompareFunc compare;
+  glong idx_offset;
+} RTPTimerHeap;
+
+struct _RTPTimerQueue
+{
+  RTPTimerHeap expected;
+  RTPTimerHeap output;
+  RTPTimerHeap reorder;
+  GHashTable *seqnums;
+
+  RTPTimer *free_timers;
+  guint num_free_timers;
+  guint64 num_allocs;
+};
+
+#define HEAP_IDX(heap,timer)  G_STRUCT_MEMBER (gint, (timer), (heap)->idx_offset)
+#define HEAP_TIMER(heap,i)    ((RTPTimer *) g_ptr_array_index ((heap)->timers, (i)))
+
+/* the timer that should fire first sorts first */
+static gint
+compare_timeout (RTPTimer * a, RTPTimer * b)
+{
+  if (a->timeout != b->timeout) {
+    if (a->timeout == -1)
+      return -1;
+    if (b->timeout == -1)
+      return 1;
+    return a->timeout < b->timeout ? -1 : 1;
+  }
+  /* same timeout, smaller seqnum first */
+  return -gst_rtp_buffer_compare_seqnum (a->seqnum, b->seqnum);
+}
+
+/* the oldest seqnum sorts first */
+static gint
+compare_seqnum (RTPTimer * a, RTPTimer * b)
+{
+  return -gst_rtp_buffer_compare_seqnum (a->seqnum, b->seqnum);
+}
+
+static void
+heap_init (RTPTimerHeap * heap, RTPTimerCompareFunc compare, glong idx_offset)
+{
+  heap->timers = g_ptr_array_new ();
+  heap->compare = compare;
+  heap->idx_offset = idx_offset;
+}
+
+static inline void
+heap_set (RTPTimerHeap * heap, gint i, RTPTimer * timer)
+{
+  g_ptr_array_index (heap->timers, i) = timer;
+  HEAP_IDX (heap, timer) = i;
+}
+
+static void
+heap_sift_up (RTPTimerHeap * heap, gint i)
+{
+  RTPTimer *timer = HEAP_TIMER (heap, i);
+
+  while (i > 0) {
+    gint parent = (i - 1) / 2;
+    RTPTimer *ptimer = HEAP_TIMER (heap, parent);
+
+    if (heap->compare (timer, ptimer) >= 0)
+      break;
+
+    heap_set (heap, i, ptimer);
+    i = parent;
+  }
+  heap_set (heap, i, timer);
+}
+
+static void
+heap_sift_down (RTPTimerHeap * heap, gint i)
+{
+  RTPTimer *timer = HEAP_TIMER (heap, i);
+  gint len = heap->timers->len;
+
+  while (TRUE) {
+    gint child = 2 * i + 1;
+    RTPTimer *ctimer;
+
+    if (child >= len)
+      break;
+
+    ctimer = HEAP_TIMER (heap, child);
+    if (child + 1 < len
+        && heap->compare (HEAP_TIMER (heap, child + 1), ctimer) < 0)
+      ctimer = HEAP_TIMER (heap, ++child);
+
+    if (heap->compare (ctimer, timer) >= 0)
+      break;
+
+    heap_set (heap, i, ctimer);
+    i = child;
+  }
+  heap_set (heap, i, timer);
+}
+
+static void
+heap_fix (RTPTimerHeap * heap, gint i)
+{
+  if (i > 0 && heap->compare (HEAP_TIMER (heap, i),
+          HEAP_TIMER (heap, (i - 1) / 2)) < 0)
+    heap_sift_up (heap, i);
+  else
+    heap_sift_down (heap, i);
+}
+
+static void
+heap_insert (RTPTimerHeap * heap, RTPTimer * timer)
+{
+  g_ptr_array_add (heap->timers, timer);
+  heap_sift_up (heap, heap->timers->len - 1);
+}
+
+static void
+heap_remove (RTPTimerHeap * heap, RTPTimer * timer)
+{
+  gint i = HEAP_IDX (heap, timer);
+  RTPTimer *last;
+
+  last = g_ptr_array_remove_index (heap->timers, heap->timers->len - 1);
+  if (last != timer) {
+    heap_set (heap, i, last);
+    heap_fix (heap, i);
+  }
+  HEAP_IDX (heap, timer) = -1;
+}
+
+static inline RTPTimer *
+heap_peek (RTPTimerHeap * heap)
+{
+  if (heap->timers->len == 0)
+    return NULL;
+
+  return HEAP_TIMER (heap, 0);
+}
+
+static inline RTPTimerHeap *
+timeout_heap (RTPTimerQueue * queue, RTPTimer * timer)
+{
+  return timer->type == RTP_TIMER_EXPECTED ? &queue->expected : &queue->output;
+}
+
+static inline gboolean
+is_reorder (RTPTimer * timer)
+{
+  return timer->type == RTP_TIMER_EXPECTED && timer->num_rtx_retry == 0
+      && timer->timeout != -1;
+}
+
+static void
+link_seqnum (RTPTimerQueue * queue, RTPTimer * timer)
+{
+  gpointer key = GUINT_TO_POINTER (timer->seqnum);
+
+  timer->key = timer->seqnum;
+  timer->next = g_hash_table_lookup (queue->seqnums, key);
+  g_hash_table_insert (queue->seqnums, key, timer);
+}
+
+static void
+unlink_seqnum (RTPTimerQueue * queue, RTPTimer * timer)
+{
+  gpointer key = GUINT_TO_POINTER (timer->key);
+  RTPTimer *head, **walk;
+
+  head = g_hash_table_lookup (queue->seqnums, key);
+  for (walk = &head; *walk; walk = &(*walk)->next) {
+    if (*walk == timer) {
+      *walk = timer->next;
+      break;
+    }
+  }
+  if (head)
+    g_hash_table_insert (queue->seqnums, key, head);
+  else
+    g_hash_table_remove (queue->seqnums, key);
+
+  timer->next = NULL;
+}
+
+static void
+release_timer (RTPTimerQueue * queue, RTPTimer * timer)
+{
+  if (queue->num_free_timers < MAX_FREE_TIMERS) {
+    timer->next = queue->free_timers;
+    queue->free_timers = timer;
+    queue->num_free_timers++;
+  } else {
+    rtp_timer_free (timer);
+  }
+}
+
+/**
+ * rtp_timer_new:
+ *
+ * Allocate a new #RTPTimer with all fields cleared.
+ *
+ * Returns: a new #RTPTimer.
+ */
+RTPTimer *
+rtp_timer_new (void)
+{
+  RTPTimer *timer;
+
+  timer = g_slice_new0 (RTPTimer);
+  timer->idx = -1;
+  timer->reorder_idx = -1;
+
+  return timer;
+}
+
+/**
+ * rtp_timer_free:
+ * @timer: a #RTPTimer
+ *
+ * Free @timer. @timer should not be in a queue.
+ */
+void
+rtp_timer_free (RTPTimer * timer)
+{
+  g_slice_free (RTPTimer, timer);
+}
+
+/**
+ * rtp_timer_queue_new:
+ *
+ * Create a new, empty #RTPTimerQueue.
+ *
+ * Returns: a new #RTPTimerQueue. Free with rtp_timer_queue_free().
+ */
+RTPTimerQueue *
+rtp_timer_queue_new (void)
+{
+  RTPTimerQueue *queue;
+
+  queue = g_slice_new0 (RTPTimerQueue);
+  heap_init (&queue->expected, compare_timeout, G_STRUCT_OFFSET (RTPTimer,
+          idx));
+  heap_init (&queue->output, compare_timeout, G_STRUCT_OFFSET (RTPTimer, idx));
+  heap_init (&queue->reorder, compare_seqnum, G_STRUCT_OFFSET (RTPTimer,
+          reorder_idx));
+  queue->seqnums = g_hash_table_new (NULL, NULL);
+
+  return queue;
+}
+
+/**
+ * rtp_timer_queue_free:
+ * @queue: a #RTPTimerQueue
+ *
+ * Free @queue and all the timers in it.
+ */
+void
+rtp_timer_queue_free (RTPTimerQueue * queue)
+{
+  RTPTimer *timer;
+
+  rtp_timer_queue_clear (queue);
+
+  while ((timer = queue->free_timers)) {
+    queue->free_timers = timer->next;
+    rtp_timer_free (timer);
+  }
+
+  g_ptr_array_free (queue->expected.timers, TRUE);
+  g_ptr_array_free (queue->output.timers, TRUE);
+  g_ptr_array_free (queue->reorder.timers, TRUE);
+  g_hash_table_destroy (queue->seqnums);
+  g_slice_free (RTPTimerQueue, queue);
+}
+
+/**
+ * rtp_timer_queue_alloc:
+ * @queue: a #RTPTimerQueue
+ *
+ * Get a timer with all fields cleared, like rtp_timer_new(), reusing a timer
+ * that was previously removed from @queue when possible.
+ *
+ * Returns: a #RTPTimer to insert in @queue.
+ */
+RTPTimer *
+rtp_timer_queue_alloc (RTPTimerQueue * queue)
+{
+  RTPTimer *timer;
+
+  if ((timer = queue->free_timers)) {
+    queue->free_timers = timer->next;
+    queue->num_free_timers--;
+    memset (timer, 0, sizeof (RTPTimer));
+    timer->idx = -1;
+    timer->reorder_idx = -1;
+  } else {
+    timer = rtp_timer_new ();
+    queue->num_allocs++;
+  }
+  return timer;
+}
+
+/**
+ * rtp_timer_queue_get_num_allocs:
+ * @queue: a #RTPTimerQueue
+ *
+ * Returns: the number of timers that rtp_timer_queue_alloc() could not take
+ * from the free-list and had to allocate.
+ */
+guint64
+rtp_timer_queue_get_num_allocs (RTPTimerQueue * queue)
+{
+  return queue->num_allocs;
+}
+
+/**
+ * rtp_timer_queue_insert:
+ * @queue: a #RTPTimerQueue
+ * @timer: (transfer full): a #RTPTimer
+ *
+ * Insert @timer in @queue. This function takes ownership of @timer.
+ */
+void
+rtp_timer_queue_insert (RTPTimerQueue * queue, RTPTimer * timer)
+{
+  g_return_if_fail (timer->heap == NULL);
+
+  timer->heap = timeout_heap (queue, timer);
+  heap_insert (timer->heap, timer);
+  if (is_reorder (timer))
+    heap_insert (&queue->reorder, timer);
+  link_seqnum (queue, timer);
+}
+
+/**
+ * rtp_timer_queue_update:
+ * @queue: a #RTPTimerQueue
+ * @timer: a #RTPTimer in @queue
+ *
+ * Restore the position of @timer in @queue after its seqnum, type, timeout
+ * or number of retries changed.
+ */
+void
+rtp_timer_queue_update (RTPTimerQueue * queue, RTPTimer * timer)
+{
+  RTPTimerHeap *heap;
+
+  heap = timeout_heap (queue, timer);
+  if (timer->heap != heap) {
+    heap_remove (timer->heap, timer);
+    timer->heap = heap;
+    heap_insert (heap, timer);
+  } else {
+    heap_fix (heap, timer->idx);
+  }
+
+  if (is_reorder (timer)) {
+    if (timer->reorder_idx == -1)
+      heap_insert (&queue->reorder, timer);
+    else
+      heap_fix (&queue->reorder, timer->reorder_idx);
+  } else if (timer->reorder_idx != -1) {
+    heap_remove (&queue->reorder, timer);
+  }
+
+  if (timer->key != timer->seqnum) {
+    unlink_seqnum (queue, timer);
+    link_seqnum (queue, timer);
+  }
+}
+
+/**
+ * rtp_timer_queue_remove:
+ * @queue: a #RTPTimerQueue
+ * @timer: a #RTPTimer in @queue
+ *
+ * Remove @timer from @queue and free it or keep it for reuse.
+ */
+void
+rtp_timer_queue_remove (RTPTimerQueue * queue, RTPTimer * timer)
+{
+  g_return_if_fail (timer->heap != NULL);
+
+  heap_remove (timer->heap, timer);
+  if (timer->reorder_idx != -1)
+    heap_remove (&queue->reorder, timer);
+  unlink_seqnum (queue, timer);
+
+  release_timer (queue, timer);
+}
+
+/**
+ * rtp_timer_queue_clear:
+ * @queue: a #RTPTimerQueue
+ *
+ * Remove all timers from @queue.
+ */
+void
+rtp_timer_queue_clear (RTPTimerQueue * queue)
+{
+  guint i;
+
+  for (i = 0; i < queue->expected.timers->len; i++)
+    release_timer (queue, HEAP_TIMER (&queue->expected, i));
+  for (i = 0; i < queue->output.timers->len; i++)
+    release_timer (queue, HEAP_TIMER (&queue->output, i));
+
+  g_ptr_array_set_size (queue->expected.timers, 0);
+  g_ptr_array_set_size (queue->output.timers, 0);
+  g_ptr_array_set_size (queue->reorder.timers, 0);
+  g_hash_table_remove_all (queue->seqnums);
+}
+
+/**
+ * rtp_timer_queue_length:
+ * @queue: a #RTPTimerQueue
+ *
+ * Returns: the number of timers in @queue.
+ */
+guint
+rtp_timer_queue_length (RTPTimerQueue * queue)
+{
+  return queue->expected.timers->len + queue->output.timers->len;
+}
+
+/**
+ * rtp_timer_queue_find:
+ * @queue: a #RTPTimerQueue
+ * @type: a #RTPTimerType
+ * @seqnum: a seqnum
+ *
+ * Find the timer of @type for @seqnum.
+ *
+ * Returns: the #RTPTimer or %NULL when there is no such timer.
+ */
+RTPTimer *
+rtp_timer_queue_find (RTPTimerQueue * queue, RTPTimerType type, guint16 seqnum)
+{
+  RTPTimer *timer;
+
+  timer = g_hash_table_lookup (queue->seqnums, GUINT_TO_POINTER (seqnum));
+  while (timer && timer->type != type)
+    timer = timer->next;
+
+  return timer;
+}
+
+/**
+ * rtp_timer_queue_find_seqnum:
+ * @queue: a #RTPTimerQueue
+ * @seqnum: a seqnum
+ *
+ * Find a timer of any type for @seqnum.
+ *
+ * Returns: the #RTPTimer or %NULL when there is no timer for @seqnum.
+ */
+RTPTimer *
+rtp_timer_queue_find_seqnum (RTPTimerQueue * queue, guint16 seqnum)
+{
+  return g_hash_table_lookup (queue->seqnums, GUINT_TO_POINTER (seqnum));
+}
+
+/**
+ * rtp_timer_queue_peek_expected:
+ * @queue: a #RTPTimerQueue
+ *
+ * Returns: the %RTP_TIMER_EXPECTED timer that expires first or %NULL.
+ */
+RTPTimer *
+rtp_timer_queue_peek_expected (RTPTimerQueue * queue)
+{
+  return heap_peek (&queue->expected);
+}
+
+/**
+ * rtp_timer_queue_peek_output:
+ * @queue: a #RTPTimerQueue
+ *
+ * Returns: the timer that is not an %RTP_TIMER_EXPECTED timer and that
+ * expires first or %NULL.
+ */
+RTPTimer *
+rtp_timer_queue_peek_output (RTPTimerQueue * queue)
+{
+  return heap_peek (&queue->output);
+}
+
+/**
+ * rtp_timer_queue_peek_reorder:
+ * @queue: a #RTPTimerQueue
+ *
+ * Returns: the %RTP_TIMER_EXPECTED timer with the oldest seqnum that has a
+ * timeout and did not make any retransmission requests yet, or %NULL.
+ */
+RTPTimer *
+rtp_timer_queue_peek_reorder (RTPTimerQueue * queue)
+{
+  return heap_peek (&queue->reorder);
+}
@@ -0,0 +1,108 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RTP_TIMER_QUEUE_H__
+#define __RTP_TIMER_QUEUE_H__
+
+#include <gst/gst.h>
+
+typedef struct _RTPTimer RTPTimer;
+typedef struct _RTPTimerQueue RTPTimerQueue;
+
+/**
+ * RTPTimerType:
+ * @RTP_TIMER_EXPECTED: a packet is expected at the timeout
+ * @RTP_TIMER_LOST: a packet is considered lost at the timeout
+ * @RTP_TIMER_DEADLINE: the deadline for the first packet
+ * @RTP_TIMER_EOS: the time when EOS is expected
+ *
+ * The different kinds of timers. The timeout of an %RTP_TIMER_EXPECTED
+ * timer is expressed in input running time, all other timers are expressed
+ * in RTP time and need the offset and latency applied to them.
+ */
+typedef enum
+{
+  RTP_TIMER_EXPECTED,
+  RTP_TIMER_LOST,
+  RTP_TIMER_DEADLINE,
+  RTP_TIMER_EOS
+} RTPTimerType;
+
+/**
+ * RTPTimer:
+ * @seqnum: the seqnum of the timer
+ * @num: the number of packets covered by a lost timer
+ * @type: the #RTPTimerType
+ * @timeout: the timeout or -1 when the timer should fire immediately
+ * @duration: the duration of the packet(s)
+ * @rtx_base: the base time for retransmission requests
+ * @rtx_delay: the delay of the first retransmission request
+ * @rtx_retry: the accumulated delay of the retries
+ * @rtx_last: the time of the last retransmission request
+ * @num_rtx_retry: the number of retransmission requests made
+ *
+ * A timer in an #RTPTimerQueue. After changing @seqnum, @type, @timeout or
+ * @num_rtx_retry of a queued timer, rtp_timer_queue_update() must be called
+ * to restore the ordering of the queue.
+ */
+struct _RTPTimer
+{
+  guint16 seqnum;
+  guint num;
+  RTPTimerType type;
+  GstClockTime timeout;
+  GstClockTime duration;
+  GstClockTime rtx_base;
+  GstClockTime rtx_delay;
+  GstClockTime rtx_retry;
+  GstClockTime rtx_last;
+  guint num_rtx_retry;
+
+  /*< private >*/
+  gpointer heap;
+  gint idx;
+  gint reorder_idx;
+  guint16 key;
+  RTPTimer *next;
+};
+
+RTPTimer *        rtp_timer_new                  (void);
+void              rtp_timer_free                 (RTPTimer *timer);
+
+RTPTimerQueue *   rtp_timer_queue_new            (void);
+void              rtp_timer_queue_free           (RTPTimerQueue *queue);
+
+RTPTimer *        rtp_timer_queue_alloc          (RTPTimerQueue *queue);
+guint64           rtp_timer_queue_get_num_allocs (RTPTimerQueue *queue);
+
+void              rtp_timer_queue_insert         (RTPTimerQueue *queue, RTPTimer *timer);
+void              rtp_timer_queue_update         (RTPTimerQueue *queue, RTPTimer *timer);
+void              rtp_timer_queue_remove         (RTPTimerQueue *queue, RTPTimer *timer);
+void              rtp_timer_queue_clear          (RTPTimerQueue *queue);
+
+guint             rtp_timer_queue_length         (RTPTimerQueue *queue);
+
+RTPTimer *        rtp_timer_queue_find           (RTPTimerQueue *queue, RTPTimerType type,
+                                                  guint16 seqnum);
+RTPTimer *        rtp_timer_queue_find_seqnum    (RTPTimerQueue *queue, guint16 seqnum);
+
+RTPTimer *        rtp_timer_queue_peek_expected  (RTPTimerQueue *queue);
+RTPTimer *        rtp_timer_queue_peek_output    (RTPTimerQueue *queue);
+RTPTimer *        rtp_timer_queue_peek_reorder   (RTPTimerQueue *queue);
+
+#endif /* __RTP_TIMER_QUEUE_H__ */
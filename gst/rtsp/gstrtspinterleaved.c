@@ -0,0 +1,196 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "gstrtspinterleaved.h"
+
+GST_DEBUG_CATEGORY_STATIC (rtspinterleaved_debug);
+#define GST_CAT_DEFAULT (rtspinterleaved_debug)
+
+/* how much interleaved data to look at once */
+#define PEEK_SIZE (64 * 1024)
+
+/**
+ * gst_rtsp_interleaved_reader_init:
+ * @reader: a #GstRTSPInterleavedReader
+ *
+ * Initialize @reader.
+ */
+void
+gst_rtsp_interleaved_reader_init (GstRTSPInterleavedReader * reader)
+{
+  GST_DEBUG_CATEGORY_INIT (rtspinterleaved_debug, "rtspinterleaved", 0,
+      "RTSP interleaved data");
+
+  memset (reader, 0, sizeof (GstRTSPInterleavedReader));
+}
+
+/**
+ * gst_rtsp_interleaved_reader_clear:
+ * @reader: a #GstRTSPInterleavedReader
+ *
+ * Free all the resources of @reader.
+ */
+void
+gst_rtsp_interleaved_reader_clear (GstRTSPInterleavedReader * reader)
+{
+  g_free (reader->peek);
+  reader->peek = NULL;
+}
+
+static GstRTSPResult
+error_to_result (GError * err)
+{
+  GstRTSPResult res;
+
+  if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    res = GST_RTSP_EINTR;
+  } else if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_TIMED_OUT)) {
+    res = GST_RTSP_ETIMEOUT;
+  } else {
+    GST_WARNING ("error reading data: %s", err->message);
+    res = GST_RTSP_ESYS;
+  }
+  g_error_free (err);
+
+  return res;
+}
+
+static GstRTSPResult
+wait_data (GSocket * socket, gint64 timeout, GCancellable * cancellable)
+{
+  GError *err = NULL;
+
+  if (!g_socket_condition_timed_wait (socket, G_IO_IN, timeout, cancellable,
+          &err))
+    return error_to_result (err);
+
+  return GST_RTSP_OK;
+}
+
+/* read @size bytes into @data. The bytes were peeked already, so they are
+ * queued on @socket and the read is not cancellable: a flush must not leave
+ * half a frame behind for the connection. */
+static GstRTSPResult
+read_data (GSocket * socket, guint8 * data, gsize size)
+{
+  GError *err = NULL;
+  gsize done = 0;
+  gssize len;
+
+  while (done < size) {
+    len = g_socket_receive_with_blocking (socket, (gchar *) data + done,
+        size - done, TRUE, NULL, &err);
+    if (len < 0)
+      return error_to_result (err);
+    if (len == 0)
+      return GST_RTSP_EEOF;
+
+    done += len;
+  }
+  return GST_RTSP_OK;
+}
+
+/**
+ * gst_rtsp_interleaved_reader_read:
+ * @reader: a #GstRTSPInterleavedReader
+ * @socket: the socket to read from
+ * @timeout: the timeout of the wait for data in microseconds or -1
+ * @cancellable: a #GCancellable to interrupt the wait
+ * @is_data: set to %FALSE when the next message on @socket has to be read
+ *     with the connection
+ * @frames: the complete frames that were read
+ *
+ * Read all complete interleaved frames that are available on @socket, with
+ * their headers, into one memory. Only frames that were seen completely
+ * with a peek are read, so the read never stops in the middle of a frame.
+ * Data that is not interleaved and a first frame that is not complete yet
+ * are left on @socket for the connection.
+ *
+ * Returns: #GST_RTSP_OK on success. @frames can be %NULL when @is_data is
+ * %TRUE but nothing could be read yet.
+ */
+GstRTSPResult
+gst_rtsp_interleaved_reader_read (GstRTSPInterleavedReader * reader,
+    GSocket * socket, gint64 timeout, GCancellable * cancellable,
+    gboolean * is_data, GstBuffer ** frames)
+{
+  GstRTSPResult res;
+  GstMemory *mem;
+  GstMapInfo map;
+  GInputVector vec;
+  GError *err = NULL;
+  gint flags = G_SOCKET_MSG_PEEK;
+  gssize avail;
+  gsize total, len;
+
+  *is_data = FALSE;
+  *frames = NULL;
+
+  if ((res = wait_data (socket, timeout, cancellable)) != GST_RTSP_OK)
+    return res;
+
+  /* look at what we have without taking it from the socket */
+  if (reader->peek == NULL)
+    reader->peek = g_malloc (PEEK_SIZE);
+  vec.buffer = reader->peek;
+  vec.size = PEEK_SIZE;
+  avail = g_socket_receive_message (socket, NULL, &vec, 1, NULL, NULL,
+      &flags, cancellable, &err);
+  if (avail < 0) {
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+      g_clear_error (&err);
+      /* nothing yet, try again */
+      *is_data = TRUE;
+      return GST_RTSP_OK;
+    }
+    return error_to_result (err);
+  }
+  if (avail == 0)
+    return GST_RTSP_EEOF;
+
+  /* the size of the complete frames */
+  total = 0;
+  while (total + 4 <= avail && reader->peek[total] == '$') {
+    len = 4 + GST_READ_UINT16_BE (reader->peek + total + 2);
+    if (total + len > avail)
+      break;
+    total += len;
+  }
+  if (total == 0) {
+    GST_LOG ("no complete frame in %" G_GSSIZE_FORMAT " bytes", avail);
+    return GST_RTSP_OK;
+  }
+
+  *is_data = TRUE;
+
+  mem = gst_allocator_alloc (NULL, total, NULL);
+  gst_memory_map (mem, &map, GST_MAP_WRITE);
+  res = read_data (socket, map.data, total);
+  gst_memory_unmap (mem, &map);
+  if (res != GST_RTSP_OK) {
+    gst_memory_unref (mem);
+    return res;
+  }
+
+  *frames = gst_buffer_new ();
+  gst_buffer_append_memory (*frames, mem);
+
+  return GST_RTSP_OK;
+}
@@ -0,0 +1,52 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_RTSP_INTERLEAVED_H__
+#define __GST_RTSP_INTERLEAVED_H__
+
+#include <gst/gst.h>
+#include <gio/gio.h>
+#include <gst/rtsp/gstrtspdefs.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstRTSPInterleavedReader GstRTSPInterleavedReader;
+
+/**
+ * GstRTSPInterleavedReader:
+ *
+ * Reads complete $-framed interleaved data directly from a socket. It never
+ * takes part of a frame from the socket, so whatever it leaves can be read
+ * with the connection.
+ */
+struct _GstRTSPInterleavedReader
+{
+  guint8 *peek;
+};
+
+void          gst_rtsp_interleaved_reader_init  (GstRTSPInterleavedReader *reader);
+void          gst_rtsp_interleaved_reader_clear (GstRTSPInterleavedReader *reader);
+
+GstRTSPResult gst_rtsp_interleaved_reader_read  (GstRTSPInterleavedReader *reader,
+                                                 GSocket *socket, gint64 timeout,
+                                                 GCancellable *cancellable,
+                                                 gboolean *is_data, GstBuffer **frames);
+
+G_END_DECLS
+
+#endif /* __GST_RTSP_INTERLEAVED_H__ */
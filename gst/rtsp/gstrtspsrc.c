@@ -706,6 +706,8 @@ static void
 gst_rtspsrc_init (GstRTSPSrc * src)
 {
   src->conninfo.location = g_strdup (DEFAULT_LOCATION);
+  src->data_cancellable = g_cancellable_new ();
+  gst_rtsp_interleaved_reader_init (&src->data_reader);
   src->protocols = DEFAULT_PROTOCOLS;
   src->debug = DEFAULT_DEBUG;
   src->retry = DEFAULT_RETRY;
@@ -782,6 +784,9 @@ gst_rtspsrc_finalize (GObject * object)
   if (rtspsrc->tls_database)
     g_object_unref (rtspsrc->tls_database);
 
+  g_object_unref (rtspsrc->data_cancellable);
+  gst_rtsp_interleaved_reader_clear (&rtspsrc->data_reader);
+
   /* free locks */
   g_rec_mutex_clear (&rtspsrc->stream_rec_lock);
   g_rec_mutex_clear (&rtspsrc->state_rec_lock);
@@ -4163,6 +4168,10 @@ gst_rtspsrc_connection_flush (GstRTSPSrc * src, gboolean flush)
   if (src->conninfo.connection && src->conninfo.flushing != flush) {
     GST_DEBUG_OBJECT (src, "connection flush");
     gst_rtsp_connection_flush (src->conninfo.connection, flush);
+    if (flush)
+      g_cancellable_cancel (src->data_cancellable);
+    else
+      g_cancellable_reset (src->data_cancellable);
     src->conninfo.flushing = flush;
   }
   for (walk = src->streams; walk; walk = g_list_next (walk)) {
@@ -4288,70 +4297,40 @@ send_error:
   }
 }
 
-static GstFlowReturn
-gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
+/* get the pad for the data of @channel in @stream */
+static GstPad *
+gst_rtspsrc_get_data_pad (GstRTSPStream * stream, gint channel,
+    const guint8 * data, gboolean * is_rtcp)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-  gint channel;
-  GstRTSPStream *stream;
   GstPad *outpad = NULL;
-  guint8 *data;
-  guint size;
-  GstBuffer *buf;
-  gboolean is_rtcp;
-  GstEvent *event;
-
-  channel = message->type_data.data.channel;
-
-  stream = find_stream (src, &channel, (gpointer) find_stream_by_channel);
-  if (!stream)
-    goto unknown_stream;
 
   if (channel == stream->channel[0]) {
     outpad = stream->channelpad[0];
-    is_rtcp = FALSE;
+    *is_rtcp = FALSE;
   } else if (channel == stream->channel[1]) {
     outpad = stream->channelpad[1];
-    is_rtcp = TRUE;
+    *is_rtcp = TRUE;
   } else {
-    is_rtcp = FALSE;
+    *is_rtcp = FALSE;
   }
 
-  /* take a look at the body to figure out what we have */
-  gst_rtsp_message_get_body (message, &data, &size);
-  if (size < 2)
-    goto invalid_length;
-
   /* channels are not correct on some servers, do extra check */
   if (data[1] >= 200 && data[1] <= 204) {
     /* hmm RTCP message switch to the RTCP pad of the same stream. */
     outpad = stream->channelpad[1];
-    is_rtcp = TRUE;
+    *is_rtcp = TRUE;
   }
+  return outpad;
+}
 
-  /* we have no clue what this is, just ignore then. */
-  if (outpad == NULL)
-    goto unknown_stream;
-
-  /* take the message body for further processing */
-  gst_rtsp_message_steal_body (message, &data, &size);
-
-  /* strip the trailing \0 */
-  size -= 1;
-
-  buf = gst_buffer_new ();
-  gst_buffer_append_memory (buf,
-      gst_memory_new_wrapped (0, data, size, 0, size, data, g_free));
-
-  /* don't need message anymore */
-  gst_rtsp_message_unset (message);
-
-  GST_DEBUG_OBJECT (src, "pushing data of size %d on channel %d", size,
-      channel);
+/* activate the streams and take the base time before pushing the first data */
+static void
+gst_rtspsrc_prepare_data (GstRTSPSrc * src)
+{
+  GstEvent *event;
 
   if (src->need_activate) {
     gchar *stream_id;
-    GstEvent *event;
     GChecksum *cs;
     gchar *uri;
     GList *streams;
@@ -4406,7 +4385,12 @@ gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
     }
     GST_OBJECT_UNLOCK (src);
   }
+}
 
+static void
+gst_rtspsrc_handle_discont (GstRTSPSrc * src, GstRTSPStream * stream,
+    gboolean is_rtcp, GstBuffer * buf)
+{
   if (stream->discont && !is_rtcp) {
     /* mark first RTP buffer as discont */
     GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
@@ -4418,18 +4402,83 @@ gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
 
     GST_BUFFER_TIMESTAMP (buf) = src->base_time;
   }
+}
+
+/* push @buf or @list to @outpad */
+static GstFlowReturn
+gst_rtspsrc_push_data (GstRTSPSrc * src, GstRTSPStream * stream,
+    GstPad * outpad, gboolean is_rtcp, GstBuffer * buf, GstBufferList * list)
+{
+  GstFlowReturn ret;
 
   /* chain to the peer pad */
-  if (GST_PAD_IS_SINK (outpad))
-    ret = gst_pad_chain (outpad, buf);
-  else
-    ret = gst_pad_push (outpad, buf);
+  if (buf) {
+    if (GST_PAD_IS_SINK (outpad))
+      ret = gst_pad_chain (outpad, buf);
+    else
+      ret = gst_pad_push (outpad, buf);
+  } else {
+    if (GST_PAD_IS_SINK (outpad))
+      ret = gst_pad_chain_list (outpad, list);
+    else
+      ret = gst_pad_push_list (outpad, list);
+  }
 
   if (!is_rtcp) {
     /* combine all stream flows for the data transport */
     ret = gst_rtspsrc_combine_flows (src, stream, ret);
   }
   return ret;
+}
+
+static GstFlowReturn
+gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
+{
+  gint channel;
+  GstRTSPStream *stream;
+  GstPad *outpad = NULL;
+  guint8 *data;
+  guint size;
+  GstBuffer *buf;
+  gboolean is_rtcp;
+
+  channel = message->type_data.data.channel;
+
+  stream = find_stream (src, &channel, (gpointer) find_stream_by_channel);
+  if (!stream)
+    goto unknown_stream;
+
+  /* take a look at the body to figure out what we have */
+  gst_rtsp_message_get_body (message, &data, &size);
+  if (size < 2)
+    goto invalid_length;
+
+  outpad = gst_rtspsrc_get_data_pad (stream, channel, data, &is_rtcp);
+
+  /* we have no clue what this is, just ignore then. */
+  if (outpad == NULL)
+    goto unknown_stream;
+
+  /* take the message body for further processing */
+  gst_rtsp_message_steal_body (message, &data, &size);
+
+  /* strip the trailing \0 */
+  size -= 1;
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf,
+      gst_memory_new_wrapped (0, data, size, 0, size, data, g_free));
+
+  /* don't need message anymore */
+  gst_rtsp_message_unset (message);
+
+  GST_DEBUG_OBJECT (src, "pushing data of size %d on channel %d", size,
+      channel);
+
+  gst_rtspsrc_prepare_data (src);
+  gst_rtspsrc_handle_discont (src, stream, is_rtcp, buf);
+
+  return gst_rtspsrc_push_data (src, stream, outpad, is_rtcp, buf, NULL);
 
   /* ERRORS */
 unknown_stream:
@@ -4447,6 +4496,117 @@ invalid_length:
   }
 }
 
+/* The interleaved data is read directly from the socket of the connection,
+ * many frames at once, when the connection does not need to decode it. The
+ * frames are pushed as sub-buffers of one memory. Everything that is not
+ * interleaved data is left on the socket for the connection. */
+static gboolean
+gst_rtspsrc_can_receive_data (GstRTSPSrc * src)
+{
+  GstRTSPConnection *conn = src->conninfo.connection;
+
+  if (gst_rtsp_connection_is_tunneled (conn))
+    return FALSE;
+  if (src->conninfo.url->transports & GST_RTSP_LOWER_TRANS_TLS)
+    return FALSE;
+
+  return gst_rtsp_connection_get_read_socket (conn) != NULL;
+}
+
+/* Read all complete interleaved frames that are available and push them in a
+ * list per channel. @is_data is FALSE when the next message is not
+ * interleaved data or a frame that did not arrive completely, and needs to be
+ * read with the connection. */
+static GstRTSPResult
+gst_rtspsrc_receive_data (GstRTSPSrc * src, gboolean * is_data,
+    GstFlowReturn * ret)
+{
+  GstRTSPResult res;
+  GSocket *socket;
+  gint64 timeout = -1;
+  gsize total, offset, len;
+  GstMapInfo map;
+  GstBuffer *buffer;
+  GstBufferList *list = NULL;
+  GstRTSPStream *stream = NULL;
+  GstPad *outpad = NULL;
+  gboolean is_rtcp = FALSE, prepared = FALSE;
+
+  *ret = GST_FLOW_OK;
+
+  socket = gst_rtsp_connection_get_read_socket (src->conninfo.connection);
+  if (src->ptcp_timeout)
+    timeout = src->ptcp_timeout->tv_sec * G_USEC_PER_SEC +
+        src->ptcp_timeout->tv_usec;
+
+  res = gst_rtsp_interleaved_reader_read (&src->data_reader, socket, timeout,
+      src->data_cancellable, is_data, &buffer);
+  if (res != GST_RTSP_OK || buffer == NULL)
+    return res;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  total = map.size;
+
+  for (offset = 0; offset < total; offset += 4 + len) {
+    GstRTSPStream *fstream;
+    GstPad *fpad;
+    gboolean frtcp;
+    GstBuffer *buf;
+    gint channel;
+
+    channel = map.data[offset + 1];
+    len = GST_READ_UINT16_BE (map.data + offset + 2);
+
+    fstream = find_stream (src, &channel, (gpointer) find_stream_by_channel);
+    if (!fstream) {
+      GST_DEBUG_OBJECT (src, "unknown stream on channel %d, ignored", channel);
+      continue;
+    }
+    if (len < 2) {
+      GST_ELEMENT_WARNING (src, RESOURCE, READ, (NULL),
+          ("Short message received, ignoring."));
+      continue;
+    }
+    fpad = gst_rtspsrc_get_data_pad (fstream, channel, map.data + offset + 4,
+        &frtcp);
+    if (fpad == NULL) {
+      GST_DEBUG_OBJECT (src, "unknown stream on channel %d, ignored", channel);
+      continue;
+    }
+
+    if (fpad != outpad) {
+      if (list) {
+        *ret = gst_rtspsrc_push_data (src, stream, outpad, is_rtcp, NULL, list);
+        list = NULL;
+        if (*ret != GST_FLOW_OK)
+          break;
+      }
+      stream = fstream;
+      outpad = fpad;
+      is_rtcp = frtcp;
+      list = gst_buffer_list_new ();
+    }
+
+    if (!prepared) {
+      gst_rtspsrc_prepare_data (src);
+      prepared = TRUE;
+    }
+
+    buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, offset + 4,
+        len);
+    gst_rtspsrc_handle_discont (src, stream, is_rtcp, buf);
+    gst_buffer_list_add (list, buf);
+  }
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  if (list) {
+    GST_DEBUG_OBJECT (src, "pushing %u buffers", gst_buffer_list_length (list));
+    *ret = gst_rtspsrc_push_data (src, stream, outpad, is_rtcp, NULL, list);
+  }
+  return GST_RTSP_OK;
+}
+
 static GstFlowReturn
 gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
 {
@@ -4454,6 +4614,9 @@ gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
   GstRTSPResult res;
   GstFlowReturn ret = GST_FLOW_OK;
   GTimeVal tv_timeout;
+  gboolean can_receive_data, is_data;
+
+  can_receive_data = gst_rtspsrc_can_receive_data (src);
 
   while (TRUE) {
     /* get the next timeout interval */
@@ -4473,15 +4636,23 @@ gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
     GST_DEBUG_OBJECT (src, "doing receive with timeout %ld seconds, %ld usec",
         tv_timeout.tv_sec, tv_timeout.tv_usec);
 
+    is_data = FALSE;
+    if (can_receive_data)
+      res = gst_rtspsrc_receive_data (src, &is_data, &ret);
+    else
+      res = GST_RTSP_OK;
+
     /* protect the connection with the connection lock so that we can see when
      * we are finished doing server communication */
-    res =
-        gst_rtspsrc_connection_receive (src, src->conninfo.connection,
-        &message, src->ptcp_timeout);
+    if (res == GST_RTSP_OK && !is_data)
+      res =
+          gst_rtspsrc_connection_receive (src, src->conninfo.connection,
+          &message, src->ptcp_timeout);
 
     switch (res) {
       case GST_RTSP_OK:
-        GST_DEBUG_OBJECT (src, "we received a server message");
+        if (!is_data)
+          GST_DEBUG_OBJECT (src, "we received a server message");
         break;
       case GST_RTSP_EINTR:
         /* we got interrupted this means we need to stop */
@@ -4499,6 +4670,12 @@ gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
         goto receive_error;
     }
 
+    if (is_data) {
+      if (ret != GST_FLOW_OK)
+        goto handle_data_failed;
+      continue;
+    }
+
     switch (message.type) {
       case GST_RTSP_MESSAGE_REQUEST:
         /* server sends us a request message, handle it */
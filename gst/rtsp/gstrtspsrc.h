@@ -55,6 +55,7 @@ G_BEGIN_DECLS
 #include <gio/gio.h>
 
 #include "gstrtspext.h"
+#include "gstrtspinterleaved.h"
 
 #define GST_TYPE_RTSPSRC \
   (gst_rtspsrc_get_type())
@@ -193,6 +194,10 @@ struct _GstRTSPSrc {
   gboolean         ignore_timeout;
   gboolean         open_error;
 
+  /* TCP mode loop */
+  GCancellable    *data_cancellable;
+  GstRTSPInterleavedReader data_reader;
+
   /* mutex for protecting state changes */
   GRecMutex        state_rec_lock;
 
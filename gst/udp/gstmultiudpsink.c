@@ -47,6 +47,11 @@
 #include <netinet/in.h>
 #endif
 
+#ifdef HAVE_SENDMMSG
+#include <errno.h>
+#include <sys/uio.h>
+#endif
+
 #include "gst/glib-compat-private.h"
 
 GST_DEBUG_CATEGORY_STATIC (multiudpsink_debug);
@@ -54,6 +59,30 @@ GST_DEBUG_CATEGORY_STATIC (multiudpsink_debug);
 
 #define UDP_MAX_SIZE 65507
 
+/* a buffer of a buffer list, mapped for sending */
+typedef struct
+{
+  GOutputVector *vec;
+#ifdef HAVE_SENDMMSG
+  struct iovec *iov;
+#endif
+  guint n_vec;
+  gsize size;
+} GstMultiUDPSinkPacket;
+
+#ifdef HAVE_SENDMMSG
+/* max number of messages handed to the kernel in one sendmmsg() call */
+#define SEND_BATCH_SIZE 256
+
+typedef struct
+{
+  GSocket *socket;
+  guint n_msgs;
+  struct mmsghdr msgs[SEND_BATCH_SIZE];
+  GstUDPClientEntry *clients[SEND_BATCH_SIZE];
+} GstMultiUDPSinkBatch;
+#endif
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -124,6 +153,8 @@ static void gst_multiudpsink_finalize (GObject * object);
 
 static GstFlowReturn gst_multiudpsink_render (GstBaseSink * sink,
     GstBuffer * buffer);
+static GstFlowReturn gst_multiudpsink_render_list (GstBaseSink * sink,
+    GstBufferList * buffer_list);
 
 static gboolean gst_multiudpsink_start (GstBaseSink * bsink);
 static gboolean gst_multiudpsink_stop (GstBaseSink * bsink);
@@ -139,6 +170,7 @@ static void gst_multiudpsink_add_internal (GstMultiUDPSink * sink,
     const gchar * host, gint port, gboolean lock);
 static void gst_multiudpsink_clear_internal (GstMultiUDPSink * sink,
     gboolean lock);
+static GstUDPClientList *gst_udp_client_list_new (GList * clients);
 
 static guint gst_multiudpsink_signals[LAST_SIGNAL] = { 0 };
 
@@ -360,6 +392,7 @@ gst_multiudpsink_class_init (GstMultiUDPSinkClass * klass)
       "Wim Taymans <wim.taymans@gmail.com>");
 
   gstbasesink_class->render = gst_multiudpsink_render;
+  gstbasesink_class->render_list = gst_multiudpsink_render_list;
   gstbasesink_class->start = gst_multiudpsink_start;
   gstbasesink_class->stop = gst_multiudpsink_stop;
   gstbasesink_class->unlock = gst_multiudpsink_unlock;
@@ -379,6 +412,8 @@ gst_multiudpsink_init (GstMultiUDPSink * sink)
   guint max_mem;
 
   g_mutex_init (&sink->client_lock);
+  g_mutex_init (&sink->stats_lock);
+  sink->client_list = gst_udp_client_list_new (NULL);
   sink->socket = DEFAULT_SOCKET;
   sink->socket_v6 = DEFAULT_SOCKET;
   sink->used_socket = DEFAULT_USED_SOCKET;
@@ -403,6 +438,10 @@ gst_multiudpsink_init (GstMultiUDPSink * sink)
 
   sink->vec = g_new (GOutputVector, max_mem);
   sink->map = g_new (GstMapInfo, max_mem);
+
+#ifdef HAVE_SENDMMSG
+  sink->send_batch = g_new (GstMultiUDPSinkBatch, 1);
+#endif
 }
 
 static GstUDPClient *
@@ -438,17 +477,36 @@ create_client (GstMultiUDPSink * sink, const gchar * host, gint port)
 
   client = g_slice_new0 (GstUDPClient);
   client->refcount = 1;
+  client->users = 1;
   client->host = g_strdup (host);
   client->port = port;
   client->addr = g_inet_socket_address_new (addr, port);
   g_object_unref (addr);
 
+  client->native_len = g_socket_address_get_native_size (client->addr);
+  client->native_addr = g_malloc (client->native_len);
+  if (!g_socket_address_to_native (client->addr, client->native_addr,
+          client->native_len, &err))
+    goto native_error;
+
   return client;
 
 name_resolve:
   {
     g_object_unref (resolver);
 
+    return NULL;
+  }
+native_error:
+  {
+    GST_WARNING_OBJECT (sink, "could not convert address of host %s: %s",
+        host, err->message);
+    g_clear_error (&err);
+    g_free (client->native_addr);
+    g_object_unref (client->addr);
+    g_free (client->host);
+    g_slice_free (GstUDPClient, client);
+
     return NULL;
   }
 }
@@ -457,10 +515,99 @@ static void
 free_client (GstUDPClient * client)
 {
   g_object_unref (client->addr);
+  g_free (client->native_addr);
   g_free (client->host);
   g_slice_free (GstUDPClient, client);
 }
 
+static GstUDPClient *
+gst_udp_client_ref (GstUDPClient * client)
+{
+  g_atomic_int_inc (&client->users);
+  return client;
+}
+
+static void
+gst_udp_client_unref (GstUDPClient * client)
+{
+  if (g_atomic_int_dec_and_test (&client->users))
+    free_client (client);
+}
+
+static GstUDPClientList *
+gst_udp_client_list_new (GList * clients)
+{
+  GstUDPClientList *list;
+  guint i, n_clients;
+
+  n_clients = g_list_length (clients);
+  list = g_malloc (sizeof (GstUDPClientList) +
+      n_clients * sizeof (GstUDPClientEntry));
+  list->refcount = 1;
+  list->n_clients = n_clients;
+
+  for (i = 0; clients; clients = g_list_next (clients), i++) {
+    GstUDPClient *client = (GstUDPClient *) clients->data;
+
+    list->clients[i].client = gst_udp_client_ref (client);
+    list->clients[i].count = client->refcount;
+    list->clients[i].bytes_sent = 0;
+    list->clients[i].packets_sent = 0;
+  }
+
+  return list;
+}
+
+static GstUDPClientList *
+gst_udp_client_list_ref (GstUDPClientList * list)
+{
+  g_atomic_int_inc (&list->refcount);
+  return list;
+}
+
+static void
+gst_udp_client_list_unref (GstUDPClientList * list)
+{
+  guint i;
+
+  if (!g_atomic_int_dec_and_test (&list->refcount))
+    return;
+
+  for (i = 0; i < list->n_clients; i++)
+    gst_udp_client_unref (list->clients[i].client);
+  g_free (list);
+}
+
+/* called with the client_lock, the next render picks up the current
+ * clients */
+static void
+gst_multiudpsink_update_client_list (GstMultiUDPSink * sink)
+{
+  g_atomic_int_set (&sink->clients_changed, TRUE);
+}
+
+/* called from the streaming thread, makes a new snapshot of the clients when
+ * they changed since the last one */
+static GstUDPClientList *
+gst_multiudpsink_get_client_list (GstMultiUDPSink * sink)
+{
+  if (g_atomic_int_get (&sink->clients_changed)) {
+    GstUDPClientList *list;
+
+    g_mutex_lock (&sink->client_lock);
+    list = gst_udp_client_list_new (sink->clients);
+    g_atomic_int_set (&sink->clients_changed, FALSE);
+    g_mutex_unlock (&sink->client_lock);
+
+    GST_LOG_OBJECT (sink, "new snapshot of %u clients", list->n_clients);
+
+    gst_udp_client_list_unref (sink->client_list);
+    sink->client_list = list;
+  }
+
+  return gst_udp_client_list_ref (sink->client_list);
+}
+
 static gint
 client_compare (GstUDPClient * a, GstUDPClient * b)
 {
@@ -477,8 +624,10 @@ gst_multiudpsink_finalize (GObject * object)
 
   sink = GST_MULTIUDPSINK (object);
 
-  g_list_foreach (sink->clients, (GFunc) free_client, NULL);
+  g_list_foreach (sink->clients, (GFunc) gst_udp_client_unref, NULL);
   g_list_free (sink->clients);
+  gst_udp_client_list_unref (sink->client_list);
+  sink->client_list = NULL;
 
   if (sink->socket)
     g_object_unref (sink->socket);
@@ -507,23 +656,81 @@ gst_multiudpsink_finalize (GObject * object)
   sink->vec = NULL;
   g_free (sink->map);
   sink->map = NULL;
+  g_free (sink->send_batch);
+  sink->send_batch = NULL;
 
   g_free (sink->bind_address);
   sink->bind_address = NULL;
 
   g_mutex_clear (&sink->client_lock);
+  g_mutex_clear (&sink->stats_lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+/* Select socket to send from for this address */
+static GSocket *
+gst_multiudpsink_get_client_socket (GstMultiUDPSink * sink,
+    GstUDPClient * client)
+{
+  GSocketFamily family;
+
+  family = g_socket_address_get_family (G_SOCKET_ADDRESS (client->addr));
+  if (family == G_SOCKET_FAMILY_IPV6 || !sink->used_socket)
+    return sink->used_socket_v6;
+
+  return sink->used_socket;
+}
+
+static void
+gst_multiudpsink_post_send_warning (GstMultiUDPSink * sink, gsize size,
+    const gchar * reason)
+{
+  if (size > UDP_MAX_SIZE) {
+    GST_ELEMENT_WARNING (sink, RESOURCE, WRITE,
+        ("Attempting to send a UDP packet larger than maximum size "
+            "(%" G_GSIZE_FORMAT " > %d)", size, UDP_MAX_SIZE),
+        ("Reason: %s", reason ? reason : "unknown reason"));
+  } else {
+    GST_ELEMENT_WARNING (sink, RESOURCE, WRITE,
+        ("Error sending UDP packet"), ("Reason: %s",
+            reason ? reason : "unknown reason"));
+  }
+}
+
+/* add the counters that were collected in the entries of @list during a
+ * render to the stats, with one lock */
+static void
+gst_multiudpsink_update_stats (GstMultiUDPSink * sink, GstUDPClientList * list,
+    gsize bytes_to_serve)
+{
+  guint c;
+
+  g_mutex_lock (&sink->stats_lock);
+  sink->bytes_to_serve += bytes_to_serve;
+  for (c = 0; c < list->n_clients; c++) {
+    GstUDPClientEntry *entry = &list->clients[c];
+
+    if (entry->packets_sent == 0)
+      continue;
+
+    entry->client->bytes_sent += entry->bytes_sent;
+    entry->client->packets_sent += entry->packets_sent;
+    sink->bytes_served += entry->bytes_sent;
+    entry->bytes_sent = 0;
+    entry->packets_sent = 0;
+  }
+  g_mutex_unlock (&sink->stats_lock);
+}
+
 static GstFlowReturn
 gst_multiudpsink_render (GstBaseSink * bsink, GstBuffer * buffer)
 {
   GstMultiUDPSink *sink;
-  GList *clients;
+  GstUDPClientList *list;
   GOutputVector *vec;
   GstMapInfo *map;
-  guint n_mem, i;
+  guint n_mem, i, c;
   gsize size;
   GstMemory *mem;
   gint num, no_clients;
@@ -551,35 +758,27 @@ gst_multiudpsink_render (GstBaseSink * bsink, GstBuffer * buffer)
     size += map[i].size;
   }
 
-  sink->bytes_to_serve += size;
-
-  /* grab lock while iterating and sending to clients, this should be
-   * fast as UDP never blocks */
-  g_mutex_lock (&sink->client_lock);
+  /* send to a snapshot of the clients so that adding and removing clients
+   * does not have to wait for us and the other way around */
+  list = gst_multiudpsink_get_client_list (sink);
   GST_LOG_OBJECT (bsink, "about to send %" G_GSIZE_FORMAT " bytes in %u blocks",
       size, n_mem);
 
   no_clients = 0;
   num = 0;
-  for (clients = sink->clients; clients; clients = g_list_next (clients)) {
+  for (c = 0; c < list->n_clients; c++) {
     GstUDPClient *client;
     GSocket *socket;
-    GSocketFamily family;
     gint count;
 
-    client = (GstUDPClient *) clients->data;
+    client = list->clients[c].client;
     no_clients++;
     GST_LOG_OBJECT (sink, "sending %" G_GSIZE_FORMAT " bytes to client %p",
         size, client);
 
-    family = g_socket_address_get_family (G_SOCKET_ADDRESS (client->addr));
-    /* Select socket to send from for this address */
-    if (family == G_SOCKET_FAMILY_IPV6 || !sink->used_socket)
-      socket = sink->used_socket_v6;
-    else
-      socket = sink->used_socket;
+    socket = gst_multiudpsink_get_client_socket (sink, client);
 
-    count = sink->send_duplicates ? client->refcount : 1;
+    count = sink->send_duplicates ? list->clients[c].count : 1;
 
     while (count--) {
       gssize ret;
@@ -594,26 +793,18 @@ gst_multiudpsink_render (GstBaseSink * bsink, GstBuffer * buffer)
 
         /* we continue after posting a warning, next packets might be ok
          * again */
-        if (size > UDP_MAX_SIZE) {
-          GST_ELEMENT_WARNING (sink, RESOURCE, WRITE,
-              ("Attempting to send a UDP packet larger than maximum size "
-                  "(%" G_GSIZE_FORMAT " > %d)", size, UDP_MAX_SIZE),
-              ("Reason: %s", err ? err->message : "unknown reason"));
-        } else {
-          GST_ELEMENT_WARNING (sink, RESOURCE, WRITE,
-              ("Error sending UDP packet"), ("Reason: %s",
-                  err ? err->message : "unknown reason"));
-        }
+        gst_multiudpsink_post_send_warning (sink, size,
+            err ? err->message : NULL);
         g_clear_error (&err);
       } else {
         num++;
-        client->bytes_sent += ret;
-        client->packets_sent++;
-        sink->bytes_served += ret;
+        list->clients[c].bytes_sent += ret;
+        list->clients[c].packets_sent++;
       }
     }
   }
-  g_mutex_unlock (&sink->client_lock);
+  gst_multiudpsink_update_stats (sink, list, size);
+  gst_udp_client_list_unref (list);
 
   /* unmap all memory again */
   for (i = 0; i < n_mem; i++) {
@@ -633,7 +824,8 @@ no_data:
 flushing:
   {
     GST_DEBUG ("we are flushing");
-    g_mutex_unlock (&sink->client_lock);
+    gst_multiudpsink_update_stats (sink, list, size);
+    gst_udp_client_list_unref (list);
     g_clear_error (&err);
 
     /* unmap all memory */
@@ -646,6 +838,294 @@ flushing:
   }
 }
 
+#ifdef HAVE_SENDMMSG
+/* hand all queued messages to the kernel, waiting for room in the socket
+ * send buffer when needed */
+static GstFlowReturn
+gst_multiudpsink_flush_batch (GstMultiUDPSink * sink,
+    GstMultiUDPSinkBatch * batch, gint * num)
+{
+  GError *err = NULL;
+  guint sent = 0, i;
+  gint fd, ret;
+
+  fd = g_socket_get_fd (batch->socket);
+
+  while (sent < batch->n_msgs) {
+    ret = sendmmsg (fd, &batch->msgs[sent], batch->n_msgs - sent, 0);
+
+    if (G_UNLIKELY (ret < 0)) {
+      gint errsv = errno;
+      struct msghdr *hdr;
+      gsize size;
+
+      if (errsv == EINTR)
+        continue;
+
+      if (errsv == EAGAIN || errsv == EWOULDBLOCK) {
+        /* GSocket sockets are non-blocking, wait until we can write again */
+        if (!g_socket_condition_timed_wait (batch->socket, G_IO_OUT, -1,
+                sink->cancellable, &err)) {
+          if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            goto flushing;
+
+          gst_multiudpsink_post_send_warning (sink, 0, err->message);
+          g_clear_error (&err);
+          break;
+        }
+        continue;
+      }
+
+      /* the first message failed, skip it after posting a warning, the next
+       * packets might be ok again */
+      hdr = &batch->msgs[sent].msg_hdr;
+      for (i = 0, size = 0; i < hdr->msg_iovlen; i++)
+        size += hdr->msg_iov[i].iov_len;
+
+      gst_multiudpsink_post_send_warning (sink, size, g_strerror (errsv));
+      sent++;
+      continue;
+    }
+
+    for (i = sent; i < sent + ret; i++) {
+      batch->clients[i]->bytes_sent += batch->msgs[i].msg_len;
+      batch->clients[i]->packets_sent++;
+    }
+    *num += ret;
+    sent += ret;
+  }
+
+  batch->n_msgs = 0;
+
+  return GST_FLOW_OK;
+
+flushing:
+  {
+    GST_DEBUG ("we are flushing");
+    g_clear_error (&err);
+    batch->n_msgs = 0;
+    return GST_FLOW_FLUSHING;
+  }
+}
+
+/* queue one message per packet and client, grouped per socket, and submit
+ * them with as few sendmmsg() calls as possible */
+static GstFlowReturn
+gst_multiudpsink_send_list (GstMultiUDPSink * sink, GstUDPClientList * list,
+    GstMultiUDPSinkPacket * packets, guint n_packets, gint * num,
+    gint * no_clients)
+{
+  GstMultiUDPSinkBatch *batch = sink->send_batch;
+  GSocket *sockets[2];
+  GstFlowReturn ret;
+  guint s, c, i;
+
+  sockets[0] = sink->used_socket;
+  sockets[1] = sink->used_socket_v6;
+
+  for (s = 0; s < 2; s++) {
+    if (sockets[s] == NULL || (s == 1 && sockets[1] == sockets[0]))
+      continue;
+
+    batch->socket = sockets[s];
+    batch->n_msgs = 0;
+
+    for (c = 0; c < list->n_clients; c++) {
+      GstUDPClient *client;
+      gint count;
+
+      client = list->clients[c].client;
+      if (gst_multiudpsink_get_client_socket (sink, client) != batch->socket)
+        continue;
+
+      (*no_clients)++;
+
+      count = sink->send_duplicates ? list->clients[c].count : 1;
+
+      while (count--) {
+        for (i = 0; i < n_packets; i++) {
+          struct mmsghdr *msg;
+
+          if (packets[i].n_vec == 0)
+            continue;
+
+          if (batch->n_msgs == SEND_BATCH_SIZE) {
+            if ((ret = gst_multiudpsink_flush_batch (sink, batch,
+                        num)) != GST_FLOW_OK)
+              return ret;
+          }
+
+          msg = &batch->msgs[batch->n_msgs];
+          memset (msg, 0, sizeof (struct mmsghdr));
+          msg->msg_hdr.msg_name = client->native_addr;
+          msg->msg_hdr.msg_namelen = client->native_len;
+          msg->msg_hdr.msg_iov = packets[i].iov;
+          msg->msg_hdr.msg_iovlen = packets[i].n_vec;
+          batch->clients[batch->n_msgs] = &list->clients[c];
+          batch->n_msgs++;
+        }
+      }
+    }
+
+    if ((ret = gst_multiudpsink_flush_batch (sink, batch, num)) != GST_FLOW_OK)
+      return ret;
+  }
+
+  return GST_FLOW_OK;
+}
+#else
+static GstFlowReturn
+gst_multiudpsink_send_list (GstMultiUDPSink * sink, GstUDPClientList * list,
+    GstMultiUDPSinkPacket * packets, guint n_packets, gint * num,
+    gint * no_clients)
+{
+  GError *err = NULL;
+  guint c, i;
+
+  for (c = 0; c < list->n_clients; c++) {
+    GstUDPClient *client;
+    GSocket *socket;
+    gint count;
+
+    client = list->clients[c].client;
+    (*no_clients)++;
+
+    socket = gst_multiudpsink_get_client_socket (sink, client);
+    count = sink->send_duplicates ? list->clients[c].count : 1;
+
+    while (count--) {
+      for (i = 0; i < n_packets; i++) {
+        gssize ret;
+
+        if (packets[i].n_vec == 0)
+          continue;
+
+        ret =
+            g_socket_send_message (socket, client->addr, packets[i].vec,
+            packets[i].n_vec, NULL, 0, 0, sink->cancellable, &err);
+
+        if (G_UNLIKELY (ret < 0)) {
+          if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            GST_DEBUG ("we are flushing");
+            g_clear_error (&err);
+            return GST_FLOW_FLUSHING;
+          }
+
+          gst_multiudpsink_post_send_warning (sink, packets[i].size,
+              err ? err->message : NULL);
+          g_clear_error (&err);
+        } else {
+          (*num)++;
+          list->clients[c].bytes_sent += ret;
+          list->clients[c].packets_sent++;
+        }
+      }
+    }
+  }
+
+  return GST_FLOW_OK;
+}
+#endif
+
+static GstFlowReturn
+gst_multiudpsink_render_list (GstBaseSink * bsink, GstBufferList * buffer_list)
+{
+  GstMultiUDPSink *sink;
+  GstUDPClientList *list;
+  GstMultiUDPSinkPacket *packets;
+  GOutputVector *vec;
+#ifdef HAVE_SENDMMSG
+  struct iovec *iov;
+#endif
+  GstMapInfo *map;
+  GstFlowReturn ret;
+  guint n_bufs, n_mem, i, j, m;
+  gsize size;
+  gint num, no_clients;
+
+  sink = GST_MULTIUDPSINK (bsink);
+
+  n_bufs = gst_buffer_list_length (buffer_list);
+  n_mem = 0;
+  for (i = 0; i < n_bufs; i++)
+    n_mem += gst_buffer_n_memory (gst_buffer_list_get (buffer_list, i));
+
+  if (n_mem == 0)
+    goto no_data;
+
+  /* map all memory of the list once, the resulting vectors are shared by
+   * the messages to all clients */
+  packets = g_new (GstMultiUDPSinkPacket, n_bufs);
+  vec = g_new (GOutputVector, n_mem);
+  map = g_new (GstMapInfo, n_mem);
+#ifdef HAVE_SENDMMSG
+  iov = g_new (struct iovec, n_mem);
+#endif
+
+  size = 0;
+  m = 0;
+  for (i = 0; i < n_bufs; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (buffer_list, i);
+    guint n = gst_buffer_n_memory (buffer);
+
+    packets[i].vec = &vec[m];
+#ifdef HAVE_SENDMMSG
+    packets[i].iov = &iov[m];
+#endif
+    packets[i].n_vec = n;
+    packets[i].size = 0;
+
+    for (j = 0; j < n; j++, m++) {
+      GstMemory *mem = gst_buffer_get_memory (buffer, j);
+
+      gst_memory_map (mem, &map[m], GST_MAP_READ);
+
+      vec[m].buffer = map[m].data;
+      vec[m].size = map[m].size;
+#ifdef HAVE_SENDMMSG
+      iov[m].iov_base = map[m].data;
+      iov[m].iov_len = map[m].size;
+#endif
+      packets[i].size += map[m].size;
+    }
+    size += packets[i].size;
+  }
+
+  list = gst_multiudpsink_get_client_list (sink);
+  GST_LOG_OBJECT (bsink, "about to send %" G_GSIZE_FORMAT " bytes in %u "
+      "packets", size, n_bufs);
+
+  num = 0;
+  no_clients = 0;
+  ret = gst_multiudpsink_send_list (sink, list, packets, n_bufs, &num,
+      &no_clients);
+  gst_multiudpsink_update_stats (sink, list, size);
+  gst_udp_client_list_unref (list);
+
+  /* unmap all memory again */
+  for (i = 0; i < n_mem; i++) {
+    gst_memory_unmap (map[i].memory, &map[i]);
+    gst_memory_unref (map[i].memory);
+  }
+
+  g_free (packets);
+  g_free (vec);
+  g_free (map);
+#ifdef HAVE_SENDMMSG
+  g_free (iov);
+#endif
+
+  GST_LOG_OBJECT (sink, "sent %d packets of %u to %d clients", num, n_bufs,
+      no_clients);
+
+  return ret;
+
+no_data:
+  {
+    return GST_FLOW_OK;
+  }
+}
+
 static void
 gst_multiudpsink_set_clients_string (GstMultiUDPSink * sink,
     const gchar * string)
@@ -671,6 +1151,8 @@ gst_multiudpsink_set_clients_string (GstMultiUDPSink * sink,
     if (port != 0)
       gst_multiudpsink_add_internal (sink, host, port, FALSE);
   }
+  /* publish all changes at once */
+  gst_multiudpsink_update_client_list (sink);
   g_mutex_unlock (&sink->client_lock);
 
   g_strfreev (clients);
@@ -844,10 +1326,14 @@ gst_multiudpsink_get_property (GObject * object, guint prop_id, GValue * value,
 
   switch (prop_id) {
     case PROP_BYTES_TO_SERVE:
+      g_mutex_lock (&udpsink->stats_lock);
       g_value_set_uint64 (value, udpsink->bytes_to_serve);
+      g_mutex_unlock (&udpsink->stats_lock);
       break;
     case PROP_BYTES_SERVED:
+      g_mutex_lock (&udpsink->stats_lock);
       g_value_set_uint64 (value, udpsink->bytes_served);
+      g_mutex_unlock (&udpsink->stats_lock);
       break;
     case PROP_SOCKET:
       g_value_set_object (value, udpsink->socket);
@@ -1160,8 +1646,10 @@ gst_multiudpsink_start (GstBaseSink * bsink)
   if (sink->used_socket_v6)
     g_socket_set_broadcast (sink->used_socket_v6, TRUE);
 
+  g_mutex_lock (&sink->stats_lock);
   sink->bytes_to_serve = 0;
   sink->bytes_served = 0;
+  g_mutex_unlock (&sink->stats_lock);
 
   gst_multiudpsink_setup_qos_dscp (sink, sink->used_socket);
   gst_multiudpsink_setup_qos_dscp (sink, sink->used_socket_v6);
@@ -1279,8 +1767,10 @@ gst_multiudpsink_add_internal (GstMultiUDPSink * sink, const gchar * host,
     sink->clients = g_list_prepend (sink->clients, client);
   }
 
-  if (lock)
+  if (lock) {
+    gst_multiudpsink_update_client_list (sink);
     g_mutex_unlock (&sink->client_lock);
+  }
 
   g_signal_emit (G_OBJECT (sink),
       gst_multiudpsink_signals[SIGNAL_CLIENT_ADDED], 0, host, port);
@@ -1366,8 +1856,9 @@ gst_multiudpsink_remove (GstMultiUDPSink * sink, const gchar * host, gint port)
 
     sink->clients = g_list_delete_link (sink->clients, find);
 
-    free_client (client);
+    gst_udp_client_unref (client);
   }
+  gst_multiudpsink_update_client_list (sink);
   g_mutex_unlock (&sink->client_lock);
 
   return;
@@ -1390,11 +1881,13 @@ gst_multiudpsink_clear_internal (GstMultiUDPSink * sink, gboolean lock)
    * socket or anything to free for UDP */
   if (lock)
     g_mutex_lock (&sink->client_lock);
-  g_list_foreach (sink->clients, (GFunc) free_client, sink);
+  g_list_foreach (sink->clients, (GFunc) gst_udp_client_unref, NULL);
   g_list_free (sink->clients);
   sink->clients = NULL;
-  if (lock)
+  if (lock) {
+    gst_multiudpsink_update_client_list (sink);
     g_mutex_unlock (&sink->client_lock);
+  }
 }
 
 void
@@ -1428,11 +1921,13 @@ gst_multiudpsink_get_stats (GstMultiUDPSink * sink, const gchar * host,
 
   result = gst_structure_new_empty ("multiudpsink-stats");
 
+  g_mutex_lock (&sink->stats_lock);
   gst_structure_set (result,
       "bytes-sent", G_TYPE_UINT64, client->bytes_sent,
       "packets-sent", G_TYPE_UINT64, client->packets_sent,
       "connect-time", G_TYPE_UINT64, client->connect_time,
       "disconnect-time", G_TYPE_UINT64, client->disconnect_time, NULL);
+  g_mutex_unlock (&sink->stats_lock);
 
   g_mutex_unlock (&sink->client_lock);
 
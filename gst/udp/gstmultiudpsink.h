@@ -38,12 +38,19 @@ typedef struct _GstMultiUDPSink GstMultiUDPSink;
 typedef struct _GstMultiUDPSinkClass GstMultiUDPSinkClass;
 
 typedef struct {
+  /* number of times the client was added */
   gint refcount;
+  /* number of client lists holding this client, atomic */
+  gint users;
 
   GSocketAddress *addr;
   gchar *host;
   gint port;
 
+  /* native form of addr, for batched sends */
+  gpointer native_addr;
+  gsize native_len;
+
   /* Per-client stats */
   guint64 bytes_sent;
   guint64 packets_sent;
@@ -51,6 +58,26 @@ typedef struct {
   guint64 disconnect_time;
 } GstUDPClient;
 
+typedef struct {
+  GstUDPClient *client;
+  gint count;
+
+  /* what was sent to the client in the current render, added to the stats
+   * of the client once at the end of it */
+  guint64 bytes_sent;
+  guint64 packets_sent;
+} GstUDPClientEntry;
+
+/* refcounted snapshot of the clients, used by the streaming thread only. The
+ * streaming thread makes a new one when the clients changed since the last
+ * render, so that it can send without taking the client lock and so that
+ * many changes between two renders cost one copy */
+typedef struct {
+  gint refcount;
+  guint n_clients;
+  GstUDPClientEntry clients[1];
+} GstUDPClientList;
+
 /* sends udp packets to multiple host/port pairs.
  */
 struct _GstMultiUDPSink {
@@ -61,10 +88,21 @@ struct _GstMultiUDPSink {
 
   GMutex         client_lock;
   GList         *clients;
+  /* set with the client lock when clients changed, atomic */
+  gint           clients_changed;
+  /* used by the streaming thread only */
+  GstUDPClientList *client_list;
 
   GOutputVector *vec;
   GstMapInfo *map;
 
+  /* scratch space for sending buffer lists */
+  gpointer send_batch;
+
+  /* protects the byte and packet counters of the sink and the clients,
+   * which are updated without the client lock, once per render */
+  GMutex         stats_lock;
+
   /* properties */
   guint64        bytes_to_serve;
   guint64        bytes_served;
@@ -128,9 +128,21 @@
 #endif
 #endif
 
+#ifdef HAVE_RECVMMSG
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#endif
+
 /* not 100% correct, but a good upper bound for memory allocation purposes */
 #define MAX_IPV4_UDP_PACKET_SIZE (65536 - 8)
 
+/* size of the buffers that batched datagrams are received into */
+#define BATCH_SLOT_SIZE 65536
+/* datagrams smaller than this are copied into a buffer of their size, so
+ * that a small packet does not hold on to a whole slot downstream */
+#define BATCH_COPY_SIZE (BATCH_SLOT_SIZE / 2)
+
 GST_DEBUG_CATEGORY_STATIC (udpsrc_debug);
 #define GST_CAT_DEFAULT (udpsrc_debug)
 
@@ -152,6 +164,9 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
 #define UDP_DEFAULT_USED_SOCKET        NULL
 #define UDP_DEFAULT_AUTO_MULTICAST     TRUE
 #define UDP_DEFAULT_REUSE              TRUE
+#define UDP_DEFAULT_BATCH_SIZE         1
+#define UDP_DEFAULT_BATCH_MAX_WAIT     0
+#define UDP_MAX_BATCH_SIZE             256
 
 enum
 {
@@ -171,6 +186,8 @@ enum
   PROP_AUTO_MULTICAST,
   PROP_REUSE,
   PROP_ADDRESS,
+  PROP_BATCH_SIZE,
+  PROP_BATCH_MAX_WAIT,
 
   PROP_LAST
 };
@@ -182,6 +199,7 @@ static GstFlowReturn gst_udpsrc_create (GstPushSrc * psrc, GstBuffer ** buf);
 static gboolean gst_udpsrc_close (GstUDPSrc * src);
 static gboolean gst_udpsrc_unlock (GstBaseSrc * bsrc);
 static gboolean gst_udpsrc_unlock_stop (GstBaseSrc * bsrc);
+static void gst_udpsrc_free_batch (GstUDPSrc * src);
 
 static void gst_udpsrc_finalize (GObject * object);
 
@@ -279,6 +297,36 @@ gst_udpsrc_class_init (GstUDPSrcClass * klass)
           "Address to receive packets for. This is equivalent to the "
           "multicast-group property for now", UDP_DEFAULT_MULTICAST_GROUP,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstUDPSrc:batch-size:
+   *
+   * Maximum number of datagrams to read from the socket per wakeup. When
+   * bigger than 1, all datagrams pending on the socket (up to this number)
+   * are drained at once, using recvmmsg() where available, and handed out
+   * without going back to the socket.
+   *
+   * Since: 1.4
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size", "Batch Size",
+          "Maximum number of datagrams to receive per wakeup (1 = disabled)",
+          1, UDP_MAX_BATCH_SIZE, UDP_DEFAULT_BATCH_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstUDPSrc:batch-max-wait:
+   *
+   * Maximum time in nanoseconds to wait for more datagrams after the first
+   * one of a batch arrived, in batched receive mode. 0 hands out whatever
+   * was pending on the socket without waiting. Note that waiting delays the
+   * timestamps of the first packets of a batch by up to this amount.
+   *
+   * Since: 1.4
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_MAX_WAIT,
+      g_param_spec_uint64 ("batch-max-wait", "Batch Max Wait",
+          "Maximum time to wait for a batch to fill up in nanoseconds "
+          "(0 = don't wait)", 0, G_MAXUINT64, UDP_DEFAULT_BATCH_MAX_WAIT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&src_template));
@@ -317,6 +365,10 @@ gst_udpsrc_init (GstUDPSrc * udpsrc)
   udpsrc->auto_multicast = UDP_DEFAULT_AUTO_MULTICAST;
   udpsrc->used_socket = UDP_DEFAULT_USED_SOCKET;
   udpsrc->reuse = UDP_DEFAULT_REUSE;
+  udpsrc->batch_size = UDP_DEFAULT_BATCH_SIZE;
+  udpsrc->batch_max_wait = UDP_DEFAULT_BATCH_MAX_WAIT;
+
+  g_queue_init (&udpsrc->batch);
 
   udpsrc->cancellable = g_cancellable_new ();
 
@@ -361,6 +413,8 @@ gst_udpsrc_finalize (GObject * object)
     g_object_unref (udpsrc->cancellable);
   udpsrc->cancellable = NULL;
 
+  gst_udpsrc_free_batch (udpsrc);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -390,28 +444,14 @@ gst_udpsrc_getcaps (GstBaseSrc * src, GstCaps * filter)
   return result;
 }
 
+/* wait until the socket becomes readable, posting an element message each
+ * time the configured timeout expires */
 static GstFlowReturn
-gst_udpsrc_create (GstPushSrc * psrc, GstBuffer ** buf)
+gst_udpsrc_wait_readable (GstUDPSrc * udpsrc)
 {
-  GstFlowReturn ret;
-  GstUDPSrc *udpsrc;
-  GstBuffer *outbuf = NULL;
-  GstMapInfo info;
-  GSocketAddress *saddr = NULL;
-  gsize offset;
-  gssize readsize;
-  gssize res;
   gboolean try_again;
   GError *err = NULL;
 
-  udpsrc = GST_UDPSRC_CAST (psrc);
-
-retry:
-  /* quick check, avoid going in select when we already have data */
-  readsize = g_socket_get_available_bytes (udpsrc->used_socket);
-  if (readsize > 0)
-    goto no_select;
-
   do {
     gint64 timeout;
 
@@ -444,6 +484,404 @@ retry:
     }
   } while (G_UNLIKELY (try_again));
 
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+select_error:
+  {
+    GST_ELEMENT_ERROR (udpsrc, RESOURCE, READ, (NULL),
+        ("select error: %s", err->message));
+    g_clear_error (&err);
+    return GST_FLOW_ERROR;
+  }
+stopped:
+  {
+    GST_DEBUG ("stop called");
+    g_clear_error (&err);
+    return GST_FLOW_FLUSHING;
+  }
+}
+
+/* drop the buffer of slot @i, mapped for receiving into */
+static void
+gst_udpsrc_clear_batch_slot (GstUDPSrc * src, guint i)
+{
+  if (src->batch_bufs[i] == NULL)
+    return;
+
+  gst_buffer_unmap (src->batch_bufs[i], &src->batch_maps[i]);
+  gst_buffer_unref (src->batch_bufs[i]);
+  src->batch_bufs[i] = NULL;
+}
+
+/* drop the datagrams that were received but not handed out yet */
+static void
+gst_udpsrc_flush_batch (GstUDPSrc * src)
+{
+  if (!g_queue_is_empty (&src->batch))
+    GST_DEBUG_OBJECT (src, "dropping %u batched buffers",
+        g_queue_get_length (&src->batch));
+
+  g_queue_foreach (&src->batch, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&src->batch);
+}
+
+static void
+gst_udpsrc_free_batch (GstUDPSrc * src)
+{
+  guint i;
+
+  gst_udpsrc_flush_batch (src);
+
+  for (i = 0; i < src->batch_slots; i++) {
+    gst_udpsrc_clear_batch_slot (src, i);
+    if (src->batch_addrs[i])
+      g_object_unref (src->batch_addrs[i]);
+  }
+  g_free (src->batch_bufs);
+  src->batch_bufs = NULL;
+  g_free (src->batch_maps);
+  src->batch_maps = NULL;
+  g_free (src->batch_addrs);
+  src->batch_addrs = NULL;
+  g_free (src->batch_lens);
+  src->batch_lens = NULL;
+  g_free (src->batch_msgs);
+  src->batch_msgs = NULL;
+  src->batch_slots = 0;
+}
+
+static void
+gst_udpsrc_ensure_batch (GstUDPSrc * src, guint slots)
+{
+  if (src->batch_slots >= slots)
+    return;
+
+  /* only called with an empty queue */
+  gst_udpsrc_free_batch (src);
+
+  GST_DEBUG_OBJECT (src, "allocating %u batch slots", slots);
+
+  src->batch_bufs = g_new0 (GstBuffer *, slots);
+  src->batch_maps = g_new0 (GstMapInfo, slots);
+  src->batch_lens = g_new0 (gsize, slots);
+  src->batch_addrs = g_new0 (GSocketAddress *, slots);
+#ifdef HAVE_RECVMMSG
+  src->batch_msgs = g_malloc0 (slots * (sizeof (struct sockaddr_storage) +
+          sizeof (struct mmsghdr) + sizeof (struct iovec)));
+#endif
+  src->batch_slots = slots;
+}
+
+/* give the first @max slots a mapped buffer to receive into. Slots keep their
+ * buffer until a datagram was received into it. */
+static GstFlowReturn
+gst_udpsrc_prepare_batch_slots (GstUDPSrc * src, guint max)
+{
+  GstFlowReturn ret;
+  guint i;
+
+  for (i = 0; i < max; i++) {
+    GstBuffer *buf;
+
+    if (src->batch_bufs[i])
+      continue;
+
+    ret = GST_BASE_SRC_CLASS (parent_class)->alloc (GST_BASE_SRC_CAST (src),
+        -1, BATCH_SLOT_SIZE, &buf);
+    if (ret != GST_FLOW_OK) {
+      GST_DEBUG_OBJECT (src, "Allocation failed");
+      return ret;
+    }
+    if (!gst_buffer_map (buf, &src->batch_maps[i], GST_MAP_WRITE)) {
+      gst_buffer_unref (buf);
+      GST_ELEMENT_ERROR (src, RESOURCE, FAILED, (NULL),
+          ("Failed to map buffer"));
+      return GST_FLOW_ERROR;
+    }
+    src->batch_bufs[i] = buf;
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* read up to @max pending datagrams into the batch slots without blocking.
+ * Returns the number of datagrams read or -1 on error. */
+static gint
+gst_udpsrc_receive_batch (GstUDPSrc * src, guint max, GError ** err)
+{
+#ifdef HAVE_RECVMMSG
+  struct sockaddr_storage *addrs;
+  struct mmsghdr *msgs;
+  struct iovec *iovs;
+  guint i;
+  gint res;
+
+  addrs = (struct sockaddr_storage *) src->batch_msgs;
+  msgs = (struct mmsghdr *) (addrs + src->batch_slots);
+  iovs = (struct iovec *) (msgs + src->batch_slots);
+
+  for (i = 0; i < max; i++) {
+    iovs[i].iov_base = src->batch_maps[i].data;
+    iovs[i].iov_len = src->batch_maps[i].size;
+    memset (&msgs[i], 0, sizeof (struct mmsghdr));
+    msgs[i].msg_hdr.msg_name = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof (struct sockaddr_storage);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  do {
+    res = recvmmsg (g_socket_get_fd (src->used_socket), msgs, max,
+        MSG_DONTWAIT, NULL);
+  } while (res < 0 && errno == EINTR);
+
+  if (res < 0) {
+    gint errsv = errno;
+
+    /* nothing pending anymore, or an ICMP error from a previous send which
+     * we ignore, see gst_udpsrc_create() */
+    if (errsv == EAGAIN || errsv == EWOULDBLOCK || errsv == ECONNREFUSED
+        || errsv == EHOSTUNREACH)
+      return 0;
+
+    g_set_error (err, G_IO_ERROR, g_io_error_from_errno (errsv),
+        "Error receiving message: %s", g_strerror (errsv));
+    return -1;
+  }
+
+  for (i = 0; i < (guint) res; i++) {
+    if (G_UNLIKELY (msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+      GST_WARNING_OBJECT (src, "datagram truncated to %u bytes",
+          msgs[i].msg_len);
+    src->batch_lens[i] = msgs[i].msg_len;
+    src->batch_addrs[i] =
+        g_socket_address_new_from_native (&addrs[i],
+        msgs[i].msg_hdr.msg_namelen);
+  }
+
+  return res;
+#else
+  guint i;
+
+  /* one receive per datagram, the last one fails with WOULD_BLOCK once the
+   * socket is drained */
+  g_socket_set_blocking (src->used_socket, FALSE);
+  for (i = 0; i < max; i++) {
+    gssize res;
+
+    res = g_socket_receive_from (src->used_socket, &src->batch_addrs[i],
+        (gchar *) src->batch_maps[i].data, src->batch_maps[i].size,
+        src->cancellable, err);
+    if (G_UNLIKELY (res < 0)) {
+      if (g_error_matches (*err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK) ||
+          g_error_matches (*err, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE)) {
+        g_clear_error (err);
+        break;
+      }
+      g_socket_set_blocking (src->used_socket, TRUE);
+      return -1;
+    }
+    src->batch_lens[i] = res;
+  }
+  g_socket_set_blocking (src->used_socket, TRUE);
+
+  return i;
+#endif
+}
+
+/* queue the datagrams of the first @n slots. Big datagrams take the buffer of
+ * their slot, small ones are copied out and leave it for the next round. */
+static GstFlowReturn
+gst_udpsrc_queue_batch (GstUDPSrc * src, gint n)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i, j;
+
+  for (i = 0; i < (guint) n; i++) {
+    GstBuffer *outbuf;
+    GSocketAddress *saddr;
+    gsize len;
+
+    saddr = src->batch_addrs[i];
+    src->batch_addrs[i] = NULL;
+    len = src->batch_lens[i];
+
+    /* an empty slot buffer can be received into again */
+    if (ret != GST_FLOW_OK || len == 0)
+      goto next;
+
+    if (G_UNLIKELY (len < (gsize) src->skip_first_bytes)) {
+      GST_ELEMENT_ERROR (src, STREAM, DECODE, (NULL),
+          ("UDP buffer to small to skip header"));
+      ret = GST_FLOW_ERROR;
+      goto next;
+    }
+
+    if (len < BATCH_COPY_SIZE) {
+      len -= src->skip_first_bytes;
+      ret = GST_BASE_SRC_CLASS (parent_class)->alloc (GST_BASE_SRC_CAST (src),
+          -1, len, &outbuf);
+      if (ret != GST_FLOW_OK) {
+        GST_DEBUG_OBJECT (src, "Allocation failed");
+        goto next;
+      }
+      gst_buffer_fill (outbuf, 0,
+          src->batch_maps[i].data + src->skip_first_bytes, len);
+    } else {
+      outbuf = src->batch_bufs[i];
+      gst_buffer_unmap (outbuf, &src->batch_maps[i]);
+      src->batch_bufs[i] = NULL;
+
+      gst_buffer_resize (outbuf, src->skip_first_bytes,
+          len - src->skip_first_bytes);
+    }
+
+    if (saddr)
+      gst_buffer_add_net_address_meta (outbuf, saddr);
+
+    g_queue_push_tail (&src->batch, outbuf);
+
+  next:
+    if (saddr)
+      g_object_unref (saddr);
+  }
+
+  /* move the buffers that were not received into to the front, the next
+   * round receives into the first slots */
+  for (i = 0, j = 0; i < src->batch_slots; i++) {
+    if (src->batch_bufs[i] == NULL)
+      continue;
+    if (i != j) {
+      src->batch_bufs[j] = src->batch_bufs[i];
+      src->batch_maps[j] = src->batch_maps[i];
+      src->batch_bufs[i] = NULL;
+    }
+    j++;
+  }
+
+  return ret;
+}
+
+/* wait for the first datagram, then drain the socket until the batch is full
+ * or the max-wait deadline passed */
+static GstFlowReturn
+gst_udpsrc_fill_batch (GstUDPSrc * udpsrc)
+{
+  GstFlowReturn ret;
+  guint batch_size;
+  gint64 deadline;
+  GError *err = NULL;
+  gint n;
+
+  batch_size = MAX (udpsrc->batch_size, 1);
+  gst_udpsrc_ensure_batch (udpsrc, batch_size);
+
+  while (g_queue_is_empty (&udpsrc->batch)) {
+    ret = gst_udpsrc_wait_readable (udpsrc);
+    if (ret != GST_FLOW_OK)
+      return ret;
+
+    if (udpsrc->batch_max_wait > 0)
+      deadline = g_get_monotonic_time () + udpsrc->batch_max_wait / 1000;
+    else
+      deadline = -1;
+
+    while (TRUE) {
+      guint queued = g_queue_get_length (&udpsrc->batch);
+      gint64 remaining;
+
+      ret = gst_udpsrc_prepare_batch_slots (udpsrc, batch_size - queued);
+      if (ret != GST_FLOW_OK)
+        return ret;
+
+      n = gst_udpsrc_receive_batch (udpsrc, batch_size - queued, &err);
+      if (G_UNLIKELY (n < 0))
+        goto receive_error;
+
+      GST_LOG_OBJECT (udpsrc, "received %d datagrams", n);
+
+      ret = gst_udpsrc_queue_batch (udpsrc, n);
+      if (ret != GST_FLOW_OK)
+        return ret;
+
+      if (queued + n >= batch_size || deadline == -1)
+        break;
+
+      remaining = deadline - g_get_monotonic_time ();
+      if (remaining <= 0)
+        break;
+
+      if (!g_socket_condition_timed_wait (udpsrc->used_socket,
+              G_IO_IN | G_IO_PRI, remaining, udpsrc->cancellable, &err)) {
+        if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_TIMED_OUT)) {
+          g_clear_error (&err);
+          break;
+        } else if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_BUSY)
+            || g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+          g_clear_error (&err);
+          return GST_FLOW_FLUSHING;
+        }
+        goto receive_error;
+      }
+    }
+  }
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+receive_error:
+  {
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_BUSY) ||
+        g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      g_clear_error (&err);
+      return GST_FLOW_FLUSHING;
+    } else {
+      GST_ELEMENT_ERROR (udpsrc, RESOURCE, READ, (NULL),
+          ("receive error: %s", err->message));
+      g_clear_error (&err);
+      return GST_FLOW_ERROR;
+    }
+  }
+}
+
+static GstFlowReturn
+gst_udpsrc_create (GstPushSrc * psrc, GstBuffer ** buf)
+{
+  GstFlowReturn ret;
+  GstUDPSrc *udpsrc;
+  GstBuffer *outbuf = NULL;
+  GstMapInfo info;
+  GSocketAddress *saddr = NULL;
+  gsize offset;
+  gssize readsize;
+  gssize res;
+  GError *err = NULL;
+
+  udpsrc = GST_UDPSRC_CAST (psrc);
+
+  if (udpsrc->batch_size > 1 || !g_queue_is_empty (&udpsrc->batch)) {
+    if (g_queue_is_empty (&udpsrc->batch)) {
+      ret = gst_udpsrc_fill_batch (udpsrc);
+      if (ret != GST_FLOW_OK)
+        return ret;
+    }
+    *buf = g_queue_pop_head (&udpsrc->batch);
+    GST_LOG_OBJECT (udpsrc, "handing out batched buffer, %u left",
+        g_queue_get_length (&udpsrc->batch));
+    return GST_FLOW_OK;
+  }
+
+retry:
+  /* quick check, avoid going in select when we already have data */
+  readsize = g_socket_get_available_bytes (udpsrc->used_socket);
+  if (readsize > 0)
+    goto no_select;
+
+  ret = gst_udpsrc_wait_readable (udpsrc);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
   /* ask how much is available for reading on the socket, this should be exactly
    * one UDP packet. We will check the return value, though, because in some
    * case it can return 0 and we don't want a 0 sized buffer. */
@@ -533,19 +971,6 @@ no_select:
   return ret;
 
   /* ERRORS */
-select_error:
-  {
-    GST_ELEMENT_ERROR (udpsrc, RESOURCE, READ, (NULL),
-        ("select error: %s", err->message));
-    g_clear_error (&err);
-    return GST_FLOW_ERROR;
-  }
-stopped:
-  {
-    GST_DEBUG ("stop called");
-    g_clear_error (&err);
-    return GST_FLOW_FLUSHING;
-  }
 get_available_error:
   {
     GST_ELEMENT_ERROR (udpsrc, RESOURCE, READ, (NULL),
@@ -714,6 +1139,12 @@ gst_udpsrc_set_property (GObject * object, guint prop_id, const GValue * value,
     case PROP_REUSE:
       udpsrc->reuse = g_value_get_boolean (value);
       break;
+    case PROP_BATCH_SIZE:
+      udpsrc->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_BATCH_MAX_WAIT:
+      udpsrc->batch_max_wait = g_value_get_uint64 (value);
+      break;
     default:
       break;
   }
@@ -768,6 +1199,12 @@ gst_udpsrc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_REUSE:
       g_value_set_boolean (value, udpsrc->reuse);
       break;
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, udpsrc->batch_size);
+      break;
+    case PROP_BATCH_MAX_WAIT:
+      g_value_set_uint64 (value, udpsrc->batch_max_wait);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1062,6 +1499,9 @@ gst_udpsrc_unlock_stop (GstBaseSrc * bsrc)
   GST_LOG_OBJECT (src, "No longer flushing");
   g_cancellable_reset (src->cancellable);
 
+  /* the streaming thread is stopped, the batch is from before the flush */
+  gst_udpsrc_flush_batch (src);
+
   return TRUE;
 }
 
@@ -1102,6 +1542,8 @@ gst_udpsrc_close (GstUDPSrc * src)
     src->addr = NULL;
   }
 
+  gst_udpsrc_free_batch (src);
+
   return TRUE;
 }
 
@@ -1128,6 +1570,11 @@ gst_udpsrc_change_state (GstElement * element, GstStateChange transition)
     goto failure;
 
   switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* drop datagrams that were received but not handed out yet */
+      g_queue_foreach (&src->batch, (GFunc) gst_buffer_unref, NULL);
+      g_queue_clear (&src->batch);
+      break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       gst_udpsrc_close (src);
       break;
@@ -60,6 +60,8 @@ struct _GstUDPSrc {
   gboolean   close_socket;
   gboolean   auto_multicast;
   gboolean   reuse;
+  guint      batch_size;
+  guint64    batch_max_wait;
 
   /* our sockets */
   GSocket   *used_socket;
@@ -68,6 +70,17 @@ struct _GstUDPSrc {
   gboolean   external_socket;
 
   gchar     *uri;
+
+  /* batched receive, datagrams are read straight into the mapped slot
+   * buffers and handed out from the queue on the next create calls. Small
+   * datagrams are copied out so that the slot is reused. */
+  GQueue     batch;
+  GstBuffer **batch_bufs;
+  GstMapInfo *batch_maps;
+  guint      batch_slots;
+  gsize     *batch_lens;
+  GSocketAddress **batch_addrs;
+  gpointer   batch_msgs;
 };
 
 struct _GstUDPSrcClass {
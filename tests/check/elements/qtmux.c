@@ -54,6 +54,12 @@ static GstPad *mysrcpad, *mysinkpad;
                             "profile=(string)lc, " \
                             "codec_data=(buffer)1208"
 
+#define AUDIO_RAW_CAPS_STRING "audio/x-raw, " \
+                            "format=(string)S16LE, " \
+                            "layout=(string)interleaved, " \
+                            "channels=(int)1, " \
+                            "rate=(int)48000"
+
 #define VIDEO_CAPS_STRING "video/mpeg, " \
                            "mpegversion = (int) 4, " \
                            "systemstream = (boolean) false, " \
@@ -100,6 +106,12 @@ GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS (AUDIO_AAC_CAPS_STRING));
 
+static GstStaticPadTemplate srcaudiorawtemplate =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (AUDIO_RAW_CAPS_STRING));
+
 /* setup and teardown needs some special handling for muxer */
 static GstPad *
 setup_src_pad (GstElement * element,
@@ -889,6 +901,1018 @@ GST_START_TEST (test_average_bitrate)
 GST_END_TEST;
 
 
+/* the samples of the demux tests have different sizes and are filled with
+ * their index, with a keyframe every 10 samples. Large samples are for the
+ * tests that need several samples in the size of a pull. */
+#define DEMUX_SAMPLE_SIZE(i,large) ((large) ? 100 + (i) * 7 : 1 + (i) % 16)
+#define DEMUX_SAMPLE_BYTE(i) ((i) & 0xff)
+
+/* The samples last one frame of 1/30s and have PTS == DTS. With variable
+ * timing, they last 1, 2 or 3 frames in runs of 7 samples and the PTS is up
+ * to 3 frames after the DTS, so that the file gets stts entries of
+ * different durations and a ctts. The times are in frames. */
+static void
+demux_sample_timing (guint i, gboolean variable, guint64 * dts,
+    guint * duration, guint * pts_offset)
+{
+  static const guint run_start[] = { 0, 7, 21 };
+  guint r = i % 21;
+
+  if (!variable) {
+    *dts = i;
+    *duration = 1;
+    *pts_offset = 0;
+    return;
+  }
+
+  *dts = (guint64) (i / 21) * 42 + run_start[r / 7] + (r % 7) * (r / 7 + 1);
+  *duration = 1 + r / 7;
+  *pts_offset = i % 4;
+}
+
+#define DEMUX_FRAMES_TO_TIME(f) gst_util_uint64_scale (f, GST_SECOND, 30)
+
+/* the DTS of frame @f in a track with a timescale of 1000, where the frames
+ * of 33.3ms last 33 or 34ms */
+#define DEMUX_FRAMES_TO_MS_TIME(f) gst_util_uint64_scale ( \
+    gst_util_uint64_scale_round (DEMUX_FRAMES_TO_TIME (f), 1000, GST_SECOND), \
+    GST_SECOND, 1000)
+
+typedef struct
+{
+  guint n_buffers;
+  guint fragment_duration;
+  const gchar *sample_table_file;
+  gboolean variable;            /* variable durations and PTS != DTS */
+  gboolean large_samples;
+  gboolean faststart;
+  guint trak_timescale;
+} MuxParams;
+
+static void
+mux_file (const gchar * location, const MuxParams * params)
+{
+  GstElement *qtmux;
+  GstElement *filesink;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GstSegment segment;
+  guint i;
+
+  qtmux = gst_check_setup_element ("qtmux");
+  g_object_set (qtmux, "fragment-duration", params->fragment_duration,
+      "sample-table-file", params->sample_table_file,
+      "faststart", params->faststart, "trak-timescale",
+      params->trak_timescale, NULL);
+  filesink = gst_element_factory_make ("filesink", NULL);
+  g_object_set (filesink, "location", location, NULL);
+  gst_element_link (qtmux, filesink);
+  mysrcpad = setup_src_pad (qtmux, &srcvideoh264template, "video_%u");
+  fail_unless (mysrcpad != NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  fail_unless (gst_element_set_state (filesink,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set filesink to playing");
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_pad_set_caps (mysrcpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  for (i = 0; i < params->n_buffers; i++) {
+    guint64 dts;
+    guint duration, pts_offset;
+    gsize size = DEMUX_SAMPLE_SIZE (i, params->large_samples);
+
+    demux_sample_timing (i, params->variable, &dts, &duration, &pts_offset);
+    inbuffer = gst_buffer_new_and_alloc (size);
+    gst_buffer_memset (inbuffer, 0, DEMUX_SAMPLE_BYTE (i), size);
+    GST_BUFFER_DTS (inbuffer) = DEMUX_FRAMES_TO_TIME (dts);
+    GST_BUFFER_PTS (inbuffer) = DEMUX_FRAMES_TO_TIME (dts + pts_offset);
+    GST_BUFFER_DURATION (inbuffer) = DEMUX_FRAMES_TO_TIME (dts + duration) -
+        GST_BUFFER_DTS (inbuffer);
+    if (i % 10 != 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  }
+
+  /* send eos to have moov written */
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  gst_element_set_state (qtmux, GST_STATE_NULL);
+  gst_element_set_state (filesink, GST_STATE_NULL);
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  teardown_src_pad (mysrcpad);
+  gst_object_unref (filesink);
+  gst_check_teardown_element (qtmux);
+}
+
+typedef struct
+{
+  guint64 offset;
+  gsize size;
+} DemuxRange;
+
+/* the pull_range calls of qtdemux */
+typedef struct
+{
+  guint n_pulls;
+  gsize max_size;
+  GArray *ranges;               /* DemuxRange of every pull when not NULL */
+} DemuxPulls;
+
+static GstPadProbeReturn
+count_pulls (GstPad * pad, GstPadProbeInfo * info, DemuxPulls * pulls)
+{
+  DemuxRange range;
+
+  range.offset = GST_PAD_PROBE_INFO_OFFSET (info);
+  range.size = gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info));
+
+  pulls->n_pulls++;
+  pulls->max_size = MAX (pulls->max_size, range.size);
+  if (pulls->ranges)
+    g_array_append_val (pulls->ranges, range);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* the existing @pulls->ranges are kept */
+static void
+add_pulls_probe (GstElement * demux, DemuxPulls * pulls)
+{
+  GstPad *pad;
+
+  pulls->n_pulls = 0;
+  pulls->max_size = 0;
+
+  pad = gst_element_get_static_pad (demux, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_PULL | GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) count_pulls, pulls, NULL);
+  gst_object_unref (pad);
+}
+
+#define DEMUX_MS_N_BUFFERS 3000
+
+typedef struct
+{
+  guint n_buffers;
+  GList *buffers;               /* only kept when keep is TRUE */
+  gboolean keep;
+  guint first;                  /* index of the first sample */
+  gboolean variable;            /* check the timing of mux_file() */
+  gboolean large_samples;
+  DemuxPulls pulls;
+  gboolean by_time;             /* samples in any order, known by their DTS */
+  gboolean ms_timescale;        /* check the timing in a timescale of 1000 */
+} DemuxResult;
+
+static void
+demux_handoff (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    DemuxResult * result)
+{
+  GstMapInfo map;
+  guint i;
+  gsize j;
+
+  if (result->by_time)
+    i = gst_util_uint64_scale_round (GST_BUFFER_DTS (buf), 30, GST_SECOND);
+  else
+    i = result->first + result->n_buffers;
+  result->n_buffers++;
+
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      DEMUX_SAMPLE_SIZE (i, result->large_samples));
+  fail_unless_equals_int (GST_BUFFER_FLAG_IS_SET (buf,
+          GST_BUFFER_FLAG_DELTA_UNIT), i % 10 != 0);
+
+  if (result->variable) {
+    guint64 dts;
+    guint duration, pts_offset;
+
+    demux_sample_timing (i, TRUE, &dts, &duration, &pts_offset);
+    fail_unless_equals_uint64 (GST_BUFFER_DTS (buf),
+        DEMUX_FRAMES_TO_TIME (dts));
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf),
+        DEMUX_FRAMES_TO_TIME (dts + pts_offset));
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf),
+        DEMUX_FRAMES_TO_TIME (dts + duration) - DEMUX_FRAMES_TO_TIME (dts));
+  }
+
+  if (result->ms_timescale) {
+    fail_unless_equals_uint64 (GST_BUFFER_DTS (buf),
+        DEMUX_FRAMES_TO_MS_TIME (i));
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf),
+        DEMUX_FRAMES_TO_MS_TIME (i));
+    /* the last sample has the duration of the buffer */
+    if (i + 1 < DEMUX_MS_N_BUFFERS)
+      fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf),
+          DEMUX_FRAMES_TO_MS_TIME (i + 1) - DEMUX_FRAMES_TO_MS_TIME (i));
+  }
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  for (j = 0; j < map.size; j++)
+    fail_unless_equals_int (map.data[j], DEMUX_SAMPLE_BYTE (i));
+  gst_buffer_unmap (buf, &map);
+
+  if (result->keep)
+    result->buffers = g_list_append (result->buffers, gst_buffer_ref (buf));
+}
+
+/* a prerolled pipeline that demuxes the file at @location and checks the
+ * samples written by mux_file() */
+static GstElement *
+demux_file_setup (const gchar * location, guint read_ahead,
+    DemuxResult * result)
+{
+  GstElement *pipeline, *src, *demux, *sink;
+
+  pipeline = gst_parse_launch ("filesrc name=src ! qtdemux name=demux ! "
+      "fakesink name=sink signal-handoffs=true", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "location", location, NULL);
+  demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  g_object_set (demux, "read-ahead", read_ahead, NULL);
+  add_pulls_probe (demux, &result->pulls);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (demux_handoff), result);
+  gst_object_unref (sink);
+  gst_object_unref (demux);
+  gst_object_unref (src);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PAUSED)
+      != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  return pipeline;
+}
+
+/* flushing seek in a paused @pipeline, returns when it prerolled again */
+static void
+demux_file_seek (GstElement * pipeline, gdouble rate, GstClockTime start,
+    GstClockTime stop)
+{
+  fail_unless (gst_element_seek (pipeline, rate, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, start,
+          GST_CLOCK_TIME_IS_VALID (stop) ? GST_SEEK_TYPE_SET :
+          GST_SEEK_TYPE_NONE, stop));
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+}
+
+/* play @pipeline to the end and free it */
+static void
+demux_file_run (GstElement * pipeline)
+{
+  GstMessage *msg;
+  GstBus *bus;
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING)
+      != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_ERROR | GST_MESSAGE_EOS);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+/* demux the file at @location from @seek and check the samples written by
+ * mux_file() */
+static void
+demux_file (const gchar * location, guint read_ahead, GstClockTime seek,
+    DemuxResult * result)
+{
+  GstElement *pipeline;
+
+  pipeline = demux_file_setup (location, read_ahead, result);
+  if (GST_CLOCK_TIME_IS_VALID (seek))
+    demux_file_seek (pipeline, 1.0, seek, GST_CLOCK_TIME_NONE);
+  demux_file_run (pipeline);
+}
+
+/* compare the timestamps of the buffers in @result with the ones in @ref */
+static void
+compare_demuxed_buffers (DemuxResult * result, DemuxResult * ref)
+{
+  GList *l, *r;
+
+  fail_unless_equals_int (g_list_length (result->buffers),
+      g_list_length (ref->buffers));
+  for (l = result->buffers, r = ref->buffers; l; l = l->next, r = r->next) {
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (l->data),
+        GST_BUFFER_PTS (r->data));
+    fail_unless_equals_uint64 (GST_BUFFER_DTS (l->data),
+        GST_BUFFER_DTS (r->data));
+  }
+  g_list_free_full (result->buffers, (GDestroyNotify) gst_buffer_unref);
+}
+
+GST_START_TEST (test_demux_read_ahead)
+{
+  MuxParams params = { 50, 0, NULL, FALSE, TRUE };
+  DemuxResult ref = { 0, NULL, TRUE, 0, FALSE, TRUE };
+  DemuxResult result = { 0, NULL, TRUE, 0, FALSE, TRUE };
+  gchar *location;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxtest",
+      g_random_int ());
+  mux_file (location, &params);
+
+  /* every sample on its own */
+  demux_file (location, 0, GST_CLOCK_TIME_NONE, &ref);
+  fail_unless_equals_int (ref.n_buffers, 50);
+
+  /* a few samples per pull */
+  demux_file (location, 1000, GST_CLOCK_TIME_NONE, &result);
+  fail_unless_equals_int (result.n_buffers, 50);
+  compare_demuxed_buffers (&result, &ref);
+
+  /* the whole file in one pull */
+  result.n_buffers = 0;
+  result.buffers = NULL;
+  demux_file (location, 1024 * 1024, GST_CLOCK_TIME_NONE,
+      &result);
+  fail_unless_equals_int (result.n_buffers, 50);
+  compare_demuxed_buffers (&result, &ref);
+
+  g_list_free_full (ref.buffers, (GDestroyNotify) gst_buffer_unref);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* the audio of the audio and video demux test is raw audio in buffers of
+ * 1/3s filled with their index, every buffer is a chunk of its own that
+ * qtdemux pushes in parts of 4096 frames */
+#define DEMUX_AV_N_BUFFERS 300
+#define DEMUX_AUDIO_BUFFER_SIZE (16000 * 2)
+#define DEMUX_AUDIO_MAX_SIZE (4096 * 2)
+
+static void
+push_demux_stream (GstPad * pad, gboolean audio, guint n_buffers)
+{
+  GstClockTime duration = audio ? GST_SECOND / 3 : GST_SECOND / 30;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GstSegment segment;
+  guint i;
+
+  gst_pad_push_event (pad,
+      gst_event_new_stream_start (audio ? "test-audio" : "test-video"));
+
+  caps = gst_pad_get_pad_template_caps (pad);
+  gst_pad_set_caps (pad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (pad, gst_event_new_segment (&segment)));
+
+  for (i = 0; i < n_buffers; i++) {
+    gsize size =
+        audio ? DEMUX_AUDIO_BUFFER_SIZE : DEMUX_SAMPLE_SIZE (i, FALSE);
+
+    inbuffer = gst_buffer_new_and_alloc (size);
+    gst_buffer_memset (inbuffer, 0, DEMUX_SAMPLE_BYTE (i), size);
+    GST_BUFFER_PTS (inbuffer) = GST_BUFFER_DTS (inbuffer) = i * duration;
+    GST_BUFFER_DURATION (inbuffer) = duration;
+    if (!audio && i % 10 != 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless (gst_pad_push (pad, inbuffer) == GST_FLOW_OK);
+  }
+
+  fail_unless (gst_pad_push_event (pad, gst_event_new_eos ()) == TRUE);
+}
+
+static gpointer
+push_demux_audio (GstPad * pad)
+{
+  push_demux_stream (pad, TRUE, DEMUX_AV_N_BUFFERS / 10);
+
+  return NULL;
+}
+
+/* mux DEMUX_AV_N_BUFFERS video samples and the audio of the same duration,
+ * the pads are fed from two threads as qtmux waits for data on both */
+static void
+mux_av_file (const gchar * location)
+{
+  GstElement *qtmux;
+  GstElement *filesink;
+  GstPad *audiopad;
+  GThread *thread;
+
+  qtmux = gst_check_setup_element ("qtmux");
+  filesink = gst_element_factory_make ("filesink", NULL);
+  g_object_set (filesink, "location", location, NULL);
+  gst_element_link (qtmux, filesink);
+  mysrcpad = setup_src_pad (qtmux, &srcvideoh264template, "video_%u");
+  fail_unless (mysrcpad != NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  audiopad = setup_src_pad (qtmux, &srcaudiorawtemplate, "audio_%u");
+  fail_unless (audiopad != NULL);
+  gst_pad_set_active (audiopad, TRUE);
+
+  fail_unless (gst_element_set_state (filesink,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set filesink to playing");
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  thread = g_thread_new ("audio", (GThreadFunc) push_demux_audio, audiopad);
+  push_demux_stream (mysrcpad, FALSE, DEMUX_AV_N_BUFFERS);
+  g_thread_join (thread);
+
+  gst_element_set_state (qtmux, GST_STATE_NULL);
+  gst_element_set_state (filesink, GST_STATE_NULL);
+
+  gst_pad_set_active (audiopad, FALSE);
+  teardown_src_pad (audiopad);
+  gst_pad_set_active (mysrcpad, FALSE);
+  teardown_src_pad (mysrcpad);
+  gst_object_unref (filesink);
+  gst_check_teardown_element (qtmux);
+}
+
+typedef struct
+{
+  guint n_video;
+  GByteArray *audio;
+  DemuxPulls pulls;
+} DemuxAVResult;
+
+static void
+demux_video_handoff (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    DemuxAVResult * result)
+{
+  guint i = result->n_video++;
+  GstMapInfo map;
+  gsize j;
+
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      DEMUX_SAMPLE_SIZE (i, FALSE));
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  for (j = 0; j < map.size; j++)
+    fail_unless_equals_int (map.data[j], DEMUX_SAMPLE_BYTE (i));
+  gst_buffer_unmap (buf, &map);
+}
+
+static void
+demux_audio_handoff (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    DemuxAVResult * result)
+{
+  GstMapInfo map;
+
+  fail_unless (gst_buffer_get_size (buf) <= DEMUX_AUDIO_MAX_SIZE);
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  g_byte_array_append (result->audio, map.data, map.size);
+  gst_buffer_unmap (buf, &map);
+}
+
+/* demux the file written by mux_av_file(), check the samples of both
+ * streams and count the pull_range calls of qtdemux */
+static void
+demux_av_file (const gchar * location, guint read_ahead,
+    DemuxAVResult * result)
+{
+  GstElement *pipeline, *src, *demux, *vsink, *asink;
+  GstMessage *msg;
+  GstBus *bus;
+  guint i;
+
+  pipeline = gst_parse_launch ("filesrc name=src ! qtdemux name=demux "
+      "demux.video_0 ! queue ! fakesink name=vsink signal-handoffs=true "
+      "demux.audio_0 ! queue ! fakesink name=asink signal-handoffs=true",
+      NULL);
+  fail_unless (pipeline != NULL);
+
+  result->n_video = 0;
+  result->audio = g_byte_array_new ();
+  result->pulls.ranges = NULL;
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "location", location, NULL);
+  demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  g_object_set (demux, "read-ahead", read_ahead, NULL);
+  add_pulls_probe (demux, &result->pulls);
+  vsink = gst_bin_get_by_name (GST_BIN (pipeline), "vsink");
+  g_signal_connect (vsink, "handoff", G_CALLBACK (demux_video_handoff),
+      result);
+  asink = gst_bin_get_by_name (GST_BIN (pipeline), "asink");
+  g_signal_connect (asink, "handoff", G_CALLBACK (demux_audio_handoff),
+      result);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING)
+      != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_ERROR | GST_MESSAGE_EOS);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (asink);
+  gst_object_unref (vsink);
+  gst_object_unref (demux);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+
+  fail_unless_equals_int (result->n_video, DEMUX_AV_N_BUFFERS);
+  fail_unless_equals_int (result->audio->len,
+      DEMUX_AV_N_BUFFERS / 10 * DEMUX_AUDIO_BUFFER_SIZE);
+  for (i = 0; i < result->audio->len; i++)
+    fail_unless_equals_int (result->audio->data[i],
+        DEMUX_SAMPLE_BYTE (i / DEMUX_AUDIO_BUFFER_SIZE));
+  g_byte_array_unref (result->audio);
+}
+
+/* interleaved audio and video, of which the audio chunks are pushed in
+ * parts, read ahead has to give the same data in fewer pulls */
+GST_START_TEST (test_demux_read_ahead_av)
+{
+  DemuxAVResult ref, result;
+  gchar *location;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxtest",
+      g_random_int ());
+  mux_av_file (location);
+
+  /* every sample and every part of an audio chunk on its own */
+  demux_av_file (location, 0, &ref);
+  fail_unless (ref.pulls.n_pulls > DEMUX_AV_N_BUFFERS);
+
+  /* the audio chunks and the video samples around them in one pull */
+  demux_av_file (location, 64 * 1024, &result);
+  fail_unless (result.pulls.n_pulls * 4 < ref.pulls.n_pulls,
+      "%u pulls with read-ahead, %u without", result.pulls.n_pulls,
+      ref.pulls.n_pulls);
+
+  /* the parts of the audio chunks are too big for the window and are pulled
+   * on their own, the video samples between them still in one pull */
+  demux_av_file (location, 4096, &result);
+  fail_unless (result.pulls.n_pulls < ref.pulls.n_pulls,
+      "%u pulls with read-ahead, %u without", result.pulls.n_pulls,
+      ref.pulls.n_pulls);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* sample timing in many stts runs of different durations with a ctts, the
+ * DTS, PTS, duration and keyframe flag of every sample are checked, also
+ * after seeking to the start and into the middle of runs */
+GST_START_TEST (test_demux_sample_timing)
+{
+  /* the first samples of a run, in the middle of a run and the last run */
+  static const guint seek_samples[] = { 7, 2107, 5250 + 14, 7000 + 10,
+    10500 - 2
+  };
+  MuxParams params = { 10500, 0, NULL, TRUE };
+  DemuxResult result = { 0, NULL, FALSE, 0, TRUE };
+  gchar *location;
+  guint i;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxtest",
+      g_random_int ());
+  mux_file (location, &params);
+
+  demux_file (location, 0, GST_CLOCK_TIME_NONE, &result);
+  fail_unless_equals_int (result.n_buffers, 10500);
+
+  for (i = 0; i < G_N_ELEMENTS (seek_samples); i++) {
+    guint sample = seek_samples[i];
+    guint64 dts;
+    guint duration, pts_offset;
+
+    demux_sample_timing (sample, TRUE, &dts, &duration, &pts_offset);
+
+    /* at the start of the sample, playback starts at the keyframe before */
+    result.n_buffers = 0;
+    result.first = sample - sample % 10;
+    demux_file (location, 0, DEMUX_FRAMES_TO_TIME (dts), &result);
+    fail_unless_equals_int (result.n_buffers, 10500 - result.first);
+
+    /* the same in the middle of a sample of more than one frame */
+    if (duration > 1) {
+      result.n_buffers = 0;
+      demux_file (location, 0, DEMUX_FRAMES_TO_TIME (dts + 1), &result);
+      fail_unless_equals_int (result.n_buffers, 10500 - result.first);
+    }
+  }
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* 30 fps in a timescale of 1000, where the durations of 33 and 34ms change
+ * every one or two samples. The samples go to the time table of qtdemux
+ * instead of runs. */
+GST_START_TEST (test_demux_ms_timing)
+{
+  static const guint seek_samples[] = { 1, 1235, DEMUX_MS_N_BUFFERS - 2 };
+  MuxParams params = { DEMUX_MS_N_BUFFERS, 0, NULL, FALSE, FALSE, FALSE,
+    1000
+  };
+  DemuxResult result = { 0, NULL, FALSE };
+  gchar *location;
+  guint i;
+
+  result.ms_timescale = TRUE;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxtest",
+      g_random_int ());
+  mux_file (location, &params);
+
+  demux_file (location, 0, GST_CLOCK_TIME_NONE, &result);
+  fail_unless_equals_int (result.n_buffers, DEMUX_MS_N_BUFFERS);
+
+  /* playback starts at the keyframe before the sample */
+  for (i = 0; i < G_N_ELEMENTS (seek_samples); i++) {
+    guint sample = seek_samples[i];
+
+    result.n_buffers = 0;
+    result.first = sample - sample % 10;
+    demux_file (location, 0, DEMUX_FRAMES_TO_MS_TIME (sample), &result);
+    fail_unless_equals_int (result.n_buffers,
+        DEMUX_MS_N_BUFFERS - result.first);
+  }
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* a moov just over the 1MB from which qtdemux reads the sample tables while
+ * playing, the samples take about 8.4 bytes of tables each. None of the
+ * pulls may get the whole moov, also not when seeking close to the end,
+ * which needs the tables of almost all samples. */
+#define DEMUX_LARGE_MOOV_SAMPLES 140000
+#define DEMUX_LAZY_MOOV_SIZE (1024 * 1024)
+
+GST_START_TEST (test_demux_large_moov)
+{
+  MuxParams params = { DEMUX_LARGE_MOOV_SAMPLES, 0, NULL, FALSE };
+  DemuxResult result = { 0, NULL, FALSE };
+  gchar *location;
+  guint64 dts;
+  guint duration, pts_offset;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxtest",
+      g_random_int ());
+  mux_file (location, &params);
+
+  demux_file (location, 0, GST_CLOCK_TIME_NONE, &result);
+  fail_unless_equals_int (result.n_buffers, DEMUX_LARGE_MOOV_SAMPLES);
+  fail_unless (result.pulls.max_size < DEMUX_LAZY_MOOV_SIZE,
+      "pulled %" G_GSIZE_FORMAT " bytes at once", result.pulls.max_size);
+
+  /* into the middle of the last GOP */
+  demux_sample_timing (DEMUX_LARGE_MOOV_SAMPLES - 5, FALSE, &dts, &duration,
+      &pts_offset);
+  result.n_buffers = 0;
+  result.first = DEMUX_LARGE_MOOV_SAMPLES - 10;
+  demux_file (location, 0, DEMUX_FRAMES_TO_TIME (dts), &result);
+  fail_unless_equals_int (result.n_buffers, 10);
+  fail_unless (result.pulls.max_size < DEMUX_LAZY_MOOV_SIZE,
+      "pulled %" G_GSIZE_FORMAT " bytes at once", result.pulls.max_size);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* a moof of the file patched by add_tfdt() */
+typedef struct
+{
+  guint64 offset;
+  gsize size;
+  guint first_sample;
+} DemuxMoof;
+
+#define DEMUX_TFDT_SIZE 20
+
+/* copy @moof to @out with a version 1 tfdt of @decode_time after the tfhd of
+ * its traf. Returns the decode time after its samples and adds their number
+ * to @n_samples. */
+static guint64
+copy_moof_with_tfdt (GByteArray * out, const guint8 * moof, gsize size,
+    guint64 decode_time, guint * n_samples)
+{
+  guint moof_start = out->len;
+  guint32 default_duration = 0;
+  gsize pos;
+
+  g_byte_array_append (out, moof, 8);
+  for (pos = 8; pos + 8 <= size;) {
+    const guint8 *traf = moof + pos;
+    guint32 traf_size = GST_READ_UINT32_BE (traf);
+    guint traf_start = out->len;
+    gsize tpos;
+
+    fail_unless (traf_size >= 8 && pos + traf_size <= size);
+    pos += traf_size;
+    /* the mfhd */
+    if (GST_READ_UINT32_LE (traf + 4) != GST_MAKE_FOURCC ('t', 'r', 'a', 'f')) {
+      g_byte_array_append (out, traf, traf_size);
+      continue;
+    }
+
+    g_byte_array_append (out, traf, 8);
+    for (tpos = 8; tpos + 8 <= traf_size;) {
+      const guint8 *box = traf + tpos;
+      guint32 box_size = GST_READ_UINT32_BE (box);
+      guint32 fourcc = GST_READ_UINT32_LE (box + 4);
+      guint box_start = out->len;
+
+      fail_unless (box_size >= 8 && tpos + box_size <= traf_size);
+      tpos += box_size;
+      g_byte_array_append (out, box, box_size);
+
+      if (fourcc == GST_MAKE_FOURCC ('t', 'f', 'h', 'd')) {
+        guint32 flags = GST_READ_UINT32_BE (box + 8) & 0xffffff;
+        guint8 tfdt[DEMUX_TFDT_SIZE];
+        guint o = 16;
+
+        /* base data offset and sample description index come first */
+        o += (flags & 0x01) ? 8 : 0;
+        o += (flags & 0x02) ? 4 : 0;
+        if (flags & 0x08)
+          default_duration = GST_READ_UINT32_BE (box + o);
+
+        GST_WRITE_UINT32_BE (tfdt, DEMUX_TFDT_SIZE);
+        GST_WRITE_UINT32_LE (tfdt + 4, GST_MAKE_FOURCC ('t', 'f', 'd', 't'));
+        GST_WRITE_UINT32_BE (tfdt + 8, 1 << 24);
+        GST_WRITE_UINT64_BE (tfdt + 12, decode_time);
+        g_byte_array_append (out, tfdt, DEMUX_TFDT_SIZE);
+      } else if (fourcc == GST_MAKE_FOURCC ('t', 'r', 'u', 'n')) {
+        guint32 flags = GST_READ_UINT32_BE (box + 8) & 0xffffff;
+        guint32 count = GST_READ_UINT32_BE (box + 12);
+        guint sample_size = 0;
+        guint o = 16;
+        guint32 i;
+
+        /* the sample data moved by the tfdt, relative to the moof */
+        if (flags & 0x001) {
+          GST_WRITE_UINT32_BE (out->data + box_start + o,
+              GST_READ_UINT32_BE (box + o) + DEMUX_TFDT_SIZE);
+          o += 4;
+        }
+        o += (flags & 0x004) ? 4 : 0;
+        for (i = 0x100; i <= 0x800; i <<= 1)
+          sample_size += (flags & i) ? 4 : 0;
+
+        for (i = 0; i < count; i++, o += sample_size)
+          decode_time += (flags & 0x100) ? GST_READ_UINT32_BE (box + o) :
+              default_duration;
+        *n_samples += count;
+      }
+    }
+    GST_WRITE_UINT32_BE (out->data + traf_start, out->len - traf_start);
+  }
+  GST_WRITE_UINT32_BE (out->data + moof_start, out->len - moof_start);
+
+  return decode_time;
+}
+
+/* qtmux does not write tfdt, add one to the moofs of the single track file
+ * at @location. The mfra is dropped, its moof offsets would be wrong.
+ * Returns the moofs of the new file. */
+static GArray *
+add_tfdt (const gchar * location)
+{
+  GArray *moofs;
+  GByteArray *out;
+  guint64 decode_time = 0;
+  guint n_samples = 0;
+  gchar *data;
+  gsize len, pos;
+
+  fail_unless (g_file_get_contents (location, &data, &len, NULL));
+  out = g_byte_array_sized_new (len + 4096);
+  moofs = g_array_new (FALSE, FALSE, sizeof (DemuxMoof));
+
+  for (pos = 0; pos + 8 <= len;) {
+    const guint8 *atom = (const guint8 *) data + pos;
+    guint32 size = GST_READ_UINT32_BE (atom);
+    guint32 fourcc = GST_READ_UINT32_LE (atom + 4);
+
+    fail_unless (size >= 8 && pos + size <= len);
+    pos += size;
+
+    if (fourcc == GST_MAKE_FOURCC ('m', 'o', 'o', 'f')) {
+      DemuxMoof moof;
+
+      moof.offset = out->len;
+      moof.first_sample = n_samples;
+      decode_time = copy_moof_with_tfdt (out, atom, size, decode_time,
+          &n_samples);
+      moof.size = out->len - moof.offset;
+      g_array_append_val (moofs, moof);
+    } else if (fourcc != GST_MAKE_FOURCC ('m', 'f', 'r', 'a')) {
+      g_byte_array_append (out, atom, size);
+    }
+  }
+
+  fail_unless (g_file_set_contents (location, (const gchar *) out->data,
+          out->len, NULL));
+  g_byte_array_unref (out);
+  g_free (data);
+
+  return moofs;
+}
+
+/* if the moof of @index was pulled completely since pull @start */
+static gboolean
+demux_moof_pulled (GArray * ranges, guint start, GArray * moofs, guint index)
+{
+  DemuxMoof *moof = &g_array_index (moofs, DemuxMoof, index);
+  guint i;
+
+  for (i = start; i < ranges->len; i++) {
+    DemuxRange *range = &g_array_index (ranges, DemuxRange, i);
+
+    if (range->offset == moof->offset && range->size == moof->size)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* check that a seek to @sample went straight to its moof: since pull @start
+ * that moof was parsed, and none of the moofs between the first one and it */
+static void
+check_moof_seek (GArray * ranges, guint start, GArray * moofs, guint sample)
+{
+  guint target, i;
+
+  for (target = 0; target + 1 < moofs->len; target++) {
+    if (g_array_index (moofs, DemuxMoof, target + 1).first_sample > sample)
+      break;
+  }
+  fail_unless (target > 1);
+
+  fail_unless (demux_moof_pulled (ranges, start, moofs, target),
+      "moof %u of sample %u was not parsed", target, sample);
+  for (i = 1; i < target; i++)
+    fail_if (demux_moof_pulled (ranges, start, moofs, i),
+        "moof %u before the one of sample %u was parsed", i, sample);
+}
+
+/* seek in a fragmented file with a tfdt in every moof. The samples from
+ * there on are in later moofs than the ones parsed before playing. Seeking
+ * back afterwards and reverse playback need the earlier moofs again. */
+GST_START_TEST (test_demux_fragmented_seek)
+{
+  MuxParams params = { 200, 500, NULL, FALSE };
+  DemuxResult result = { 0, NULL, TRUE, 30 };
+  GstElement *pipeline;
+  GArray *moofs, *ranges;
+  gboolean seen[60] = { FALSE, };
+  gchar *location;
+  GList *l;
+  guint start, i;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxtest",
+      g_random_int ());
+  mux_file (location, &params);
+  /* qtmux starts a fragment at every keyframe */
+  moofs = add_tfdt (location);
+  fail_unless_equals_int (moofs->len, 20);
+
+  ranges = g_array_new (FALSE, FALSE, sizeof (DemuxRange));
+  result.pulls.ranges = ranges;
+
+  /* forward to 5s and back to 1s */
+  pipeline = demux_file_setup (location, 0, &result);
+  start = ranges->len;
+  demux_file_seek (pipeline, 1.0, 5 * GST_SECOND, GST_CLOCK_TIME_NONE);
+  check_moof_seek (ranges, start, moofs, 150);
+  start = ranges->len;
+  demux_file_seek (pipeline, 1.0, 1 * GST_SECOND, GST_CLOCK_TIME_NONE);
+  check_moof_seek (ranges, start, moofs, 30);
+  demux_file_run (pipeline);
+
+  fail_unless_equals_int (result.n_buffers, 170);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (result.buffers->data),
+      1 * GST_SECOND);
+  fail_unless_equals_uint64 (GST_BUFFER_DTS (result.buffers->data),
+      1 * GST_SECOND);
+  g_list_free_full (result.buffers, (GDestroyNotify) gst_buffer_unref);
+
+  /* forward to 5s, then backwards from 2s, which has to get back to the
+   * first moof and play all the samples before 2s */
+  result.n_buffers = 0;
+  result.buffers = NULL;
+  result.by_time = TRUE;
+  g_array_set_size (ranges, 0);
+  pipeline = demux_file_setup (location, 0, &result);
+  demux_file_seek (pipeline, 1.0, 5 * GST_SECOND, GST_CLOCK_TIME_NONE);
+  start = ranges->len;
+  demux_file_seek (pipeline, -1.0, 0, 2 * GST_SECOND);
+  fail_unless (demux_moof_pulled (ranges, start, moofs, 0));
+  demux_file_run (pipeline);
+
+  for (l = result.buffers; l; l = l->next) {
+    i = gst_util_uint64_scale_round (GST_BUFFER_DTS (l->data), 30, GST_SECOND);
+    if (i < G_N_ELEMENTS (seen))
+      seen[i] = TRUE;
+  }
+  for (i = 0; i < G_N_ELEMENTS (seen); i++)
+    fail_unless (seen[i], "sample %u was not played", i);
+  g_list_free_full (result.buffers, (GDestroyNotify) gst_buffer_unref);
+
+  g_array_free (ranges, TRUE);
+  g_array_free (moofs, TRUE);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* mux a file with @params once with and once without a sample table file,
+ * both have to be of the same size and demux the same */
+static void
+check_sample_table_file (MuxParams * params)
+{
+  DemuxResult ref = { 0, NULL, TRUE, 0, params->variable };
+  DemuxResult result = { 0, NULL, TRUE, 0, params->variable };
+  gchar *location, *ref_location, *table_location;
+  GStatBuf st, ref_st;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxtest",
+      g_random_int ());
+  ref_location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxtest",
+      g_random_int ());
+  table_location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (),
+      "qtmuxtest-table", g_random_int ());
+
+  params->sample_table_file = NULL;
+  mux_file (ref_location, params);
+  demux_file (ref_location, 0, GST_CLOCK_TIME_NONE, &ref);
+  fail_unless_equals_int (ref.n_buffers, params->n_buffers);
+
+  params->sample_table_file = table_location;
+  mux_file (location, params);
+  fail_if (g_file_test (table_location, G_FILE_TEST_EXISTS));
+  demux_file (location, 0, GST_CLOCK_TIME_NONE, &result);
+  fail_unless_equals_int (result.n_buffers, params->n_buffers);
+  compare_demuxed_buffers (&result, &ref);
+
+  fail_unless (g_stat (location, &st) == 0);
+  fail_unless (g_stat (ref_location, &ref_st) == 0);
+  fail_unless_equals_uint64 (st.st_size, ref_st.st_size);
+
+  g_list_free_full (ref.buffers, (GDestroyNotify) gst_buffer_unref);
+  g_unlink (location);
+  g_unlink (ref_location);
+  g_free (location);
+  g_free (ref_location);
+  g_free (table_location);
+}
+
+/* enough samples for the sample tables to go to the sample table file in
+ * several blocks */
+GST_START_TEST (test_sample_table_file)
+{
+  MuxParams params = { 50000, 0, NULL, FALSE };
+
+  check_sample_table_file (&params);
+
+  /* the moov before the data, the chunk offsets from the file are moved */
+  params.faststart = TRUE;
+  check_sample_table_file (&params);
+
+  /* stts entries of different durations and a ctts, from PTS != DTS */
+  params.faststart = FALSE;
+  params.variable = TRUE;
+  check_sample_table_file (&params);
+}
+
+GST_END_TEST;
+
 static Suite *
 qtmux_suite (void)
 {
@@ -918,6 +1942,13 @@ qtmux_suite (void)
   tcase_add_test (tc_chain, test_audio_pad_frag_asc_streamable);
 
   tcase_add_test (tc_chain, test_average_bitrate);
+  tcase_add_test (tc_chain, test_demux_read_ahead);
+  tcase_add_test (tc_chain, test_demux_read_ahead_av);
+  tcase_add_test (tc_chain, test_demux_sample_timing);
+  tcase_add_test (tc_chain, test_demux_ms_timing);
+  tcase_add_test (tc_chain, test_demux_large_moov);
+  tcase_add_test (tc_chain, test_demux_fragmented_seek);
+  tcase_add_test (tc_chain, test_sample_table_file);
 
   tcase_add_test (tc_chain, test_reuse);
   tcase_add_test (tc_chain, test_encodebin_qtmux);
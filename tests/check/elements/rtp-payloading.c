@@ -18,6 +18,8 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/video/video.h>
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -576,6 +578,113 @@ GST_START_TEST (rtp_h264_list_lt_mtu_avc)
       rtp_h264_list_lt_mtu_bytes_sent_avc, rtp_h264_list_lt_mtu_mtu_size, TRUE);
 }
 
+GST_END_TEST;
+/* SPS, PPS and two small slices of one access unit */
+static const guint8 rtp_h264_aggregate_frame_data[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x14, 0xac, 0xd9, 0x41, 0x41,
+  0xfb, 0x01, 0x10, 0x00, 0x00, 0x03, 0x00, 0x17, 0x73, 0x59, 0x40, 0x00,
+  0xf1, 0x42, 0x99, 0x60,
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xec, 0xb2, 0x2c,
+  0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x11, 0x22, 0x33,
+  0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x44, 0x55, 0x66
+};
+
+static GstStaticPadTemplate rtp_payloader_srctemplate =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate rtp_payloader_sinktemplate =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp"));
+
+/*
+ * Pushes one buffer with @data in the payloader @pay, the RTP packets are
+ * collected in the global buffers list.
+ * @return the number of RTP packets
+ */
+static guint
+rtp_payloader_push (const gchar * pay, const gchar * filtercaps,
+    const guint8 * data, gsize size, guint mtu, gint aggregate_mode)
+{
+  GstElement *rtppay;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  GstBuffer *buf;
+  guint num_buffers;
+
+  rtppay = gst_check_setup_element (pay);
+  if (mtu)
+    g_object_set (rtppay, "mtu", mtu, NULL);
+  if (aggregate_mode >= 0)
+    g_object_set (rtppay, "aggregate-mode", aggregate_mode, NULL);
+  srcpad = gst_check_setup_src_pad (rtppay, &rtp_payloader_srctemplate);
+  sinkpad = gst_check_setup_sink_pad (rtppay, &rtp_payloader_sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (rtppay, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (filtercaps);
+  gst_check_setup_events (srcpad, rtppay, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (guint8 *) data, size, 0, size, NULL, NULL);
+  GST_BUFFER_PTS (buf) = 0;
+  fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+  /* drain data that the payloader keeps until EOS */
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  num_buffers = g_list_length (buffers);
+
+  gst_element_set_state (rtppay, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (rtppay);
+  gst_check_teardown_sink_pad (rtppay);
+  gst_check_teardown_element (rtppay);
+
+  return num_buffers;
+}
+
+GST_START_TEST (rtp_h264_aggregate)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 *payload;
+
+  /* one packet per NAL unit */
+  fail_unless_equals_int (rtp_payloader_push ("rtph264pay",
+          "video/x-h264,stream-format=byte-stream,alignment=au",
+          rtp_h264_aggregate_frame_data,
+          sizeof (rtp_h264_aggregate_frame_data), 0, 0), 4);
+  gst_check_drop_buffers ();
+
+  /* all NAL units in one STAP-A packet */
+  fail_unless_equals_int (rtp_payloader_push ("rtph264pay",
+          "video/x-h264,stream-format=byte-stream,alignment=au",
+          rtp_h264_aggregate_frame_data,
+          sizeof (rtp_h264_aggregate_frame_data), 0, 1), 1);
+
+  fail_unless (gst_rtp_buffer_map (buffers->data, GST_MAP_READ, &rtp));
+  fail_unless (gst_rtp_buffer_get_marker (&rtp));
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp),
+      1 + (2 + 24) + (2 + 5) + (2 + 5) + (2 + 5));
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  /* STAP-A with the NRI of the SPS */
+  fail_unless_equals_int (payload[0], 0x60 | 24);
+  fail_unless_equals_int (GST_READ_UINT16_BE (payload + 1), 24);
+  fail_unless_equals_int (payload[3], 0x67);
+  fail_unless_equals_int (GST_READ_UINT16_BE (payload + 27), 5);
+  fail_unless_equals_int (payload[29], 0x68);
+  gst_rtp_buffer_unmap (&rtp);
+
+  gst_check_drop_buffers ();
+}
+
 GST_END_TEST;
 static const guint8 rtp_h264_list_gt_mtu_frame_data[] =
     /* not packetized, next NAL starts with 0001 */
@@ -687,6 +796,165 @@ GST_START_TEST (rtp_mp2t)
 }
 
 GST_END_TEST;
+
+/* 21 TS packets with a PCR every 7 packets, 10ms apart, starting at @start in
+ * 90kHz units */
+static GstBuffer *
+rtp_mp2t_pcr_buffer (guint64 start)
+{
+  guint8 *data, *p;
+  guint i;
+
+  data = g_malloc0 (21 * 188);
+  for (i = 0; i < 21; i++) {
+    p = data + i * 188;
+    p[0] = 0x47;
+    p[1] = 0x01;
+    p[2] = 0x00;
+    if (i % 7 == 0) {
+      guint64 base = start + (i / 7) * 900;
+
+      /* adaptation field with only a PCR */
+      p[3] = 0x30;
+      p[4] = 7;
+      p[5] = 0x10;
+      p[6] = base >> 25;
+      p[7] = base >> 17;
+      p[8] = base >> 9;
+      p[9] = base >> 1;
+      p[10] = ((base & 1) << 7) | 0x7e;
+      p[11] = 0;
+    } else {
+      p[3] = 0x10;
+    }
+  }
+
+  return gst_buffer_new_wrapped (data, 21 * 188);
+}
+
+GST_START_TEST (rtp_mp2t_pcr_pacing)
+{
+  GstElement *rtppay;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  GstBuffer *buf;
+  GList *l;
+  guint i;
+
+  rtppay = gst_check_setup_element ("rtpmp2tpay");
+  /* 7 TS packets per RTP packet */
+  g_object_set (rtppay, "mtu", 12 + 7 * 188, "pcr-pacing", TRUE, NULL);
+  srcpad = gst_check_setup_src_pad (rtppay, &rtp_payloader_srctemplate);
+  sinkpad = gst_check_setup_sink_pad (rtppay, &rtp_payloader_sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (rtppay, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("video/mpegts,packetsize=188,systemstream=true");
+  gst_check_setup_events (srcpad, rtppay, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  buf = rtp_mp2t_pcr_buffer (0);
+  GST_BUFFER_PTS (buf) = GST_SECOND;
+  GST_BUFFER_DURATION (buf) = 30 * GST_MSECOND;
+  fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+
+  /* the first packet has the input timestamp, the others follow the PCR */
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    buf = l->data;
+    fail_unless_equals_int (gst_buffer_get_size (buf), 12 + 7 * 188);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf),
+        GST_SECOND + i * 10 * GST_MSECOND);
+  }
+  fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf), 10 * GST_MSECOND);
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (rtppay, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (rtppay);
+  gst_check_teardown_sink_pad (rtppay);
+  gst_check_teardown_element (rtppay);
+}
+
+GST_END_TEST;
+
+/* pushes a buffer of PCRs from @start at @pts and checks that the packets are
+ * paced from @expected */
+static void
+rtp_mp2t_push_paced (GstPad * srcpad, guint64 start, GstClockTime pts,
+    gboolean discont, GstClockTime expected)
+{
+  GstBuffer *buf;
+  GList *l;
+  guint i;
+
+  buf = rtp_mp2t_pcr_buffer (start);
+  GST_BUFFER_PTS (buf) = pts;
+  GST_BUFFER_DURATION (buf) = 30 * GST_MSECOND;
+  if (discont)
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+  fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  for (l = buffers, i = 0; l; l = l->next, i++)
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (l->data),
+        expected + i * 10 * GST_MSECOND);
+  gst_check_drop_buffers ();
+}
+
+GST_START_TEST (rtp_mp2t_pcr_pacing_restart)
+{
+  GstElement *rtppay;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  GstSegment segment;
+
+  rtppay = gst_check_setup_element ("rtpmp2tpay");
+  g_object_set (rtppay, "mtu", 12 + 7 * 188, "pcr-pacing", TRUE, NULL);
+  srcpad = gst_check_setup_src_pad (rtppay, &rtp_payloader_srctemplate);
+  sinkpad = gst_check_setup_sink_pad (rtppay, &rtp_payloader_sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (rtppay, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("video/mpegts,packetsize=188,systemstream=true");
+  gst_check_setup_events (srcpad, rtppay, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* the PCR continues over two buffers */
+  rtp_mp2t_push_paced (srcpad, 0, GST_SECOND, FALSE, GST_SECOND);
+  rtp_mp2t_push_paced (srcpad, 2700, GST_SECOND + 30 * GST_MSECOND, FALSE,
+      GST_SECOND + 30 * GST_MSECOND);
+
+  /* the input jumps ahead while the PCR continues, pacing follows the input */
+  rtp_mp2t_push_paced (srcpad, 5400, 3 * GST_SECOND, FALSE, 3 * GST_SECOND);
+
+  /* a flushing seek back in time */
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_flush_stop (TRUE)));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+  rtp_mp2t_push_paced (srcpad, 0, GST_SECOND, FALSE, GST_SECOND);
+
+  /* a discont a little back in time with a continuing PCR is not clamped to
+   * the time of the previous packets */
+  rtp_mp2t_push_paced (srcpad, 2700, 900 * GST_MSECOND, TRUE,
+      900 * GST_MSECOND);
+
+  gst_element_set_state (rtppay, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (rtppay);
+  gst_check_teardown_sink_pad (rtppay);
+  gst_check_teardown_element (rtppay);
+}
+
+GST_END_TEST;
+
 static const guint8 rtp_mp4v_frame_data[] =
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
@@ -888,6 +1156,111 @@ GST_START_TEST (rtp_jpeg_list_width_and_height_greater_than_2040)
 
 GST_END_TEST;
 
+/* a 16x16 picture with two quant tables, the first one filled with
+ * @luma_quant */
+static GstBuffer *
+rtp_jpeg_header_frame (guint8 luma_quant)
+{
+  static const guint8 sof[] = {
+    0xFF, 0xC0, 0x00, 0x11, 0x08, 0x00, 0x10, 0x00, 0x10,
+    0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01
+  };
+  static const guint8 sos[] = {
+    0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11,
+    0x00, 0x3F, 0x00
+  };
+  static const guint8 scan[] = { 0x12, 0x34, 0x56, 0x78, 0xFF, 0xD9 };
+  guint8 *data, *p;
+  gsize size;
+
+  size = 2 + 4 + 2 * 65 + sizeof (sof) + sizeof (sos) + sizeof (scan);
+  data = p = g_malloc (size);
+
+  /* SOI */
+  *p++ = 0xFF;
+  *p++ = 0xD8;
+  /* DQT */
+  *p++ = 0xFF;
+  *p++ = 0xDB;
+  *p++ = 0x00;
+  *p++ = 2 + 2 * 65;
+  *p++ = 0x00;
+  memset (p, luma_quant, 64);
+  p += 64;
+  *p++ = 0x01;
+  memset (p, 0x02, 64);
+  p += 64;
+  memcpy (p, sof, sizeof (sof));
+  p += sizeof (sof);
+  memcpy (p, sos, sizeof (sos));
+  p += sizeof (sos);
+  memcpy (p, scan, sizeof (scan));
+
+  return gst_buffer_new_wrapped (data, size);
+}
+
+GST_START_TEST (rtp_jpeg_header_cache)
+{
+  GstElement *rtppay;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  GList *l;
+  const guint8 luma_quant[] = { 0x01, 0x01, 0x05 };
+  guint i;
+
+  rtppay = gst_check_setup_element ("rtpjpegpay");
+  srcpad = gst_check_setup_src_pad (rtppay, &rtp_payloader_srctemplate);
+  sinkpad = gst_check_setup_sink_pad (rtppay, &rtp_payloader_sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (rtppay, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("video/x-jpeg,height=16,width=16");
+  gst_check_setup_events (srcpad, rtppay, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* the second frame reuses the header of the first, the third has a
+   * different luma table */
+  for (i = 0; i < G_N_ELEMENTS (luma_quant); i++)
+    fail_unless_equals_int (gst_pad_push (srcpad,
+            rtp_jpeg_header_frame (luma_quant[i])), GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    guint8 *payload;
+
+    fail_unless (gst_rtp_buffer_map (l->data, GST_MAP_READ, &rtp));
+    fail_unless (gst_rtp_buffer_get_marker (&rtp));
+    fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp),
+        8 + 4 + 128 + 6);
+    payload = gst_rtp_buffer_get_payload (&rtp);
+    /* type 1 for 4:2:0, width and height in 8 pixel blocks */
+    fail_unless_equals_int (payload[4], 1);
+    fail_unless_equals_int (payload[6], 2);
+    fail_unless_equals_int (payload[7], 2);
+    /* quant header and tables */
+    fail_unless_equals_int (GST_READ_UINT16_BE (payload + 10), 128);
+    fail_unless_equals_int (payload[12], luma_quant[i]);
+    fail_unless_equals_int (payload[12 + 63], luma_quant[i]);
+    fail_unless_equals_int (payload[12 + 64], 0x02);
+    /* the scan data */
+    fail_unless_equals_int (payload[12 + 128], 0x12);
+    gst_rtp_buffer_unmap (&rtp);
+  }
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (rtppay, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (rtppay);
+  gst_check_teardown_sink_pad (rtppay);
+  gst_check_teardown_element (rtppay);
+}
+
+GST_END_TEST;
+
 static const guint8 rtp_g729_frame_data[] =
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
@@ -906,6 +1279,228 @@ GST_START_TEST (rtp_g729)
 
 GST_END_TEST;
 
+/*
+ * Checks that the payload of all the RTP packets in the global buffers list
+ * is shared with @data and was not copied.
+ */
+static void
+rtp_check_payload_shared (const guint8 * data, gsize size)
+{
+  GList *l;
+
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buf = l->data;
+    GstMapInfo map;
+    guint n_mem;
+
+    /* RTP header and payload header in the first memory, payload after */
+    n_mem = gst_buffer_n_memory (buf);
+    fail_unless (n_mem > 1);
+
+    fail_unless (gst_memory_map (gst_buffer_peek_memory (buf, n_mem - 1),
+            &map, GST_MAP_READ));
+    fail_unless (map.data >= data && map.data + map.size <= data + size);
+    gst_memory_unmap (gst_buffer_peek_memory (buf, n_mem - 1), &map);
+  }
+}
+
+GST_START_TEST (rtp_payload_no_copy)
+{
+  /* single NAL unit packets */
+  fail_unless (rtp_payloader_push ("rtph264pay",
+          "video/x-h264,stream-format=byte-stream,alignment=au",
+          rtp_h264_aggregate_frame_data,
+          sizeof (rtp_h264_aggregate_frame_data), 0, -1) > 0);
+  rtp_check_payload_shared (rtp_h264_aggregate_frame_data,
+      sizeof (rtp_h264_aggregate_frame_data));
+  gst_check_drop_buffers ();
+
+  /* FU-A */
+  fail_unless (rtp_payloader_push ("rtph264pay",
+          "video/x-h264,stream-format=byte-stream,alignment=nal",
+          rtp_h264_list_gt_mtu_frame_data, rtp_h264_list_gt_mtu_frame_data_size,
+          rtp_h264_list_gt_mtu_mty_size, -1) > 1);
+  rtp_check_payload_shared (rtp_h264_list_gt_mtu_frame_data,
+      rtp_h264_list_gt_mtu_frame_data_size);
+  gst_check_drop_buffers ();
+
+  /* JPEG fragments */
+  fail_unless (rtp_payloader_push ("rtpjpegpay",
+          "video/x-jpeg,height=640,width=480", rtp_jpeg_frame_data,
+          rtp_jpeg_frame_data_size, 64, -1) > 1);
+  rtp_check_payload_shared (rtp_jpeg_frame_data, rtp_jpeg_frame_data_size);
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
+/*
+ * Payloads a frame of the given raw video format with a small MTU so that
+ * lines are split over packets, depayloads the packets again and checks that
+ * the frame survives.
+ */
+static void
+rtp_vraw_roundtrip (GstVideoFormat format, const gchar * sampling)
+{
+  GstVideoInfo info;
+  GstElement *rtpdepay;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  gchar *filtercaps;
+  guint8 *data;
+  GList *packets, *l;
+  gsize i;
+
+  gst_video_info_set_format (&info, format, 16, 8);
+  data = g_malloc (info.size);
+  for (i = 0; i < info.size; i++)
+    data[i] = (i * 7) & 0xff;
+  /* alpha is not transported */
+  if (format == GST_VIDEO_FORMAT_AYUV)
+    for (i = 0; i < info.size; i += 4)
+      data[i] = 0;
+
+  filtercaps = g_strdup_printf ("video/x-raw,format=%s,width=16,height=8,"
+      "framerate=30/1", gst_video_format_to_string (format));
+  fail_unless (rtp_payloader_push ("rtpvrawpay", filtercaps, data, info.size,
+          64, -1) > 1);
+  g_free (filtercaps);
+
+  packets = buffers;
+  buffers = NULL;
+
+  rtpdepay = gst_check_setup_element ("rtpvrawdepay");
+  srcpad = gst_check_setup_src_pad (rtpdepay, &rtp_payloader_srctemplate);
+  sinkpad = gst_check_setup_sink_pad (rtpdepay, &rtp_payloader_sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (rtpdepay, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "media", G_TYPE_STRING, "video", "clock-rate", G_TYPE_INT, 90000,
+      "encoding-name", G_TYPE_STRING, "RAW", "sampling", G_TYPE_STRING,
+      sampling, "depth", G_TYPE_STRING, "8", "width", G_TYPE_STRING, "16",
+      "height", G_TYPE_STRING, "8", NULL);
+  gst_check_setup_events (srcpad, rtpdepay, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (l = packets; l; l = l->next)
+    fail_unless_equals_int (gst_pad_push (srcpad, l->data), GST_FLOW_OK);
+  g_list_free (packets);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  fail_unless_equals_int (gst_buffer_get_size (buffers->data), info.size);
+  fail_unless (gst_buffer_memcmp (buffers->data, 0, data, info.size) == 0);
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (rtpdepay, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (rtpdepay);
+  gst_check_teardown_sink_pad (rtpdepay);
+  gst_check_teardown_element (rtpdepay);
+
+  g_free (data);
+}
+
+GST_START_TEST (rtp_vraw)
+{
+  rtp_vraw_roundtrip (GST_VIDEO_FORMAT_RGB, "RGB");
+  rtp_vraw_roundtrip (GST_VIDEO_FORMAT_AYUV, "YCbCr-4:4:4");
+  rtp_vraw_roundtrip (GST_VIDEO_FORMAT_UYVY, "YCbCr-4:2:2");
+  rtp_vraw_roundtrip (GST_VIDEO_FORMAT_I420, "YCbCr-4:2:0");
+  rtp_vraw_roundtrip (GST_VIDEO_FORMAT_Y41B, "YCbCr-4:1:1");
+}
+
+GST_END_TEST;
+
+/* three framed packets, split over the input buffers so that a packet and a
+ * length field cross buffer boundaries */
+static const guint8 rtp_stream_depay_data[] = {
+  0x00, 0x04, 0xa0, 0xa1, 0xa2, 0xa3,
+  0x00, 0x03, 0xb0, 0xb1, 0xb2,
+  0x00, 0x02, 0xc0, 0xc1
+};
+
+GST_START_TEST (rtp_stream_depay)
+{
+  GstElement *depay;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  GstBuffer *buf;
+  GList *l;
+  const gsize splits[] = { 0, 7, 14, sizeof (rtp_stream_depay_data) };
+  const guint8 sizes[] = { 4, 3, 2 };
+  const GstClockTime pts[] = { 0, GST_CLOCK_TIME_NONE, 10 * GST_MSECOND };
+  guint i;
+
+  depay = gst_check_setup_element ("rtpstreamdepay");
+  srcpad = gst_check_setup_src_pad (depay, &rtp_payloader_srctemplate);
+  sinkpad = gst_check_setup_sink_pad (depay, &rtp_payloader_sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (depay, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("application/x-rtp-stream,media=audio,"
+      "clock-rate=8000,encoding-name=PCMU");
+  gst_check_setup_events (srcpad, depay, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* 1 packet and the first byte of the next length, then the rest of the
+   * second packet and the start of the third, then the end of the third */
+  for (i = 0; i < 3; i++) {
+    buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        (guint8 *) rtp_stream_depay_data + splits[i],
+        splits[i + 1] - splits[i], 0, splits[i + 1] - splits[i], NULL, NULL);
+    GST_BUFFER_PTS (buf) = i * 10 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+    fail_unless_equals_int (g_list_length (buffers), i + 1);
+  }
+
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstMapInfo map;
+
+    buf = l->data;
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, sizes[i]);
+    fail_unless_equals_int (map.data[0], 0xa0 + 0x10 * i);
+    fail_unless_equals_int (map.data[map.size - 1],
+        0xa0 + 0x10 * i + sizes[i] - 1);
+    gst_buffer_unmap (buf, &map);
+
+    /* only the first packet starting in an input buffer gets its timestamp */
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), pts[i]);
+    fail_unless_equals_int (GST_BUFFER_FLAG_IS_SET (buf,
+            GST_BUFFER_FLAG_DISCONT), i == 0);
+  }
+  gst_check_drop_buffers ();
+
+  /* a discont drops the incomplete data */
+  buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (guint8 *) rtp_stream_depay_data, 7, 0, 7, NULL, NULL);
+  fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+  buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (guint8 *) rtp_stream_depay_data + 11, 4, 0, 4, NULL, NULL);
+  GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+  fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  buf = buffers->next->data;
+  fail_unless_equals_int (gst_buffer_get_size (buf), 2);
+  fail_unless (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DISCONT));
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (depay, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (depay);
+  gst_check_teardown_sink_pad (depay);
+  gst_check_teardown_element (depay);
+}
+
+GST_END_TEST;
+
 /*
  * Creates the test suite.
  *
@@ -933,11 +1528,14 @@ rtp_payloading_suite (void)
   tcase_add_test (tc_chain, rtp_h264);
   tcase_add_test (tc_chain, rtp_h264_list_lt_mtu);
   tcase_add_test (tc_chain, rtp_h264_list_lt_mtu_avc);
+  tcase_add_test (tc_chain, rtp_h264_aggregate);
   tcase_add_test (tc_chain, rtp_h264_list_gt_mtu);
   tcase_add_test (tc_chain, rtp_h264_list_gt_mtu_avc);
   tcase_add_test (tc_chain, rtp_L16);
   tcase_add_test (tc_chain, rtp_L24);
   tcase_add_test (tc_chain, rtp_mp2t);
+  tcase_add_test (tc_chain, rtp_mp2t_pcr_pacing);
+  tcase_add_test (tc_chain, rtp_mp2t_pcr_pacing_restart);
   tcase_add_test (tc_chain, rtp_mp4v);
   tcase_add_test (tc_chain, rtp_mp4v_list);
   tcase_add_test (tc_chain, rtp_mp4g);
@@ -951,7 +1549,11 @@ rtp_payloading_suite (void)
   tcase_add_test (tc_chain, rtp_jpeg_list_width_greater_than_2040);
   tcase_add_test (tc_chain, rtp_jpeg_list_height_greater_than_2040);
   tcase_add_test (tc_chain, rtp_jpeg_list_width_and_height_greater_than_2040);
+  tcase_add_test (tc_chain, rtp_jpeg_header_cache);
   tcase_add_test (tc_chain, rtp_g729);
+  tcase_add_test (tc_chain, rtp_payload_no_copy);
+  tcase_add_test (tc_chain, rtp_vraw);
+  tcase_add_test (tc_chain, rtp_stream_depay);
   return s;
 }
 
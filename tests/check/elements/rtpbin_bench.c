@@ -0,0 +1,571 @@
+/* GStreamer
+ *
+ * benchmark for the rtpbin receive path
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Pushes synthetic RTP and RTCP through rtpbin, rtpsession, rtpssrcdemux and
+ * rtpjitterbuffer with a GstTestClock and reports the throughput, the
+ * latency of the packets and how many queue items and timers the
+ * jitterbuffers had to allocate because their free lists were empty with
+ * GST_INFO. Other allocations are not counted. Run with GST_DEBUG=check:4
+ * to see the results.
+ *
+ * By default only a short smoke scenario runs. Set GST_RTPBIN_BENCH=full to
+ * run the benchmark scenarios below, or set it to a custom scenario like:
+ *
+ *   bench, packets=(int)100000, ssrcs=(int)4, rate=(int)10000,
+ *       loss=(double)0.01, reorder=(double)0.05, latency=(int)200,
+ *       seed=(int)1
+ *
+ * rate is the number of packets per second of all SSRCs together, loss and
+ * reorder the probability that a packet is dropped or swapped with the next
+ * packet of its SSRC and latency the latency of rtpbin in milliseconds.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+#include <stdlib.h>
+
+#define BENCH_CLOCK_RATE   90000
+#define BENCH_PAYLOAD_SIZE 160
+#define BENCH_PT           96
+#define BENCH_SSRC_BASE    0x10000000
+/* the first packets of a new SSRC must be in order to pass the probation of
+ * rtpsession */
+#define BENCH_PROBATION    4
+/* how long to wait for the last packets */
+#define BENCH_TIMEOUT      (10 * GST_SECOND)
+
+typedef struct
+{
+  const gchar *name;
+  guint packets;
+  guint ssrcs;
+  guint rate;
+  gdouble loss;
+  gdouble reorder;
+  guint latency;
+  guint seed;
+} BenchScenario;
+
+static const BenchScenario smoke_scenario =
+    {"smoke", 2000, 2, 1000, 0.01, 0.01, 200, 1};
+
+static const BenchScenario scenarios[] = {
+  {"clean", 20000, 1, 1000, 0.0, 0.0, 200, 1},
+  {"lossy", 20000, 1, 1000, 0.02, 0.02, 200, 1},
+  {"multi-ssrc", 40000, 16, 8000, 0.01, 0.01, 200, 1},
+};
+
+typedef struct
+{
+  GstBuffer *buffer;
+  GstClockTime arrival;
+  /* the index of the packet in the payload */
+  guint index;
+  gboolean lost;
+} BenchPacket;
+
+typedef struct
+{
+  GstClock *clock;
+  GstElement *pipeline;
+  GstElement *rtpbin;
+  GstPad *rtp_src;
+  GstPad *rtcp_src;
+
+  GMutex lock;
+  GList *jitterbuffers;
+  GList *sinkpads;
+
+  /* indexed on the index in the payload */
+  GstClockTime *arrival;
+  GstClockTime *push_time;
+  GstClockTime *wall_latency;
+  GstClockTime *clock_latency;
+  gint received;
+} BenchData;
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp"));
+
+static GstStaticPadTemplate rtp_src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp"));
+
+static GstStaticPadTemplate rtcp_src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtcp"));
+
+static GstFlowReturn
+bench_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  BenchData *data = g_object_get_data (G_OBJECT (pad), "bench-data");
+  GstClockTime now = gst_util_get_timestamp ();
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 *payload;
+  guint index;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  index = GST_READ_UINT32_BE (payload);
+  gst_rtp_buffer_unmap (&rtp);
+
+  data->wall_latency[index] = now - data->push_time[index];
+  data->clock_latency[index] =
+      gst_clock_get_time (data->clock) - data->arrival[index];
+  g_atomic_int_inc (&data->received);
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static void
+pad_added_cb (GstElement * rtpbin, GstPad * pad, BenchData * data)
+{
+  GstPad *sinkpad;
+
+  if (GST_PAD_IS_SINK (pad))
+    return;
+
+  sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  g_object_set_data (G_OBJECT (sinkpad), "bench-data", data);
+  gst_pad_set_chain_function (sinkpad, bench_sink_chain);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+
+  g_mutex_lock (&data->lock);
+  data->sinkpads = g_list_prepend (data->sinkpads, sinkpad);
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+new_jitterbuffer_cb (GstElement * rtpbin, GstElement * jitterbuffer,
+    guint session, guint ssrc, BenchData * data)
+{
+  g_mutex_lock (&data->lock);
+  data->jitterbuffers =
+      g_list_prepend (data->jitterbuffers, gst_object_ref (jitterbuffer));
+  g_mutex_unlock (&data->lock);
+}
+
+static GstPad *
+setup_src_pad (GstElement * rtpbin, GstStaticPadTemplate * template,
+    const gchar * sink_name, GstCaps * caps)
+{
+  GstPad *srcpad, *sinkpad;
+  GstSegment segment;
+
+  srcpad = gst_pad_new_from_static_template (template, "src");
+  gst_pad_set_active (srcpad, TRUE);
+
+  sinkpad = gst_element_get_request_pad (rtpbin, sink_name);
+  fail_unless (sinkpad != NULL);
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start (sink_name)));
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_caps (caps)));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+  gst_caps_unref (caps);
+
+  return srcpad;
+}
+
+static void
+setup_bench (BenchData * data, const BenchScenario * scenario)
+{
+  GstCaps *caps;
+
+  memset (data, 0, sizeof (BenchData));
+  g_mutex_init (&data->lock);
+
+  data->arrival = g_new0 (GstClockTime, scenario->packets);
+  data->push_time = g_new0 (GstClockTime, scenario->packets);
+  data->wall_latency = g_new0 (GstClockTime, scenario->packets);
+  data->clock_latency = g_new0 (GstClockTime, scenario->packets);
+
+  data->clock = gst_test_clock_new ();
+  data->pipeline = gst_pipeline_new (NULL);
+  gst_pipeline_use_clock (GST_PIPELINE (data->pipeline), data->clock);
+
+  data->rtpbin = gst_element_factory_make ("rtpbin", NULL);
+  fail_unless (data->rtpbin != NULL);
+  g_object_set (data->rtpbin, "latency", scenario->latency, NULL);
+  g_signal_connect (data->rtpbin, "pad-added", (GCallback) pad_added_cb, data);
+  g_signal_connect (data->rtpbin, "new-jitterbuffer",
+      (GCallback) new_jitterbuffer_cb, data);
+  gst_bin_add (GST_BIN (data->pipeline), data->rtpbin);
+
+  fail_unless (gst_element_set_state (data->pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "media", G_TYPE_STRING, "video",
+      "clock-rate", G_TYPE_INT, BENCH_CLOCK_RATE,
+      "encoding-name", G_TYPE_STRING, "RAW",
+      "payload", G_TYPE_INT, BENCH_PT, NULL);
+  data->rtp_src = setup_src_pad (data->rtpbin, &rtp_src_template,
+      "recv_rtp_sink_0", caps);
+  data->rtcp_src = setup_src_pad (data->rtpbin, &rtcp_src_template,
+      "recv_rtcp_sink_0", gst_caps_new_empty_simple ("application/x-rtcp"));
+}
+
+static void
+cleanup_bench (BenchData * data)
+{
+  gst_element_set_state (data->pipeline, GST_STATE_NULL);
+
+  gst_object_unref (data->rtp_src);
+  gst_object_unref (data->rtcp_src);
+  g_list_free_full (data->sinkpads, gst_object_unref);
+  g_list_free_full (data->jitterbuffers, gst_object_unref);
+  gst_object_unref (data->pipeline);
+  gst_object_unref (data->clock);
+
+  g_free (data->arrival);
+  g_free (data->push_time);
+  g_free (data->wall_latency);
+  g_free (data->clock_latency);
+  g_mutex_clear (&data->lock);
+}
+
+static guint32
+packet_rtptime (const BenchScenario * scenario, guint seqnum)
+{
+  return gst_util_uint64_scale (seqnum, BENCH_CLOCK_RATE * scenario->ssrcs,
+      scenario->rate);
+}
+
+/* Make all packets before the measurement. The packets of the SSRCs are
+ * interleaved and arrive at a constant rate, a reordered packet is swapped
+ * with the next packet of the same SSRC. */
+static BenchPacket *
+make_packets (const BenchScenario * scenario, guint * expected)
+{
+  BenchPacket *packets;
+  GRand *rand;
+  guint i;
+
+  rand = g_rand_new_with_seed (scenario->seed);
+  packets = g_new0 (BenchPacket, scenario->packets);
+  *expected = 0;
+
+  for (i = 0; i < scenario->packets; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    guint seqnum = i / scenario->ssrcs;
+    guint8 *payload;
+
+    packets[i].buffer =
+        gst_rtp_buffer_new_allocate (BENCH_PAYLOAD_SIZE, 0, 0);
+    gst_rtp_buffer_map (packets[i].buffer, GST_MAP_WRITE, &rtp);
+    gst_rtp_buffer_set_payload_type (&rtp, BENCH_PT);
+    gst_rtp_buffer_set_ssrc (&rtp, BENCH_SSRC_BASE + i % scenario->ssrcs);
+    gst_rtp_buffer_set_seq (&rtp, seqnum);
+    gst_rtp_buffer_set_timestamp (&rtp, packet_rtptime (scenario, seqnum));
+    payload = gst_rtp_buffer_get_payload (&rtp);
+    memset (payload, 0, BENCH_PAYLOAD_SIZE);
+    GST_WRITE_UINT32_BE (payload, i);
+    gst_rtp_buffer_unmap (&rtp);
+
+    packets[i].index = i;
+    packets[i].arrival = gst_util_uint64_scale (i, GST_SECOND, scenario->rate);
+
+    if (seqnum >= BENCH_PROBATION &&
+        g_rand_double (rand) < scenario->loss) {
+      packets[i].lost = TRUE;
+    } else {
+      (*expected)++;
+    }
+  }
+
+  for (i = 0; i + scenario->ssrcs < scenario->packets; i++) {
+    BenchPacket *a = &packets[i];
+    BenchPacket *b = &packets[i + scenario->ssrcs];
+
+    if (i / scenario->ssrcs < BENCH_PROBATION)
+      continue;
+
+    if (g_rand_double (rand) < scenario->reorder) {
+      BenchPacket tmp = *a;
+
+      /* swap everything but the arrival time */
+      a->buffer = b->buffer;
+      a->index = b->index;
+      a->lost = b->lost;
+      b->buffer = tmp.buffer;
+      b->index = tmp.index;
+      b->lost = tmp.lost;
+    }
+  }
+
+  g_rand_free (rand);
+
+  return packets;
+}
+
+static GstBuffer *
+make_sender_report (const BenchScenario * scenario, guint ssrc,
+    guint seqnum, GstClockTime arrival)
+{
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  GstBuffer *buffer;
+  guint64 ntptime;
+
+  /* NTP time, seconds since 1900 in 32.32 fixed point */
+  ntptime = gst_util_uint64_scale (arrival + 2208988800LL * GST_SECOND,
+      G_GUINT64_CONSTANT (1) << 32, GST_SECOND);
+
+  buffer = gst_rtcp_buffer_new (1400);
+  gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcp);
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SR, &packet));
+  gst_rtcp_packet_sr_set_sender_info (&packet, ssrc, ntptime,
+      packet_rtptime (scenario, seqnum), seqnum,
+      seqnum * (BENCH_PAYLOAD_SIZE + 12));
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  GST_BUFFER_DTS (buffer) = arrival;
+
+  return buffer;
+}
+
+/* process all the clock ids that are due */
+static void
+process_due_ids (GstTestClock * clock)
+{
+  GstClockID id;
+
+  while ((id = gst_test_clock_process_next_clock_id (clock)))
+    gst_clock_id_unref (id);
+}
+
+static gint
+compare_time (gconstpointer a, gconstpointer b)
+{
+  GstClockTime ta = *(const GstClockTime *) a;
+  GstClockTime tb = *(const GstClockTime *) b;
+
+  return ta < tb ? -1 : ta > tb ? 1 : 0;
+}
+
+/* sort the latencies of the received packets and report the percentiles */
+static void
+report_latency (const gchar * name, const gchar * what, GstClockTime * latency,
+    BenchPacket * packets, guint n_packets, guint n_received)
+{
+  GstClockTime *sorted;
+  guint i, n = 0;
+
+  sorted = g_new (GstClockTime, n_received);
+  for (i = 0; i < n_packets; i++) {
+    if (!packets[i].lost)
+      sorted[n++] = latency[packets[i].index];
+  }
+  qsort (sorted, n, sizeof (GstClockTime), compare_time);
+
+  GST_INFO ("%s: %s latency p50 %" GST_TIME_FORMAT ", p90 %" GST_TIME_FORMAT
+      ", p99 %" GST_TIME_FORMAT ", max %" GST_TIME_FORMAT, name, what,
+      GST_TIME_ARGS (sorted[n * 50 / 100]), GST_TIME_ARGS (sorted[n * 90 / 100]),
+      GST_TIME_ARGS (sorted[n * 99 / 100]), GST_TIME_ARGS (sorted[n - 1]));
+
+  g_free (sorted);
+}
+
+static void
+run_scenario (const BenchScenario * scenario)
+{
+  GstTestClock *clock;
+  BenchData data;
+  BenchPacket *packets;
+  GstClockTime start, drain, elapsed, last = 0;
+  guint64 item_allocs = 0, timer_allocs = 0;
+  guint i, expected;
+  GList *walk;
+
+  GST_INFO ("%s: %u packets, %u ssrcs, %u packets/s, loss %.3f, "
+      "reorder %.3f, latency %u ms", scenario->name, scenario->packets,
+      scenario->ssrcs, scenario->rate, scenario->loss, scenario->reorder,
+      scenario->latency);
+
+  packets = make_packets (scenario, &expected);
+  setup_bench (&data, scenario);
+  clock = GST_TEST_CLOCK (data.clock);
+
+  for (i = 0; i < scenario->packets; i++)
+    data.arrival[packets[i].index] = packets[i].arrival;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < scenario->packets; i++) {
+    BenchPacket *packet = &packets[i];
+    guint seqnum = packet->index / scenario->ssrcs;
+
+    if (packet->lost) {
+      gst_buffer_unref (packet->buffer);
+      continue;
+    }
+
+    gst_test_clock_set_time (clock, packet->arrival);
+    last = packet->arrival;
+
+    /* a sender report every second for each SSRC */
+    if (seqnum % (scenario->rate / scenario->ssrcs) == 0) {
+      fail_unless_equals_int (gst_pad_push (data.rtcp_src,
+              make_sender_report (scenario,
+                  BENCH_SSRC_BASE + packet->index % scenario->ssrcs, seqnum,
+                  packet->arrival)), GST_FLOW_OK);
+    }
+
+    GST_BUFFER_DTS (packet->buffer) = packet->arrival;
+    data.push_time[packet->index] = gst_util_get_timestamp ();
+    fail_unless_equals_int (gst_pad_push (data.rtp_src, packet->buffer),
+        GST_FLOW_OK);
+
+    process_due_ids (clock);
+  }
+
+  /* let all the timers expire and wait for the last packets */
+  gst_test_clock_set_time (clock, last + 2 * scenario->latency * GST_MSECOND);
+  drain = gst_util_get_timestamp ();
+  while (g_atomic_int_get (&data.received) < expected) {
+    fail_unless (gst_util_get_timestamp () - drain < BENCH_TIMEOUT,
+        "received %d of %u packets", g_atomic_int_get (&data.received),
+        expected);
+    process_due_ids (clock);
+    g_usleep (100);
+  }
+  elapsed = gst_util_get_timestamp () - start;
+
+  fail_unless_equals_int (g_atomic_int_get (&data.received), expected);
+
+  g_mutex_lock (&data.lock);
+  fail_unless_equals_int (g_list_length (data.jitterbuffers), scenario->ssrcs);
+  for (walk = data.jitterbuffers; walk; walk = g_list_next (walk)) {
+    GstStructure *stats;
+    guint64 allocs;
+
+    g_object_get (walk->data, "stats", &stats, NULL);
+    gst_structure_get_uint64 (stats, "item-allocs", &allocs);
+    item_allocs += allocs;
+    gst_structure_get_uint64 (stats, "timer-allocs", &allocs);
+    timer_allocs += allocs;
+    gst_structure_free (stats);
+  }
+  g_mutex_unlock (&data.lock);
+
+  GST_INFO ("%s: %u packets in %" GST_TIME_FORMAT ", %" G_GUINT64_FORMAT
+      " packets/s", scenario->name, expected, GST_TIME_ARGS (elapsed),
+      gst_util_uint64_scale (expected, GST_SECOND, MAX (elapsed, 1)));
+  report_latency (scenario->name, "processing", data.wall_latency, packets,
+      scenario->packets, expected);
+  report_latency (scenario->name, "buffering", data.clock_latency, packets,
+      scenario->packets, expected);
+  GST_INFO ("%s: %" G_GUINT64_FORMAT " queue items and %" G_GUINT64_FORMAT
+      " timers allocated on empty free lists in %u jitterbuffers",
+      scenario->name, item_allocs, timer_allocs, scenario->ssrcs);
+
+  cleanup_bench (&data);
+  g_free (packets);
+}
+
+/* parses a custom scenario from @env, returns FALSE when @env only asks
+ * for the full benchmark */
+static gboolean
+get_custom_scenario (const gchar * env, BenchScenario * scenario)
+{
+  GstStructure *s;
+  gint val;
+
+  if (g_str_equal (env, "full"))
+    return FALSE;
+
+  s = gst_structure_from_string (env, NULL);
+  fail_unless (s != NULL && gst_structure_has_name (s, "bench"),
+      "invalid GST_RTPBIN_BENCH: %s", env);
+
+  *scenario = scenarios[0];
+  scenario->name = "custom";
+  if (gst_structure_get_int (s, "packets", &val))
+    scenario->packets = val;
+  if (gst_structure_get_int (s, "ssrcs", &val))
+    scenario->ssrcs = val;
+  if (gst_structure_get_int (s, "rate", &val))
+    scenario->rate = val;
+  if (gst_structure_get_int (s, "latency", &val))
+    scenario->latency = val;
+  if (gst_structure_get_int (s, "seed", &val))
+    scenario->seed = val;
+  gst_structure_get_double (s, "loss", &scenario->loss);
+  gst_structure_get_double (s, "reorder", &scenario->reorder);
+  gst_structure_free (s);
+
+  fail_unless (scenario->ssrcs > 0 && scenario->rate >= scenario->ssrcs);
+
+  return TRUE;
+}
+
+GST_START_TEST (test_receive_bench)
+{
+  BenchScenario custom;
+  const gchar *env;
+  guint i;
+
+  env = g_getenv ("GST_RTPBIN_BENCH");
+  if (env == NULL) {
+    run_scenario (&smoke_scenario);
+    return;
+  }
+
+  if (get_custom_scenario (env, &custom)) {
+    run_scenario (&custom);
+    return;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (scenarios); i++)
+    run_scenario (&scenarios[i]);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtpbin_bench_suite (void)
+{
+  Suite *s = suite_create ("rtpbin_bench");
+  TCase *tc_chain = tcase_create ("general");
+
+  /* the smoke scenario fits in the default timeout */
+  if (g_getenv ("GST_RTPBIN_BENCH"))
+    tcase_set_timeout (tc_chain, 180);
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_receive_bench);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpbin_bench);
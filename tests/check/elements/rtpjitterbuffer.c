@@ -294,6 +294,89 @@ GST_START_TEST (test_push_unordered)
 
 GST_END_TEST;
 
+GST_START_TEST (test_push_reordered)
+{
+  GstElement *jitterbuffer;
+  const guint num_buffers = 33;
+  GstBuffer *buffer;
+  guint i, j;
+
+  jitterbuffer = setup_jitterbuffer (num_buffers);
+  fail_unless (start_jitterbuffer (jitterbuffer)
+      == GST_STATE_CHANGE_SUCCESS, "could not set to playing");
+
+  /* push buffers; 0, 8..1, 16..9, ... */
+  buffer = (GstBuffer *) inbuffers->data;
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  for (i = 1; i < num_buffers; i += 8) {
+    for (j = 0; j < 8; j++) {
+      buffer = g_list_nth_data (inbuffers, i + 7 - j);
+      fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+    }
+  }
+
+  /* check the buffer list */
+  check_jitterbuffer_results (jitterbuffer, num_buffers);
+
+  /* cleanup */
+  cleanup_jitterbuffer (jitterbuffer);
+}
+
+GST_END_TEST;
+
+static void
+get_allocs (GstElement * jitterbuffer, guint64 * item_allocs,
+    guint64 * timer_allocs)
+{
+  GstStructure *stats;
+
+  g_object_get (jitterbuffer, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "item-allocs", item_allocs));
+  fail_unless (gst_structure_get_uint64 (stats, "timer-allocs",
+          timer_allocs));
+  gst_structure_free (stats);
+}
+
+GST_START_TEST (test_steady_state_allocs)
+{
+  GstElement *jitterbuffer;
+  const guint num_buffers = 20;
+  guint64 item_allocs, timer_allocs, item_allocs2, timer_allocs2;
+  GstBuffer *buffer;
+  guint i;
+
+  jitterbuffer = setup_jitterbuffer (num_buffers);
+  fail_unless (start_jitterbuffer (jitterbuffer)
+      == GST_STATE_CHANGE_SUCCESS, "could not set to playing");
+
+  /* push the first half and wait until it's all out */
+  for (i = 0; i < num_buffers / 2; i++) {
+    buffer = g_list_nth_data (inbuffers, i);
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  }
+  g_usleep (400 * 1000);
+  fail_unless_equals_int (g_list_length (buffers), num_buffers / 2);
+
+  get_allocs (jitterbuffer, &item_allocs, &timer_allocs);
+  fail_unless (item_allocs > 0);
+
+  /* the second half reuses the items and timers of the first half */
+  for (; i < num_buffers; i++) {
+    buffer = g_list_nth_data (inbuffers, i);
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  }
+  g_usleep (400 * 1000);
+  fail_unless_equals_int (g_list_length (buffers), num_buffers);
+
+  get_allocs (jitterbuffer, &item_allocs2, &timer_allocs2);
+  fail_unless_equals_uint64 (item_allocs2, item_allocs);
+  fail_unless_equals_uint64 (timer_allocs2, timer_allocs);
+
+  cleanup_jitterbuffer (jitterbuffer);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_basetime)
 {
   GstElement *jitterbuffer;
@@ -476,7 +559,7 @@ test_src_pad_event_cb (GstPad * pad, GstObject * parent, GstEvent * event)
 }
 
 static void
-setup_testharness (TestData * data)
+setup_testharness_full (TestData * data, gboolean rtx_thread)
 {
   GstPad *jb_sink_pad, *jb_src_pad;
   GstSegment seg;
@@ -493,6 +576,7 @@ setup_testharness (TestData * data)
   g_assert (data->jitter_buffer);
   gst_element_set_clock (data->jitter_buffer, data->clock);
   g_object_set (data->jitter_buffer, "do-lost", TRUE, NULL);
+  g_object_set (data->jitter_buffer, "rtx-thread", rtx_thread, NULL);
   g_assert_cmpint (gst_element_set_state (data->jitter_buffer,
           GST_STATE_PLAYING), !=, GST_STATE_CHANGE_FAILURE);
 
@@ -547,6 +631,12 @@ setup_testharness (TestData * data)
   gst_mini_object_unref (obj);
 }
 
+static void
+setup_testharness (TestData * data)
+{
+  setup_testharness_full (data, FALSE);
+}
+
 static void
 destroy_testharness (TestData * data)
 {
@@ -1086,6 +1176,96 @@ GST_START_TEST (test_rtx_expected_next)
 
 GST_END_TEST;
 
+static GstPadProbeReturn
+block_output_probe_cb (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  gboolean *blocked = user_data;
+
+  g_mutex_lock (&check_mutex);
+  *blocked = TRUE;
+  g_cond_signal (&check_cond);
+  g_mutex_unlock (&check_mutex);
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_rtx_thread)
+{
+  TestData data;
+  GstPad *jb_src_pad;
+  GstClockID tid;
+  GstBuffer *in_buf;
+  GstEvent *out_event;
+  gboolean blocked = FALSE;
+  gulong probe_id;
+
+  /* the expected timers run in their own thread */
+  setup_testharness_full (&data, TRUE);
+  g_object_set (data.jitter_buffer, "do-retransmission", TRUE, NULL);
+  g_object_set (data.jitter_buffer, "latency", 200, NULL);
+  g_object_set (data.jitter_buffer, "rtx-retry-period", 120, NULL);
+
+  /* block the output thread downstream on a serialized event */
+  jb_src_pad = gst_element_get_static_pad (data.jitter_buffer, "src");
+  probe_id = gst_pad_add_probe (jb_src_pad,
+      GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      block_output_probe_cb, &blocked, NULL);
+  gst_pad_push_event (data.test_src_pad,
+      gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM,
+          gst_structure_new_empty ("block")));
+  g_mutex_lock (&check_mutex);
+  while (!blocked)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), 0);
+  in_buf = generate_test_buffer (0 * GST_MSECOND, TRUE, 0, 0);
+  g_assert_cmpint (gst_pad_push (data.test_src_pad, in_buf), ==, GST_FLOW_OK);
+
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), 20 * GST_MSECOND);
+  in_buf = generate_test_buffer (20 * GST_MSECOND, TRUE, 1, 160);
+  g_assert_cmpint (gst_pad_push (data.test_src_pad, in_buf), ==, GST_FLOW_OK);
+
+  /* #2 and #3 are missing, both are expected at 60ms */
+  in_buf = generate_test_buffer (80 * GST_MSECOND, TRUE, 4, 640);
+  g_assert_cmpint (gst_pad_push (data.test_src_pad, in_buf), ==, GST_FLOW_OK);
+
+  /* the timer thread waits for the deadline of #0 at 200ms and the rtx
+   * thread for the expected timers at 60ms. Only the rtx wait is due. */
+  gst_test_clock_wait_for_multiple_pending_ids (GST_TEST_CLOCK (data.clock),
+      2, NULL);
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), 60 * GST_MSECOND);
+  tid = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (data.clock));
+  g_assert (tid != NULL);
+  g_assert_cmpint (gst_clock_id_get_time (tid), ==, 60 * GST_MSECOND);
+  gst_clock_id_unref (tid);
+  g_assert (gst_test_clock_process_next_clock_id (GST_TEST_CLOCK
+          (data.clock)) == NULL);
+
+  /* both requests are sent on time while downstream is still blocked */
+  out_event = g_async_queue_pop (data.src_event_queue);
+  g_assert (out_event != NULL);
+  verify_rtx_event (out_event, 2, 40 * GST_MSECOND, 20, 20 * GST_MSECOND);
+  out_event = g_async_queue_pop (data.src_event_queue);
+  g_assert (out_event != NULL);
+  verify_rtx_event (out_event, 3, 60 * GST_MSECOND, 0, 20 * GST_MSECOND);
+  g_assert_cmpint (data.rtx_event_count, ==, 2);
+  g_assert_cmpint (g_async_queue_length (data.sink_event_queue), ==, 0);
+  g_assert_cmpint (g_async_queue_length (data.buf_queue), ==, 0);
+
+  /* unblock, the held event goes out first */
+  gst_pad_remove_probe (jb_src_pad, probe_id);
+  gst_object_unref (jb_src_pad);
+  out_event = g_async_queue_pop (data.sink_event_queue);
+  g_assert_cmpint (GST_EVENT_TYPE (out_event), ==, GST_EVENT_CUSTOM_DOWNSTREAM);
+  gst_event_unref (out_event);
+
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_rtx_two_missing)
 {
   TestData data;
@@ -1579,6 +1759,8 @@ rtpjitterbuffer_suite (void)
   tcase_add_test (tc_chain, test_push_forward_seq);
   tcase_add_test (tc_chain, test_push_backward_seq);
   tcase_add_test (tc_chain, test_push_unordered);
+  tcase_add_test (tc_chain, test_push_reordered);
+  tcase_add_test (tc_chain, test_steady_state_allocs);
   tcase_add_test (tc_chain, test_basetime);
   tcase_add_test (tc_chain, test_clear_pt_map);
   tcase_add_test (tc_chain, test_only_one_lost_event_on_large_gaps);
@@ -1587,6 +1769,7 @@ rtpjitterbuffer_suite (void)
   tcase_add_test (tc_chain, test_all_packets_are_timestamped_zero);
   tcase_add_test (tc_chain, test_rtx_expected_next);
   tcase_add_test (tc_chain, test_rtx_two_missing);
+  tcase_add_test (tc_chain, test_rtx_thread);
   tcase_add_test (tc_chain, test_rtx_packet_delay);
   tcase_add_test (tc_chain, test_gap_exceeds_latency);
 
@@ -292,6 +292,109 @@ GST_START_TEST (test_rtpdtmfmux_lock)
 
 GST_END_TEST;
 
+GST_START_TEST (test_rtpmux_list)
+{
+  GstElement *rtpmux;
+  GstPad *reqpad, *src, *sink;
+  GstBufferList *list;
+  GstMemory *payload;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstCaps *caps;
+  GList *l;
+  gint i;
+
+  rtpmux = gst_check_setup_element ("rtpmux");
+  g_object_set (rtpmux, "seqnum-offset", 100, "timestamp-offset", 1000,
+      "ssrc", 55, NULL);
+
+  reqpad = gst_element_get_request_pad (rtpmux, "sink_1");
+  fail_unless (reqpad != NULL);
+  sink = gst_check_setup_sink_pad_by_name (rtpmux, &sinktemplate, "src");
+  src = gst_pad_new_from_static_template (&srctemplate, "src");
+  fail_unless (gst_pad_link (src, reqpad) == GST_PAD_LINK_OK);
+
+  fail_unless (gst_element_set_state (rtpmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+  gst_pad_set_active (sink, TRUE);
+  gst_pad_set_active (src, TRUE);
+
+  caps = gst_caps_from_string ("application/x-rtp,payload=98,"
+      "clock-rate=90000,clock-base=(uint)57");
+  gst_check_setup_events (src, rtpmux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* all packets share the payload memory, the mux must not copy it */
+  payload = gst_allocator_alloc (NULL, 10, NULL);
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 3; i++) {
+    GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+    GstBuffer *inbuf;
+
+    inbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+    gst_rtp_buffer_map (inbuf, GST_MAP_WRITE, &rtpbuffer);
+    gst_rtp_buffer_set_payload_type (&rtpbuffer, 98);
+    gst_rtp_buffer_set_ssrc (&rtpbuffer, 44);
+    gst_rtp_buffer_set_timestamp (&rtpbuffer, 200 + i);
+    gst_rtp_buffer_set_seq (&rtpbuffer, 2000 + i);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+    gst_buffer_append_memory (inbuf, gst_memory_ref (payload));
+    GST_BUFFER_PTS (inbuf) = i * GST_MSECOND;
+    gst_buffer_list_add (list, inbuf);
+  }
+  fail_unless (gst_pad_push_list (src, list) == GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+    fail_unless (gst_buffer_peek_memory (l->data, 1) == payload);
+
+    fail_unless (gst_rtp_buffer_map (l->data, GST_MAP_READ, &rtpbuffer));
+    fail_unless_equals_int (gst_rtp_buffer_get_ssrc (&rtpbuffer), 55);
+    fail_unless_equals_int (gst_rtp_buffer_get_timestamp (&rtpbuffer),
+        200 - 57 + 1000 + i);
+    fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtpbuffer), 100 + 1 + i);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+  }
+  gst_check_drop_buffers ();
+  gst_memory_unref (payload);
+
+  /* packets whose CSRCs or header extension do not fit are dropped */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 3; i++) {
+    GstBuffer *inbuf;
+    GstMapInfo map;
+
+    inbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+    gst_buffer_map (inbuf, &map, GST_MAP_WRITE);
+    if (i == 0)
+      map.data[0] |= 2;
+    else if (i == 1)
+      map.data[0] |= 0x10;
+    gst_buffer_unmap (inbuf, &map);
+    gst_buffer_list_add (list, inbuf);
+  }
+  fail_unless (gst_pad_push_list (src, list) == GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  fail_unless (gst_rtp_buffer_map (buffers->data, GST_MAP_READ, &rtp));
+  fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtp), 100 + 4);
+  gst_rtp_buffer_unmap (&rtp);
+  gst_check_drop_buffers ();
+
+  gst_pad_set_active (sink, FALSE);
+  gst_pad_set_active (src, FALSE);
+  fail_unless (gst_element_set_state (rtpmux,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_check_teardown_pad_by_name (rtpmux, "src");
+  gst_object_unref (reqpad);
+  gst_check_teardown_pad_by_name (rtpmux, "sink_1");
+  gst_element_release_request_pad (rtpmux, reqpad);
+  gst_check_teardown_element (rtpmux);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtpmux_suite (void)
 {
@@ -300,6 +403,7 @@ rtpmux_suite (void)
 
   tc_chain = tcase_create ("rtpmux_basic");
   tcase_add_test (tc_chain, test_rtpmux_basic);
+  tcase_add_test (tc_chain, test_rtpmux_list);
   suite_add_tcase (s, tc_chain);
 
   tc_chain = tcase_create ("rtpdtmfmux_basic");
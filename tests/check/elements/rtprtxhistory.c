@@ -0,0 +1,268 @@
+/* GStreamer
+ *
+ * unit test and microbenchmark for the rtprtxsend packet history
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "rtprtxhistory.h"
+
+static GstBuffer *
+push_packet (RTPRtxHistory * history, guint16 seqnum, guint32 rtptime)
+{
+  GstBuffer *buffer = gst_buffer_new ();
+
+  rtp_rtx_history_push (history, seqnum, rtptime, buffer);
+
+  return buffer;
+}
+
+GST_START_TEST (test_history_lookup)
+{
+  RTPRtxHistory *history;
+  GstBuffer *b[200];
+  guint i;
+
+  history = rtp_rtx_history_new ();
+  fail_unless (rtp_rtx_history_lookup (history, 0) == NULL);
+
+  /* wrap around the seqnum space and grow the ring */
+  for (i = 0; i < 200; i++)
+    b[i] = push_packet (history, 65500 + i, i * 10);
+  fail_unless_equals_int (rtp_rtx_history_length (history), 200);
+  fail_unless_equals_int (rtp_rtx_history_get_rtptime_span (history), 1990);
+
+  for (i = 0; i < 200; i++)
+    fail_unless (rtp_rtx_history_lookup (history, 65500 + i) == b[i]);
+  fail_unless (rtp_rtx_history_lookup (history, 65499) == NULL);
+  fail_unless (rtp_rtx_history_lookup (history, 164) == NULL);
+
+  /* remove the oldest */
+  rtp_rtx_history_pop (history);
+  fail_unless (rtp_rtx_history_lookup (history, 65500) == NULL);
+  fail_unless (rtp_rtx_history_lookup (history, 65501) == b[1]);
+  fail_unless_equals_int (rtp_rtx_history_length (history), 199);
+
+  /* a little older than the oldest packet is dropped */
+  push_packet (history, 65450, 0);
+  fail_unless (rtp_rtx_history_lookup (history, 65450) == NULL);
+  fail_unless_equals_int (rtp_rtx_history_length (history), 199);
+
+  /* a packet with the same seqnum replaces the old one */
+  b[2] = push_packet (history, 65502, 20);
+  fail_unless (rtp_rtx_history_lookup (history, 65502) == b[2]);
+  fail_unless_equals_int (rtp_rtx_history_length (history), 199);
+
+  rtp_rtx_history_clear (history);
+  fail_unless_equals_int (rtp_rtx_history_length (history), 0);
+  fail_unless (rtp_rtx_history_lookup (history, 65502) == NULL);
+
+  rtp_rtx_history_free (history);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_history_gaps)
+{
+  RTPRtxHistory *history;
+  GstBuffer *b1, *b2, *b3;
+
+  history = rtp_rtx_history_new ();
+
+  b1 = push_packet (history, 100, 1000);
+  b2 = push_packet (history, 105, 2000);
+  fail_unless (rtp_rtx_history_lookup (history, 102) == NULL);
+  fail_unless_equals_int (rtp_rtx_history_length (history), 2);
+
+  /* fill a gap */
+  b3 = push_packet (history, 102, 1500);
+  fail_unless (rtp_rtx_history_lookup (history, 102) == b3);
+  fail_unless_equals_int (rtp_rtx_history_get_rtptime_span (history), 1000);
+
+  /* popping skips the empty slots */
+  rtp_rtx_history_pop (history);
+  fail_unless (rtp_rtx_history_lookup (history, 100) == NULL);
+  rtp_rtx_history_pop (history);
+  fail_unless (rtp_rtx_history_lookup (history, 102) == NULL);
+  fail_unless (rtp_rtx_history_lookup (history, 105) == b2);
+  fail_unless_equals_int (rtp_rtx_history_get_rtptime_span (history), 0);
+
+  /* a jump of more than half the seqnum space restarts the history */
+  b1 = push_packet (history, 105 + 40000, 3000);
+  fail_unless_equals_int (rtp_rtx_history_length (history), 1);
+  fail_unless (rtp_rtx_history_lookup (history, 105) == NULL);
+  fail_unless (rtp_rtx_history_lookup (history, 105 + 40000) == b1);
+
+  rtp_rtx_history_free (history);
+}
+
+GST_END_TEST;
+
+/* Microbenchmark, compares the history against a GSequence, like rtprtxsend
+ * used to do. Packets are stored and the oldest removed to keep the history
+ * at a fixed size, every 100 packets there is a burst of NACKs for the
+ * packets of the last 50 ms. By default only a short run checks that both
+ * find the same packets, set GST_RTPRTXHISTORY_BENCH to measure. */
+#define BENCH_PACKETS 200000
+#define BENCH_PACKETS_SMOKE 2000
+#define BENCH_BURST_INTERVAL 100
+#define BENCH_BURST_SIZE 40
+
+typedef struct
+{
+  guint16 seqnum;
+  guint32 timestamp;
+  GstBuffer *buffer;
+} BenchItem;
+
+static void
+bench_item_free (BenchItem * item)
+{
+  gst_buffer_unref (item->buffer);
+  g_slice_free (BenchItem, item);
+}
+
+static gint
+bench_item_cmp (BenchItem * a, BenchItem * b, gpointer user_data)
+{
+  return gst_rtp_buffer_compare_seqnum (b->seqnum, a->seqnum);
+}
+
+static GstClockTime
+bench_sequence (GstBuffer * buffer, guint n_packets, guint history_size,
+    guint * found)
+{
+  GSequence *queue;
+  GstClockTime start;
+  guint i, j;
+
+  queue = g_sequence_new ((GDestroyNotify) bench_item_free);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < n_packets; i++) {
+    BenchItem *item;
+
+    item = g_slice_new0 (BenchItem);
+    item->seqnum = i;
+    item->timestamp = i * 90;
+    item->buffer = gst_buffer_ref (buffer);
+    g_sequence_append (queue, item);
+
+    while (g_sequence_get_length (queue) > history_size)
+      g_sequence_remove (g_sequence_get_begin_iter (queue));
+
+    if (i % BENCH_BURST_INTERVAL == 0) {
+      for (j = 0; j < BENCH_BURST_SIZE; j++) {
+        BenchItem search_item;
+
+        search_item.seqnum = i - j * 2;
+        if (g_sequence_lookup (queue, &search_item,
+                (GCompareDataFunc) bench_item_cmp, NULL))
+          (*found)++;
+      }
+    }
+  }
+  start = gst_util_get_timestamp () - start;
+
+  g_sequence_free (queue);
+
+  return start;
+}
+
+static GstClockTime
+bench_history (GstBuffer * buffer, guint n_packets, guint history_size,
+    guint * found)
+{
+  RTPRtxHistory *history;
+  GstClockTime start;
+  guint i, j;
+
+  history = rtp_rtx_history_new ();
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < n_packets; i++) {
+    rtp_rtx_history_push (history, i, i * 90, gst_buffer_ref (buffer));
+
+    while (rtp_rtx_history_length (history) > history_size)
+      rtp_rtx_history_pop (history);
+
+    if (i % BENCH_BURST_INTERVAL == 0) {
+      for (j = 0; j < BENCH_BURST_SIZE; j++) {
+        if (rtp_rtx_history_lookup (history, i - j * 2))
+          (*found)++;
+      }
+    }
+  }
+  start = gst_util_get_timestamp () - start;
+
+  rtp_rtx_history_free (history);
+
+  return start;
+}
+
+GST_START_TEST (test_history_bench)
+{
+  static const guint sizes[] = { 100, 1000, 10000 };
+  GstBuffer *buffer;
+  guint n_packets;
+  guint i;
+
+  if (g_getenv ("GST_RTPRTXHISTORY_BENCH"))
+    n_packets = BENCH_PACKETS;
+  else
+    n_packets = BENCH_PACKETS_SMOKE;
+
+  buffer = gst_buffer_new ();
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    GstClockTime seq_time, history_time;
+    guint seq_found = 0, history_found = 0;
+
+    seq_time = bench_sequence (buffer, n_packets, sizes[i], &seq_found);
+    history_time = bench_history (buffer, n_packets, sizes[i],
+        &history_found);
+
+    /* both find the same packets */
+    fail_unless_equals_int (seq_found, history_found);
+
+    GST_INFO ("%5u packets: sequence %" G_GUINT64_FORMAT " ns/packet, "
+        "history %" G_GUINT64_FORMAT " ns/packet", sizes[i],
+        seq_time / n_packets, history_time / n_packets);
+  }
+
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtprtxhistory_suite (void)
+{
+  Suite *s = suite_create ("rtprtxhistory");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_history_lookup);
+  tcase_add_test (tc_chain, test_history_gaps);
+  tcase_add_test (tc_chain, test_history_bench);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtprtxhistory);
@@ -27,6 +27,8 @@
 #include <gst/rtp/gstrtpbuffer.h>
 #include <gst/rtp/gstrtcpbuffer.h>
 
+#include "rtppacketmeta.h"
+
 static const guint payload_size = 160;
 static const guint clock_rate = 8000;
 static const guint payload_type = 0;
@@ -404,6 +406,188 @@ GST_START_TEST (test_multiple_senders_roundrobin_rbs)
 
 GST_END_TEST;
 
+#define N_BATCH_SENDERS 100
+
+/* With more sources than the session handles per lock hold, verify that one
+ * RTCP timeout still makes a complete compound packet for every sender */
+GST_START_TEST (test_batched_rtcp_generation)
+{
+  TestData data;
+  GstFlowReturn res;
+  GstClockID id, tid;
+  GstBuffer *buf;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket rtcp_packet;
+  GstClockTime time;
+  GHashTable *sr_ssrcs;
+  guint32 ssrc, rb_ssrc;
+  gint i, j;
+
+  setup_testharness (&data, TRUE);
+
+  /* only the RTCP thread waits on the clock */
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+
+  for (i = 0; i < 5; i++) {
+    gst_test_clock_advance_time (GST_TEST_CLOCK (data.clock),
+        200 * GST_MSECOND);
+
+    for (j = 0; j < N_BATCH_SENDERS; j++) {
+      buf = generate_test_buffer (i * 200 * GST_MSECOND, FALSE, i, i * 200,
+          10000 + j);
+      res = gst_pad_push (data.src, buf);
+      fail_unless (res == GST_FLOW_OK || res == GST_FLOW_FLUSHING);
+    }
+  }
+
+  do {
+    /* crank the RTCP pad thread until it outputs a round of packets */
+    time = gst_clock_id_get_time (id);
+    gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), time);
+    tid = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (data.clock));
+    fail_unless_equals_pointer (tid, id);
+    gst_clock_id_unref (id);
+    gst_clock_id_unref (tid);
+
+    gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock),
+        &id);
+  } while (g_async_queue_length (data.rtcp_queue) == 0);
+  gst_clock_id_unref (id);
+
+  fail_unless_equals_int (g_async_queue_length (data.rtcp_queue),
+      N_BATCH_SENDERS);
+
+  sr_ssrcs = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (i = 0; i < N_BATCH_SENDERS; i++) {
+    buf = g_async_queue_pop (data.rtcp_queue);
+    g_assert (gst_rtcp_buffer_validate (buf));
+
+    gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp);
+
+    /* SR of one of the senders, reporting on as many others as fit */
+    g_assert (gst_rtcp_buffer_get_first_packet (&rtcp, &rtcp_packet));
+    g_assert_cmpint (gst_rtcp_packet_get_type (&rtcp_packet), ==,
+        GST_RTCP_TYPE_SR);
+    gst_rtcp_packet_sr_get_sender_info (&rtcp_packet, &ssrc, NULL, NULL, NULL,
+        NULL);
+    g_assert_cmpint (ssrc, >=, 10000);
+    g_assert_cmpint (ssrc, <, 10000 + N_BATCH_SENDERS);
+    g_assert (!g_hash_table_contains (sr_ssrcs, GUINT_TO_POINTER (ssrc)));
+    g_hash_table_add (sr_ssrcs, GUINT_TO_POINTER (ssrc));
+
+    g_assert_cmpint (gst_rtcp_packet_get_rb_count (&rtcp_packet), ==,
+        GST_RTCP_MAX_RB_COUNT);
+    for (j = 0; j < GST_RTCP_MAX_RB_COUNT; j++) {
+      gst_rtcp_packet_get_rb (&rtcp_packet, j, &rb_ssrc, NULL, NULL,
+          NULL, NULL, NULL, NULL);
+      g_assert_cmpint (rb_ssrc, >=, 10000);
+      g_assert_cmpint (rb_ssrc, <, 10000 + N_BATCH_SENDERS);
+      g_assert_cmpint (rb_ssrc, !=, ssrc);
+    }
+
+    /* followed by the SDES of the same sender */
+    g_assert (gst_rtcp_packet_move_to_next (&rtcp_packet));
+    g_assert_cmpint (gst_rtcp_packet_get_type (&rtcp_packet), ==,
+        GST_RTCP_TYPE_SDES);
+    g_assert_cmpint (gst_rtcp_packet_sdes_get_item_count (&rtcp_packet), ==,
+        1);
+    g_assert (gst_rtcp_packet_sdes_first_item (&rtcp_packet));
+    g_assert_cmpint (gst_rtcp_packet_sdes_get_ssrc (&rtcp_packet), ==, ssrc);
+
+    gst_rtcp_buffer_unmap (&rtcp);
+    gst_buffer_unref (buf);
+  }
+
+  g_assert_cmpint (g_hash_table_size (sr_ssrcs), ==, N_BATCH_SENDERS);
+  g_hash_table_unref (sr_ssrcs);
+
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
+static GstFlowReturn
+test_rtp_chain_cb (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GList **received = gst_pad_get_element_private (pad);
+
+  *received = g_list_append (*received, buffer);
+
+  return GST_FLOW_OK;
+}
+
+static RTPPacketMeta *
+find_packet_meta (GstBuffer * buffer)
+{
+  gpointer state = NULL;
+  GstMeta *meta;
+
+  /* the meta api is registered by the plugin */
+  while ((meta = gst_buffer_iterate_meta (buffer, &state))) {
+    if (g_str_equal (g_type_name (meta->info->api), "RTPPacketMetaAPI"))
+      return (RTPPacketMeta *) meta;
+  }
+  return NULL;
+}
+
+/* RTP header with the marker bit and a one word header extension followed by
+ * 4 bytes of payload */
+static const guint8 ext_packet[] = {
+  0x90, 0x80 | 8, 0x00, 0x00, 0x00, 0x00, 0x03, 0x20,
+  0x01, 0xba, 0xdb, 0xad,
+  0xbe, 0xde, 0x00, 0x01,
+  0x10, 0xaa, 0x00, 0x00,
+  0x01, 0x02, 0x03, 0x04
+};
+
+/* This verifies that the session attaches the parsed header of received
+ * packets for the elements after it */
+GST_START_TEST (test_receive_packet_meta)
+{
+  TestData data;
+  GList *received = NULL;
+  RTPPacketMeta *meta;
+  GstFlowReturn res;
+  guint i;
+
+  setup_testharness (&data, FALSE);
+
+  gst_pad_set_element_private (data.rtpsrc, &received);
+  gst_pad_set_chain_function (data.rtpsrc, test_rtp_chain_cb);
+  g_assert (gst_pad_set_active (data.rtpsrc, TRUE));
+
+  /* two packets to get the source out of probation */
+  for (i = 0; i < 2; i++) {
+    guint8 *packet = g_memdup (ext_packet, sizeof (ext_packet));
+
+    packet[3] = i;
+    res = gst_pad_push (data.src, gst_buffer_new_wrapped (packet,
+            sizeof (ext_packet)));
+    fail_unless_equals_int (res, GST_FLOW_OK);
+  }
+
+  fail_unless_equals_int (g_list_length (received), 2);
+  for (i = 0; i < 2; i++) {
+    meta = find_packet_meta (g_list_nth_data (received, i));
+    fail_unless (meta != NULL);
+    fail_unless_equals_int (meta->ssrc, 0x01BADBAD);
+    fail_unless_equals_int (meta->seqnum, i);
+    fail_unless_equals_int (meta->pt, 8);
+    fail_unless (meta->marker);
+    fail_unless_equals_int (meta->rtptime, 800);
+    fail_unless_equals_int (meta->ext_offset, 16);
+    fail_unless_equals_int (meta->ext_len, 4);
+    fail_unless_equals_int (meta->payload_offset, 20);
+    fail_unless_equals_int (meta->payload_len, 4);
+  }
+
+  g_list_free_full (received, (GDestroyNotify) gst_buffer_unref);
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
 static Suite *
 gstrtpsession_suite (void)
 {
@@ -413,6 +597,8 @@ gstrtpsession_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_multiple_ssrc_rr);
   tcase_add_test (tc_chain, test_multiple_senders_roundrobin_rbs);
+  tcase_add_test (tc_chain, test_batched_rtcp_generation);
+  tcase_add_test (tc_chain, test_receive_packet_meta);
 
   return s;
 }
@@ -0,0 +1,207 @@
+/* GStreamer
+ *
+ * unit test for rtpssrcdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp"));
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp"));
+
+/* what one src pad of the demuxer received */
+typedef struct
+{
+  guint32 ssrc;
+  GstPad *sinkpad;
+  GList *lists;
+} SsrcOutput;
+
+static GList *outputs;
+
+static GstFlowReturn
+output_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
+{
+  SsrcOutput *output = gst_pad_get_element_private (pad);
+
+  output->lists = g_list_append (output->lists, list);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+output_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstBufferList *list = gst_buffer_list_new ();
+
+  gst_buffer_list_add (list, buffer);
+  return output_chain_list (pad, parent, list);
+}
+
+static void
+new_ssrc_pad (GstElement * demux, guint ssrc, GstPad * pad, gpointer user_data)
+{
+  SsrcOutput *output = g_new0 (SsrcOutput, 1);
+
+  output->ssrc = ssrc;
+  output->sinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_element_private (output->sinkpad, output);
+  gst_pad_set_chain_function (output->sinkpad, output_chain);
+  gst_pad_set_chain_list_function (output->sinkpad, output_chain_list);
+  gst_pad_set_active (output->sinkpad, TRUE);
+  fail_unless_equals_int (gst_pad_link (pad, output->sinkpad),
+      GST_PAD_LINK_OK);
+
+  outputs = g_list_append (outputs, output);
+}
+
+static void
+free_output (SsrcOutput * output)
+{
+  gst_pad_set_active (output->sinkpad, FALSE);
+  gst_object_unref (output->sinkpad);
+  g_list_free_full (output->lists, (GDestroyNotify) gst_buffer_list_unref);
+  g_free (output);
+}
+
+static GstBuffer *
+create_rtp_buffer (guint32 ssrc, guint16 seqnum)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+
+  buf = gst_rtp_buffer_new_allocate (4, 0, 0);
+  gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_ssrc (&rtp, ssrc);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buf;
+}
+
+/* checks that @list holds the packets of @ssrc with the seqnums in
+ * @seqnums */
+static void
+check_list (GstBufferList * list, guint32 ssrc, const guint16 * seqnums,
+    guint n_seqnums)
+{
+  guint i;
+
+  fail_unless_equals_int (gst_buffer_list_length (list), n_seqnums);
+  for (i = 0; i < n_seqnums; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+    fail_unless (gst_rtp_buffer_map (gst_buffer_list_get (list, i),
+            GST_MAP_READ, &rtp));
+    fail_unless_equals_int (gst_rtp_buffer_get_ssrc (&rtp), ssrc);
+    fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtp), seqnums[i]);
+    gst_rtp_buffer_unmap (&rtp);
+  }
+}
+
+GST_START_TEST (test_ssrc_demux_buffer_list)
+{
+  static const guint32 ssrcs[] = { 0xaaaa, 0xbbbb, 0xaaaa, 0xcccc, 0xbbbb,
+    0xaaaa
+  };
+  static const guint16 seqnums_a[] = { 0, 2, 5, 6 };
+  static const guint16 seqnums_b[] = { 1, 4, 7 };
+  static const guint16 seqnums_c[] = { 3 };
+  GstElement *demux;
+  GstPad *srcpad;
+  GstBufferList *list;
+  GstSegment segment;
+  GstCaps *caps;
+  SsrcOutput *a, *b, *c;
+  guint i;
+
+  demux = gst_check_setup_element ("rtpssrcdemux");
+  g_signal_connect (demux, "new-ssrc-pad", G_CALLBACK (new_ssrc_pad), NULL);
+  srcpad = gst_check_setup_src_pad_by_name (demux, &srctemplate, "sink");
+  gst_pad_set_active (srcpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  caps = gst_caps_from_string ("application/x-rtp");
+  gst_pad_set_caps (srcpad, caps);
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  /* interleaved packets of three new SSRCs */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < G_N_ELEMENTS (ssrcs); i++)
+    gst_buffer_list_add (list, create_rtp_buffer (ssrcs[i], i));
+  fail_unless_equals_int (gst_pad_push_list (srcpad, list), GST_FLOW_OK);
+
+  /* a pad per SSRC, created in the order the SSRCs appear in the list */
+  fail_unless_equals_int (g_list_length (outputs), 3);
+  a = g_list_nth_data (outputs, 0);
+  b = g_list_nth_data (outputs, 1);
+  c = g_list_nth_data (outputs, 2);
+  fail_unless_equals_int (a->ssrc, 0xaaaa);
+  fail_unless_equals_int (b->ssrc, 0xbbbb);
+  fail_unless_equals_int (c->ssrc, 0xcccc);
+
+  /* packets of known SSRCs go to the existing pads */
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list, create_rtp_buffer (0xbbbb, 7));
+  gst_buffer_list_add (list, create_rtp_buffer (0xaaaa, 6));
+  fail_unless_equals_int (gst_pad_push_list (srcpad, list), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (outputs), 3);
+
+  /* each pad gets its packets as one sub-list per input list, in order */
+  fail_unless_equals_int (g_list_length (a->lists), 2);
+  check_list (a->lists->data, 0xaaaa, seqnums_a, 3);
+  check_list (a->lists->next->data, 0xaaaa, seqnums_a + 3, 1);
+  fail_unless_equals_int (g_list_length (b->lists), 2);
+  check_list (b->lists->data, 0xbbbb, seqnums_b, 2);
+  check_list (b->lists->next->data, 0xbbbb, seqnums_b + 2, 1);
+  fail_unless_equals_int (g_list_length (c->lists), 1);
+  check_list (c->lists->data, 0xcccc, seqnums_c, 1);
+
+  gst_element_set_state (demux, GST_STATE_NULL);
+  g_list_free_full (outputs, (GDestroyNotify) free_output);
+  outputs = NULL;
+  gst_check_teardown_src_pad (demux);
+  gst_check_teardown_element (demux);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtpssrcdemux_suite (void)
+{
+  Suite *s = suite_create ("rtpssrcdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_ssrc_demux_buffer_list);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpssrcdemux);
@@ -0,0 +1,269 @@
+/* GStreamer
+ *
+ * unit test and microbenchmark for the rtpjitterbuffer timer queue
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "rtptimerqueue.h"
+
+static RTPTimer *
+add_timer (RTPTimerQueue * queue, RTPTimerType type, guint16 seqnum,
+    GstClockTime timeout)
+{
+  RTPTimer *timer;
+
+  timer = rtp_timer_new ();
+  timer->type = type;
+  timer->seqnum = seqnum;
+  timer->timeout = timeout;
+  rtp_timer_queue_insert (queue, timer);
+
+  return timer;
+}
+
+GST_START_TEST (test_timer_queue_order)
+{
+  RTPTimerQueue *queue;
+  RTPTimer *timer;
+  GstClockTime last = 0;
+  guint16 last_seqnum = 0;
+  GRand *rand;
+  gint i;
+
+  queue = rtp_timer_queue_new ();
+  rand = g_rand_new_with_seed (42);
+
+  for (i = 0; i < 1000; i++)
+    add_timer (queue, RTP_TIMER_LOST, i, g_rand_int_range (rand, 0, 100));
+  add_timer (queue, RTP_TIMER_DEADLINE, 2000, -1);
+  add_timer (queue, RTP_TIMER_EXPECTED, 3000, 0);
+  fail_unless_equals_int (rtp_timer_queue_length (queue), 1002);
+
+  /* expected timers are kept apart */
+  timer = rtp_timer_queue_peek_expected (queue);
+  fail_unless (timer != NULL);
+  fail_unless_equals_int (timer->seqnum, 3000);
+  rtp_timer_queue_remove (queue, timer);
+  fail_unless (rtp_timer_queue_peek_expected (queue) == NULL);
+
+  /* immediate timers go first */
+  timer = rtp_timer_queue_peek_output (queue);
+  fail_unless_equals_int (timer->seqnum, 2000);
+  rtp_timer_queue_remove (queue, timer);
+
+  /* then by timeout and by seqnum for the same timeout */
+  for (i = 0; i < 1000; i++) {
+    timer = rtp_timer_queue_peek_output (queue);
+    fail_unless (timer != NULL);
+    fail_unless (timer->timeout >= last);
+    if (i > 0 && timer->timeout == last)
+      fail_unless (gst_rtp_buffer_compare_seqnum (last_seqnum,
+              timer->seqnum) > 0);
+    last = timer->timeout;
+    last_seqnum = timer->seqnum;
+    rtp_timer_queue_remove (queue, timer);
+  }
+  fail_unless (rtp_timer_queue_peek_output (queue) == NULL);
+  fail_unless_equals_int (rtp_timer_queue_length (queue), 0);
+
+  g_rand_free (rand);
+  rtp_timer_queue_free (queue);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_timer_queue_update)
+{
+  RTPTimerQueue *queue;
+  RTPTimer *t1, *t2, *t3;
+
+  queue = rtp_timer_queue_new ();
+
+  t1 = add_timer (queue, RTP_TIMER_EXPECTED, 10, 100);
+  t2 = add_timer (queue, RTP_TIMER_EXPECTED, 11, 200);
+  t3 = add_timer (queue, RTP_TIMER_DEADLINE, 11, 50);
+
+  fail_unless (rtp_timer_queue_find (queue, RTP_TIMER_EXPECTED, 10) == t1);
+  fail_unless (rtp_timer_queue_find (queue, RTP_TIMER_EXPECTED, 11) == t2);
+  fail_unless (rtp_timer_queue_find (queue, RTP_TIMER_DEADLINE, 11) == t3);
+  fail_unless (rtp_timer_queue_find (queue, RTP_TIMER_LOST, 10) == NULL);
+  fail_unless (rtp_timer_queue_find_seqnum (queue, 12) == NULL);
+
+  /* the oldest expected timer is the reorder candidate */
+  fail_unless (rtp_timer_queue_peek_reorder (queue) == t1);
+  fail_unless (rtp_timer_queue_peek_expected (queue) == t1);
+
+  /* move t1 later and give it another seqnum */
+  t1->seqnum = 12;
+  t1->timeout = 300;
+  rtp_timer_queue_update (queue, t1);
+  fail_unless (rtp_timer_queue_find (queue, RTP_TIMER_EXPECTED, 10) == NULL);
+  fail_unless (rtp_timer_queue_find (queue, RTP_TIMER_EXPECTED, 12) == t1);
+  fail_unless (rtp_timer_queue_peek_expected (queue) == t2);
+  fail_unless (rtp_timer_queue_peek_reorder (queue) == t2);
+
+  /* an immediate timer is no reorder candidate and goes first */
+  t1->timeout = -1;
+  rtp_timer_queue_update (queue, t1);
+  fail_unless (rtp_timer_queue_peek_expected (queue) == t1);
+  fail_unless (rtp_timer_queue_peek_reorder (queue) == t2);
+
+  /* after a retransmission request t2 is no reorder candidate anymore */
+  t2->num_rtx_retry++;
+  rtp_timer_queue_update (queue, t2);
+  fail_unless (rtp_timer_queue_peek_reorder (queue) == NULL);
+
+  /* convert to a lost timer */
+  t2->type = RTP_TIMER_LOST;
+  t2->timeout = 10;
+  rtp_timer_queue_update (queue, t2);
+  fail_unless (rtp_timer_queue_peek_output (queue) == t2);
+  fail_unless (rtp_timer_queue_peek_expected (queue) == t1);
+  fail_unless (rtp_timer_queue_find (queue, RTP_TIMER_LOST, 11) == t2);
+
+  rtp_timer_queue_remove (queue, t2);
+  fail_unless (rtp_timer_queue_find_seqnum (queue, 11) == t3);
+  fail_unless (rtp_timer_queue_peek_output (queue) == t3);
+  fail_unless_equals_int (rtp_timer_queue_length (queue), 2);
+
+  rtp_timer_queue_clear (queue);
+  fail_unless_equals_int (rtp_timer_queue_length (queue), 0);
+  fail_unless (rtp_timer_queue_find_seqnum (queue, 11) == NULL);
+
+  rtp_timer_queue_free (queue);
+}
+
+GST_END_TEST;
+
+/* Microbenchmark, compares the timer queue against a linear scan over an
+ * array of timers, like the jitterbuffer used to do, for a growing number of
+ * pending timers. For each packet we find the timer of the seqnum,
+ * reschedule it and look up the next timeout. */
+#define BENCH_OPS 20000
+
+static GstClockTime
+bench_array (guint n_timers)
+{
+  GArray *timers;
+  GstClockTime start;
+  guint i, j, sum = 0;
+
+  timers = g_array_new (FALSE, TRUE, sizeof (RTPTimer));
+  g_array_set_size (timers, n_timers);
+  for (i = 0; i < n_timers; i++) {
+    RTPTimer *t = &g_array_index (timers, RTPTimer, i);
+    t->type = RTP_TIMER_LOST;
+    t->seqnum = i;
+    t->timeout = i * GST_MSECOND;
+  }
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < BENCH_OPS; i++) {
+    guint16 seqnum = (i * 7) % n_timers;
+    RTPTimer *timer = NULL, *best = NULL;
+
+    for (j = 0; j < n_timers; j++) {
+      RTPTimer *t = &g_array_index (timers, RTPTimer, j);
+      if (t->seqnum == seqnum && t->type == RTP_TIMER_LOST) {
+        timer = t;
+        break;
+      }
+    }
+    timer->timeout += n_timers * GST_MSECOND;
+
+    for (j = 0; j < n_timers; j++) {
+      RTPTimer *t = &g_array_index (timers, RTPTimer, j);
+      if (best == NULL || t->timeout < best->timeout)
+        best = t;
+    }
+    sum += best->seqnum;
+  }
+  start = gst_util_get_timestamp () - start;
+
+  g_array_free (timers, TRUE);
+  GST_LOG ("sum %u", sum);
+
+  return start;
+}
+
+static GstClockTime
+bench_queue (guint n_timers)
+{
+  RTPTimerQueue *queue;
+  GstClockTime start;
+  guint i, sum = 0;
+
+  queue = rtp_timer_queue_new ();
+  for (i = 0; i < n_timers; i++)
+    add_timer (queue, RTP_TIMER_LOST, i, i * GST_MSECOND);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < BENCH_OPS; i++) {
+    guint16 seqnum = (i * 7) % n_timers;
+    RTPTimer *timer;
+
+    timer = rtp_timer_queue_find (queue, RTP_TIMER_LOST, seqnum);
+    timer->timeout += n_timers * GST_MSECOND;
+    rtp_timer_queue_update (queue, timer);
+
+    sum += rtp_timer_queue_peek_output (queue)->seqnum;
+  }
+  start = gst_util_get_timestamp () - start;
+
+  rtp_timer_queue_free (queue);
+  GST_LOG ("sum %u", sum);
+
+  return start;
+}
+
+GST_START_TEST (test_timer_queue_scaling)
+{
+  static const guint sizes[] = { 16, 128, 1024, 8192 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    GstClockTime array_time, queue_time;
+
+    array_time = bench_array (sizes[i]);
+    queue_time = bench_queue (sizes[i]);
+
+    GST_INFO ("%5u timers: array %" G_GUINT64_FORMAT " ns/op, queue %"
+        G_GUINT64_FORMAT " ns/op", sizes[i], array_time / BENCH_OPS,
+        queue_time / BENCH_OPS);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+rtptimerqueue_suite (void)
+{
+  Suite *s = suite_create ("rtptimerqueue");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_timer_queue_order);
+  tcase_add_test (tc_chain, test_timer_queue_update);
+  tcase_add_test (tc_chain, test_timer_queue_scaling);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtptimerqueue);
@@ -0,0 +1,229 @@
+/* GStreamer
+ *
+ * unit test for the interleaved data reader of rtspsrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "gstrtspinterleaved.h"
+
+/* how long to wait for data that will not come, in microseconds */
+#define SHORT_TIMEOUT (10 * 1000)
+
+static GSocket *server, *client;
+static GstRTSPInterleavedReader reader;
+
+static void
+setup_sockets (void)
+{
+  gint fds[2];
+
+  fail_unless (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  server = g_socket_new_from_fd (fds[0], NULL);
+  client = g_socket_new_from_fd (fds[1], NULL);
+  fail_unless (server != NULL && client != NULL);
+  gst_rtsp_interleaved_reader_init (&reader);
+}
+
+static void
+teardown_sockets (void)
+{
+  gst_rtsp_interleaved_reader_clear (&reader);
+  g_object_unref (server);
+  g_object_unref (client);
+}
+
+/* makes a frame on @channel with @size payload bytes of value @channel */
+static guint8 *
+make_frame (guint8 channel, guint16 size)
+{
+  guint8 *frame = g_malloc (4 + size);
+
+  frame[0] = '$';
+  frame[1] = channel;
+  GST_WRITE_UINT16_BE (frame + 2, size);
+  memset (frame + 4, channel, size);
+
+  return frame;
+}
+
+static void
+send_data (const guint8 * data, gsize size)
+{
+  fail_unless_equals_int (g_socket_send (server, (const gchar *) data, size,
+          NULL, NULL), size);
+}
+
+static GstRTSPResult
+read_frames (gint64 timeout, GstBuffer ** frames)
+{
+  gboolean is_data;
+  GstRTSPResult res;
+
+  res = gst_rtsp_interleaved_reader_read (&reader, client, timeout, NULL,
+      &is_data, frames);
+  fail_unless (is_data);
+
+  return res;
+}
+
+/* checks that @buffer holds exactly @size bytes of @data */
+static void
+check_frames (GstBuffer * buffer, const guint8 * data, gsize size)
+{
+  fail_unless (buffer != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), size);
+  fail_unless (gst_buffer_memcmp (buffer, 0, data, size) == 0);
+  gst_buffer_unref (buffer);
+}
+
+GST_START_TEST (test_interleaved_coalesced)
+{
+  guint8 *frames[3], data[3 * 104];
+  GstBuffer *buffer;
+  guint i;
+
+  setup_sockets ();
+
+  /* three frames in one write come out in one read */
+  for (i = 0; i < 3; i++) {
+    frames[i] = make_frame (i, 100);
+    memcpy (data + i * 104, frames[i], 104);
+    g_free (frames[i]);
+  }
+  send_data (data, sizeof (data));
+
+  fail_unless_equals_int (read_frames (-1, &buffer), GST_RTSP_OK);
+  check_frames (buffer, data, sizeof (data));
+
+  /* nothing is left */
+  fail_unless_equals_int (read_frames (SHORT_TIMEOUT, &buffer),
+      GST_RTSP_ETIMEOUT);
+  fail_unless (buffer == NULL);
+
+  teardown_sockets ();
+}
+
+GST_END_TEST;
+
+/* reads @size bytes from the client socket, like the connection would, and
+ * checks that they are @data */
+static void
+check_left (const guint8 * data, gsize size)
+{
+  gchar *left = g_malloc (size);
+
+  fail_unless_equals_int (g_socket_receive (client, left, size, NULL, NULL),
+      size);
+  fail_unless (memcmp (left, data, size) == 0);
+  g_free (left);
+}
+
+GST_START_TEST (test_interleaved_split)
+{
+  guint8 *first, *second;
+  GstBuffer *buffer;
+  gboolean is_data;
+
+  setup_sockets ();
+
+  first = make_frame (0, 100);
+  second = make_frame (1, 50);
+
+  /* a complete frame and the start of the next one: only the complete frame
+   * is taken from the socket */
+  send_data (first, 104);
+  send_data (second, 30);
+  fail_unless_equals_int (read_frames (-1, &buffer), GST_RTSP_OK);
+  check_frames (buffer, first, 104);
+
+  /* the partial frame is left for the connection, which waits for the rest
+   * of it */
+  fail_unless_equals_int (gst_rtsp_interleaved_reader_read (&reader, client,
+          -1, NULL, &is_data, &buffer), GST_RTSP_OK);
+  fail_if (is_data);
+  fail_unless (buffer == NULL);
+  send_data (second + 30, 54 - 30);
+  check_left (second, 54);
+
+  /* a frame split in its header is left as well */
+  send_data (first, 2);
+  fail_unless_equals_int (gst_rtsp_interleaved_reader_read (&reader, client,
+          -1, NULL, &is_data, &buffer), GST_RTSP_OK);
+  fail_if (is_data);
+  send_data (first + 2, 102);
+  fail_unless_equals_int (read_frames (SHORT_TIMEOUT, &buffer), GST_RTSP_OK);
+  check_frames (buffer, first, 104);
+
+  g_free (first);
+  g_free (second);
+
+  teardown_sockets ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_interleaved_message)
+{
+  static const gchar response[] = "RTSP/1.0 200 OK\r\nCSeq: 1\r\n\r\n";
+  guint8 *frame;
+  GstBuffer *buffer;
+  gboolean is_data;
+
+  setup_sockets ();
+
+  /* a complete frame followed by a response: only the frame is read */
+  frame = make_frame (0, 20);
+  send_data (frame, 24);
+  send_data ((const guint8 *) response, sizeof (response) - 1);
+  fail_unless_equals_int (read_frames (-1, &buffer), GST_RTSP_OK);
+  check_frames (buffer, frame, 24);
+
+  /* the response is left on the socket for the connection */
+  fail_unless_equals_int (gst_rtsp_interleaved_reader_read (&reader, client,
+          -1, NULL, &is_data, &buffer), GST_RTSP_OK);
+  fail_if (is_data);
+  fail_unless (buffer == NULL);
+  check_left ((const guint8 *) response, sizeof (response) - 1);
+
+  g_free (frame);
+
+  teardown_sockets ();
+}
+
+GST_END_TEST;
+
+static Suite *
+rtspinterleaved_suite (void)
+{
+  Suite *s = suite_create ("rtspinterleaved");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_interleaved_coalesced);
+  tcase_add_test (tc_chain, test_interleaved_split);
+  tcase_add_test (tc_chain, test_interleaved_message);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtspinterleaved);
@@ -19,7 +19,9 @@
  */
 #include <gst/check/gstcheck.h>
 #include <gst/base/gstbasesink.h>
+#include <gio/gio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #if 0
@@ -185,6 +187,116 @@ GST_START_TEST (test_udpsink_bufferlist)
 GST_END_TEST;
 #endif
 
+static GstStaticPadTemplate list_srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define N_LIST_CLIENTS 2
+#define N_LIST_BUFFERS 5
+
+static GSocket *
+create_receiver (gint * port)
+{
+  GSocket *socket;
+  GInetAddress *ia;
+  GSocketAddress *sa;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (socket != NULL);
+
+  ia = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  sa = g_inet_socket_address_new (ia, 0);
+  fail_unless (g_socket_bind (socket, sa, TRUE, NULL));
+  g_object_unref (sa);
+  g_object_unref (ia);
+
+  sa = g_socket_get_local_address (socket, NULL);
+  *port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (sa));
+  g_object_unref (sa);
+
+  g_socket_set_timeout (socket, 5);
+
+  return socket;
+}
+
+GST_START_TEST (test_multiudpsink_render_list)
+{
+  GstElement *sink;
+  GstPad *srcpad;
+  GstBufferList *list;
+  GstSegment segment;
+  GSocket *receivers[N_LIST_CLIENTS];
+  GString *clients;
+  guint i, j;
+
+  clients = g_string_new ("");
+  for (i = 0; i < N_LIST_CLIENTS; i++) {
+    gint port;
+
+    receivers[i] = create_receiver (&port);
+    g_string_append_printf (clients, "%s127.0.0.1:%d", i ? "," : "", port);
+  }
+
+  sink = gst_check_setup_element ("multiudpsink");
+  g_object_set (sink, "clients", clients->str, "sync", FALSE, "async", FALSE,
+      NULL);
+  g_string_free (clients, TRUE);
+
+  srcpad = gst_check_setup_src_pad_by_name (sink, &list_srctemplate, "sink");
+  gst_pad_set_active (srcpad, TRUE);
+
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  /* packets made of two memory blocks, like RTP header and payload */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < N_LIST_BUFFERS; i++) {
+    GstBuffer *buf = gst_buffer_new ();
+    guint8 *header = g_malloc (4);
+
+    memcpy (header, "hdr", 3);
+    header[3] = '0' + i;
+    gst_buffer_append_memory (buf,
+        gst_memory_new_wrapped (0, header, 4, 0, 4, header, g_free));
+    gst_buffer_append_memory (buf,
+        gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, (gpointer) "data",
+            4, 0, 4, NULL, NULL));
+    gst_buffer_list_add (list, buf);
+  }
+
+  fail_unless_equals_int (gst_pad_push_list (srcpad, list), GST_FLOW_OK);
+
+  /* every client gets every packet, in order */
+  for (i = 0; i < N_LIST_CLIENTS; i++) {
+    for (j = 0; j < N_LIST_BUFFERS; j++) {
+      gchar data[16];
+      gssize len;
+
+      len = g_socket_receive (receivers[i], data, sizeof (data), NULL, NULL);
+      fail_unless_equals_int (len, 8);
+      fail_unless (memcmp (data, "hdr", 3) == 0);
+      fail_unless_equals_int (data[3], '0' + j);
+      fail_unless (memcmp (data + 4, "data", 4) == 0);
+    }
+  }
+
+  gst_element_set_state (sink, GST_STATE_NULL);
+  gst_check_teardown_src_pad (sink);
+  gst_check_teardown_element (sink);
+
+  for (i = 0; i < N_LIST_CLIENTS; i++)
+    g_object_unref (receivers[i]);
+}
+
+GST_END_TEST;
+
 /*
  * Creates the test suite.
  *
@@ -201,6 +313,7 @@ udpsink_suite (void)
   tcase_set_timeout (tc_chain, 60);
 
   suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_multiudpsink_render_list);
 #if 0
   tcase_add_test (tc_chain, test_udpsink);
   tcase_add_test (tc_chain, test_udpsink_bufferlist);
@@ -20,6 +20,7 @@
 #include <gio/gio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -109,6 +110,81 @@ GST_START_TEST (test_udpsrc_empty_packet)
 
 GST_END_TEST;
 
+GST_START_TEST (test_udpsrc_batch)
+{
+  GstElement *udpsrc;
+  GSocket *socket;
+  GSocketAddress *sa;
+  GInetAddress *ia;
+  GstPad *sinkpad;
+  int port = 0;
+  guint i;
+
+  udpsrc = gst_check_setup_element ("udpsrc");
+  fail_unless (udpsrc != NULL);
+  g_object_set (udpsrc, "port", 0, "batch-size", 4,
+      "batch-max-wait", 10 * GST_MSECOND, NULL);
+
+  sinkpad = gst_check_setup_sink_pad_by_name (udpsrc, &sinktemplate, "src");
+  fail_unless (sinkpad != NULL);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  gst_element_set_state (udpsrc, GST_STATE_PLAYING);
+  g_object_get (udpsrc, "port", &port, NULL);
+  GST_INFO ("udpsrc port = %d", port);
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  if (socket == NULL) {
+    GST_WARNING ("Could not create IPv4 UDP socket for unit test");
+    goto done;
+  }
+
+  ia = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  sa = g_inet_socket_address_new (ia, port);
+
+  /* more datagrams than fit in one batch, all must come out in order */
+  for (i = 0; i < 10; i++) {
+    gchar data[4] = { 'p', 'k', 't', '0' + i };
+
+    fail_unless (g_socket_send_to (socket, sa, data, 4, NULL, NULL) == 4);
+  }
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 10)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  fail_unless_equals_int (g_list_length (buffers), 10);
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buf = GST_BUFFER (g_list_nth_data (buffers, i));
+    GstMapInfo map;
+    gsize maxsize;
+
+    /* a small datagram does not keep a whole receive slot alive */
+    gst_buffer_get_sizes (buf, NULL, &maxsize);
+    fail_unless (maxsize < 1024);
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, 4);
+    fail_unless (memcmp (map.data, "pkt", 3) == 0);
+    fail_unless_equals_int (map.data[3], '0' + i);
+    gst_buffer_unmap (buf, &map);
+  }
+
+  g_object_unref (sa);
+  g_object_unref (ia);
+  g_object_unref (socket);
+
+done:
+  gst_element_set_state (udpsrc, GST_STATE_NULL);
+
+  gst_check_teardown_pad_by_name (udpsrc, "src");
+  gst_check_teardown_element (udpsrc);
+}
+
+GST_END_TEST;
+
 static Suite *
 udpsrc_suite (void)
 {
@@ -117,6 +193,7 @@ udpsrc_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_udpsrc_empty_packet);
+  tcase_add_test (tc_chain, test_udpsrc_batch);
   return s;
 }
 